@@ -0,0 +1,103 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Cost of fullDeviceInfo per device, the part of bring-up that turns the
+ * lockdown dict into DeviceInfo.
+ *
+ * The fixtures in fixtures/lockdown are anonymized dumps of the root lockdown
+ * domain (what `ideviceinfo -x` prints), covering an old and a current
+ * iPhone and an iPad that reports its capacities as strings.
+ *
+ * Usage: device_info_benchmark [iterations] [lockdown.plist ...]
+ */
+
+#include "iDescriptor.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <plist/plist.h>
+
+#define DEFAULT_ITERATIONS 10000
+
+static plist_t loadLockdownDump(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+    const QByteArray xml = file.readAll();
+    plist_t info = nullptr;
+    plist_from_xml(xml.constData(), static_cast<uint32_t>(xml.size()), &info);
+    if (info && plist_get_node_type(info) != PLIST_DICT) {
+        plist_free(info);
+        return nullptr;
+    }
+    return info;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments().mid(1);
+    const int iterations =
+        args.isEmpty() ? DEFAULT_ITERATIONS : qMax(1, args.takeFirst().toInt());
+
+    QStringList dumps = args;
+    if (dumps.isEmpty()) {
+        QDir fixtures(LOCKDOWN_FIXTURE_DIR);
+        for (const QString &name :
+             fixtures.entryList({"*.plist"}, QDir::Files, QDir::Name)) {
+            dumps.append(fixtures.filePath(name));
+        }
+    }
+
+    QTextStream out(stdout);
+    out << iterations << " iterations per device\n";
+
+    for (const QString &path : dumps) {
+        plist_t info = loadLockdownDump(path);
+        if (!info) {
+            QTextStream(stderr) << "Could not load " << path << "\n";
+            return 1;
+        }
+
+        // One untimed call for the result shown below and to warm up
+        iDescriptorInitDeviceResult first;
+        const DeviceInfo parsed = fullDeviceInfo(info, first);
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < iterations; ++i) {
+            iDescriptorInitDeviceResult result;
+            fullDeviceInfo(info, result);
+        }
+        const double usPerCall = timer.nsecsElapsed() / 1000.0 / iterations;
+        plist_free(info);
+
+        out << QFileInfo(path).fileName() << ": "
+            << QString::number(usPerCall, 'f', 2) << " us per device ("
+            << QString::fromStdString(parsed.productType) << ", iOS "
+            << QString::fromStdString(parsed.productVersion) << ")\n";
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Export copy throughput against a local stand-in for an AFC file handle.
+ *
+ * Compares the old copy loop (8 KB reads, written on the reading thread)
+ * with copyThroughRing, the block ring the export uses. The stand-in reads a
+ * local file and can add a fixed delay to every read request to model the
+ * USB round trip of afc_file_read.
+ *
+ * Usage: export_copy_benchmark [size-MB] [read-latency-us] [block-count]
+ *                              [block-size-KB]
+ */
+
+#include "blockringbuffer.h"
+#include "ringcopy.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+
+// Buffer of the copy loop the export used before the block ring
+#define LEGACY_BUFFER_SIZE 8192
+// Defaults match EXPORT_BLOCK_COUNT and EXPORT_BLOCK_SIZE
+#define DEFAULT_BLOCK_COUNT 4
+#define DEFAULT_BLOCK_SIZE_KB 4096
+
+// Serves reads from a local file like afc_file_read serves them from the
+// device, every request pays the configured latency
+class LocalAfcStandIn
+{
+public:
+    LocalAfcStandIn(const QString &path, int latencyUs)
+        : m_file(path), m_latencyUs(latencyUs)
+    {
+        m_file.open(QIODevice::ReadOnly);
+    }
+
+    bool isOpen() const { return m_file.isOpen(); }
+
+    qint64 read(char *data, qint64 maxSize)
+    {
+        if (m_latencyUs > 0) {
+            QThread::usleep(m_latencyUs);
+        }
+        ++m_requests;
+        return m_file.read(data, maxSize);
+    }
+
+    quint64 requests() const { return m_requests; }
+
+private:
+    QFile m_file;
+    int m_latencyUs;
+    quint64 m_requests = 0;
+};
+
+static bool writeSource(const QString &path, qint64 size)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QByteArray chunk(1024 * 1024, Qt::Uninitialized);
+    for (qint64 written = 0; written < size; written += chunk.size()) {
+        QRandomGenerator::global()->fillRange(
+            reinterpret_cast<quint32 *>(chunk.data()),
+            chunk.size() / sizeof(quint32));
+        const qint64 length = qMin<qint64>(chunk.size(), size - written);
+        if (file.write(chunk.constData(), length) != length) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static qint64 copyLegacy(LocalAfcStandIn &source, QFile &output)
+{
+    char buffer[LEGACY_BUFFER_SIZE];
+    qint64 total = 0;
+    for (;;) {
+        qint64 bytesRead = source.read(buffer, sizeof(buffer));
+        if (bytesRead < 0) {
+            return -1;
+        }
+        if (bytesRead == 0) {
+            return total;
+        }
+        if (output.write(buffer, bytesRead) != bytesRead) {
+            return -1;
+        }
+        total += bytesRead;
+    }
+}
+
+static qint64 copyRing(LocalAfcStandIn &source, QFile &output,
+                       BlockRingBuffer &ring)
+{
+    std::atomic<bool> cancelled{false};
+    QString error;
+    qint64 total = copyThroughRing(
+        [&source](char *data, qint64 maxSize) {
+            return source.read(data, maxSize);
+        },
+        output, -1, ring, nullptr, cancelled, [](qint64) {}, error);
+    if (total < 0) {
+        QTextStream(stderr) << "Ring copy failed: " << error << "\n";
+    }
+    return total;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const QStringList args = app.arguments();
+    auto intArg = [&args](int index, int fallback) {
+        return args.size() > index ? args.at(index).toInt() : fallback;
+    };
+    const qint64 sizeMb = intArg(1, 512);
+    const int latencyUs = intArg(2, 0);
+    const int blockCount = intArg(3, DEFAULT_BLOCK_COUNT);
+    const int blockSizeKb = intArg(4, DEFAULT_BLOCK_SIZE_KB);
+
+    QTextStream out(stdout);
+    QTemporaryDir dir;
+    const QString sourcePath = dir.filePath("source.bin");
+    const QString outputPath = dir.filePath("output.bin");
+    if (!dir.isValid() || !writeSource(sourcePath, sizeMb * 1024 * 1024)) {
+        QTextStream(stderr) << "Could not create the source file\n";
+        return 1;
+    }
+
+    out << "Copying " << sizeMb << " MB, " << latencyUs
+        << " us per read request\n";
+
+    auto run = [&](const char *name,
+                   const std::function<qint64(LocalAfcStandIn &, QFile &)>
+                       &copy) {
+        LocalAfcStandIn source(sourcePath, latencyUs);
+        QFile output(outputPath);
+        if (!source.isOpen() || !output.open(QIODevice::WriteOnly)) {
+            QTextStream(stderr) << "Could not open the benchmark files\n";
+            return false;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        const qint64 copied = copy(source, output);
+        output.close();
+        const qint64 elapsedMs = qMax<qint64>(1, timer.elapsed());
+        if (copied != sizeMb * 1024 * 1024) {
+            QTextStream(stderr) << name << ": copied " << copied << " bytes\n";
+            return false;
+        }
+
+        out << qSetFieldWidth(24) << Qt::left << name << qSetFieldWidth(0)
+            << QString::number(copied / 1048576.0 / (elapsedMs / 1000.0), 'f',
+                               1)
+            << " MB/s, " << source.requests() << " read requests\n";
+        return true;
+    };
+
+    BlockRingBuffer ring(blockCount, blockSizeKb * 1024);
+    const QString ringName = QString("ring %1 x %2 KB")
+                                 .arg(blockCount)
+                                 .arg(blockSizeKb);
+    const bool ok =
+        run("legacy 8 KB", copyLegacy) &&
+        run(ringName.toUtf8().constData(),
+            [&ring](LocalAfcStandIn &source, QFile &output) {
+                return copyRing(source, output, ring);
+            });
+    return ok ? 0 : 1;
+}
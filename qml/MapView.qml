@@ -30,12 +30,57 @@ Rectangle {
         center: QtPositioning.coordinate(59.91, 10.75) // Oslo
         zoomLevel: 14
         property geoCoordinate startCentroid
+        // While set, clicks add route points instead of moving the center
+        property bool drawingRoute: false
         
         // Add a function to update center from C++
         function updateCenter(lat, lon) {
             center = QtPositioning.coordinate(lat, lon)
         }
         
+        // Replace the displayed route with a list of coordinates from C++
+        function setRoutePath(path) {
+            routeLine.path = []
+            for (var i = 0; i < path.length; ++i) {
+                routeLine.addCoordinate(path[i])
+            }
+        }
+        
+        // Move the playback marker without touching the map center
+        function updatePlaybackPosition(lat, lon) {
+            playbackMarker.coordinate = QtPositioning.coordinate(lat, lon)
+            playbackMarker.visible = true
+        }
+        
+        function clearPlaybackPosition() {
+            playbackMarker.visible = false
+        }
+        
+        // Route being played back or drawn
+        MapPolyline {
+            id: routeLine
+            line.width: 4
+            line.color: "#2196F3"
+        }
+        
+        // Last location sent during route playback
+        MapQuickItem {
+            id: playbackMarker
+            visible: false
+            anchorPoint.x: 9
+            anchorPoint.y: 9
+            z: 1
+            
+            sourceItem: Rectangle {
+                width: 18
+                height: 18
+                radius: 9
+                color: "#FF5722"
+                border.color: "white"
+                border.width: 2
+            }
+        }
+        
         // Add marker for current location
         MapQuickItem {
             id: marker
@@ -66,6 +111,12 @@ Rectangle {
             anchors.fill: parent
             onClicked: function(mouse) {
                 var coord = map.toCoordinate(Qt.point(mouse.x, mouse.y))
+                if (map.drawingRoute) {
+                    if (typeof cppHandler !== 'undefined') {
+                        cppHandler.addRoutePointFromMap(coord.latitude, coord.longitude)
+                    }
+                    return
+                }
                 map.center = coord
                 marker.coordinate = coord
                 console.log("Map clicked at:", coord.latitude, coord.longitude)
@@ -0,0 +1,210 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "afcclientpool.h"
+#include "iDescriptor.h"
+#include <QDebug>
+#include <algorithm>
+#include <libimobiledevice/lockdown.h>
+
+AfcClientLease::AfcClientLease(std::shared_ptr<AfcClientPool> pool,
+                               afc_client_t client)
+    : m_pool(std::move(pool)), m_client(client)
+{
+}
+
+AfcClientLease::~AfcClientLease() { release(); }
+
+AfcClientLease::AfcClientLease(AfcClientLease &&other) noexcept
+    : m_pool(std::move(other.m_pool)), m_client(other.m_client)
+{
+    other.m_client = nullptr;
+}
+
+AfcClientLease &AfcClientLease::operator=(AfcClientLease &&other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_pool = std::move(other.m_pool);
+        m_client = other.m_client;
+        other.m_client = nullptr;
+    }
+    return *this;
+}
+
+afc_error_t AfcClientLease::execute(
+    const std::function<afc_error_t(afc_client_t)> &operation) const
+{
+    if (!m_pool || !m_client) {
+        return AFC_E_INVALID_ARG;
+    }
+    return m_pool->execute(m_client, operation);
+}
+
+void AfcClientLease::release()
+{
+    if (m_pool && m_client) {
+        m_pool->release(m_client);
+    }
+    m_client = nullptr;
+    m_pool.reset();
+}
+
+AfcClientPool::AfcClientPool(idevice_t device, int maxClients)
+    : m_device(device), m_maxClients(std::max(1, maxClients))
+{
+}
+
+AfcClientPool::~AfcClientPool()
+{
+    // Every lease holds a reference to the pool, so nothing is leased here
+    for (afc_client_t client : m_idleClients) {
+        afc_client_free(client);
+    }
+    m_idleClients.clear();
+}
+
+AfcClientLease AfcClientPool::acquire() { return acquire(true); }
+
+AfcClientLease AfcClientPool::tryAcquire() { return acquire(false); }
+
+AfcClientLease AfcClientPool::acquire(bool wait)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            if (m_shutdown) {
+                return AfcClientLease();
+            }
+            if (!m_idleClients.empty()) {
+                afc_client_t client = m_idleClients.back();
+                m_idleClients.pop_back();
+                return AfcClientLease(shared_from_this(), client);
+            }
+            if (m_clientCount < m_maxClients) {
+                // Reserve the slot, the connection is made outside the lock
+                m_clientCount++;
+                break;
+            }
+            if (!wait) {
+                return AfcClientLease();
+            }
+            m_available.wait(lock);
+        }
+    }
+
+    afc_client_t client = createClient();
+    if (!client) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_clientCount--;
+        m_available.notify_one();
+        return AfcClientLease();
+    }
+    return AfcClientLease(shared_from_this(), client);
+}
+
+void AfcClientPool::release(afc_client_t client)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_shutdown) {
+        m_clientCount--;
+        afc_client_free(client);
+        return;
+    }
+    m_idleClients.push_back(client);
+    m_available.notify_one();
+}
+
+afc_error_t AfcClientPool::execute(
+    afc_client_t client,
+    const std::function<afc_error_t(afc_client_t)> &operation)
+{
+    std::shared_lock<std::shared_mutex> inFlight(m_inFlightMutex);
+    if (isShutdown()) {
+        return AFC_E_NO_DEVICE;
+    }
+    try {
+        return operation(client);
+    } catch (const std::exception &e) {
+        qDebug() << "Exception in AfcClientPool::execute:" << e.what();
+        return AFC_E_UNKNOWN_ERROR;
+    }
+}
+
+afc_client_t AfcClientPool::createClient()
+{
+    std::shared_lock<std::shared_mutex> inFlight(m_inFlightMutex);
+    if (isShutdown()) {
+        return nullptr;
+    }
+
+    lockdownd_client_t lockdownClient = nullptr;
+    lockdownd_service_descriptor_t service = nullptr;
+    afc_client_t client = nullptr;
+
+    if (lockdownd_client_new_with_handshake(m_device, &lockdownClient,
+                                            APP_LABEL) != LOCKDOWN_E_SUCCESS) {
+        qDebug() << "AfcClientPool: Could not connect to lockdownd";
+        return nullptr;
+    }
+
+    if (lockdownd_start_service(lockdownClient, "com.apple.afc", &service) !=
+        LOCKDOWN_E_SUCCESS) {
+        qDebug() << "AfcClientPool: Could not start AFC service";
+        lockdownd_client_free(lockdownClient);
+        return nullptr;
+    }
+
+    if (afc_client_new(m_device, service, &client) != AFC_E_SUCCESS) {
+        qDebug() << "AfcClientPool: Could not create AFC client";
+        client = nullptr;
+    }
+
+    lockdownd_service_descriptor_free(service);
+    lockdownd_client_free(lockdownClient);
+    return client;
+}
+
+void AfcClientPool::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_shutdown) {
+            return;
+        }
+        m_shutdown = true;
+    }
+    m_available.notify_all();
+
+    // Wait for every operation that is still talking to the device
+    std::unique_lock<std::shared_mutex> inFlight(m_inFlightMutex);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (afc_client_t client : m_idleClients) {
+        afc_client_free(client);
+        m_clientCount--;
+    }
+    m_idleClients.clear();
+}
+
+bool AfcClientPool::isShutdown() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_shutdown;
+}
@@ -0,0 +1,133 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef AFCCLIENTPOOL_H
+#define AFCCLIENTPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <libimobiledevice/afc.h>
+#include <libimobiledevice/libimobiledevice.h>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+#define AFC_POOL_DEFAULT_MAX_CLIENTS 4
+
+class AfcClientPool;
+
+/**
+ * @brief RAII handle for an AFC client leased from an AfcClientPool
+ *
+ * The leased client is exclusively owned by the holder until the lease is
+ * destroyed or released, so AFC file handles opened through it stay valid for
+ * the whole lifetime of the lease. Leases are move-only.
+ */
+class AfcClientLease
+{
+public:
+    AfcClientLease() = default;
+    ~AfcClientLease();
+
+    AfcClientLease(AfcClientLease &&other) noexcept;
+    AfcClientLease &operator=(AfcClientLease &&other) noexcept;
+    AfcClientLease(const AfcClientLease &) = delete;
+    AfcClientLease &operator=(const AfcClientLease &) = delete;
+
+    afc_client_t client() const { return m_client; }
+    std::shared_ptr<AfcClientPool> pool() const { return m_pool; }
+    bool isValid() const { return m_client != nullptr; }
+    explicit operator bool() const { return isValid(); }
+
+    /**
+     * @brief Run an AFC operation on the leased client
+     *
+     * Fails with AFC_E_NO_DEVICE once the owning pool has been shut down.
+     */
+    afc_error_t
+    execute(const std::function<afc_error_t(afc_client_t)> &operation) const;
+
+    // Return the client to the pool early
+    void release();
+
+private:
+    friend class AfcClientPool;
+    AfcClientLease(std::shared_ptr<AfcClientPool> pool, afc_client_t client);
+
+    std::shared_ptr<AfcClientPool> m_pool;
+    afc_client_t m_client = nullptr;
+};
+
+/**
+ * @brief Per-device pool of independent AFC connections
+ *
+ * Every client in the pool runs on its own com.apple.afc service connection,
+ * so operations on different leases do not contend on the device mutex and
+ * run in parallel on the device. Clients are created lazily up to maxClients.
+ *
+ * shutdown() is called when the device is removed: it wakes up blocked
+ * acquirers, waits for operations that are currently in flight and frees the
+ * idle clients. Clients that are still leased at that point are freed as soon
+ * as their lease is released, and every operation on them fails from then on.
+ */
+class AfcClientPool : public std::enable_shared_from_this<AfcClientPool>
+{
+public:
+    explicit AfcClientPool(idevice_t device,
+                           int maxClients = AFC_POOL_DEFAULT_MAX_CLIENTS);
+    ~AfcClientPool();
+
+    AfcClientPool(const AfcClientPool &) = delete;
+    AfcClientPool &operator=(const AfcClientPool &) = delete;
+
+    // Blocks until a client is available, returns an invalid lease on failure
+    AfcClientLease acquire();
+    // Returns an invalid lease right away if no client is available
+    AfcClientLease tryAcquire();
+
+    void shutdown();
+    bool isShutdown() const;
+
+    int maxClients() const { return m_maxClients; }
+
+private:
+    friend class AfcClientLease;
+
+    AfcClientLease acquire(bool wait);
+    void release(afc_client_t client);
+    afc_error_t
+    execute(afc_client_t client,
+            const std::function<afc_error_t(afc_client_t)> &operation);
+    afc_client_t createClient();
+
+    idevice_t m_device;
+    const int m_maxClients;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_available;
+    std::vector<afc_client_t> m_idleClients;
+    int m_clientCount = 0;
+    bool m_shutdown = false;
+
+    // Held shared by every in-flight operation, exclusively by shutdown()
+    std::shared_mutex m_inFlightMutex;
+};
+
+#endif // AFCCLIENTPOOL_H
@@ -18,12 +18,14 @@
  */
 
 #include "afcexplorerwidget.h"
+#include "directorycache.h"
 #include "exportmanager.h"
 #include "iDescriptor-ui.h"
 #include "iDescriptor.h"
 #include "mediapreviewdialog.h"
 #include "servicemanager.h"
 #include "settingsmanager.h"
+#include <QDateTime>
 #include <QDebug>
 #include <QDesktopServices>
 #include <QFileDialog>
@@ -31,6 +33,7 @@
 #include <QHeaderView>
 #include <QIcon>
 #include <QInputDialog>
+#include <QLocale>
 #include <QMenu>
 #include <QMessageBox>
 #include <QPushButton>
@@ -43,6 +46,7 @@
 #include <QTemporaryDir>
 #include <QTreeWidget>
 #include <QVariant>
+#include <QtConcurrent/QtConcurrent>
 #include <libimobiledevice/afc.h>
 #include <libimobiledevice/libimobiledevice.h>
 
@@ -201,24 +205,71 @@ void AfcExplorerWidget::updateAddressBar(const QString &path)
     m_addressBar->setText(path);
 }
 
+AfcExplorerWidget::~AfcExplorerWidget()
+{
+    cancelListing();
+    m_listingFuture.waitForFinished();
+}
+
 void AfcExplorerWidget::loadPath(const QString &path)
 {
     updateAddressBar(path);
     updateNavigationButtons();
 
-    AFCFileTree tree = ServiceManager::safeGetFileTree(
-        m_device, path.toStdString(), true, m_afc);
-
-    if (!tree.success) {
-        showErrorState();
-        return;
-    }
+    // A listing for the previous path may still be streaming in
+    cancelListing();
 
     // Clear the file list and show file list state
     m_fileList->clear();
     showFileListState();
 
-    for (const auto &entry : tree.entries) {
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    m_listingCancelled = cancelled;
+
+    // Entries are stat'ed in batches across pooled AFC clients and appended
+    // as they arrive, so large folders show their first page right away
+    iDescriptorDevice *device = m_device;
+    afc_client_t afc = m_afc;
+    m_listingFuture = QtConcurrent::run([this, device, afc, path,
+                                         cancelled]() {
+        bool success = ServiceManager::safeListDirectory(
+            device, path.toStdString(),
+            [this, cancelled](const std::vector<MediaEntry> &batch) {
+                QMetaObject::invokeMethod(
+                    this,
+                    [this, batch, cancelled]() {
+                        if (!cancelled->load()) {
+                            appendEntries(batch);
+                        }
+                    },
+                    Qt::QueuedConnection);
+            },
+            afc, cancelled.get());
+
+        if (!success && !cancelled->load()) {
+            QMetaObject::invokeMethod(
+                this,
+                [this, cancelled]() {
+                    if (!cancelled->load()) {
+                        showErrorState();
+                    }
+                },
+                Qt::QueuedConnection);
+        }
+    });
+}
+
+void AfcExplorerWidget::cancelListing()
+{
+    if (m_listingCancelled) {
+        m_listingCancelled->store(true);
+        m_listingCancelled.reset();
+    }
+}
+
+void AfcExplorerWidget::appendEntries(const std::vector<MediaEntry> &entries)
+{
+    for (const auto &entry : entries) {
         QListWidgetItem *item =
             new QListWidgetItem(QString::fromStdString(entry.name));
         item->setData(Qt::UserRole, entry.isDir);
@@ -238,6 +289,14 @@ void AfcExplorerWidget::loadPath(const QString &path)
             } else {
                 item->setIcon(fileIcon);
             }
+            // AFC reports times in nanoseconds
+            QDateTime modified = QDateTime::fromMSecsSinceEpoch(
+                static_cast<qint64>(entry.modificationTime / 1000000));
+            item->setToolTip(
+                QString("%1\nModified: %2")
+                    .arg(QLocale().formattedDataSize(
+                        static_cast<qint64>(entry.size)))
+                    .arg(QLocale().toString(modified, QLocale::ShortFormat)));
         }
         m_fileList->addItem(item);
     }
@@ -501,6 +560,13 @@ int AfcExplorerWidget::importFileToDevice(afc_client_t afc,
 
     ServiceManager::safeAfcFileClose(m_device, handle, m_afc);
     in.close();
+
+    // The size changed after the open, drop whatever was listed meanwhile
+    std::optional<afc_client_t> afc = m_afc;
+    if (ServiceManager::usesMediaDomain(m_device, afc)) {
+        DirectoryCache::sharedInstance()->invalidate(m_device->udid,
+                                                     device_path);
+    }
     return 0;
 }
 
@@ -772,6 +838,11 @@ void AfcExplorerWidget::onRetryClicked()
     if (!m_history.isEmpty()) {
         currentPath = m_history.top();
     }
+    // A retry must go to the device, not to a cached listing
+    if (m_device) {
+        DirectoryCache::sharedInstance()->invalidate(m_device->udid,
+                                                     currentPath.toStdString());
+    }
     loadPath(currentPath);
 }
 
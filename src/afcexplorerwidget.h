@@ -24,6 +24,7 @@
 #include "iDescriptor.h"
 #include <QAction>
 #include <QEvent>
+#include <QFuture>
 #include <QHBoxLayout>
 #include <QInputDialog>
 #include <QLabel>
@@ -38,7 +39,9 @@
 #include <QTreeWidget>
 #include <QVBoxLayout>
 #include <QWidget>
+#include <atomic>
 #include <libimobiledevice/afc.h>
+#include <memory>
 
 class ExportManager;
 class ExportProgressDialog;
@@ -51,6 +54,7 @@ public:
                                bool favEnabled = false,
                                afc_client_t afcClient = nullptr,
                                QString root = "/", QWidget *parent = nullptr);
+    ~AfcExplorerWidget();
     void navigateToPath(const QString &path);
     void goHome();
 signals:
@@ -98,8 +102,14 @@ private:
     ExportManager *m_exportManager;
     ExportProgressDialog *m_exportProgressDialog;
 
+    // Background directory listing, batches are appended as they arrive
+    QFuture<void> m_listingFuture;
+    std::shared_ptr<std::atomic<bool>> m_listingCancelled;
+
     void setupFileExplorer();
     void loadPath(const QString &path);
+    void cancelListing();
+    void appendEntries(const std::vector<MediaEntry> &entries);
     void updateAddressBar(const QString &path);
     void updateNavigationButtons();
     void setErrorMessage(const QString &message);
@@ -0,0 +1,245 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "afcinputstream.h"
+#include "servicemanager.h"
+#include <QDebug>
+#include <algorithm>
+
+AfcInputStream::AfcInputStream(iDescriptorDevice *device, const QString &path,
+                               std::optional<afc_client_t> altAfc,
+                               QObject *parent)
+    : QIODevice(parent), m_device(device), m_path(path), m_altAfc(altAfc)
+{
+}
+
+AfcInputStream::~AfcInputStream() { close(); }
+
+afc_error_t AfcInputStream::afcCall(
+    const std::function<afc_error_t(afc_client_t)> &operation)
+{
+    if (m_lease) {
+        return ServiceManager::executeAfcOperation(m_lease, operation);
+    }
+    return ServiceManager::executeAfcOperation(m_device, operation, m_altAfc);
+}
+
+bool AfcInputStream::open(OpenMode mode)
+{
+    if (isOpen() || !(mode & ReadOnly) || (mode & WriteOnly)) {
+        return false;
+    }
+
+    // Alternative clients such as AFC2 see a different file system, only
+    // streams on the primary one can move to a pooled connection
+    if (!m_altAfc) {
+        m_lease = ServiceManager::leaseAfcClient(m_device, false);
+    }
+
+    const QByteArray path = m_path.toUtf8();
+    afc_error_t err = afcCall([&](afc_client_t client) {
+        afc_error_t result =
+            afc_file_open(client, path.constData(), AFC_FOPEN_RDONLY, &m_handle);
+        if (result != AFC_E_SUCCESS) {
+            return result;
+        }
+        uint64_t fileSize = 0;
+        result = afc_file_seek(client, m_handle, 0, SEEK_END);
+        if (result == AFC_E_SUCCESS) {
+            result = afc_file_tell(client, m_handle, &fileSize);
+        }
+        if (result == AFC_E_SUCCESS) {
+            result = afc_file_seek(client, m_handle, 0, SEEK_SET);
+        }
+        if (result != AFC_E_SUCCESS) {
+            afc_file_close(client, m_handle);
+        }
+        m_fileSize = fileSize;
+        return result;
+    });
+    if (err != AFC_E_SUCCESS) {
+        qDebug() << "AfcInputStream: could not open" << m_path
+                 << "Error:" << err;
+        m_handle = 0;
+        m_lease.release();
+        setErrorString(QString("Could not open %1 (AFC error %2)")
+                           .arg(m_path)
+                           .arg(static_cast<int>(err)));
+        return false;
+    }
+
+    m_handlePosition = 0;
+    m_lastFetched = -1;
+    m_readAhead = 1;
+    // The block cache replaces QIODevice's own read buffer
+    return QIODevice::open(ReadOnly | Unbuffered);
+}
+
+void AfcInputStream::close()
+{
+    if (!isOpen()) {
+        return;
+    }
+    QIODevice::close();
+
+    afcCall([this](afc_client_t client) {
+        return afc_file_close(client, m_handle);
+    });
+    m_handle = 0;
+    m_cache.clear();
+    m_lease.release();
+}
+
+bool AfcInputStream::seek(qint64 pos)
+{
+    if (pos < 0 || pos > m_fileSize) {
+        return false;
+    }
+    return QIODevice::seek(pos);
+}
+
+qint64 AfcInputStream::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+    return -1;
+}
+
+qint64 AfcInputStream::readData(char *data, qint64 maxSize)
+{
+    qint64 position = pos();
+    qint64 total = 0;
+    maxSize = qMin(maxSize, m_fileSize - position);
+
+    while (total < maxSize) {
+        const qint64 index = position / AFC_STREAM_BLOCK_SIZE;
+        const CachedBlock *cached = block(index);
+        if (!cached) {
+            return total > 0 ? total : -1;
+        }
+
+        const qint64 offset = position - index * AFC_STREAM_BLOCK_SIZE;
+        const qint64 available =
+            qMin(maxSize - total, qint64(cached->data.size()) - offset);
+        if (available <= 0) {
+            break; // File shrank on the device
+        }
+        memcpy(data + total, cached->data.constData() + offset, available);
+        total += available;
+        position += available;
+    }
+    return total;
+}
+
+AfcInputStream::CachedBlock *AfcInputStream::findCached(qint64 index)
+{
+    for (CachedBlock &cached : m_cache) {
+        if (cached.index == index) {
+            return &cached;
+        }
+    }
+    return nullptr;
+}
+
+const AfcInputStream::CachedBlock *AfcInputStream::block(qint64 index)
+{
+    if (CachedBlock *cached = findCached(index)) {
+        cached->lastUsed = ++m_useCounter;
+        return cached;
+    }
+
+    // Sequential misses fetch more blocks per request, random access only
+    // the block that was asked for. A cached previous block counts as
+    // sequential too, so readers taking turns on one stream keep their
+    // read-ahead.
+    const bool sequential =
+        index == m_lastFetched + 1 || (index > 0 && findCached(index - 1));
+    m_readAhead =
+        sequential ? qMin(m_readAhead * 2, AFC_STREAM_MAX_READ_AHEAD) : 1;
+    if (!fetch(index, m_readAhead)) {
+        return nullptr;
+    }
+
+    CachedBlock *cached = findCached(index);
+    if (cached) {
+        cached->lastUsed = ++m_useCounter;
+    }
+    return cached;
+}
+
+bool AfcInputStream::fetch(qint64 firstIndex, int count)
+{
+    const qint64 offset = firstIndex * AFC_STREAM_BLOCK_SIZE;
+    const qint64 length =
+        qMin(qint64(count) * AFC_STREAM_BLOCK_SIZE, m_fileSize - offset);
+    if (length <= 0) {
+        return false;
+    }
+
+    QByteArray buffer(length, Qt::Uninitialized);
+    qint64 bytesRead = 0;
+    afc_error_t err = afcCall([&](afc_client_t client) {
+        afc_error_t result = AFC_E_SUCCESS;
+        if (m_handlePosition != offset) {
+            result = afc_file_seek(client, m_handle, offset, SEEK_SET);
+        }
+        while (result == AFC_E_SUCCESS && bytesRead < length) {
+            uint32_t chunkRead = 0;
+            result = afc_file_read(client, m_handle, buffer.data() + bytesRead,
+                                   static_cast<uint32_t>(length - bytesRead),
+                                   &chunkRead);
+            if (chunkRead == 0) {
+                break;
+            }
+            bytesRead += chunkRead;
+        }
+        return result;
+    });
+    m_handlePosition = err == AFC_E_SUCCESS ? offset + bytesRead : -1;
+    if (err != AFC_E_SUCCESS || bytesRead == 0) {
+        qDebug() << "AfcInputStream: read failed for" << m_path
+                 << "at offset" << offset << "Error:" << err;
+        setErrorString(QString("Read failed (AFC error %1)")
+                           .arg(static_cast<int>(err)));
+        return false;
+    }
+
+    // Split into cache blocks, evicting the least recently used ones
+    for (qint64 start = 0; start < bytesRead; start += AFC_STREAM_BLOCK_SIZE) {
+        if (m_cache.size() >= m_cacheBlocks) {
+            auto oldest = std::min_element(
+                m_cache.begin(), m_cache.end(),
+                [](const CachedBlock &a, const CachedBlock &b) {
+                    return a.lastUsed < b.lastUsed;
+                });
+            m_cache.erase(oldest);
+        }
+
+        CachedBlock cached;
+        cached.index = firstIndex + start / AFC_STREAM_BLOCK_SIZE;
+        m_cache.removeIf([&](const CachedBlock &existing) {
+            return existing.index == cached.index;
+        });
+        cached.data = buffer.mid(start, AFC_STREAM_BLOCK_SIZE);
+        cached.lastUsed = ++m_useCounter;
+        m_lastFetched = cached.index;
+        m_cache.append(cached);
+    }
+    return true;
+}
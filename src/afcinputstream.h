@@ -0,0 +1,104 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef AFCINPUTSTREAM_H
+#define AFCINPUTSTREAM_H
+
+#include "afcclientpool.h"
+#include "iDescriptor.h"
+#include <QByteArray>
+#include <QIODevice>
+#include <QList>
+#include <QString>
+#include <functional>
+#include <optional>
+
+// Granularity of device reads and of the block cache
+#define AFC_STREAM_BLOCK_SIZE (256 * 1024)
+#define AFC_STREAM_CACHE_BLOCKS 16
+// Sequential reads double the read-ahead up to this many blocks
+#define AFC_STREAM_MAX_READ_AHEAD 8
+
+/**
+ * @brief Seekable, read-only QIODevice over a file on the device
+ *
+ * Bytes are pulled over AFC on demand in blocks, so decoders like
+ * QImageReader, libheif or FFmpeg only fetch the ranges they touch instead of
+ * the whole file. Recently used blocks are kept in a small LRU cache and
+ * sequential access reads ahead with growing request sizes.
+ *
+ * The stream runs on a pooled AFC client when one is free, otherwise on the
+ * device's primary client (or altAfc) under the device mutex. Like the AFC
+ * clients it uses, a stream must only be used from one thread at a time.
+ */
+class AfcInputStream : public QIODevice
+{
+public:
+    AfcInputStream(iDescriptorDevice *device, const QString &path,
+                   std::optional<afc_client_t> altAfc = std::nullopt,
+                   QObject *parent = nullptr);
+    ~AfcInputStream() override;
+
+    // Only QIODevice::ReadOnly is supported
+    bool open(OpenMode mode) override;
+    void close() override;
+
+    bool isSequential() const override { return false; }
+    qint64 size() const override { return m_fileSize; }
+    bool seek(qint64 pos) override;
+
+    QString path() const { return m_path; }
+    // Number of blocks the cache may hold, AFC_STREAM_CACHE_BLOCKS by default
+    void setCacheBlocks(int blocks) { m_cacheBlocks = qMax(1, blocks); }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    struct CachedBlock {
+        qint64 index = -1;
+        QByteArray data;
+        quint64 lastUsed = 0;
+    };
+
+    const CachedBlock *block(qint64 index);
+    CachedBlock *findCached(qint64 index);
+    bool fetch(qint64 firstIndex, int count);
+    afc_error_t
+    afcCall(const std::function<afc_error_t(afc_client_t)> &operation);
+
+    iDescriptorDevice *m_device;
+    const QString m_path;
+    std::optional<afc_client_t> m_altAfc;
+    AfcClientLease m_lease;
+
+    uint64_t m_handle = 0;
+    qint64 m_fileSize = 0;
+    // Offset of the AFC handle, avoids a seek request for sequential reads
+    qint64 m_handlePosition = 0;
+
+    QList<CachedBlock> m_cache;
+    int m_cacheBlocks = AFC_STREAM_CACHE_BLOCKS;
+    quint64 m_useCounter = 0;
+    qint64 m_lastFetched = -1;
+    int m_readAhead = 1;
+};
+
+#endif // AFCINPUTSTREAM_H
@@ -37,13 +37,14 @@
 #include <QPixmap>
 #include <QProcess>
 #include <QPushButton>
+#include <QScreen>
 #include <QSpinBox>
 #include <QStackedWidget>
 #include <QVBoxLayout>
 #include <QVideoWidget>
+#include <cstring>
 #ifdef Q_OS_LINUX
 // V4L2 includes
-#include <cstring>
 #include <errno.h>
 #include <fcntl.h>
 #include <linux/videodev2.h>
@@ -144,11 +145,16 @@ AirPlayWindow::AirPlayWindow(QWidget *parent)
       m_tutorialVideoWidget(nullptr), m_videoLabel(nullptr),
       m_tutorialLayout(nullptr), m_settingsButton(nullptr),
 #ifdef __linux__
-      m_v4l2Checkbox(nullptr), m_v4l2_fd(-1), m_v4l2_width(0), m_v4l2_height(0),
-      m_v4l2_enabled(false),
+      m_v4l2Checkbox(nullptr), m_v4l2Writer(nullptr), m_v4l2_enabled(false),
 #endif
+      m_frameRing(std::make_shared<FrameRing>()), m_renderTimer(nullptr),
       m_serverThread(nullptr), m_serverRunning(false), m_clientConnected(false)
 {
+    m_renderTimer = new QTimer(this);
+    m_renderTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_renderTimer, &QTimer::timeout, this,
+            &AirPlayWindow::renderLatestFrame);
+
     setupUI();
     setMinimumSize(800, 600);
     QTimer::singleShot(0, this, [this]() {
@@ -176,10 +182,11 @@ AirPlayWindow::AirPlayWindow(QWidget *parent)
 
 AirPlayWindow::~AirPlayWindow()
 {
-    stopAirPlayServer();
+    stopRendering();
 #ifdef Q_OS_LINUX
-    closeV4L2();
+    stopV4L2Output();
 #endif
+    stopAirPlayServer();
 }
 
 void AirPlayWindow::setupUI()
@@ -291,6 +298,7 @@ void AirPlayWindow::setupTutorialVideo()
 
 void AirPlayWindow::showTutorialView()
 {
+    stopRendering();
     m_stackedWidget->setCurrentWidget(m_tutorialWidget);
     if (m_tutorialPlayer) {
         m_tutorialPlayer->play();
@@ -305,6 +313,22 @@ void AirPlayWindow::showStreamingView()
     if (m_tutorialPlayer) {
         m_tutorialPlayer->pause();
     }
+    startRendering();
+}
+
+void AirPlayWindow::startRendering()
+{
+    QScreen *currentScreen = screen();
+    qreal refreshRate = currentScreen ? currentScreen->refreshRate() : 0;
+    if (refreshRate <= 0) {
+        refreshRate = AIRPLAY_FALLBACK_REFRESH_RATE;
+    }
+    m_renderTimer->start(qMax(1, qRound(1000.0 / refreshRate)));
+}
+
+void AirPlayWindow::stopRendering()
+{
+    m_renderTimer->stop();
 }
 
 void AirPlayWindow::showSettingsDialog()
@@ -330,10 +354,9 @@ void AirPlayWindow::startAirPlayServer()
         return;
 
     m_serverThread = new AirPlayServerThread(this);
+    m_serverThread->setFrameRing(m_frameRing);
     connect(m_serverThread, &AirPlayServerThread::statusChanged, this,
             &AirPlayWindow::onServerStatusChanged);
-    connect(m_serverThread, &AirPlayServerThread::videoFrameReady, this,
-            &AirPlayWindow::updateVideoFrame);
     connect(m_serverThread, &AirPlayServerThread::clientConnectionChanged, this,
             &AirPlayWindow::onClientConnectionChanged);
     connect(m_serverThread, &AirPlayServerThread::errorOccurred, this,
@@ -357,33 +380,31 @@ void AirPlayWindow::stopAirPlayServer()
     m_serverRunning = false;
 }
 
-void AirPlayWindow::updateVideoFrame(QByteArray frameData, int width,
-                                     int height)
+void AirPlayWindow::renderLatestFrame()
 {
-    if (frameData.size() != width * height * 3) {
-        qDebug() << "Invalid frame data size";
+#ifdef __linux__
+    // The V4L2 writer is the frame consumer while it runs
+    if (m_v4l2Writer) {
         return;
     }
+#endif
 
-#ifdef __linux__
-    // V4L2 output if enabled
-    if (m_v4l2_enabled) {
-        writeFrameToV4L2((uint8_t *)frameData.data(), width, height);
-        // Show message instead of rendering video when V4L2 is active
-        m_videoLabel->setText("Currently being shared via virtual camera");
+    // Frames that arrived since the last refresh are skipped, only the newest
+    // one is drawn
+    const FrameRing::Frame *frame = m_frameRing->acquireLatest();
+    if (!frame) {
         return;
     }
-#endif
 
-    QImage image((const uchar *)frameData.data(), width, height,
+    // Wraps the ring slot without copying, it stays ours until the next tick
+    QImage image((const uchar *)frame->data.constData(), frame->width,
+                 frame->height, frame->width * FRAME_RING_BYTES_PER_PIXEL,
                  QImage::Format_RGB888);
-    QPixmap pixmap = QPixmap::fromImage(image);
 
-    // Scale pixmap to fit label while maintaining aspect ratio
-    QSize labelSize = m_videoLabel->size();
-    QPixmap scaledPixmap =
-        pixmap.scaled(labelSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-    m_videoLabel->setPixmap(scaledPixmap);
+    // Scale to fit label while maintaining aspect ratio
+    QImage scaledImage = image.scaled(m_videoLabel->size(), Qt::KeepAspectRatio,
+                                      Qt::SmoothTransformation);
+    m_videoLabel->setPixmap(QPixmap::fromImage(std::move(scaledImage)));
 }
 
 void AirPlayWindow::onServerStatusChanged(bool running)
@@ -432,9 +453,16 @@ void AirPlayWindow::onClientConnectionChanged(bool connected)
 
         showStreamingView();
     } else {
+        qDebug() << "AirPlay client disconnected, dropped frames:"
+                 << m_frameRing->droppedFrames();
         m_loadingLabel->setText("Waiting for device connection...");
         m_videoLabel->clear();
         showTutorialView();
+#ifdef __linux__
+        if (m_v4l2Writer) {
+            m_videoLabel->setText("Currently being shared via virtual camera");
+        }
+#endif
     }
 }
 #ifdef __linux__
@@ -457,7 +485,7 @@ void AirPlayWindow::onV4L2CheckboxToggled(bool enabled)
 
             if (reply == QMessageBox::Yes) {
                 if (createV4L2Loopback()) {
-                    m_v4l2_enabled = true;
+                    startV4L2Output();
 
                 } else {
                     m_v4l2Checkbox->setChecked(false);
@@ -472,11 +500,37 @@ void AirPlayWindow::onV4L2CheckboxToggled(bool enabled)
                 m_v4l2_enabled = false;
             }
         } else {
-            m_v4l2_enabled = true;
+            startV4L2Output();
         }
     } else {
-        m_v4l2_enabled = false;
-        closeV4L2();
+        stopV4L2Output();
+    }
+}
+
+void AirPlayWindow::startV4L2Output()
+{
+    m_v4l2_enabled = true;
+    if (m_v4l2Writer) {
+        return;
+    }
+    m_v4l2Writer = new V4L2WriterThread(m_frameRing, this);
+    m_v4l2Writer->start();
+    // Show message instead of rendering video when V4L2 is active
+    m_videoLabel->setText("Currently being shared via virtual camera");
+}
+
+void AirPlayWindow::stopV4L2Output()
+{
+    m_v4l2_enabled = false;
+    if (!m_v4l2Writer) {
+        return;
+    }
+    // Must be fully stopped before the GUI becomes the consumer again
+    m_v4l2Writer->stop();
+    delete m_v4l2Writer;
+    m_v4l2Writer = nullptr;
+    if (m_videoLabel) {
+        m_videoLabel->clear();
     }
 }
 #endif
@@ -513,6 +567,11 @@ void AirPlayServerThread::setArguments(const QStringList &args)
     }
 }
 
+void AirPlayServerThread::setFrameRing(std::shared_ptr<FrameRing> ring)
+{
+    m_frameRing = std::move(ring);
+}
+
 // Global pointer to current server thread for callbacks
 static AirPlayServerThread *g_currentServerThread = nullptr;
 
@@ -521,8 +580,15 @@ void frame_callback(const unsigned char *data, int width, int height,
 {
     if (!g_currentServerThread)
         return;
-    QByteArray frameData((const char *)data, width * height * 3);
-    emit g_currentServerThread->videoFrameReady(frameData, width, height);
+    FrameRing *ring = g_currentServerThread->frameRing();
+    if (!ring)
+        return;
+
+    // Copy into a pre-allocated slot; whichever consumer is active picks up
+    // the newest frame on its own schedule
+    FrameRing::Frame *frame = ring->beginWrite(width, height);
+    memcpy(frame->data.data(), data, frame->data.size());
+    ring->publish();
 }
 
 void connection_callback(bool connected)
@@ -566,13 +632,41 @@ void AirPlayServerThread::run()
 
 #ifdef __linux__
 // V4L2 Implementation
-void AirPlayWindow::initV4L2(int width, int height, const char *device)
+V4L2WriterThread::V4L2WriterThread(std::shared_ptr<FrameRing> ring,
+                                   QObject *parent)
+    : QThread(parent), m_ring(std::move(ring))
+{
+}
+
+V4L2WriterThread::~V4L2WriterThread() { stop(); }
+
+void V4L2WriterThread::stop()
+{
+    m_stopRequested = true;
+    m_ring->wakeConsumer();
+    wait();
+}
+
+void V4L2WriterThread::run()
+{
+    while (!m_stopRequested) {
+        const FrameRing::Frame *frame =
+            m_ring->waitForLatest(AIRPLAY_V4L2_WAIT_MS, m_stopRequested);
+        if (frame) {
+            writeFrame(frame);
+        }
+    }
+    closeDevice();
+}
+
+void V4L2WriterThread::initDevice(int width, int height)
 {
-    closeV4L2(); // Close previous device if any
+    closeDevice(); // Close previous device if any
 
-    m_v4l2_fd = open(device, O_WRONLY);
-    if (m_v4l2_fd < 0) {
-        qWarning("Failed to open V4L2 device %s: %s", device, strerror(errno));
+    m_fd = open(AIRPLAY_V4L2_DEVICE, O_WRONLY);
+    if (m_fd < 0) {
+        qWarning("Failed to open V4L2 device %s: %s", AIRPLAY_V4L2_DEVICE,
+                 strerror(errno));
         return;
     }
 
@@ -586,41 +680,42 @@ void AirPlayWindow::initV4L2(int width, int height, const char *device)
     fmt.fmt.pix.bytesperline = width * 3;
     fmt.fmt.pix.sizeimage = (unsigned int)width * height * 3;
 
-    if (ioctl(m_v4l2_fd, VIDIOC_S_FMT, &fmt) < 0) {
+    if (ioctl(m_fd, VIDIOC_S_FMT, &fmt) < 0) {
         qWarning("Failed to set V4L2 format: %s", strerror(errno));
-        ::close(m_v4l2_fd);
-        m_v4l2_fd = -1;
+        ::close(m_fd);
+        m_fd = -1;
         return;
     }
 
-    m_v4l2_width = width;
-    m_v4l2_height = height;
-    qDebug("V4L2 device %s initialized to %dx%d", device, width, height);
+    m_width = width;
+    m_height = height;
+    qDebug("V4L2 device %s initialized to %dx%d", AIRPLAY_V4L2_DEVICE, width,
+           height);
 }
 
-void AirPlayWindow::closeV4L2()
+void V4L2WriterThread::closeDevice()
 {
-    if (m_v4l2_fd >= 0) {
-        ::close(m_v4l2_fd);
-        m_v4l2_fd = -1;
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
     }
 }
 
-void AirPlayWindow::writeFrameToV4L2(uint8_t *data, int width, int height)
+void V4L2WriterThread::writeFrame(const FrameRing::Frame *frame)
 {
     // Check if V4L2 device needs to be initialized or re-initialized
-    if (m_v4l2_fd < 0 || m_v4l2_width != width || m_v4l2_height != height) {
-        initV4L2(width, height, "/dev/video0"); // Use your v4l2loopback device
+    if (m_fd < 0 || m_width != frame->width || m_height != frame->height) {
+        initDevice(frame->width, frame->height);
     }
 
     // Write frame to V4L2 device if it's open
-    if (m_v4l2_fd >= 0) {
+    if (m_fd >= 0) {
         ssize_t bytes_written =
-            write(m_v4l2_fd, data, (size_t)width * height * 3);
+            write(m_fd, frame->data.constData(), frame->data.size());
         if (bytes_written < 0) {
             qWarning("Failed to write frame to V4L2 device: %s",
                      strerror(errno));
-            closeV4L2(); // Close on error to retry initialization
+            closeDevice(); // Close on error to retry initialization
         }
     }
 }
@@ -628,7 +723,7 @@ void AirPlayWindow::writeFrameToV4L2(uint8_t *data, int width, int height)
 bool AirPlayWindow::checkV4L2LoopbackExists()
 {
     try {
-        QFileInfo videoDevice("/dev/video0");
+        QFileInfo videoDevice(AIRPLAY_V4L2_DEVICE);
         return videoDevice.exists();
     } catch (...) {
         qWarning("Exception occurred while checking for V4L2 loopback device");
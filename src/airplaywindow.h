@@ -20,6 +20,7 @@
 #ifndef AIRPLAYWINDOW_H
 #define AIRPLAYWINDOW_H
 
+#include "framering.h"
 #include "qprocessindicator.h"
 #include <QCheckBox>
 #include <QCloseEvent>
@@ -39,6 +40,16 @@
 #include <QVBoxLayout>
 #include <QVideoWidget>
 #include <QWaitCondition>
+#include <atomic>
+#include <memory>
+
+// Used when the screen does not report its refresh rate
+#define AIRPLAY_FALLBACK_REFRESH_RATE 60
+#ifdef __linux__
+#define AIRPLAY_V4L2_DEVICE "/dev/video0"
+// How long the V4L2 writer sleeps between checks for a stop request
+#define AIRPLAY_V4L2_WAIT_MS 100
+#endif
 
 class AirPlayServerThread : public QThread
 {
@@ -50,10 +61,12 @@ public:
 
     // void stopServer();
     void setArguments(const QStringList &args);
+    // Decoded frames are published here instead of being emitted
+    void setFrameRing(std::shared_ptr<FrameRing> ring);
+    FrameRing *frameRing() const { return m_frameRing.get(); }
 
 signals:
     void statusChanged(bool running);
-    void videoFrameReady(QByteArray frameData, int width, int height);
     void clientConnectionChanged(bool connected);
     void errorOccurred(const QString &message);
 
@@ -66,8 +79,44 @@ private:
     bool m_shouldStop;
     QVector<QByteArray> m_argData;
     QVector<char *> m_argv;
+    std::shared_ptr<FrameRing> m_frameRing;
 };
 
+#ifdef __linux__
+/**
+ * @brief Feeds the newest mirrored frame to a v4l2loopback device
+ *
+ * Runs as the consumer of the frame ring while virtual camera output is
+ * enabled, so blocking writes to the device never stall the GUI thread.
+ */
+class V4L2WriterThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit V4L2WriterThread(std::shared_ptr<FrameRing> ring,
+                              QObject *parent = nullptr);
+    ~V4L2WriterThread();
+
+    // Blocks until the thread has exited and the device is closed
+    void stop();
+
+protected:
+    void run() override;
+
+private:
+    void initDevice(int width, int height);
+    void closeDevice();
+    void writeFrame(const FrameRing::Frame *frame);
+
+    std::shared_ptr<FrameRing> m_ring;
+    std::atomic<bool> m_stopRequested{false};
+    int m_fd = -1;
+    int m_width = 0;
+    int m_height = 0;
+};
+#endif
+
 class AirPlaySettings
 {
 public:
@@ -102,7 +151,7 @@ public:
     ~AirPlayWindow();
 
 private slots:
-    void updateVideoFrame(QByteArray frameData, int width, int height);
+    void renderLatestFrame();
     void onServerStatusChanged(bool running);
     void onClientConnectionChanged(bool connected);
     void showSettingsDialog();
@@ -118,10 +167,12 @@ private:
     void startAirPlayServer();
     void stopAirPlayServer();
 
+    void startRendering();
+    void stopRendering();
+
 #ifdef __linux__
-    void initV4L2(int width, int height, const char *device = "/dev/video0");
-    void closeV4L2();
-    void writeFrameToV4L2(uint8_t *data, int width, int height);
+    void startV4L2Output();
+    void stopV4L2Output();
     bool checkV4L2LoopbackExists();
     bool createV4L2Loopback();
     void setupV4L2Checkbox();
@@ -142,12 +193,15 @@ private:
 
 #ifdef __linux__
     QCheckBox *m_v4l2Checkbox;
-    int m_v4l2_fd;
-    int m_v4l2_width;
-    int m_v4l2_height;
+    V4L2WriterThread *m_v4l2Writer;
     bool m_v4l2_enabled = false;
 #endif
 
+    // Shared with the server and V4L2 threads, which may outlive the window
+    std::shared_ptr<FrameRing> m_frameRing;
+    // Pulls the newest frame once per display refresh
+    QTimer *m_renderTimer;
+
     AirPlayServerThread *m_serverThread;
     bool m_serverRunning;
     bool m_clientConnected;
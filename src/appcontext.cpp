@@ -18,13 +18,22 @@
  */
 
 #include "appcontext.h"
+#include "afcclientpool.h"
+#include "appiconstore.h"
+#include "appinventory.h"
+#include "batterytelemetry.h"
+#include "directorycache.h"
 #include "iDescriptor.h"
+#include "ipadeploymentengine.h"
 #include "mainwindow.h"
+#include "servicemanager.h"
+#include "servicesessioncache.h"
 #include "settingsmanager.h"
 #include <QDebug>
 #include <QMessageBox>
 #include <QTimer>
 #include <QUuid>
+#include <QtConcurrent/QtConcurrent>
 
 AppContext *AppContext::sharedInstance()
 {
@@ -37,15 +46,76 @@ AppContext *AppContext::sharedInstance()
  and does not reconnect them until the user plugs them
  back in, even if they are still connected
 */
-AppContext::AppContext(QObject *parent) : QObject{parent} {}
+AppContext::AppContext(QObject *parent) : QObject{parent}
+{
+    m_bringUpPool.setMaxThreadCount(DEVICE_BRINGUP_MAX_THREADS);
+}
 
+/*
+    The lockdown handshake and service setup take a while per device, so they
+    run on m_bringUpPool and several devices come up in parallel. The device
+    is added as soon as its identity is known, storage, battery and jailbreak
+    details follow in startDetailStages.
+*/
 void AppContext::addDevice(QString udid, idevice_connection_type conn_type,
                            AddType addType)
 {
-    try {
+    if (m_initializingDevices.contains(udid)) {
+        if (m_removedWhileInitializing.remove(udid)) {
+            // finishAddDevice drops the stale result and starts over
+            qDebug() << "Device replugged during initialization:" << udid;
+            m_addAfterInitializing.insert(udid, {conn_type, addType});
+            return;
+        }
+        qDebug() << "Device is already being initialized:" << udid;
+        return;
+    }
+    m_initializingDevices.insert(udid);
+
+    QtConcurrent::run(&m_bringUpPool, [this, udid, conn_type, addType]() {
         iDescriptorInitDeviceResult initResult =
             init_idescriptor_device(udid.toStdString().c_str());
+        QMetaObject::invokeMethod(
+            this,
+            [this, udid, conn_type, addType, initResult]() {
+                finishAddDevice(udid, conn_type, addType, initResult);
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+static void freeInitResult(const iDescriptorInitDeviceResult &initResult)
+{
+    if (!initResult.success) {
+        return;
+    }
+    if (initResult.afcClient)
+        afc_client_free(initResult.afcClient);
+    if (initResult.afc2Client)
+        afc_client_free(initResult.afc2Client);
+    idevice_free(initResult.device);
+}
 
+void AppContext::finishAddDevice(const QString &udid,
+                                 idevice_connection_type conn_type,
+                                 AddType addType,
+                                 const iDescriptorInitDeviceResult &initResult)
+{
+    m_initializingDevices.remove(udid);
+    if (m_removedWhileInitializing.remove(udid)) {
+        qDebug() << "Device was removed during initialization:" << udid;
+        freeInitResult(initResult);
+        return;
+    }
+    if (m_addAfterInitializing.contains(udid)) {
+        // The result belongs to the connection that was unplugged
+        const PendingAdd pending = m_addAfterInitializing.take(udid);
+        freeInitResult(initResult);
+        addDevice(udid, pending.connType, pending.addType);
+        return;
+    }
+
+    try {
         qDebug() << "init_idescriptor_device success ?: " << initResult.success;
         qDebug() << "init_idescriptor_device error code: " << initResult.error;
 
@@ -104,6 +174,7 @@ void AppContext::addDevice(QString udid, idevice_connection_type conn_type,
             .deviceInfo = initResult.deviceInfo,
             .afcClient = initResult.afcClient,
             .afc2Client = initResult.afc2Client,
+            .afcPool = std::make_shared<AfcClientPool>(initResult.device),
         };
         m_devices[device->udid] = device;
         if (addType == AddType::Regular) {
@@ -117,17 +188,76 @@ void AppContext::addDevice(QString udid, idevice_connection_type conn_type,
 
             emit deviceAdded(device);
             emit deviceChange();
+            startDetailStages(device);
             return;
         }
         emit devicePaired(device);
         emit deviceChange();
         m_pendingDevices.removeAll(udid);
+        startDetailStages(device);
 
     } catch (const std::exception &e) {
         qDebug() << "Exception in onDeviceAdded: " << e.what();
     }
 }
 
+void AppContext::startDetailStages(iDescriptorDevice *device)
+{
+    const std::string udid = device->udid;
+    const DeviceInfo identity = device->deviceInfo;
+
+    // Each stage works on its own copy and hands the result to the GUI thread,
+    // where device->deviceInfo is only ever written. removeDevice waits for
+    // this task before freeing the device.
+    auto publish = [this, device, udid](
+                       DeviceInitStage stage,
+                       std::function<void(DeviceInfo &)> apply) {
+        QMetaObject::invokeMethod(
+            this,
+            [this, device, udid, stage, apply]() {
+                if (m_devices.value(udid) != device) {
+                    return;
+                }
+                apply(device->deviceInfo);
+                emit deviceInfoUpdated(device, stage);
+                // Live battery values are sampled from here on
+                if (stage == DeviceInitStage::Battery) {
+                    BatteryTelemetry::sharedInstance()->startSampling(device);
+                }
+            },
+            Qt::QueuedConnection);
+    };
+
+    m_detailStages[udid] = QtConcurrent::run(
+        &m_bringUpPool, [device, identity, publish]() {
+            DiskInfo diskInfo = identity.diskInfo;
+            if (ServiceManager::executeOperation<bool>(
+                    device, [&diskInfo](afc_client_t afc) {
+                        return load_device_storage_info(afc, diskInfo);
+                    })) {
+                publish(DeviceInitStage::Storage,
+                        [diskInfo](DeviceInfo &d) { d.diskInfo = diskInfo; });
+            }
+
+            DeviceInfo batteryInfo = identity;
+            if (load_device_battery_info(device, batteryInfo)) {
+                publish(DeviceInitStage::Battery,
+                        [batteryInfo](DeviceInfo &d) {
+                            d.batteryInfo = batteryInfo.batteryInfo;
+                            d.oldDevice = batteryInfo.oldDevice;
+                        });
+            }
+
+            bool jailbroken = ServiceManager::executeOperation<bool>(
+                device, [](afc_client_t afc) {
+                    return detect_jailbroken(afc);
+                });
+            publish(DeviceInitStage::Jailbreak, [jailbroken](DeviceInfo &d) {
+                d.jailbroken = jailbroken;
+            });
+        });
+}
+
 int AppContext::getConnectedDeviceCount() const
 {
 #ifdef ENABLE_RECOVERY_DEVICE_SUPPORT
@@ -137,6 +267,24 @@ int AppContext::getConnectedDeviceCount() const
 #endif
 }
 
+static void releaseDevice(iDescriptorDevice *device)
+{
+    // Drain the pool before taking the device mutex, a lease holder may be
+    // waiting on the mutex for a primary client operation
+    device->afcPool->shutdown();
+
+    std::lock_guard<std::recursive_mutex> lock(device->mutex);
+
+    if (device->afcClient)
+        afc_client_free(device->afcClient);
+    if (device->afc2Client)
+        afc_client_free(device->afc2Client);
+
+    idevice_free(device->device);
+
+    delete device;
+}
+
 /*
     FIXME:
     on macOS, sometimes you get wireless disconnects even though we are not
@@ -149,6 +297,13 @@ void AppContext::removeDevice(QString _udid)
     qDebug() << "AppContext::removeDevice device with UUID:"
              << QString::fromStdString(udid);
 
+    if (m_initializingDevices.contains(_udid)) {
+        // finishAddDevice releases it once its handshake returns
+        m_addAfterInitializing.remove(_udid);
+        m_removedWhileInitializing.insert(_udid);
+        return;
+    }
+
     if (m_pendingDevices.contains(_udid)) {
         m_pendingDevices.removeAll(_udid);
         emit devicePairingExpired(_udid);
@@ -167,20 +322,30 @@ void AppContext::removeDevice(QString _udid)
 
     iDescriptorDevice *device = m_devices[udid];
     m_devices.remove(udid);
+    DirectoryCache::sharedInstance()->removeDevice(udid);
+    AppIconStore::sharedInstance()->removeDevice(udid);
+    AppInventory::sharedInstance()->removeDevice(udid);
+    QFuture<void> install =
+        IpaDeploymentEngine::sharedInstance()->removeDevice(udid);
+    BatteryTelemetry::sharedInstance()->removeDevice(udid);
+    ServiceSessionCache::sharedInstance()->removeDevice(device);
 
     emit deviceRemoved(udid);
     emit deviceChange();
 
-    std::lock_guard<std::recursive_mutex> lock(device->mutex);
-
-    if (device->afcClient)
-        afc_client_free(device->afcClient);
-    if (device->afc2Client)
-        afc_client_free(device->afc2Client);
-
-    idevice_free(device->device);
-    
-    delete device;
+    // Bring-up stages and an aborted install may still use the device's
+    // connections. They fail fast now that it is unplugged, but the device is
+    // only freed once they let go, off the GUI thread.
+    QList<QFuture<void>> pending{install};
+    if (m_detailStages.contains(udid)) {
+        pending.append(m_detailStages.take(udid));
+    }
+    QtConcurrent::run([device, pending]() {
+        for (QFuture<void> future : pending) {
+            future.waitForFinished();
+        }
+        releaseDevice(device);
+    });
 }
 
 #ifdef ENABLE_RECOVERY_DEVICE_SUPPORT
@@ -262,8 +427,10 @@ void AppContext::addRecoveryDevice(uint64_t ecid)
 
 AppContext::~AppContext()
 {
+    m_bringUpPool.waitForDone();
     for (auto device : m_devices) {
         emit deviceRemoved(device->udid);
+        device->afcPool->shutdown();
         if (device->afcClient)
             afc_client_free(device->afcClient);
         if (device->afc2Client)
@@ -22,7 +22,14 @@
 
 #include "devicesidebarwidget.h"
 #include "iDescriptor.h"
+#include <QFuture>
+#include <QMap>
 #include <QObject>
+#include <QSet>
+#include <QThreadPool>
+
+// Devices brought up at the same time, each one blocks a thread on USB I/O
+#define DEVICE_BRINGUP_MAX_THREADS 8
 
 class AppContext : public QObject
 {
@@ -50,6 +57,23 @@ private:
 #endif
     QStringList m_pendingDevices;
     DeviceSelection m_currentSelection = DeviceSelection("");
+
+    // Asynchronous bring-up, see addDevice
+    QThreadPool m_bringUpPool;
+    QSet<QString> m_initializingDevices;
+    QSet<QString> m_removedWhileInitializing;
+    // Replugged while the handshake of the old connection was still running
+    struct PendingAdd {
+        idevice_connection_type connType;
+        AddType addType;
+    };
+    QMap<QString, PendingAdd> m_addAfterInitializing;
+    QMap<std::string, QFuture<void>> m_detailStages;
+
+    void finishAddDevice(const QString &udid,
+                         idevice_connection_type conn_type, AddType addType,
+                         const iDescriptorInitDeviceResult &initResult);
+    void startDetailStages(iDescriptorDevice *device);
 signals:
     void deviceAdded(iDescriptorDevice *device);
     void deviceRemoved(const std::string &udid);
@@ -71,6 +95,8 @@ signals:
         do anything you want
     */
     void deviceChange();
+    // A bring-up stage finished and updated device->deviceInfo
+    void deviceInfoUpdated(iDescriptorDevice *device, DeviceInitStage stage);
     void currentDeviceSelectionChanged(const DeviceSelection &selection);
 public slots:
     void removeDevice(QString udid);
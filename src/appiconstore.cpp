@@ -0,0 +1,218 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "appiconstore.h"
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+AppIconStore *AppIconStore::sharedInstance()
+{
+    static AppIconStore self;
+    return &self;
+}
+
+AppIconStore::AppIconStore(QObject *parent)
+    : QObject(parent),
+      m_directory(
+          QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+              .filePath("app-icons")),
+      m_networkManager(new QNetworkAccessManager(this)),
+      m_memoryCache(APP_ICON_STORE_MEMORY_CACHE_SIZE)
+{
+    m_pool.setMaxThreadCount(APP_ICON_STORE_MAX_THREADS);
+    QDir().mkpath(m_directory);
+}
+
+AppIconStore::~AppIconStore()
+{
+    m_pool.waitForDone();
+
+    for (auto &[udid, source] : m_sources) {
+        std::lock_guard<std::mutex> lock(source->mutex);
+        if (source->client)
+            sbservices_client_free(source->client);
+        source->client = nullptr;
+        source->removed = true;
+    }
+}
+
+QString AppIconStore::makeKey(const QString &bundleId, const QString &version)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(bundleId.toUtf8());
+    hash.addData(QByteArrayView("\0", 1));
+    hash.addData(version.toUtf8());
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+QString AppIconStore::cachePath(const QString &key) const
+{
+    return QDir(m_directory).filePath(key + ".png");
+}
+
+QPixmap AppIconStore::icon(iDescriptorDevice *device, const QString &bundleId,
+                           const QString &version)
+{
+    const QString key = makeKey(bundleId, version);
+
+    if (QPixmap *cached = m_memoryCache.object(key))
+        return *cached;
+    if (m_unavailable.contains(key) || m_inFlight.contains(key))
+        return QPixmap();
+
+    m_inFlight.insert(key);
+
+    std::shared_ptr<DeviceSource> source;
+    if (device && device->device) {
+        std::shared_ptr<DeviceSource> &entry = m_sources[device->udid];
+        if (!entry) {
+            entry = std::make_shared<DeviceSource>();
+            entry->device = device->device;
+        }
+        source = entry;
+    }
+
+    const QString path = cachePath(key);
+    m_pool.start([this, key, bundleId, path, source]() {
+        QImage image;
+        QFile file(path);
+        if (file.open(QIODevice::ReadOnly))
+            image.loadFromData(file.readAll());
+
+        if (image.isNull() && source) {
+            QByteArray png = fetchFromDevice(source.get(), bundleId);
+            if (image.loadFromData(png))
+                storeOnDisk(key, png);
+        }
+
+        QMetaObject::invokeMethod(
+            this,
+            [this, key, bundleId, image]() {
+                if (image.isNull()) {
+                    fetchFromApple(key, bundleId);
+                    return;
+                }
+                finish(key, bundleId, image);
+            },
+            Qt::QueuedConnection);
+    });
+
+    return QPixmap();
+}
+
+QByteArray AppIconStore::fetchFromDevice(DeviceSource *source,
+                                         const QString &bundleId)
+{
+    std::lock_guard<std::mutex> lock(source->mutex);
+    if (source->removed)
+        return QByteArray();
+
+    if (!source->client &&
+        sbservices_client_start_service(source->device, &source->client,
+                                        APP_LABEL) != SBSERVICES_E_SUCCESS) {
+        qDebug() << "AppIconStore: could not start springboard services";
+        source->client = nullptr;
+        return QByteArray();
+    }
+
+    char *pngData = nullptr;
+    uint64_t pngSize = 0;
+    sbservices_error_t err = sbservices_get_icon_pngdata(
+        source->client, bundleId.toUtf8().constData(), &pngData, &pngSize);
+    if (err != SBSERVICES_E_SUCCESS || !pngData) {
+        if (err == SBSERVICES_E_CONN_FAILED) {
+            // Reconnect on the next request
+            sbservices_client_free(source->client);
+            source->client = nullptr;
+        }
+        free(pngData);
+        return QByteArray();
+    }
+
+    QByteArray png(pngData, static_cast<qsizetype>(pngSize));
+    free(pngData);
+    return png;
+}
+
+void AppIconStore::fetchFromApple(const QString &key, const QString &bundleId)
+{
+    auto onIcon = [this, key, bundleId](const QPixmap &pixmap) {
+        QImage image = pixmap.toImage();
+        if (!image.isNull()) {
+            m_pool.start([this, key, image]() {
+                QByteArray png;
+                QBuffer buffer(&png);
+                buffer.open(QIODevice::WriteOnly);
+                if (image.save(&buffer, "PNG"))
+                    storeOnDisk(key, png);
+            });
+        }
+        finish(key, bundleId, image);
+    };
+
+    ::fetchAppIconFromApple(m_networkManager, bundleId, onIcon);
+}
+
+void AppIconStore::storeOnDisk(const QString &key, const QByteArray &data)
+{
+    QSaveFile file(cachePath(key));
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() ||
+        !file.commit()) {
+        qDebug() << "AppIconStore: could not cache icon" << file.fileName();
+    }
+}
+
+void AppIconStore::finish(const QString &key, const QString &bundleId,
+                          const QImage &image)
+{
+    m_inFlight.remove(key);
+
+    QPixmap pixmap;
+    if (image.isNull()) {
+        m_unavailable.insert(key);
+    } else {
+        pixmap = QPixmap::fromImage(image);
+        m_memoryCache.insert(key, new QPixmap(pixmap));
+    }
+
+    emit iconReady(bundleId, pixmap);
+}
+
+void AppIconStore::removeDevice(const std::string &udid)
+{
+    auto it = m_sources.find(udid);
+    if (it == m_sources.end())
+        return;
+
+    std::shared_ptr<DeviceSource> source = it->second;
+    m_sources.erase(it);
+
+    // Waits for a request that is talking to the device right now, queued
+    // ones see the flag and fall back to the iTunes lookup
+    std::lock_guard<std::mutex> lock(source->mutex);
+    if (source->client)
+        sbservices_client_free(source->client);
+    source->client = nullptr;
+    source->removed = true;
+}
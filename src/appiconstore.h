@@ -0,0 +1,112 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef APPICONSTORE_H
+#define APPICONSTORE_H
+
+#include "iDescriptor.h"
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QNetworkAccessManager>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <libimobiledevice/sbservices.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Threads reading cached icons and talking to springboard services
+#define APP_ICON_STORE_MAX_THREADS 4
+// Decoded icons kept in memory across visits of the apps page
+#define APP_ICON_STORE_MEMORY_CACHE_SIZE 512
+
+/**
+ * @brief Shared, persistent cache of installed app icons
+ *
+ * A miss is looked up on disk first, then pulled from the device through
+ * com.apple.springboardservices and only then from the iTunes lookup API, so
+ * system and enterprise apps get their icons too and no network is needed
+ * once an icon is cached. Icons are keyed by bundle id and version, an
+ * updated app gets its new icon. Concurrent requests for the same icon share
+ * one fetch.
+ *
+ * Must only be used from the GUI thread, iconReady is emitted there as well.
+ */
+class AppIconStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    static AppIconStore *sharedInstance();
+
+    /**
+     * @brief Returns the icon if it is in memory, a null pixmap otherwise
+     *
+     * On a miss the icon is fetched in the background and iconReady is
+     * emitted once it is known. device may be null to skip springboard.
+     */
+    QPixmap icon(iDescriptorDevice *device, const QString &bundleId,
+                 const QString &version);
+
+    // Must be called before the device's connection is freed
+    void removeDevice(const std::string &udid);
+
+signals:
+    // icon is null if no source had an icon for the app
+    void iconReady(const QString &bundleId, const QPixmap &icon);
+
+private:
+    // Serializes the springboard services connection of a device
+    struct DeviceSource {
+        std::mutex mutex;
+        idevice_t device = nullptr;
+        sbservices_client_t client = nullptr;
+        bool removed = false;
+    };
+
+    explicit AppIconStore(QObject *parent = nullptr);
+    ~AppIconStore();
+
+    static QString makeKey(const QString &bundleId, const QString &version);
+    QString cachePath(const QString &key) const;
+    static QByteArray fetchFromDevice(DeviceSource *source,
+                                      const QString &bundleId);
+
+    void fetchFromApple(const QString &key, const QString &bundleId);
+    void storeOnDisk(const QString &key, const QByteArray &data);
+    void finish(const QString &key, const QString &bundleId,
+                const QImage &image);
+
+    const QString m_directory;
+    QThreadPool m_pool;
+    QNetworkAccessManager *m_networkManager;
+    QCache<QString, QPixmap> m_memoryCache;
+    // Keys being fetched, further requests for them just wait for iconReady
+    QSet<QString> m_inFlight;
+    // Keys no source has an icon for, not asked again during this session
+    QSet<QString> m_unavailable;
+    std::unordered_map<std::string, std::shared_ptr<DeviceSource>> m_sources;
+};
+
+#endif // APPICONSTORE_H
@@ -26,14 +26,21 @@
 #include <QDir>
 #include <QFutureWatcher>
 #include <QLabel>
+#include <QLocale>
 #include <QMessageBox>
 #include <QNetworkAccessManager>
 #include <QPainter>
 #include <QPainterPath>
+#include <QPointer>
 #include <QPushButton>
 #include <QTemporaryDir>
 #include <QVBoxLayout>
 #include <QtConcurrent/QtConcurrent>
+#include <atomic>
+#include <memory>
+
+// Combo box data of the entry that installs on every connected device
+#define ALL_DEVICES_KEY "*"
 
 AppInstallDialog::AppInstallDialog(const QString &appName,
                                    const QString &description,
@@ -122,6 +129,33 @@ AppInstallDialog::AppInstallDialog(const QString &appName,
     connect(AppContext::sharedInstance(), &AppContext::deviceChange, this,
             &AppInstallDialog::updateDeviceList);
 
+    IpaDeploymentEngine *engine = IpaDeploymentEngine::sharedInstance();
+    connect(engine, &IpaDeploymentEngine::progressChanged, this,
+            [this](quint64 deploymentId, double progress) {
+                if (deploymentId == m_deploymentId)
+                    updateProgressBar(qRound(progress * 100));
+            });
+    connect(engine, &IpaDeploymentEngine::deviceStatusChanged, this,
+            [this](quint64 deploymentId, const IpaDeviceStatus &status) {
+                if (deploymentId != m_deploymentId)
+                    return;
+                m_deployStatus[status.udid] = status;
+                int finished = 0;
+                for (const IpaDeviceStatus &entry : m_deployStatus) {
+                    if (entry.isFinished())
+                        ++finished;
+                }
+                m_statusLabel->setText(
+                    QString("Installing on %1 devices... %2 done")
+                        .arg(m_deployStatus.size())
+                        .arg(finished));
+            });
+    connect(engine, &IpaDeploymentEngine::deploymentFinished, this,
+            [this](quint64 deploymentId, int succeeded, int failed) {
+                if (deploymentId == m_deploymentId)
+                    onDeploymentFinished(succeeded, failed);
+            });
+
     updateDeviceList();
 }
 
@@ -144,6 +178,11 @@ void AppInstallDialog::updateDeviceList()
             m_deviceCombo->addItem(
                 deviceName + " / " + deviceId.left(8) + "...", deviceId);
         }
+        if (devices.size() > 1) {
+            m_deviceCombo->addItem(
+                QString("All connected devices (%1)").arg(devices.size()),
+                ALL_DEVICES_KEY);
+        }
         m_actionButton->setDefault(true);
         m_actionButton->setEnabled(true);
         m_statusLabel->setText("Ready to install");
@@ -153,6 +192,11 @@ void AppInstallDialog::updateDeviceList()
 void AppInstallDialog::performInstallation(const QString &ipaPath,
                                            const QString &deviceUdid)
 {
+    if (deviceUdid == ALL_DEVICES_KEY) {
+        deployToAllDevices(ipaPath);
+        return;
+    }
+
     m_statusLabel->setText("Installing app...");
 
     // Setup install watcher
@@ -179,21 +223,112 @@ void AppInstallDialog::performInstallation(const QString &ipaPath,
         }
     });
 
-    // Run installation in background thread
-    QFuture<int> future = QtConcurrent::run([ipaPath, deviceUdid]() -> int {
-        iDescriptorDevice *device =
-            AppContext::sharedInstance()->getDevice(deviceUdid.toStdString());
-        if (!device) {
-            return -1;
+    // Report upload bytes and install percent, posting only on change
+    QPointer<AppInstallDialog> safeThis = this;
+    auto lastPosted = std::make_shared<std::atomic<int>>(-1);
+    InstallIpaProgress progress = [safeThis, lastPosted](InstallIpaStage stage,
+                                                         uint64_t done,
+                                                         uint64_t total) {
+        const bool uploading = stage == InstallIpaStage::Uploading;
+        const int percentage =
+            total > 0 ? static_cast<int>((done * 100) / total) : 0;
+        // Offset the install stage so both stages get distinct keys
+        const int key = uploading ? percentage : 1000 + percentage;
+        if (lastPosted->exchange(key) == key) {
+            return;
         }
+        QMetaObject::invokeMethod(
+            qApp,
+            [safeThis, uploading, percentage, done, total]() {
+                if (!safeThis || !safeThis->m_statusLabel) {
+                    return;
+                }
+                if (uploading) {
+                    safeThis->m_statusLabel->setText(
+                        QString("Copying app to device... %1 of %2")
+                            .arg(QLocale().formattedDataSize(done))
+                            .arg(QLocale().formattedDataSize(total)));
+                } else {
+                    safeThis->m_statusLabel->setText(
+                        QString("Installing app... %1%").arg(percentage));
+                }
+                safeThis->updateProgressBar(percentage);
+            },
+            Qt::QueuedConnection);
+    };
 
-        instproxy_error_t ret = install_IPA(device->device, device->afcClient,
-                                            ipaPath.toStdString().c_str());
-        return static_cast<int>(ret);
-    });
+    // Run installation in background thread
+    QFuture<int> future =
+        QtConcurrent::run([ipaPath, deviceUdid, progress]() -> int {
+            iDescriptorDevice *device = AppContext::sharedInstance()->getDevice(
+                deviceUdid.toStdString());
+            if (!device) {
+                return -1;
+            }
+
+            instproxy_error_t ret =
+                install_IPA(device->device, device->afcClient,
+                            ipaPath.toStdString().c_str(), progress);
+            return static_cast<int>(ret);
+        });
 
     m_installWatcher->setFuture(future);
 }
+void AppInstallDialog::deployToAllDevices(const QString &ipaPath)
+{
+    IpaDeploymentEngine *engine = IpaDeploymentEngine::sharedInstance();
+
+    m_statusLabel->setText("Preparing app...");
+    m_deployStatus.clear();
+    m_deploymentId =
+        engine->deploy(ipaPath, AppContext::sharedInstance()->getAllDevices());
+    if (!m_deploymentId) {
+        m_statusLabel->setText("No devices connected");
+        m_statusLabel->setStyleSheet(
+            "font-size: 14px; color: #FF3B30; padding: 5px;");
+        return;
+    }
+    for (const IpaDeviceStatus &status :
+         engine->deviceStatus(m_deploymentId)) {
+        m_deployStatus.insert(status.udid, status);
+    }
+}
+
+void AppInstallDialog::onDeploymentFinished(int succeeded, int failed)
+{
+    m_deploymentId = 0;
+
+    if (failed == 0) {
+        m_statusLabel->setText("Installation completed successfully!");
+        m_statusLabel->setStyleSheet(
+            "font-size: 14px; color: #34C759; padding: 5px;");
+        QMessageBox::information(
+            this, "Success",
+            QString("App installed on %1 devices successfully!")
+                .arg(succeeded));
+        accept();
+        return;
+    }
+
+    QStringList failures;
+    for (const IpaDeviceStatus &status : m_deployStatus) {
+        if (status.state == IpaDeployState::Failed) {
+            failures << QString("%1 / %2...: %3")
+                            .arg(status.deviceName, status.udid.left(8),
+                                 status.error);
+        }
+    }
+    m_statusLabel->setText(QString("Installed on %1 of %2 devices")
+                               .arg(succeeded)
+                               .arg(succeeded + failed));
+    m_statusLabel->setStyleSheet(
+        "font-size: 14px; color: #FF3B30; padding: 5px;");
+    QMessageBox::critical(this, "Error",
+                          QString("Installation failed on %1 devices:\n\n%2")
+                              .arg(failed)
+                              .arg(failures.join("\n")));
+}
+
 void AppInstallDialog::onInstallClicked()
 {
     if (m_deviceCombo->count() == 0) {
@@ -270,6 +405,12 @@ void AppInstallDialog::onInstallClicked()
 
 void AppInstallDialog::reject()
 {
+    // Devices that did not start yet are skipped, running installs finish
+    if (m_deploymentId) {
+        IpaDeploymentEngine::sharedInstance()->cancel(m_deploymentId);
+        m_deploymentId = 0;
+    }
+
     // Cancel installation if it's running
     if (m_installWatcher && !m_installWatcher->isFinished()) {
         m_installWatcher->cancel();
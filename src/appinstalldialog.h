@@ -21,9 +21,11 @@
 #define APPINSTALLDIALOG_H
 
 #include "appdownloadbasedialog.h"
+#include "ipadeploymentengine.h"
 #include <QComboBox>
 #include <QDialog>
 #include <QFutureWatcher>
+#include <QHash>
 #include <QLabel>
 #include <QTemporaryDir>
 #include <QNetworkAccessManager>
@@ -51,8 +53,12 @@ private:
     QFutureWatcher<int> *m_installWatcher;
     QTemporaryDir *m_tempDir = nullptr;
     QNetworkAccessManager *m_manager = nullptr;
+    quint64 m_deploymentId = 0;
+    QHash<QString, IpaDeviceStatus> m_deployStatus;
     void updateDeviceList();
     void performInstallation(const QString &ipaPath, const QString &deviceUdid);
+    void deployToAllDevices(const QString &ipaPath);
+    void onDeploymentFinished(int succeeded, int failed);
 };
 
 #endif // APPINSTALLDIALOG_H
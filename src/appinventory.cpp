@@ -0,0 +1,311 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "appinventory.h"
+#include <QDebug>
+#include <QtConcurrent/QtConcurrent>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <libimobiledevice/installation_proxy.h>
+#include <mutex>
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// Shared between the waiting browse and the instproxy status thread
+struct BrowseContext {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    QString error;
+    Clock::time_point lastActivity = Clock::now();
+    std::function<void(QList<InstalledApp>)> onPage;
+};
+
+InstalledApp parseApp(plist_t info)
+{
+    PlistNavigator app(info);
+    InstalledApp result;
+    result.bundleId =
+        QString::fromStdString(app["CFBundleIdentifier"].getString());
+    result.displayName =
+        QString::fromStdString(app["CFBundleDisplayName"].getString());
+    if (result.displayName.isEmpty())
+        result.displayName = result.bundleId;
+    result.version =
+        QString::fromStdString(app["CFBundleShortVersionString"].getString());
+    result.type = QString::fromStdString(app["ApplicationType"].getString());
+    result.fileSharingEnabled = app["UIFileSharingEnabled"].getBool();
+    result.staticDiskUsage = app["StaticDiskUsage"].getUInt();
+    result.dynamicDiskUsage = app["DynamicDiskUsage"].getUInt();
+    return result;
+}
+
+void browseCallback(plist_t command, plist_t status, void *userData)
+{
+    Q_UNUSED(command)
+    auto *context = static_cast<BrowseContext *>(userData);
+
+    QList<InstalledApp> page;
+    plist_t list = plist_dict_get_item(status, "CurrentList");
+    if (list && plist_get_node_type(list) == PLIST_ARRAY) {
+        uint32_t count = plist_array_get_size(list);
+        page.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            InstalledApp app = parseApp(plist_array_get_item(list, i));
+            // "Any" also returns hidden internal apps
+            if (app.bundleId.isEmpty() ||
+                (app.type != "User" && app.type != "System"))
+                continue;
+            page.append(app);
+        }
+    }
+    if (!page.isEmpty())
+        context->onPage(std::move(page));
+
+    char *name = nullptr;
+    char *description = nullptr;
+    uint64_t code = 0;
+    instproxy_error_t err =
+        instproxy_status_get_error(status, &name, &description, &code);
+    char *statusName = nullptr;
+    instproxy_status_get_name(status, &statusName);
+
+    {
+        std::lock_guard<std::mutex> lock(context->mutex);
+        context->lastActivity = Clock::now();
+        if (err != INSTPROXY_E_SUCCESS) {
+            context->error = QString("Browsing apps failed: %1")
+                                 .arg(description ? description
+                                      : name      ? name
+                                                  : "unknown error");
+            context->done = true;
+        } else if (statusName && strcmp(statusName, "Complete") == 0) {
+            context->done = true;
+        }
+    }
+    context->cv.notify_one();
+
+    free(name);
+    free(description);
+    free(statusName);
+}
+} // namespace
+
+AppInventory *AppInventory::sharedInstance()
+{
+    static AppInventory self;
+    return &self;
+}
+
+AppInventory::AppInventory(QObject *parent) : QObject(parent) {}
+
+AppInventory::~AppInventory()
+{
+    for (Browse &browse : m_browses) {
+        browse.cancelled->store(true);
+        browse.future.waitForFinished();
+    }
+}
+
+QList<InstalledApp> AppInventory::apps(const QString &udid) const
+{
+    return m_snapshots.value(udid).values();
+}
+
+bool AppInventory::isRefreshing(const QString &udid) const
+{
+    return m_browses.contains(udid);
+}
+
+quint64 AppInventory::userAppsDiskUsage(const QString &udid) const
+{
+    quint64 total = 0;
+    for (const InstalledApp &app : m_snapshots.value(udid)) {
+        if (app.type == "User")
+            total += app.staticDiskUsage + app.dynamicDiskUsage;
+    }
+    return total;
+}
+
+void AppInventory::refresh(iDescriptorDevice *device)
+{
+    if (!device || !device->device)
+        return;
+
+    const QString udid = QString::fromStdString(device->udid);
+    if (m_browses.contains(udid))
+        return;
+
+    Browse &running = m_browses[udid];
+    running.id = m_nextBrowseId++;
+    running.cancelled = std::make_shared<std::atomic<bool>>(false);
+
+    const quint64 browseId = running.id;
+    auto cancelled = running.cancelled;
+    idevice_t idevice = device->device;
+
+    running.future = QtConcurrent::run([this, udid, browseId, cancelled,
+                                       idevice]() {
+        auto onPage = [this, udid, browseId](QList<InstalledApp> page) {
+            QMetaObject::invokeMethod(
+                this,
+                [this, udid, browseId, page = std::move(page)]() {
+                    applyPage(udid, browseId, page);
+                },
+                Qt::QueuedConnection);
+        };
+
+        QString error = browse(idevice, *cancelled, onPage);
+        QMetaObject::invokeMethod(
+            this,
+            [this, udid, browseId, error]() {
+                finishBrowse(udid, browseId, error);
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+QString
+AppInventory::browse(idevice_t device, const std::atomic<bool> &cancelled,
+                     const std::function<void(QList<InstalledApp>)> &onPage)
+{
+    instproxy_client_t instproxy = nullptr;
+    if (instproxy_client_start_service(device, &instproxy, APP_LABEL) !=
+        INSTPROXY_E_SUCCESS) {
+        return "Could not connect to installation proxy";
+    }
+
+    // Everything the apps page and the disk usage widget need, in one go
+    plist_t clientOpts = instproxy_client_options_new();
+    instproxy_client_options_add(clientOpts, "ApplicationType", "Any",
+                                 nullptr);
+    instproxy_client_options_set_return_attributes(
+        clientOpts, "CFBundleIdentifier", "CFBundleDisplayName",
+        "CFBundleShortVersionString", "ApplicationType",
+        "UIFileSharingEnabled", "StaticDiskUsage", "DynamicDiskUsage",
+        nullptr);
+
+    BrowseContext context;
+    context.onPage = onPage;
+
+    QString error;
+    if (instproxy_browse_with_callback(instproxy, clientOpts, browseCallback,
+                                       &context) != INSTPROXY_E_SUCCESS) {
+        error = "Could not browse installed apps";
+    } else {
+        std::unique_lock<std::mutex> lock(context.mutex);
+        const auto timeout =
+            std::chrono::milliseconds(APP_INVENTORY_BROWSE_TIMEOUT_MS);
+        while (!context.done && !cancelled.load()) {
+            context.cv.wait_for(lock, std::chrono::milliseconds(200));
+            if (!context.done &&
+                Clock::now() - context.lastActivity > timeout) {
+                context.error = "Timed out browsing installed apps";
+                break;
+            }
+        }
+        if (cancelled.load() && !context.done)
+            context.error = "Cancelled";
+        error = context.error;
+    }
+    instproxy_client_options_free(clientOpts);
+
+    // Joins the status thread, the callback no longer touches the context
+    // once this returns
+    instproxy_client_free(instproxy);
+    return error;
+}
+
+void AppInventory::applyPage(const QString &udid, quint64 browseId,
+                             const QList<InstalledApp> &page)
+{
+    auto it = m_browses.find(udid);
+    if (it == m_browses.end() || it->id != browseId)
+        return;
+
+    QHash<QString, InstalledApp> &snapshot = m_snapshots[udid];
+    QList<InstalledApp> added;
+    QList<InstalledApp> updated;
+
+    for (const InstalledApp &app : page) {
+        it->seen.insert(app.bundleId);
+        auto existing = snapshot.find(app.bundleId);
+        if (existing == snapshot.end()) {
+            snapshot.insert(app.bundleId, app);
+            added.append(app);
+        } else if (*existing != app) {
+            *existing = app;
+            updated.append(app);
+        }
+    }
+
+    if (!added.isEmpty())
+        emit appsAdded(udid, added);
+    if (!updated.isEmpty())
+        emit appsUpdated(udid, updated);
+}
+
+void AppInventory::finishBrowse(const QString &udid, quint64 browseId,
+                                const QString &error)
+{
+    auto it = m_browses.find(udid);
+    if (it == m_browses.end() || it->id != browseId)
+        return;
+
+    QSet<QString> seen = std::move(it->seen);
+    m_browses.erase(it);
+
+    if (!error.isEmpty()) {
+        qDebug() << "AppInventory:" << error << udid;
+        emit refreshFinished(udid, false, error);
+        return;
+    }
+
+    // Only a complete browse can tell which apps are gone
+    QHash<QString, InstalledApp> &snapshot = m_snapshots[udid];
+    QStringList removed;
+    for (auto app = snapshot.begin(); app != snapshot.end();) {
+        if (!seen.contains(app.key())) {
+            removed.append(app.key());
+            app = snapshot.erase(app);
+        } else {
+            ++app;
+        }
+    }
+
+    if (!removed.isEmpty())
+        emit appsRemoved(udid, removed);
+    emit refreshFinished(udid, true, QString());
+}
+
+void AppInventory::removeDevice(const std::string &udid)
+{
+    auto it = m_browses.find(QString::fromStdString(udid));
+    if (it == m_browses.end())
+        return;
+
+    // The browse fails fast on an unplugged device. The snapshot is kept,
+    // it is diffed against the next browse when the device comes back.
+    it->cancelled->store(true);
+    it->future.waitForFinished();
+    m_browses.erase(it);
+}
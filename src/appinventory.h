@@ -0,0 +1,112 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef APPINVENTORY_H
+#define APPINVENTORY_H
+
+#include "iDescriptor.h"
+#include <QFuture>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// A browse is given up when the device sends nothing for this long
+#define APP_INVENTORY_BROWSE_TIMEOUT_MS 30000
+
+struct InstalledApp {
+    QString bundleId;
+    QString displayName;
+    QString version;
+    // "User" or "System"
+    QString type;
+    bool fileSharingEnabled = false;
+    quint64 staticDiskUsage = 0;
+    quint64 dynamicDiskUsage = 0;
+
+    bool operator==(const InstalledApp &other) const = default;
+};
+
+/**
+ * @brief Shared per-device inventory of installed apps
+ *
+ * One instproxy_browse_with_callback per refresh fetches every attribute the
+ * UI needs for both User and System apps, pages are handed out while the
+ * device is still sending them. The result is kept per device, a refresh is
+ * diffed against it so a revisit shows the last known list at once and only
+ * changed rows are touched afterwards. Refreshes of the same device started
+ * while one is running share it.
+ *
+ * Must only be used from the GUI thread, all signals are emitted there.
+ */
+class AppInventory : public QObject
+{
+    Q_OBJECT
+
+public:
+    static AppInventory *sharedInstance();
+
+    // Apps known from earlier or running browses, empty if never browsed
+    QList<InstalledApp> apps(const QString &udid) const;
+    bool isRefreshing(const QString &udid) const;
+    // Static and dynamic disk usage summed over User apps
+    quint64 userAppsDiskUsage(const QString &udid) const;
+
+    void refresh(iDescriptorDevice *device);
+    // Waits for a running browse, must be called before the device is freed
+    void removeDevice(const std::string &udid);
+
+signals:
+    void appsAdded(const QString &udid, const QList<InstalledApp> &apps);
+    void appsUpdated(const QString &udid, const QList<InstalledApp> &apps);
+    void appsRemoved(const QString &udid, const QStringList &bundleIds);
+    void refreshFinished(const QString &udid, bool success,
+                         const QString &error);
+
+private:
+    struct Browse {
+        quint64 id = 0;
+        QFuture<void> future;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+        QSet<QString> seen;
+    };
+
+    explicit AppInventory(QObject *parent = nullptr);
+    ~AppInventory();
+
+    // Returns an empty string on success
+    static QString
+    browse(idevice_t device, const std::atomic<bool> &cancelled,
+           const std::function<void(QList<InstalledApp>)> &onPage);
+    void applyPage(const QString &udid, quint64 browseId,
+                   const QList<InstalledApp> &page);
+    void finishBrowse(const QString &udid, quint64 browseId,
+                      const QString &error);
+
+    QHash<QString, QHash<QString, InstalledApp>> m_snapshots;
+    QHash<QString, Browse> m_browses;
+    quint64 m_nextBrowseId = 1;
+};
+
+#endif // APPINVENTORY_H
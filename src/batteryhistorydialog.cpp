@@ -0,0 +1,293 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "batteryhistorydialog.h"
+#include "appcontext.h"
+#include <QComboBox>
+#include <QDateTime>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPainter>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+BatteryGraphWidget::BatteryGraphWidget(QWidget *parent) : QWidget(parent)
+{
+    setMinimumSize(480, 240);
+}
+
+void BatteryGraphWidget::setSamples(const QVector<BatterySample> &samples)
+{
+    m_samples = samples;
+    update();
+}
+
+void BatteryGraphWidget::appendSample(const BatterySample &sample)
+{
+    if (m_samples.size() >= BATTERY_TELEMETRY_HISTORY_SIZE) {
+        m_samples.removeFirst();
+    }
+    m_samples.append(sample);
+    update();
+}
+
+void BatteryGraphWidget::setMetric(Metric metric)
+{
+    m_metric = metric;
+    update();
+}
+
+double BatteryGraphWidget::value(const BatterySample &sample, Metric metric)
+{
+    switch (metric) {
+    case Voltage:
+        return sample.voltageMv / 1000.0;
+    case Power:
+        return sample.powerMw / 1000.0;
+    case Temperature:
+        return sample.temperature / 100.0;
+    case Level:
+    default:
+        return sample.level;
+    }
+}
+
+QString BatteryGraphWidget::unit(Metric metric)
+{
+    switch (metric) {
+    case Voltage:
+        return "V";
+    case Power:
+        return "W";
+    case Temperature:
+        return "°C";
+    case Level:
+    default:
+        return "%";
+    }
+}
+
+void BatteryGraphWidget::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+
+    const QFontMetrics metrics(font());
+    const int labelWidth = metrics.horizontalAdvance("-000.00 °C");
+    const QRectF plot =
+        QRectF(rect()).adjusted(labelWidth + 8, 8, -8, -metrics.height() - 8);
+
+    painter.setPen(palette().color(QPalette::Mid));
+    painter.drawRect(plot);
+
+    painter.setPen(palette().color(QPalette::Text));
+    if (m_samples.size() < 2) {
+        painter.drawText(plot, Qt::AlignCenter, "Waiting for samples...");
+        return;
+    }
+
+    double minValue = value(m_samples.first(), m_metric);
+    double maxValue = minValue;
+    for (const BatterySample &sample : m_samples) {
+        const double v = value(sample, m_metric);
+        minValue = qMin(minValue, v);
+        maxValue = qMax(maxValue, v);
+    }
+    if (maxValue - minValue < 1e-6) {
+        minValue -= 1;
+        maxValue += 1;
+    }
+
+    const qint64 start = m_samples.first().timestamp;
+    const qint64 span = qMax<qint64>(1, m_samples.last().timestamp - start);
+    auto toY = [&](double v) {
+        return plot.bottom() -
+               (v - minValue) / (maxValue - minValue) * plot.height();
+    };
+
+    /* A long history has many samples per pixel column. Drawing each
+       column's min and max keeps spikes visible at a fraction of the
+       points. */
+    const int columns = qMax(1, int(plot.width()));
+    QPolygonF line;
+    int column = -1;
+    double columnMin = 0, columnMax = 0;
+    auto flush = [&]() {
+        if (column < 0) {
+            return;
+        }
+        const double x = plot.left() + column;
+        line.append(QPointF(x, toY(columnMin)));
+        if (columnMax != columnMin) {
+            line.append(QPointF(x, toY(columnMax)));
+        }
+    };
+    for (const BatterySample &sample : m_samples) {
+        const int c = (sample.timestamp - start) * (columns - 1) / span;
+        const double v = value(sample, m_metric);
+        if (c != column) {
+            flush();
+            column = c;
+            columnMin = columnMax = v;
+        } else {
+            columnMin = qMin(columnMin, v);
+            columnMax = qMax(columnMax, v);
+        }
+    }
+    flush();
+
+    painter.setPen(QPen(QColor("#44bd32"), 1.5));
+    painter.drawPolyline(line);
+
+    painter.setPen(palette().color(QPalette::Text));
+    const QString suffix = " " + unit(m_metric);
+    const QRectF labels(0, plot.top(), labelWidth, plot.height());
+    painter.drawText(labels, Qt::AlignRight | Qt::AlignTop,
+                     QString::number(maxValue, 'f', 2) + suffix);
+    painter.drawText(labels, Qt::AlignRight | Qt::AlignBottom,
+                     QString::number(minValue, 'f', 2) + suffix);
+
+    const QRectF times(plot.left(), plot.bottom() + 4, plot.width(),
+                       metrics.height());
+    painter.drawText(
+        times, Qt::AlignLeft,
+        QDateTime::fromMSecsSinceEpoch(start).toString("HH:mm:ss"));
+    painter.drawText(times, Qt::AlignRight,
+                     QDateTime::fromMSecsSinceEpoch(m_samples.last().timestamp)
+                         .toString("HH:mm:ss"));
+}
+
+BatteryHistoryDialog::BatteryHistoryDialog(iDescriptorDevice *device,
+                                           QWidget *parent)
+    : QDialog(parent), m_device(device)
+{
+    setWindowTitle("Battery History - iDescriptor");
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    QHBoxLayout *controls = new QHBoxLayout();
+    m_metricCombo = new QComboBox();
+    m_metricCombo->addItem("Battery Level", BatteryGraphWidget::Level);
+    m_metricCombo->addItem("Voltage", BatteryGraphWidget::Voltage);
+    m_metricCombo->addItem("Power", BatteryGraphWidget::Power);
+    m_metricCombo->addItem("Temperature", BatteryGraphWidget::Temperature);
+    controls->addWidget(m_metricCombo);
+
+    // Fixed rates are meant for burn-in tests that need evenly spaced data
+    m_intervalCombo = new QComboBox();
+    m_intervalCombo->addItem("Adaptive sampling", 0);
+    for (int seconds : {5, 10, 30}) {
+        m_intervalCombo->addItem(QString("Every %1 s").arg(seconds),
+                                 seconds * 1000);
+    }
+    const int fixedInterval =
+        BatteryTelemetry::sharedInstance()->fixedInterval(device->udid);
+    const int index = m_intervalCombo->findData(fixedInterval);
+    m_intervalCombo->setCurrentIndex(qMax(0, index));
+    controls->addWidget(m_intervalCombo);
+
+    controls->addStretch();
+    m_exportButton = new QPushButton("Export CSV...");
+    controls->addWidget(m_exportButton);
+    layout->addLayout(controls);
+
+    m_graph = new BatteryGraphWidget();
+    m_graph->setSamples(
+        BatteryTelemetry::sharedInstance()->history(device->udid));
+    layout->addWidget(m_graph, 1);
+
+    m_summaryLabel = new QLabel();
+    layout->addWidget(m_summaryLabel);
+    updateSummary();
+
+    connect(m_metricCombo, &QComboBox::currentIndexChanged, this,
+            [this](int index) {
+                m_graph->setMetric(static_cast<BatteryGraphWidget::Metric>(
+                    m_metricCombo->itemData(index).toInt()));
+            });
+    connect(m_intervalCombo, &QComboBox::currentIndexChanged, this,
+            &BatteryHistoryDialog::onIntervalChanged);
+    connect(m_exportButton, &QPushButton::clicked, this,
+            &BatteryHistoryDialog::onExportClicked);
+    connect(BatteryTelemetry::sharedInstance(), &BatteryTelemetry::sampleAdded,
+            this, &BatteryHistoryDialog::onSampleAdded);
+    connect(AppContext::sharedInstance(), &AppContext::deviceRemoved, this,
+            [this](const std::string &udid) {
+                if (m_device->udid == udid) {
+                    close();
+                }
+            });
+}
+
+void BatteryHistoryDialog::onSampleAdded(const std::string &udid,
+                                         const BatterySample &sample)
+{
+    if (udid != m_device->udid) {
+        return;
+    }
+    m_graph->appendSample(sample);
+    updateSummary();
+}
+
+void BatteryHistoryDialog::onIntervalChanged(int index)
+{
+    BatteryTelemetry::sharedInstance()->setFixedInterval(
+        m_device->udid, m_intervalCombo->itemData(index).toInt());
+}
+
+void BatteryHistoryDialog::onExportClicked()
+{
+    const QString path = QFileDialog::getSaveFileName(
+        this, "Export Battery History",
+        QString("battery-%1.csv")
+            .arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss")),
+        "CSV Files (*.csv)");
+    if (path.isEmpty()) {
+        return;
+    }
+
+    QString error;
+    if (!BatteryTelemetry::exportCsv(m_graph->samples(), path, &error)) {
+        QMessageBox::warning(this, "Export Failed",
+                             "Could not export the battery history: " + error);
+    }
+}
+
+void BatteryHistoryDialog::updateSummary()
+{
+    const QVector<BatterySample> &samples = m_graph->samples();
+    if (samples.isEmpty()) {
+        m_summaryLabel->setText("No samples yet");
+        return;
+    }
+
+    const BatterySample &latest = samples.last();
+    m_summaryLabel->setText(
+        QString("%1 samples since %2 | %3% %4 | %5 V | %6 W | %7 °C")
+            .arg(samples.size())
+            .arg(QDateTime::fromMSecsSinceEpoch(samples.first().timestamp)
+                     .toString("HH:mm:ss"))
+            .arg(int(latest.level))
+            .arg(latest.charging ? "charging" : "discharging")
+            .arg(latest.voltageMv / 1000.0, 0, 'f', 2)
+            .arg(latest.powerMw / 1000.0, 0, 'f', 2)
+            .arg(latest.temperature / 100.0, 0, 'f', 1));
+}
@@ -0,0 +1,83 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATTERYHISTORYDIALOG_H
+#define BATTERYHISTORYDIALOG_H
+
+#include "batterytelemetry.h"
+#include "iDescriptor.h"
+#include <QDialog>
+#include <QVector>
+#include <QWidget>
+
+class QComboBox;
+class QLabel;
+class QPushButton;
+
+// Plots one value of a battery history, several samples per pixel column are
+// drawn as their min/max range
+class BatteryGraphWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    enum Metric { Level, Voltage, Power, Temperature };
+
+    explicit BatteryGraphWidget(QWidget *parent = nullptr);
+
+    void setSamples(const QVector<BatterySample> &samples);
+    // Drops the oldest sample once BATTERY_TELEMETRY_HISTORY_SIZE is reached
+    void appendSample(const BatterySample &sample);
+    void setMetric(Metric metric);
+    const QVector<BatterySample> &samples() const { return m_samples; }
+
+    static double value(const BatterySample &sample, Metric metric);
+    static QString unit(Metric metric);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    QVector<BatterySample> m_samples;
+    Metric m_metric = Level;
+};
+
+class BatteryHistoryDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit BatteryHistoryDialog(iDescriptorDevice *device,
+                                  QWidget *parent = nullptr);
+
+private slots:
+    void onSampleAdded(const std::string &udid, const BatterySample &sample);
+    void onIntervalChanged(int index);
+    void onExportClicked();
+
+private:
+    void updateSummary();
+
+    iDescriptorDevice *m_device;
+    BatteryGraphWidget *m_graph;
+    QComboBox *m_metricCombo;
+    QComboBox *m_intervalCombo;
+    QPushButton *m_exportButton;
+    QLabel *m_summaryLabel;
+};
+
+#endif // BATTERYHISTORYDIALOG_H
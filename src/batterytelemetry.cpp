@@ -0,0 +1,286 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "batterytelemetry.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QTimer>
+#include <QtConcurrent/QtConcurrent>
+#include <cstdlib>
+
+BatteryTelemetry *BatteryTelemetry::sharedInstance()
+{
+    static BatteryTelemetry self;
+    return &self;
+}
+
+BatteryTelemetry::BatteryTelemetry(QObject *parent) : QObject(parent)
+{
+    m_pool.setMaxThreadCount(BATTERY_TELEMETRY_MAX_THREADS);
+}
+
+BatteryTelemetry::~BatteryTelemetry() { m_pool.waitForDone(); }
+
+static bool parseSample(plist_t diagnostics, bool oldDevice, BatteryInfo &info,
+                        BatterySample &sample)
+{
+    PlistNavigator ioreg = PlistNavigator(diagnostics)["IORegistry"];
+    if (!ioreg.valid()) {
+        return false;
+    }
+
+    // Reuses the bring-up parsers so the live values match the first read
+    DeviceInfo parsed;
+    if (oldDevice) {
+        parseOldDeviceBattery(ioreg, parsed);
+    } else {
+        parseDeviceBattery(ioreg, parsed);
+    }
+    info = parsed.batteryInfo;
+
+    // Prefer the instantaneous current, Amperage is averaged over a minute
+    PlistNavigator amperage = ioreg["InstantAmperage"];
+    if (!amperage.valid()) {
+        amperage = ioreg["Amperage"];
+    }
+    const int64_t voltage = ioreg["Voltage"].getInt();
+
+    sample.timestamp = QDateTime::currentMSecsSinceEpoch();
+    sample.level = qBound<uint64_t>(0, info.currentBatteryLevel, 100);
+    sample.charging = info.isCharging;
+    sample.voltageMv = qBound<int64_t>(0, voltage, 0xffff);
+    sample.powerMw = voltage * amperage.getInt() / 1000;
+    sample.temperature = qBound<int64_t>(-32768, ioreg["Temperature"].getInt(),
+                                         32767);
+    sample.adapterWatts = qMin<uint64_t>(info.watts, 0xff);
+    return true;
+}
+
+void BatteryTelemetry::startSampling(iDescriptorDevice *device)
+{
+    auto it = m_devices.find(device->udid);
+    if (it != m_devices.end() && it->second->device == device) {
+        return;
+    }
+
+    auto state = std::make_unique<DeviceState>();
+    state->device = device;
+    state->history.resize(BATTERY_TELEMETRY_HISTORY_SIZE);
+    state->timer = new QTimer(this);
+    state->timer->setSingleShot(true);
+    const std::string udid = device->udid;
+    connect(state->timer, &QTimer::timeout, this,
+            [this, udid]() { sample(udid); });
+
+    // Bring-up has just read the battery, the first sample can wait
+    scheduleNext(*state);
+    m_devices[udid] = std::move(state);
+}
+
+void BatteryTelemetry::removeDevice(const std::string &udid)
+{
+    auto it = m_devices.find(udid);
+    if (it == m_devices.end()) {
+        return;
+    }
+    DeviceState &state = *it->second;
+    delete state.timer;
+    // The query uses the device, it has to finish before it is freed
+    state.inFlight.waitForFinished();
+    m_devices.erase(it);
+}
+
+QVector<BatterySample> BatteryTelemetry::history(const std::string &udid) const
+{
+    auto it = m_devices.find(udid);
+    if (it == m_devices.end()) {
+        return {};
+    }
+    const DeviceState &state = *it->second;
+
+    QVector<BatterySample> samples;
+    samples.reserve(state.count);
+    const int first =
+        (state.next - state.count + BATTERY_TELEMETRY_HISTORY_SIZE) %
+        BATTERY_TELEMETRY_HISTORY_SIZE;
+    for (int i = 0; i < state.count; ++i) {
+        samples.append(
+            state.history[(first + i) % BATTERY_TELEMETRY_HISTORY_SIZE]);
+    }
+    return samples;
+}
+
+void BatteryTelemetry::setFixedInterval(const std::string &udid,
+                                        int intervalMs)
+{
+    auto it = m_devices.find(udid);
+    if (it == m_devices.end()) {
+        return;
+    }
+    DeviceState &state = *it->second;
+    // Slower fixed rates would let the diagnostics session expire between
+    // samples, same as the adaptive maximum
+    state.fixedIntervalMs =
+        qBound(0, intervalMs, BATTERY_TELEMETRY_MAX_INTERVAL_MS);
+    state.intervalMs = BATTERY_TELEMETRY_MIN_INTERVAL_MS;
+    if (!state.inFlight.isRunning()) {
+        scheduleNext(state);
+    }
+}
+
+int BatteryTelemetry::fixedInterval(const std::string &udid) const
+{
+    auto it = m_devices.find(udid);
+    return it == m_devices.end() ? 0 : it->second->fixedIntervalMs;
+}
+
+void BatteryTelemetry::scheduleNext(DeviceState &state)
+{
+    state.timer->start(state.fixedIntervalMs > 0 ? state.fixedIntervalMs
+                                                 : state.intervalMs);
+}
+
+void BatteryTelemetry::sample(const std::string &udid)
+{
+    auto it = m_devices.find(udid);
+    if (it == m_devices.end() || it->second->inFlight.isRunning()) {
+        return;
+    }
+    DeviceState &state = *it->second;
+    iDescriptorDevice *device = state.device;
+    const bool oldDevice = device->deviceInfo.oldDevice;
+
+    state.inFlight = QtConcurrent::run(&m_pool, [this, udid, device,
+                                                 oldDevice]() {
+        plist_t diagnostics = nullptr;
+        get_battery_info(device, diagnostics);
+
+        BatteryInfo info;
+        BatterySample sample;
+        bool success = false;
+        if (diagnostics) {
+            success = parseSample(diagnostics, oldDevice, info, sample);
+            plist_free(diagnostics);
+        }
+        QMetaObject::invokeMethod(
+            this,
+            [this, udid, device, success, info, sample]() {
+                onSampled(udid, device, success, info, sample);
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+void BatteryTelemetry::onSampled(const std::string &udid,
+                                 iDescriptorDevice *device, bool success,
+                                 const BatteryInfo &info,
+                                 const BatterySample &sample)
+{
+    auto it = m_devices.find(udid);
+    if (it == m_devices.end() || it->second->device != device) {
+        return;
+    }
+    DeviceState &state = *it->second;
+
+    if (!success) {
+        qDebug() << "Battery sample failed for" << QString::fromStdString(udid);
+        state.intervalMs =
+            qMin(state.intervalMs * 2, BATTERY_TELEMETRY_MAX_INTERVAL_MS);
+        scheduleNext(state);
+        return;
+    }
+
+    bool active = true;
+    if (state.count > 0) {
+        const BatterySample &last =
+            state.history[(state.next - 1 + BATTERY_TELEMETRY_HISTORY_SIZE) %
+                          BATTERY_TELEMETRY_HISTORY_SIZE];
+        active = last.level != sample.level ||
+                 last.charging != sample.charging ||
+                 last.adapterWatts != sample.adapterWatts ||
+                 std::abs(last.powerMw - sample.powerMw) >=
+                     BATTERY_TELEMETRY_POWER_DELTA_MW ||
+                 std::abs(last.temperature - sample.temperature) >=
+                     BATTERY_TELEMETRY_TEMPERATURE_DELTA;
+    }
+    state.history[state.next] = sample;
+    state.next = (state.next + 1) % BATTERY_TELEMETRY_HISTORY_SIZE;
+    state.count = qMin(state.count + 1, BATTERY_TELEMETRY_HISTORY_SIZE);
+
+    state.intervalMs =
+        active ? BATTERY_TELEMETRY_MIN_INTERVAL_MS
+               : qMin(state.intervalMs * 2, BATTERY_TELEMETRY_MAX_INTERVAL_MS);
+    scheduleNext(state);
+
+    // Only the live values, health and cycle count come from bring-up
+    BatteryInfo &current = device->deviceInfo.batteryInfo;
+    const bool changed = current.isCharging != info.isCharging ||
+                         current.fullyCharged != info.fullyCharged ||
+                         current.currentBatteryLevel !=
+                             info.currentBatteryLevel ||
+                         current.usbConnectionType != info.usbConnectionType ||
+                         current.adapterVoltage != info.adapterVoltage ||
+                         current.watts != info.watts;
+    current.isCharging = info.isCharging;
+    current.fullyCharged = info.fullyCharged;
+    current.currentBatteryLevel = info.currentBatteryLevel;
+    current.usbConnectionType = info.usbConnectionType;
+    current.adapterVoltage = info.adapterVoltage;
+    current.watts = info.watts;
+
+    emit sampleAdded(udid, sample);
+    if (changed) {
+        emit batteryInfoChanged(device);
+    }
+}
+
+bool BatteryTelemetry::exportCsv(const QVector<BatterySample> &samples,
+                                 const QString &path, QString *error)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "timestamp,level_percent,charging,voltage_mv,power_mw,"
+           "adapter_watts,temperature_c\n";
+    for (const BatterySample &sample : samples) {
+        out << QDateTime::fromMSecsSinceEpoch(sample.timestamp, Qt::UTC)
+                   .toString(Qt::ISODateWithMs)
+            << ',' << int(sample.level) << ',' << (sample.charging ? 1 : 0)
+            << ',' << sample.voltageMv << ',' << sample.powerMw << ','
+            << int(sample.adapterWatts) << ','
+            << QString::number(sample.temperature / 100.0, 'f', 2) << '\n';
+    }
+    out.flush();
+
+    if (!file.commit()) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,124 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATTERYTELEMETRY_H
+#define BATTERYTELEMETRY_H
+
+#include "iDescriptor.h"
+#include <QFuture>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+class QTimer;
+
+// Samples kept per device, 24 hours at the fastest rate
+#define BATTERY_TELEMETRY_HISTORY_SIZE 17280
+// Sampling speeds up to the minimum interval while values change and backs
+// off towards the maximum while they hold still. The maximum stays below
+// SERVICE_SESSION_IDLE_TIMEOUT_MS so the diagnostics session is kept open.
+#define BATTERY_TELEMETRY_MIN_INTERVAL_MS 5000
+#define BATTERY_TELEMETRY_MAX_INTERVAL_MS 30000
+// Smallest changes that count as activity for the adaptive rate
+#define BATTERY_TELEMETRY_POWER_DELTA_MW 250
+#define BATTERY_TELEMETRY_TEMPERATURE_DELTA 50 // hundredths of a degree
+// Devices queried at the same time
+#define BATTERY_TELEMETRY_MAX_THREADS 2
+
+// One reading of IOPMPowerSource, packed to keep long histories small
+struct BatterySample {
+    qint64 timestamp = 0; // ms since epoch
+    qint32 powerMw = 0;   // into the battery, negative while discharging
+    quint16 voltageMv = 0;
+    qint16 temperature = 0; // hundredths of a degree Celsius
+    quint8 level = 0;       // percent
+    quint8 adapterWatts = 0;
+    bool charging = false;
+};
+
+/**
+ * @brief Samples battery telemetry of every connected device in the
+ * background
+ *
+ * Each sample is one IOPMPowerSource query over the device's cached
+ * diagnostics_relay session, parsed on a worker thread. The live values in
+ * deviceInfo.batteryInfo are updated in place and batteryInfoChanged() is only
+ * emitted when they differ from the previous sample. Every sample is also
+ * appended to a fixed-size history of BATTERY_TELEMETRY_HISTORY_SIZE entries,
+ * the oldest are overwritten.
+ *
+ * Must only be used from the GUI thread, all signals are emitted there.
+ */
+class BatteryTelemetry : public QObject
+{
+    Q_OBJECT
+
+public:
+    static BatteryTelemetry *sharedInstance();
+
+    // Does nothing when the device is already sampled
+    void startSampling(iDescriptorDevice *device);
+    // Waits for a running sample, must be called before the device is freed
+    void removeDevice(const std::string &udid);
+
+    // Oldest first
+    QVector<BatterySample> history(const std::string &udid) const;
+
+    // Samples at a fixed interval instead of the adaptive one, capped at
+    // BATTERY_TELEMETRY_MAX_INTERVAL_MS. 0 turns adaptive sampling back on
+    void setFixedInterval(const std::string &udid, int intervalMs);
+    int fixedInterval(const std::string &udid) const;
+
+    static bool exportCsv(const QVector<BatterySample> &samples,
+                          const QString &path, QString *error = nullptr);
+
+signals:
+    void sampleAdded(const std::string &udid, const BatterySample &sample);
+    void batteryInfoChanged(iDescriptorDevice *device);
+
+private:
+    struct DeviceState {
+        iDescriptorDevice *device = nullptr;
+        QTimer *timer = nullptr;
+        QFuture<void> inFlight;
+        QVector<BatterySample> history; // ring of HISTORY_SIZE entries
+        int next = 0;                   // slot of the next sample
+        int count = 0;
+        int intervalMs = BATTERY_TELEMETRY_MIN_INTERVAL_MS;
+        int fixedIntervalMs = 0;
+    };
+
+    explicit BatteryTelemetry(QObject *parent = nullptr);
+    ~BatteryTelemetry();
+
+    void sample(const std::string &udid);
+    void onSampled(const std::string &udid, iDescriptorDevice *device,
+                   bool success, const BatteryInfo &info,
+                   const BatterySample &sample);
+    void scheduleNext(DeviceState &state);
+
+    std::unordered_map<std::string, std::unique_ptr<DeviceState>> m_devices;
+    QThreadPool m_pool;
+};
+
+#endif // BATTERYTELEMETRY_H
@@ -0,0 +1,108 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "blockringbuffer.h"
+#include <QMutexLocker>
+
+BlockRingBuffer::BlockRingBuffer(int blockCount, int blockSize)
+    : m_blockSize(blockSize)
+{
+    for (int i = 0; i < blockCount; ++i) {
+        auto *block = new Block();
+        block->data.resize(blockSize);
+        m_blocks.append(block);
+        m_free.enqueue(block);
+    }
+}
+
+BlockRingBuffer::~BlockRingBuffer() { qDeleteAll(m_blocks); }
+
+BlockRingBuffer::Block *BlockRingBuffer::acquireFree()
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_free.isEmpty() && !m_aborted) {
+        m_freeAvailable.wait(&m_mutex);
+    }
+    if (m_aborted) {
+        return nullptr;
+    }
+    Block *block = m_free.dequeue();
+    block->size = 0;
+    return block;
+}
+
+void BlockRingBuffer::commit(Block *block)
+{
+    QMutexLocker locker(&m_mutex);
+    m_filled.enqueue(block);
+    m_filledAvailable.wakeOne();
+}
+
+void BlockRingBuffer::finish()
+{
+    QMutexLocker locker(&m_mutex);
+    m_finished = true;
+    m_filledAvailable.wakeAll();
+}
+
+BlockRingBuffer::Block *BlockRingBuffer::acquireFilled()
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_filled.isEmpty() && !m_finished && !m_aborted) {
+        m_filledAvailable.wait(&m_mutex);
+    }
+    if (m_aborted || m_filled.isEmpty()) {
+        return nullptr;
+    }
+    return m_filled.dequeue();
+}
+
+void BlockRingBuffer::recycle(Block *block)
+{
+    QMutexLocker locker(&m_mutex);
+    m_free.enqueue(block);
+    m_freeAvailable.wakeOne();
+}
+
+void BlockRingBuffer::abort()
+{
+    QMutexLocker locker(&m_mutex);
+    m_aborted = true;
+    m_freeAvailable.wakeAll();
+    m_filledAvailable.wakeAll();
+}
+
+bool BlockRingBuffer::isAborted() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_aborted;
+}
+
+void BlockRingBuffer::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    m_free.clear();
+    m_filled.clear();
+    for (Block *block : m_blocks) {
+        block->size = 0;
+        m_free.enqueue(block);
+    }
+    m_finished = false;
+    m_aborted = false;
+}
@@ -0,0 +1,84 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLOCKRINGBUFFER_H
+#define BLOCKRINGBUFFER_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QQueue>
+#include <QVector>
+#include <QWaitCondition>
+
+/**
+ * @brief Bounded ring of reusable byte blocks between one producer and one
+ * consumer thread
+ *
+ * The producer takes a free block, fills it and commits it; the consumer takes
+ * committed blocks in order and recycles them when done. Blocks are allocated
+ * once and reused, so a transfer of any size never holds more than
+ * blockCount * blockSize bytes in memory.
+ */
+class BlockRingBuffer
+{
+public:
+    struct Block {
+        QByteArray data;
+        qint64 size = 0; // number of valid bytes in data
+    };
+
+    BlockRingBuffer(int blockCount, int blockSize);
+    ~BlockRingBuffer();
+
+    BlockRingBuffer(const BlockRingBuffer &) = delete;
+    BlockRingBuffer &operator=(const BlockRingBuffer &) = delete;
+
+    int blockSize() const { return m_blockSize; }
+
+    // Producer side, returns nullptr once the ring was aborted
+    Block *acquireFree();
+    void commit(Block *block);
+    // No more blocks will be committed
+    void finish();
+
+    // Consumer side, returns nullptr when finished and drained, or aborted
+    Block *acquireFilled();
+    void recycle(Block *block);
+
+    // Wakes up both sides, pending blocks are dropped
+    void abort();
+    bool isAborted() const;
+
+    // Makes every block free again so the ring can be reused
+    void reset();
+
+private:
+    const int m_blockSize;
+    QVector<Block *> m_blocks;
+    QQueue<Block *> m_free;
+    QQueue<Block *> m_filled;
+    bool m_finished = false;
+    bool m_aborted = false;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_freeAvailable;
+    QWaitCondition m_filledAvailable;
+};
+
+#endif // BLOCKRINGBUFFER_H
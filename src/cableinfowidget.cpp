@@ -82,7 +82,7 @@ void CableInfoWidget::initCableInfo()
     }
 
     m_statusLabel->setText("Analyzing cable...");
-    get_cable_info(m_device->device, m_response);
+    get_cable_info(m_device, m_response);
 
     analyzeCableInfo();
     updateUI();
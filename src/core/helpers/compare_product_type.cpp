@@ -18,9 +18,10 @@
  */
 
 // TODO: move function declarations to a header file
-#include <regex>
+#include <charconv>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 
 struct ProductTypeVersion {
     int major;
@@ -61,21 +62,40 @@ struct ProductTypeVersion {
 // Example: "iPhone8,1" -> ProductTypeVersion{8, 1}
 ProductTypeVersion extractProductTypeVersion(const std::string &productType)
 {
-    // Regex to match iPhone followed by major,minor numbers
-    std::regex pattern(R"(iPhone(\d+),(\d+))");
-    std::smatch matches;
-
-    if (std::regex_search(productType, matches, pattern)) {
-        if (matches.size() >= 3) {
-            try {
-                int major = std::stoi(matches[1].str());
-                int minor = std::stoi(matches[2].str());
-                return ProductTypeVersion(major, minor);
-            } catch (const std::invalid_argument &e) {
-                throw std::invalid_argument(
-                    "Invalid numeric values in product type: " + productType);
-            }
+    // Same as matching iPhone(\d+),(\d+) anywhere in the string, without
+    // building a regex on every call
+    const std::string_view prefix = "iPhone";
+    const std::string_view input = productType;
+    const char *end = input.data() + input.size();
+
+    for (size_t pos = input.find(prefix); pos != std::string_view::npos;
+         pos = input.find(prefix, pos + 1)) {
+        const char *cursor = input.data() + pos + prefix.size();
+        // from_chars would also accept a sign
+        if (cursor == end || *cursor < '0' || *cursor > '9') {
+            continue;
+        }
+        int major = 0;
+        int minor = 0;
+
+        auto [majorEnd, majorErr] = std::from_chars(cursor, end, major);
+        if (majorErr == std::errc::result_out_of_range) {
+            throw std::invalid_argument(
+                "Invalid numeric values in product type: " + productType);
+        }
+        if (majorErr != std::errc() || end - majorEnd < 2 ||
+            *majorEnd != ',' || majorEnd[1] < '0' || majorEnd[1] > '9') {
+            continue;
+        }
+        auto [minorEnd, minorErr] = std::from_chars(majorEnd + 1, end, minor);
+        if (minorErr == std::errc::result_out_of_range) {
+            throw std::invalid_argument(
+                "Invalid numeric values in product type: " + productType);
+        }
+        if (minorErr != std::errc()) {
+            continue;
         }
+        return ProductTypeVersion(major, minor);
     }
 
     throw std::invalid_argument("Invalid iPhone product type format: " +
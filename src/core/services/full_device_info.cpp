@@ -0,0 +1,212 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../../devicedatabase.h"
+#include "../../iDescriptor.h"
+#include <QString>
+#include <QStringList>
+#include <algorithm>
+#include <plist/plist.h>
+#include <stdlib.h>
+#include <string_view>
+
+namespace
+{
+using LockdownFieldSetter = void (*)(DeviceInfo &, plist_t);
+
+struct LockdownField {
+    std::string_view key;
+    LockdownFieldSetter apply;
+};
+
+std::string plistToString(plist_t node)
+{
+    switch (plist_get_node_type(node)) {
+    case PLIST_STRING: {
+        char *value = nullptr;
+        plist_get_string_val(node, &value);
+        std::string result = value ? value : "";
+        free(value);
+        return result;
+    }
+    case PLIST_UINT: {
+        uint64_t value = 0;
+        plist_get_uint_val(node, &value);
+        return std::to_string(value);
+    }
+    case PLIST_BOOLEAN: {
+        uint8_t value = 0;
+        plist_get_bool_val(node, &value);
+        return value ? "true" : "false";
+    }
+    case PLIST_REAL: {
+        double value = 0;
+        plist_get_real_val(node, &value);
+        return std::to_string(value);
+    }
+    default:
+        return "";
+    }
+}
+
+uint64_t plistToUInt(plist_t node)
+{
+    if (plist_get_node_type(node) == PLIST_UINT) {
+        uint64_t value = 0;
+        plist_get_uint_val(node, &value);
+        return value;
+    }
+    // Some iOS versions report capacities as strings
+    return strtoull(plistToString(node).c_str(), nullptr, 10);
+}
+
+template <std::string DeviceInfo::*Field>
+void setString(DeviceInfo &d, plist_t node)
+{
+    d.*Field = plistToString(node);
+}
+
+template <uint64_t DiskInfo::*Field> void setDisk(DeviceInfo &d, plist_t node)
+{
+    d.diskInfo.*Field = plistToUInt(node);
+}
+
+void setProductionDevice(DeviceInfo &d, plist_t node)
+{
+    /* older devices dont have fusing status lets default to ProductionSOC
+     * for now*/
+    uint8_t value = 0;
+    if (plist_get_node_type(node) == PLIST_BOOLEAN) {
+        plist_get_bool_val(node, &value);
+    }
+    d.productionDevice = value;
+}
+
+void setActivationState(DeviceInfo &d, plist_t node)
+{
+    const std::string state = plistToString(node);
+    if (state == "Activated") {
+        d.activationState = DeviceInfo::ActivationState::Activated;
+        // IOS 6
+    } else if (state == "WildcardActivated") {
+        d.activationState =
+            DeviceInfo::ActivationState::Activated; // Treat as activated
+    } else if (state == "FactoryActivated") {
+        d.activationState = DeviceInfo::ActivationState::FactoryActivated;
+    } else {
+        d.activationState = DeviceInfo::ActivationState::Unactivated;
+    }
+}
+
+// Lockdown keys read into DeviceInfo. Sorted by key, every entry of the
+// lockdown dict is looked up with a binary search.
+constexpr LockdownField kLockdownFields[] = {
+    {"ActivationState", setActivationState},
+    {"BluetoothAddress", setString<&DeviceInfo::bluetoothAddress>},
+    {"BuildVersion", setString<&DeviceInfo::buildVersion>},
+    {"CPUArchitecture", setString<&DeviceInfo::cpuArchitecture>},
+    {"DeviceClass", setString<&DeviceInfo::deviceClass>},
+    {"DeviceColor", setString<&DeviceInfo::deviceColor>},
+    {"DeviceName", setString<&DeviceInfo::deviceName>},
+    {"EthernetAddress", setString<&DeviceInfo::ethernetAddress>},
+    {"FirmwareVersion", setString<&DeviceInfo::firmwareVersion>},
+    {"HardwareModel", setString<&DeviceInfo::hardwareModel>},
+    {"HardwarePlatform", setString<&DeviceInfo::hardwarePlatform>},
+    {"MobileEquipmentIdentifier",
+     setString<&DeviceInfo::mobileEquipmentIdentifier>},
+    {"ModelNumber", setString<&DeviceInfo::modelNumber>},
+    {"ProductType", setString<&DeviceInfo::rawProductType>},
+    {"ProductVersion", setString<&DeviceInfo::productVersion>},
+    {"ProductionSOC", setProductionDevice},
+    {"RegionInfo", setString<&DeviceInfo::regionRaw>},
+    {"SerialNumber", setString<&DeviceInfo::serialNumber>},
+    /*
+        For some reason TotalDataAvailable is way inaccrutate for iOS 17 and
+        up, load_device_storage_info replaces it with the AFC figure
+    */
+    {"TotalDataAvailable", setDisk<&DiskInfo::totalDataAvailable>},
+    {"TotalDataCapacity", setDisk<&DiskInfo::totalDataCapacity>},
+    {"TotalDiskCapacity", setDisk<&DiskInfo::totalDiskCapacity>},
+    {"TotalSystemCapacity", setDisk<&DiskInfo::totalSystemCapacity>},
+};
+
+constexpr bool lockdownFieldLess(const LockdownField &a,
+                                 const LockdownField &b)
+{
+    return a.key < b.key;
+}
+
+static_assert(std::is_sorted(std::begin(kLockdownFields),
+                             std::end(kLockdownFields), lockdownFieldLess),
+              "kLockdownFields must be sorted by key");
+} // namespace
+
+DeviceInfo fullDeviceInfo(plist_t info, iDescriptorInitDeviceResult &result)
+{
+    DeviceInfo &d = result.deviceInfo;
+    d.activationState = DeviceInfo::ActivationState::Unactivated;
+
+    // One pass over the lockdown dict, no intermediate serialization
+    plist_dict_iter iter = nullptr;
+    plist_dict_new_iter(info, &iter);
+    if (iter) {
+        char *key = nullptr;
+        plist_t value = nullptr;
+        for (;;) {
+            plist_dict_next_item(info, iter, &key, &value);
+            if (!key) {
+                break;
+            }
+            const std::string_view name(key);
+            const LockdownField *field = std::lower_bound(
+                std::begin(kLockdownFields), std::end(kLockdownFields), name,
+                [](const LockdownField &entry, std::string_view k) {
+                    return entry.key < k;
+                });
+            if (field != std::end(kLockdownFields) && field->key == name) {
+                field->apply(d, value);
+            }
+            free(key);
+            key = nullptr;
+        }
+        free(iter);
+    }
+
+    QString q_version = QString::fromStdString(d.productVersion);
+    QStringList parts = q_version.split('.');
+
+    int major = (parts.length() > 0) ? parts[0].toInt() : 0;
+    int minor = (parts.length() > 1) ? parts[1].toInt() : 0;
+    int patch = (parts.length() > 2) ? parts[2].toInt() : 0;
+
+    d.parsedDeviceVersion = IDEVICE_DEVICE_VERSION(major, minor, patch);
+
+    d.region = DeviceDatabase::parseRegionInfo(d.regionRaw);
+    const DeviceDatabaseInfo *dbInfo =
+        DeviceDatabase::findByIdentifier(d.rawProductType);
+    d.productType =
+        dbInfo ? dbInfo->displayName ? dbInfo->displayName
+                                     : dbInfo->marketingName
+               : "Unknown Device";
+    d.marketingName = dbInfo ? dbInfo->marketingName : "Unknown Device";
+    // Filled in later by the jailbreak probe, see detect_jailbroken
+    d.jailbroken = false;
+    d.is_iPhone = d.deviceClass == "iPhone";
+    return d;
+}
@@ -55,7 +55,6 @@
 #include <libimobiledevice/libimobiledevice.h>
 #include <libimobiledevice/lockdown.h>
 #include <plist/plist.h>
-#include <pugixml.hpp>
 
 #define FORMAT_KEY_VALUE 1
 #define FORMAT_XML 2
@@ -106,20 +105,3 @@ plist_t get_device_info(const char *udid, lockdownd_client_t client,
 
     return node;
 }
-
-void get_device_info_xml(const char *udid, lockdownd_client_t client,
-                         idevice_t device, pugi::xml_document &infoXml)
-{
-    plist_t node = get_device_info(udid, client, device);
-    if (!node)
-        return;
-    char *xml_string = nullptr;
-    uint32_t xml_length = 0;
-    plist_to_xml(node, &xml_string, &xml_length);
-    plist_free(node);
-
-    if (xml_string) {
-        infoXml.load_string(xml_string);
-        free(xml_string);
-    }
-}
\ No newline at end of file
@@ -22,8 +22,56 @@
 #include <iostream>
 #include <libimobiledevice/afc.h>
 #include <libimobiledevice/lockdown.h>
+#include <stdlib.h>
 #include <string.h>
 
+MediaEntry afc_stat_entry(afc_client_t afcClient, const std::string &dirPath,
+                          const std::string &name)
+{
+    MediaEntry entry{name, false};
+
+    std::string fullPath = dirPath;
+    if (fullPath.empty() || fullPath.back() != '/')
+        fullPath += "/";
+    fullPath += name;
+
+    char **info = NULL;
+    if (afc_get_file_info(afcClient, fullPath.c_str(), &info) !=
+            AFC_E_SUCCESS ||
+        !info) {
+        return entry;
+    }
+
+    for (int j = 0; info[j] && info[j + 1]; j += 2) {
+        const char *key = info[j];
+        const char *value = info[j + 1];
+        if (strcmp(key, "st_ifmt") == 0) {
+            entry.isDir = strcmp(value, "S_IFDIR") == 0;
+            entry.isSymlink = strcmp(value, "S_IFLNK") == 0;
+        } else if (strcmp(key, "st_size") == 0) {
+            entry.size = strtoull(value, NULL, 10);
+        } else if (strcmp(key, "st_mtime") == 0) {
+            entry.modificationTime = strtoull(value, NULL, 10);
+        } else if (strcmp(key, "st_birthtime") == 0) {
+            entry.birthTime = strtoull(value, NULL, 10);
+        }
+    }
+    afc_dictionary_free(info);
+
+    if (entry.isSymlink) {
+        // AFC does not resolve links, a link is a directory if we can list it
+        char **dir_contents = NULL;
+        if (afc_read_directory(afcClient, fullPath.c_str(), &dir_contents) ==
+            AFC_E_SUCCESS) {
+            entry.isDir = true;
+            if (dir_contents) {
+                afc_dictionary_free(dir_contents);
+            }
+        }
+    }
+    return entry;
+}
+
 AFCFileTree get_file_tree(afc_client_t afcClient, const std::string &path,
                           bool checkDir)
 {
@@ -42,47 +90,16 @@ AFCFileTree get_file_tree(afc_client_t afcClient, const std::string &path,
         if (entryName == "." || entryName == "..")
             continue;
 
-        char **info = NULL;
-        std::string fullPath = path;
-        if (fullPath.back() != '/')
-            fullPath += "/";
-        fullPath += entryName;
-        bool isDir = false;
-        if (!checkDir) {
-            isDir = false;
-        } else if (afc_get_file_info(afcClient, fullPath.c_str(), &info) ==
-                       AFC_E_SUCCESS &&
-                   info) {
-            if (entryName == "var") {
-                qDebug() << "File info for var:" << info[0] << info[1]
-                         << info[2] << info[3] << info[4] << info[5];
-            }
-            for (int j = 0; info[j]; j += 2) {
-                if (strcmp(info[j], "st_ifmt") == 0) {
-                    if (strcmp(info[j + 1], "S_IFDIR") == 0) {
-                        isDir = true;
-                    } else if (strcmp(info[j + 1], "S_IFLNK") == 0) {
-                        /*symlink*/
-                        char **dir_contents = NULL;
-                        if (afc_read_directory(afcClient, fullPath.c_str(),
-                                               &dir_contents) ==
-                            AFC_E_SUCCESS) {
-                            isDir = true;
-                            if (dir_contents) {
-                                afc_dictionary_free(dir_contents);
-                            }
-                        }
-                    }
-                    break;
-                }
-            }
-            afc_dictionary_free(info);
+        if (checkDir) {
+            result.entries.push_back(
+                afc_stat_entry(afcClient, path, entryName));
+        } else {
+            result.entries.push_back({entryName, false});
         }
-        result.entries.push_back({entryName, isDir});
     }
     if (dirs) {
         afc_dictionary_free(dirs);
     }
     result.success = true;
     return result;
-}
\ No newline at end of file
+}
@@ -149,143 +149,43 @@ void parseDeviceBattery(PlistNavigator &ioreg, DeviceInfo &d)
     d.batteryInfo.watts = ioreg["AppleRawAdapterDetails"][0]["Watts"].getUInt();
 }
 
-DeviceInfo fullDeviceInfo(const pugi::xml_document &doc,
-                          afc_client_t &afcClient,
-                          iDescriptorInitDeviceResult &result)
+bool load_device_storage_info(afc_client_t afcClient, DiskInfo &diskInfo)
 {
-    pugi::xml_node dict = doc.child("plist").child("dict");
-    auto safeGet = [&](const char *key) -> std::string {
-        for (pugi::xml_node child = dict.first_child(); child;
-             child = child.next_sibling()) {
-            if (strcmp(child.name(), "key") == 0 &&
-                strcmp(child.text().as_string(), key) == 0) {
-                pugi::xml_node value = child.next_sibling();
-                if (value)
-                    return value.text().as_string();
-            }
-        }
-        return "";
-    };
-
-    auto safeGetBool = [&](const char *key) -> bool {
-        for (pugi::xml_node child = dict.first_child(); child;
-             child = child.next_sibling()) {
-            if (strcmp(child.name(), "key") == 0 &&
-                strcmp(child.text().as_string(), key) == 0) {
-                pugi::xml_node value = child.next_sibling();
-                if (value && strcmp(value.name(), "true") == 0)
-                    return true;
-                else
-                    return false;
-            }
-        }
+    /*
+        Example : this data seems to be the most accurate
+    */
+    //"Model: iPhone12,8"
+    // "FSTotalBytes: 63966400512"
+    // "FSFreeBytes: 2867101696"
+    // "FSBlockSize: 4096"
+    char **info = NULL;
+    if (afc_get_device_info(afcClient, &info) != AFC_E_SUCCESS || !info) {
         return false;
-    };
-    DeviceInfo &d = result.deviceInfo;
-    d.deviceName = safeGet("DeviceName");
-    d.deviceClass = safeGet("DeviceClass");
-    d.deviceColor = safeGet("DeviceColor");
-    d.modelNumber = safeGet("ModelNumber");
-    d.cpuArchitecture = safeGet("CPUArchitecture");
-    d.buildVersion = safeGet("BuildVersion");
-    d.hardwareModel = safeGet("HardwareModel");
-    d.hardwarePlatform = safeGet("HardwarePlatform");
-    d.ethernetAddress = safeGet("EthernetAddress");
-    d.bluetoothAddress = safeGet("BluetoothAddress");
-    d.firmwareVersion = safeGet("FirmwareVersion");
-    d.productVersion = safeGet("ProductVersion");
-
-    QString q_version = QString::fromStdString(d.productVersion);
-    QStringList parts = q_version.split('.');
-
-    int major = (parts.length() > 0) ? parts[0].toInt() : 0;
-    int minor = (parts.length() > 1) ? parts[1].toInt() : 0;
-    int patch = (parts.length() > 2) ? parts[2].toInt() : 0;
-
-    d.parsedDeviceVersion = IDEVICE_DEVICE_VERSION(major, minor, patch);
-
-    /*DiskInfo*/
+    }
+    bool success = false;
     try {
-        d.diskInfo.totalDiskCapacity =
-            std::stoull(safeGet("TotalDiskCapacity"));
-        d.diskInfo.totalDataCapacity =
-            std::stoull(safeGet("TotalDataCapacity"));
-        d.diskInfo.totalSystemCapacity =
-            std::stoull(safeGet("TotalSystemCapacity"));
-        /*
-            For some reason this is way inaccrutate for iOS 17 and up
-        */
-        d.diskInfo.totalDataAvailable =
-            std::stoull(safeGet("TotalDataAvailable"));
-
-        try {
-            /*
-                Example : this data seems to be the most accurate
-            */
-            //"Model: iPhone12,8"
-            // "FSTotalBytes: 63966400512"
-            // "FSFreeBytes: 2867101696"
-            // "FSBlockSize: 4096"
-            char **info = NULL;
-            afc_get_device_info(afcClient, &info);
-            if (info && info[6]) {
-                d.diskInfo.totalDataAvailable =
-                    std::stoull(std::string(info[5]));
-            }
-            afc_dictionary_free(info);
-        } catch (const std::exception &e) {
-            qDebug() << "Error parsing disk info: " << e.what();
+        if (info[6]) {
+            diskInfo.totalDataAvailable = std::stoull(std::string(info[5]));
+            success = true;
         }
     } catch (const std::exception &e) {
-        qDebug() << e.what();
-        /*It's ok if any of those fails*/
+        qDebug() << "Error parsing disk info: " << e.what();
     }
+    afc_dictionary_free(info);
+    return success;
+}
 
-    std::string _activationState = safeGet("ActivationState");
-
-    /* older devices dont have fusing status lets default to ProductionSOC for
-     * now*/
-    // std::string fStatus = safeGet("FusingStatus");
-    // d.productionDevice = std::stoi(fStatus.empty() ? "0" : fStatus) == 3;
-
-    d.productionDevice = safeGetBool("ProductionSOC");
-    if (_activationState == "Activated") {
-        d.activationState = DeviceInfo::ActivationState::Activated;
-        // IOS 6
-    } else if (_activationState == "WildcardActivated") {
-        d.activationState =
-            DeviceInfo::ActivationState::Activated; // Treat as activated
-    } else if (_activationState == "FactoryActivated") {
-        d.activationState = DeviceInfo::ActivationState::FactoryActivated;
-    } else if (_activationState == "Unactivated") {
-        d.activationState = DeviceInfo::ActivationState::Unactivated;
-    } else {
-        d.activationState =
-            DeviceInfo::ActivationState::Unactivated; // Default value
-    }
-    std::string regionInfo = safeGet("RegionInfo");
-    d.regionRaw = regionInfo;
-    d.region = DeviceDatabase::parseRegionInfo(regionInfo);
-    std::string rawProductType = safeGet("ProductType");
-    const DeviceDatabaseInfo *info =
-        DeviceDatabase::findByIdentifier(rawProductType);
-    d.productType =
-        info ? info->displayName ? info->displayName : info->marketingName
-             : "Unknown Device";
-    d.marketingName = info ? info->marketingName : "Unknown Device";
-    d.rawProductType = rawProductType;
-    d.jailbroken = detect_jailbroken(afcClient);
-    d.is_iPhone = safeGet("DeviceClass") == "iPhone";
-    d.serialNumber = safeGet("SerialNumber");
-    d.mobileEquipmentIdentifier = safeGet("MobileEquipmentIdentifier");
-
-    /*BatteryInfo*/
+bool load_device_battery_info(iDescriptorDevice *device, DeviceInfo &d)
+{
+    const std::string &rawProductType = d.rawProductType;
+
+    // Opens the diagnostics session BatteryTelemetry keeps sampling on
     plist_t diagnostics = nullptr;
-    get_battery_info(rawProductType, result.device, d.is_iPhone, diagnostics);
+    get_battery_info(device, diagnostics);
 
     if (!diagnostics) {
         qDebug() << "Failed to get diagnostics plist.";
-        return d;
+        return false;
     }
     try {
         PlistNavigator ioreg = PlistNavigator(diagnostics)["IORegistry"];
@@ -296,7 +196,7 @@ DeviceInfo fullDeviceInfo(const pugi::xml_document &doc,
             parseOldDevice(ioreg, d);
             plist_free(diagnostics);
             diagnostics = nullptr;
-            return d;
+            return true;
         }
 
         bool newerThaniPhone8 =
@@ -333,10 +233,11 @@ DeviceInfo fullDeviceInfo(const pugi::xml_document &doc,
         plist_free(diagnostics);
         diagnostics = nullptr;
 
-        return d;
+        return true;
     } catch (const std::exception &e) {
         qDebug() << "Error occurred: " << e.what();
-        return d;
+        plist_free(diagnostics);
+        return false;
     }
 }
 
@@ -352,7 +253,7 @@ iDescriptorInitDeviceResult init_idescriptor_device(const char *udid)
     lockdownd_service_descriptor_t lockdownService = nullptr;
     afc_client_t afcClient = nullptr;
     afc_client_t afc2Client = nullptr;
-    pugi::xml_document infoXml;
+    plist_t info = nullptr;
 
     idevice_error_t ret =
         idevice_new_with_options(&device, udid, IDEVICE_LOOKUP_USBMUX);
@@ -394,9 +295,9 @@ iDescriptorInitDeviceResult init_idescriptor_device(const char *udid)
         qDebug() << "AFC2 client created successfully.";
     }
 
-    get_device_info_xml(udid, client, device, infoXml);
+    info = get_device_info(udid, client, device);
 
-    if (infoXml.empty()) {
+    if (!info || plist_get_node_type(info) != PLIST_DICT) {
         qDebug() << "Failed to retrieve device info XML for UDID: "
                  << QString::fromUtf8(udid);
         goto cleanup;
@@ -407,9 +308,13 @@ iDescriptorInitDeviceResult init_idescriptor_device(const char *udid)
     result.device = device;
     result.afcClient = afcClient;
     result.afc2Client = afc2Client;
-    fullDeviceInfo(infoXml, afcClient, result);
+
+    fullDeviceInfo(info, result);
 
 cleanup:
+    if (info) {
+        plist_free(info);
+    }
     if (lockdownService) {
         lockdownd_service_descriptor_free(lockdownService);
     }
@@ -478,6 +383,9 @@ init_idescriptor_recovery_device(uint64_t ecid)
     } else {
         qDebug() << "Could not resolve hardware_model from client.";
     }
+    if (!info) {
+        info = DeviceDatabase::findByChipId(deviceInfo->cpid, deviceInfo->bdid);
+    }
 
     result.displayName =
         info ? (info->displayName ? info->displayName : info->marketingName)
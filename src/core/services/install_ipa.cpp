@@ -17,538 +17,559 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.
  */
 
-#ifdef HAVE_CONFIG_H
-#include <config.h>
-#endif
-#include <stdlib.h>
-#define _GNU_SOURCE 1
-#define __USE_GNU 1
-#include <dirent.h>
-#include <errno.h>
-#include <getopt.h>
-#include <inttypes.h>
-#include <libgen.h>
-#include <limits.h>
-#include <stdio.h>
-#include <string.h>
-#include <sys/stat.h>
-#include <time.h>
-
-#ifdef HAVE_UNISTD_H
-#include <unistd.h>
-#endif
-#ifndef WIN32
-#include <signal.h>
-#endif
-
+#include "../../blockringbuffer.h"
+#include "../../iDescriptor.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QFuture>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
 #include <libimobiledevice/afc.h>
 #include <libimobiledevice/installation_proxy.h>
 #include <libimobiledevice/libimobiledevice.h>
-#include <libimobiledevice/lockdown.h>
-#include <libimobiledevice/notification_proxy.h>
-
-
+#include <mutex>
 #include <plist/plist.h>
-
 #include <zip.h>
 
-#ifdef WIN32
-#include <windows.h>
-#define wait_ms(x) Sleep(x)
-#else
-#define wait_ms(x)                                                             \
-    {                                                                          \
-        struct timespec ts;                                                    \
-        ts.tv_sec = 0;                                                         \
-        ts.tv_nsec = x * 1000000;                                              \
-        nanosleep(&ts, NULL);                                                  \
-    }
-#endif
-
 #define ITUNES_METADATA_PLIST_FILENAME "iTunesMetadata.plist"
+// Largest archive entry read into memory for the metadata
+#define INSTALL_IPA_MAX_ENTRY_SIZE (10 * 1024 * 1024)
+// Two blocks let the next one be read from disk while one goes over AFC
+#define INSTALL_IPA_UPLOAD_BLOCKS 2
+#define INSTALL_IPA_UPLOAD_BLOCK_SIZE (1024 * 1024)
+// Give up when installation_proxy reports nothing for this long
+#define INSTALL_IPA_STATUS_TIMEOUT_MS (5 * 60 * 1000)
+/* The status thread exits silently when the connection drops, so the wait
+   for it is sliced to check for an abort and for the device going away */
+#define INSTALL_IPA_STATUS_POLL_MS 250
+#define INSTALL_IPA_CONNECTION_CHECK_MS 1000
 
 const char PKG_PATH[] = "PublicStaging";
 
-struct install_status_data {
-    int command_completed;
-    int err_occurred;
-    char *last_status;
+struct MetadataResult {
+    bool ok = false;
+    IpaMetadata metadata;
+    std::string error;
+};
+
+struct InstallStatus {
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool completed = false;
+    bool failed = false;
+    uint64_t updates = 0;
+    const InstallIpaProgress *progress = nullptr;
 };
 
+// Runs on the installation_proxy status thread
 static void status_cb(plist_t command, plist_t status, void *user_data)
 {
-    struct install_status_data *isd = (struct install_status_data *)user_data;
-    if (command && status) {
-        char *command_name = NULL;
-        instproxy_command_get_name(command, &command_name);
-
-        /* get status */
-        char *status_name = NULL;
-        instproxy_status_get_name(status, &status_name);
-
-        if (status_name) {
-            if (!strcmp(status_name, "Complete")) {
-                isd->command_completed = 1;
-            }
+    InstallStatus *isd = static_cast<InstallStatus *>(user_data);
+    if (!command || !status) {
+        qWarning() << __func__ << "was called with invalid arguments";
+        return;
+    }
+
+    char *status_name = NULL;
+    instproxy_status_get_name(status, &status_name);
+
+    char *error_name = NULL;
+    char *error_description = NULL;
+    uint64_t error_code = 0;
+    instproxy_status_get_error(status, &error_name, &error_description,
+                               &error_code);
+
+    int percent = -1;
+    instproxy_status_get_percent_complete(status, &percent);
+
+    const bool complete = status_name && !strcmp(status_name, "Complete");
+    if (error_name) {
+        qWarning() << "Install failed with" << error_name << "code"
+                   << error_code << ":"
+                   << (error_description ? error_description : "N/A");
+    } else if (status_name) {
+        qDebug() << "Install status:" << status_name << percent;
+        if (*isd->progress && (complete || percent >= 0)) {
+            (*isd->progress)(InstallIpaStage::Installing,
+                             complete ? 100 : percent, 100);
         }
+    }
 
-        /* get error if any */
-        char *error_name = NULL;
-        char *error_description = NULL;
-        uint64_t error_code = 0;
-        instproxy_status_get_error(status, &error_name, &error_description,
-                                   &error_code);
-
-        /* output/handling */
-        if (!error_name) {
-            if (status_name) {
-                /* get progress if any */
-                int percent = -1;
-                instproxy_status_get_percent_complete(status, &percent);
-
-                if (isd->last_status &&
-                    (strcmp(isd->last_status, status_name))) {
-                    printf("\n");
-                }
-
-                if (percent >= 0) {
-                    printf("\r%s: %s (%d%%)", command_name, status_name,
-                           percent);
-                } else {
-                    printf("\r%s: %s", command_name, status_name);
-                }
-                if (isd->command_completed) {
-                    printf("\n");
-                }
-            }
-        } else {
-            /* report error to the user */
-            if (error_description)
-                fprintf(stderr,
-                        "ERROR: %s failed. Got error \"%s\" with code "
-                        "0x%08" PRIx64 ": %s\n",
-                        command_name, error_name, error_code,
-                        error_description ? error_description : "N/A");
-            else
-                fprintf(stderr, "ERROR: %s failed. Got error \"%s\".\n",
-                        command_name, error_name);
-            isd->err_occurred = 1;
+    {
+        std::lock_guard<std::mutex> lock(isd->mutex);
+        ++isd->updates;
+        if (error_name) {
+            isd->failed = true;
+        } else if (complete) {
+            isd->completed = true;
         }
-
-        /* clean up */
-        free(error_name);
-        free(error_description);
-
-        free(isd->last_status);
-        isd->last_status = status_name;
-
-        free(command_name);
-        command_name = NULL;
-    } else {
-        fprintf(stderr, "ERROR: %s was called with invalid arguments!\n",
-                __func__);
     }
+    isd->changed.notify_all();
+
+    free(status_name);
+    free(error_name);
+    free(error_description);
 }
 
-static int zip_get_contents(struct zip *zf, const char *filename,
-                            int locate_flags, char **buffer, uint32_t *len)
+static bool zip_read_entry(zip_t *zf, const char *name, QByteArray &out)
 {
-    struct zip_stat zs;
-    struct zip_file *zfile;
-    int zindex = zip_name_locate(zf, filename, locate_flags);
-
-    *buffer = NULL;
-    *len = 0;
-
-    if (zindex < 0) {
-        return -1;
+    zip_int64_t index = zip_name_locate(zf, name, 0);
+    if (index < 0) {
+        return false;
     }
 
+    zip_stat_t zs;
     zip_stat_init(&zs);
-
-    if (zip_stat_index(zf, zindex, 0, &zs) != 0) {
-        fprintf(stderr, "ERROR: zip_stat_index '%s' failed!\n", filename);
-        return -2;
+    if (zip_stat_index(zf, index, 0, &zs) != 0 ||
+        !(zs.valid & ZIP_STAT_SIZE)) {
+        qWarning() << "zip_stat_index failed for" << name;
+        return false;
     }
-
-    if (zs.size > 10485760) {
-        fprintf(stderr, "ERROR: file '%s' is too large!\n", filename);
-        return -3;
+    if (zs.size > INSTALL_IPA_MAX_ENTRY_SIZE) {
+        qWarning() << "Archive entry" << name << "is too large";
+        return false;
     }
 
-    zfile = zip_fopen_index(zf, zindex, 0);
+    zip_file_t *zfile = zip_fopen_index(zf, index, 0);
     if (!zfile) {
-        fprintf(stderr, "ERROR: zip_fopen '%s' failed!\n", filename);
-        return -4;
-    }
-
-    *buffer = (char *)malloc(zs.size);
-    if (zs.size > LLONG_MAX ||
-        zip_fread(zfile, *buffer, zs.size) != (zip_int64_t)zs.size) {
-        fprintf(stderr, "ERROR: zip_fread %" PRIu64 " bytes from '%s'\n",
-                (uint64_t)zs.size, filename);
-        free(*buffer);
-        *buffer = NULL;
-        zip_fclose(zfile);
-        return -5;
+        qWarning() << "zip_fopen_index failed for" << name;
+        return false;
     }
-    *len = zs.size;
+    out.resize(static_cast<qsizetype>(zs.size));
+    zip_int64_t bytesRead = zip_fread(zfile, out.data(), zs.size);
     zip_fclose(zfile);
-    return 0;
+    if (bytesRead != (zip_int64_t)zs.size) {
+        qWarning() << "zip_fread failed for" << name;
+        out.clear();
+        return false;
+    }
+    return true;
 }
 
-static int zip_get_app_directory(struct zip *zf, char **path)
+// Finds the "Payload/<name>.app/" directory, names come from the central
+// directory so no entry data is read
+static std::string zip_app_directory(zip_t *zf)
 {
-    zip_int64_t i = 0;
-    zip_int64_t c = (zip_int64_t)zip_get_num_entries(zf, 0);
-    int len = 0;
-    const char *name = NULL;
-
-    /* look through all filenames in the archive */
-    do {
-        /* get filename at current index */
-        name = zip_get_name(zf, i++, 0);
-        if (name != NULL) {
-            /* check if we have a "Payload/.../" name */
-            len = strlen(name);
-            if (!strncmp(name, "Payload/", 8) && (len > 8)) {
-                /* skip hidden files */
-                if (name[8] == '.')
-                    continue;
-
-                /* locate the second directory delimiter */
-                const char *p = name + 8;
-                do {
-                    if (*p == '/') {
-                        break;
-                    }
-                } while (p++ != NULL);
-
-                /* try next entry if not found */
-                if (p == NULL)
-                    continue;
-
-                len = p - name + 1;
-
-                /* make sure app directory endwith .app */
-                if (len < 12 || strncmp(p - 4, ".app", 4)) {
-                    continue;
-                }
-
-                if (path != NULL) {
-                    free(*path);
-                    *path = NULL;
-                }
-
-                /* allocate and copy filename */
-                *path = (char *)malloc(len + 1);
-                strncpy(*path, name, len);
-
-                /* add terminating null character */
-                char *t = *path + len;
-                *t = '\0';
-                break;
-            }
+    const size_t payloadLength = strlen("Payload/");
+    zip_int64_t count = zip_get_num_entries(zf, 0);
+    for (zip_int64_t i = 0; i < count; ++i) {
+        const char *name = zip_get_name(zf, i, 0);
+        if (!name || strncmp(name, "Payload/", payloadLength) != 0) {
+            continue;
         }
-    } while (i < c);
-
-    if (*path == NULL) {
-        return -1;
+        // Skip hidden files
+        if (name[payloadLength] == '.') {
+            continue;
+        }
+        const char *slash = strchr(name + payloadLength, '/');
+        if (!slash) {
+            continue;
+        }
+        std::string directory(name, slash - name + 1);
+        if (directory.size() < payloadLength + strlen("x.app/") ||
+            directory.compare(directory.size() - 5, 5, ".app/") != 0) {
+            continue;
+        }
+        return directory;
     }
-
-    return 0;
+    return std::string();
 }
 
-static int afc_upload_file(afc_client_t afc, const char *filename,
-                           const char *dstfn)
+static std::string plist_dict_get_string(plist_t dict, const char *key)
 {
-    FILE *f = NULL;
-    uint64_t af = 0;
-    char buf[1048576];
-
-    f = fopen(filename, "rb");
-    if (!f) {
-        fprintf(stderr, "fopen: %s: %s\n", filename, strerror(errno));
-        return -1;
+    std::string value;
+    plist_t node = plist_dict_get_item(dict, key);
+    if (node && plist_get_node_type(node) == PLIST_STRING) {
+        char *str = NULL;
+        plist_get_string_val(node, &str);
+        if (str) {
+            value = str;
+            free(str);
+        }
     }
+    return value;
+}
 
-    if ((afc_file_open(afc, dstfn, AFC_FOPEN_WRONLY, &af) != AFC_E_SUCCESS) ||
-        !af) {
-        fclose(f);
-        fprintf(stderr, "afc_file_open on '%s' failed!\n", dstfn);
-        return -1;
-    }
+bool read_ipa_metadata(const char *filePath, IpaMetadata &metadata,
+                       std::string &error)
+{
+    metadata = IpaMetadata();
 
-    size_t amount = 0;
-    do {
-        amount = fread(buf, 1, sizeof(buf), f);
-        if (amount > 0) {
-            uint32_t written, total = 0;
-            while (total < amount) {
-                written = 0;
-                afc_error_t aerr =
-                    afc_file_write(afc, af, buf, amount, &written);
-                if (aerr != AFC_E_SUCCESS) {
-                    fprintf(stderr, "AFC Write error: %d\n", aerr);
-                    break;
-                }
-                total += written;
-            }
-            if (total != amount) {
-                fprintf(stderr, "Error: wrote only %u of %u\n", total,
-                        (uint32_t)amount);
-                afc_file_close(afc, af);
-                fclose(f);
-                return -1;
+    int zerr = 0;
+    zip_t *zf = zip_open(filePath, ZIP_RDONLY, &zerr);
+    if (!zf) {
+        error = "Could not open archive (zip error " + std::to_string(zerr) +
+                ")";
+        return false;
+    }
+
+    auto read = [&]() -> bool {
+        QByteArray itunesMetadata;
+        if (zip_read_entry(zf, ITUNES_METADATA_PLIST_FILENAME,
+                           itunesMetadata)) {
+            plist_t dict = NULL;
+            plist_from_memory(itunesMetadata.constData(),
+                              itunesMetadata.size(), &dict, NULL);
+            if (dict) {
+                metadata.iTunesMetadata = itunesMetadata;
+                plist_free(dict);
             }
         }
-    } while (amount > 0);
-
-    afc_file_close(afc, af);
-    fclose(f);
-
-    return 0;
-}
+        if (metadata.iTunesMetadata.isEmpty()) {
+            qDebug() << "No usable" << ITUNES_METADATA_PLIST_FILENAME
+                     << "in archive";
+        }
 
-instproxy_error_t install_IPA(idevice_t device, afc_client_t afc,
-                              const char *filePath)
-{
-    lockdownd_client_t client = NULL;
-    instproxy_client_t ipc = NULL;
-    lockdownd_service_descriptor_t service = NULL;
-    instproxy_error_t err = INSTPROXY_E_UNKNOWN_ERROR;
-    char *bundleidentifier = NULL;
-    struct install_status_data status_data = {0, 0, NULL};
-    plist_t sinf = NULL;
-    plist_t meta = NULL;
-    char *pkgname = NULL;
-    struct stat fst;
-    char **strs = NULL;
-    plist_t client_opts = instproxy_client_options_new();
-    char *zbuf = NULL;
-    uint32_t len = 0;
-    plist_t meta_dict = NULL;
-    int errp = 0;
-    struct zip *zf = zip_open(filePath, 0, &errp);
-    plist_t info = NULL;
-    char *filename = NULL;
-    char *app_directory_name = NULL;
-    char *bundleexecutable = NULL;
-    plist_t bname = NULL;
-    char *sinfname = NULL;
+        const std::string appDirectory = zip_app_directory(zf);
+        if (appDirectory.empty()) {
+            error = "Unable to locate .app directory in archive. Make sure "
+                    "it is inside a 'Payload' directory.";
+            return false;
+        }
 
-    if (!device || !filePath || !afc) {
-        fprintf(stderr, "ERROR: Invalid arguments passed to install_IPA.\n");
-        return INSTPROXY_E_INVALID_ARG;
-    }
+        const std::string infoPath = appDirectory + "Info.plist";
+        QByteArray infoData;
+        if (!zip_read_entry(zf, infoPath.c_str(), infoData)) {
+            error = "Could not locate " + infoPath + " in archive";
+            return false;
+        }
 
-    lockdownd_error_t lerr = lockdownd_client_new_with_handshake(
-        device, &client, "ideviceinstaller");
-    if (lerr != LOCKDOWN_E_SUCCESS) {
-        fprintf(stderr, "Could not connect to lockdownd: %s. Exiting.\n",
-                lockdownd_strerror(lerr));
-        return INSTPROXY_E_OP_FAILED;
-    }
+        plist_t info = NULL;
+        plist_from_memory(infoData.constData(), infoData.size(), &info, NULL);
+        if (!info) {
+            error = "Could not parse Info.plist";
+            return false;
+        }
+        metadata.bundleExecutable =
+            plist_dict_get_string(info, "CFBundleExecutable");
+        metadata.bundleIdentifier =
+            plist_dict_get_string(info, "CFBundleIdentifier");
+        plist_free(info);
+
+        if (metadata.bundleExecutable.empty()) {
+            error = "Could not determine value for CFBundleExecutable";
+            return false;
+        }
+        if (metadata.bundleIdentifier.empty()) {
+            error = "Could not determine value for CFBundleIdentifier";
+            return false;
+        }
 
-    lerr = lockdownd_start_service(
-        client, "com.apple.mobile.installation_proxy", &service);
-    if (lerr != LOCKDOWN_E_SUCCESS) {
-        fprintf(stderr,
-                "Could not start com.apple.mobile.installation_proxy: %s\n",
-                lockdownd_strerror(lerr));
-        lockdownd_client_free(client);
-        return INSTPROXY_E_OP_FAILED;
-    }
+        const std::string sinfPath = "Payload/" + metadata.bundleExecutable +
+                                     ".app/SC_Info/" +
+                                     metadata.bundleExecutable + ".sinf";
+        if (!zip_read_entry(zf, sinfPath.c_str(), metadata.sinf)) {
+            qDebug() << "Could not locate" << sinfPath.c_str()
+                     << "in archive";
+        }
+        return true;
+    };
 
-    err = instproxy_client_new(device, service, &ipc);
-    if (service) {
-        lockdownd_service_descriptor_free(service);
-        service = NULL;
-    }
+    const bool ok = read();
+    zip_close(zf);
+    return ok;
+}
 
-    if (err != INSTPROXY_E_SUCCESS) {
-        fprintf(stderr, "Could not connect to installation_proxy!\n");
-        lockdownd_client_free(client);
-        return err;
+// Uploads the file through a reader thread, so reading the next block from
+// disk overlaps with writing the current one to the device
+static bool upload_package(afc_client_t afc, QFile &file, const char *dstPath,
+                           const std::function<bool()> &shouldAbort,
+                           const InstallIpaProgress &progress)
+{
+    uint64_t handle = 0;
+    if (afc_file_open(afc, dstPath, AFC_FOPEN_WRONLY, &handle) !=
+            AFC_E_SUCCESS ||
+        !handle) {
+        qWarning() << "afc_file_open failed for" << dstPath;
+        return false;
+    }
+
+    BlockRingBuffer ring(INSTALL_IPA_UPLOAD_BLOCKS,
+                         INSTALL_IPA_UPLOAD_BLOCK_SIZE);
+    bool readError = false;
+    QThread *reader = QThread::create([&file, &ring, &readError]() {
+        while (BlockRingBuffer::Block *block = ring.acquireFree()) {
+            block->size = file.read(block->data.data(), ring.blockSize());
+            if (block->size <= 0) {
+                readError = block->size < 0;
+                ring.recycle(block);
+                break;
+            }
+            ring.commit(block);
+        }
+        ring.finish();
+    });
+    reader->start();
+
+    const uint64_t total = file.size();
+    uint64_t uploaded = 0;
+    bool ok = true;
+    while (BlockRingBuffer::Block *block = ring.acquireFilled()) {
+        qint64 offset = 0;
+        while (offset < block->size) {
+            uint32_t written = 0;
+            afc_error_t aerr = afc_file_write(
+                afc, handle, block->data.constData() + offset,
+                static_cast<uint32_t>(block->size - offset), &written);
+            if (aerr != AFC_E_SUCCESS || written == 0) {
+                qWarning() << "AFC write error:" << aerr;
+                ok = false;
+                break;
+            }
+            offset += written;
+            uploaded += written;
+            if (progress) {
+                progress(InstallIpaStage::Uploading, uploaded, total);
+            }
+        }
+        ring.recycle(block);
+        if (!ok || shouldAbort()) {
+            ok = false;
+            break;
+        }
     }
 
-    setbuf(stdout, NULL);
+    ring.abort();
+    reader->wait();
+    delete reader;
+    afc_file_close(afc, handle);
 
-    if (stat(filePath, &fst) != 0) {
-        fprintf(stderr, "ERROR: stat: %s: %s\n", filePath, strerror(errno));
-        err = INSTPROXY_E_INVALID_ARG;
-        goto leave_cleanup;
+    if (readError) {
+        qWarning() << "Failed to read" << file.fileName() << ":"
+                   << file.errorString();
+        return false;
     }
+    return ok && uploaded == total;
+}
 
-    if (afc_get_file_info(afc, PKG_PATH, &strs) != AFC_E_SUCCESS) {
+static void ensure_staging_directory(afc_client_t afc)
+{
+    char **info = NULL;
+    if (afc_get_file_info(afc, PKG_PATH, &info) != AFC_E_SUCCESS) {
         if (afc_make_directory(afc, PKG_PATH) != AFC_E_SUCCESS) {
-            fprintf(stderr,
-                    "WARNING: Could not create directory '%s' on device!\n",
-                    PKG_PATH);
+            qWarning() << "Could not create directory" << PKG_PATH
+                       << "on device";
         }
     }
-    if (strs) {
-        int i = 0;
-        while (strs[i]) {
-            free(strs[i]);
-            i++;
-        }
-        free(strs);
+    if (info) {
+        afc_dictionary_free(info);
     }
+}
 
-    if (!zf) {
-        fprintf(stderr, "ERROR: zip_open: %s: %d\n", filePath, errp);
-        err = INSTPROXY_E_INVALID_ARG;
-        goto leave_cleanup;
-    }
+// A stable name per archive, so a package left over from an interrupted
+// install gets overwritten by the next attempt
+static QByteArray staging_path(const char *filePath)
+{
+    const QByteArray key =
+        QFileInfo(QString::fromUtf8(filePath)).absoluteFilePath().toUtf8();
+    return QByteArray(PKG_PATH) + "/" +
+           QCryptographicHash::hash(key, QCryptographicHash::Sha1)
+               .toHex()
+               .left(16) +
+           ".ipa";
+}
 
-    /* extract iTunesMetadata.plist from package */
-    if (zip_get_contents(zf, ITUNES_METADATA_PLIST_FILENAME, 0, &zbuf, &len) ==
-        0) {
-        meta = plist_new_data(zbuf, len);
-        plist_from_memory(zbuf, len, &meta_dict, NULL);
-    }
-    if (!meta_dict) {
-        plist_free(meta);
-        meta = NULL;
-        fprintf(stderr, "WARNING: could not locate %s in archive!\n",
-                ITUNES_METADATA_PLIST_FILENAME);
+// Whether usbmuxd still lists the device, true when that can not be told
+static bool device_attached(idevice_t device)
+{
+    char *udid = NULL;
+    if (idevice_get_udid(device, &udid) != IDEVICE_E_SUCCESS || !udid) {
+        return true;
+    }
+
+    bool attached = true;
+    idevice_info_t *devices = NULL;
+    int count = 0;
+    if (idevice_get_device_list_extended(&devices, &count) ==
+        IDEVICE_E_SUCCESS) {
+        attached = false;
+        for (int i = 0; i < count && !attached; ++i) {
+            attached = strcmp(devices[i]->udid, udid) == 0;
+        }
+        idevice_device_list_extended_free(devices);
     }
-    free(zbuf);
+    free(udid);
+    return attached;
+}
 
-    /* determine .app directory in archive */
-    zbuf = NULL;
-    len = 0;
+static instproxy_error_t install_package(idevice_t device, afc_client_t afc,
+                                         const char *filePath,
+                                         const IpaMetadata *knownMetadata,
+                                         const InstallIpaProgress &progress,
+                                         const InstallIpaAbort &abort)
+{
+    auto aborted = [&abort]() { return abort && abort(); };
 
-    if (zip_get_app_directory(zf, &app_directory_name)) {
-        fprintf(stderr, "ERROR: Unable to locate .app directory in archive. "
-                        "Make sure it is inside a 'Payload' directory.\n");
-        err = INSTPROXY_E_INVALID_ARG;
-        goto zip_cleanup;
+    if (!device || !filePath || !afc) {
+        qWarning() << "Invalid arguments passed to install_IPA";
+        return INSTPROXY_E_INVALID_ARG;
     }
 
-    /* construct full filename to Info.plist */
-    filename = (char *)malloc(strlen(app_directory_name) + 10 + 1);
-    strcpy(filename, app_directory_name);
-    free(app_directory_name);
-    app_directory_name = NULL;
-    strcat(filename, "Info.plist");
-
-    if (zip_get_contents(zf, filename, 0, &zbuf, &len) < 0) {
-        fprintf(stderr, "WARNING: could not locate %s in archive!\n", filename);
-        free(filename);
-        err = INSTPROXY_E_INVALID_ARG;
-        goto zip_cleanup;
-    }
-    free(filename);
-    plist_from_memory(zbuf, len, &info, NULL);
-    free(zbuf);
-
-    if (!info) {
-        fprintf(stderr, "Could not parse Info.plist!\n");
-        err = INSTPROXY_E_INVALID_ARG;
-        goto zip_cleanup;
+    QFile file(QString::fromUtf8(filePath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not open" << filePath << ":"
+                   << file.errorString();
+        return INSTPROXY_E_INVALID_ARG;
     }
 
-    bname = plist_dict_get_item(info, "CFBundleExecutable");
-    if (bname) {
-        plist_get_string_val(bname, &bundleexecutable);
+    // Validate the archive while it is already being uploaded
+    QFuture<MetadataResult> metadataFuture;
+    if (!knownMetadata) {
+        const std::string path(filePath);
+        metadataFuture = QtConcurrent::run([path]() {
+            MetadataResult result;
+            result.ok =
+                read_ipa_metadata(path.c_str(), result.metadata, result.error);
+            return result;
+        });
     }
+    auto stopUpload = [&metadataFuture, &aborted]() {
+        return aborted() ||
+               (metadataFuture.isValid() && metadataFuture.isFinished() &&
+                !metadataFuture.result().ok);
+    };
 
-    bname = plist_dict_get_item(info, "CFBundleIdentifier");
-    if (bname) {
-        plist_get_string_val(bname, &bundleidentifier);
+    instproxy_client_t ipc = NULL;
+    instproxy_error_t err =
+        instproxy_client_start_service(device, &ipc, APP_LABEL);
+    if (err != INSTPROXY_E_SUCCESS) {
+        qWarning() << "Could not connect to installation_proxy:" << err;
+        metadataFuture.waitForFinished();
+        return err;
     }
-    plist_free(info);
-    info = NULL;
 
-    if (!bundleexecutable) {
-        fprintf(stderr, "Could not determine value for CFBundleExecutable!\n");
-        err = INSTPROXY_E_INVALID_ARG;
-        goto zip_cleanup;
-    }
+    ensure_staging_directory(afc);
+    const QByteArray pkgname = staging_path(filePath);
 
-    if (asprintf(&sinfname, "Payload/%s.app/SC_Info/%s.sinf", bundleexecutable,
-                 bundleexecutable) < 0) {
-        fprintf(stderr, "Out of memory!?\n");
-        err = INSTPROXY_E_UNKNOWN_ERROR;
-        goto zip_cleanup;
-    }
-    free(bundleexecutable);
+    qDebug() << "Copying" << filePath << "to device as" << pkgname;
+    const bool uploaded = upload_package(afc, file, pkgname.constData(),
+                                         stopUpload, progress);
+    file.close();
 
-    /* extract .sinf from package */
-    zbuf = NULL;
-    len = 0;
-    if (zip_get_contents(zf, sinfname, 0, &zbuf, &len) == 0) {
-        sinf = plist_new_data(zbuf, len);
+    IpaMetadata metadata;
+    if (knownMetadata) {
+        metadata = *knownMetadata;
     } else {
-        fprintf(stderr, "WARNING: could not locate %s in archive!\n", sinfname);
-    }
-    free(sinfname);
-    free(zbuf);
-
-    /* copy archive to device */
-    pkgname = NULL;
-    if (asprintf(&pkgname, "%s/%s", PKG_PATH, bundleidentifier) < 0) {
-        fprintf(stderr, "Out of memory!?\n");
-        err = INSTPROXY_E_UNKNOWN_ERROR;
-        goto zip_cleanup;
+        MetadataResult result = metadataFuture.result();
+        if (!result.ok) {
+            qWarning() << "Invalid IPA" << filePath << ":"
+                       << result.error.c_str();
+            afc_remove_path(afc, pkgname.constData());
+            instproxy_client_free(ipc);
+            return INSTPROXY_E_INVALID_ARG;
+        }
+        metadata = std::move(result.metadata);
     }
 
-    printf("Copying '%s' to device... ", filePath);
-
-    if (afc_upload_file(afc, filePath, pkgname) < 0) {
-        printf("FAILED\n");
-        free(pkgname);
-        err = INSTPROXY_E_OP_FAILED;
-        goto zip_cleanup;
+    if (!uploaded) {
+        qWarning() << "Failed to copy" << filePath << "to device";
+        afc_remove_path(afc, pkgname.constData());
+        instproxy_client_free(ipc);
+        return INSTPROXY_E_CONN_FAILED;
     }
 
-    printf("DONE.\n");
-
-    if (bundleidentifier) {
-        instproxy_client_options_add(client_opts, "CFBundleIdentifier",
-                                     bundleidentifier, NULL);
-    }
-    if (sinf) {
+    plist_t client_opts = instproxy_client_options_new();
+    instproxy_client_options_add(client_opts, "CFBundleIdentifier",
+                                 metadata.bundleIdentifier.c_str(), NULL);
+    if (!metadata.sinf.isEmpty()) {
+        plist_t sinf = plist_new_data(metadata.sinf.constData(),
+                                      metadata.sinf.size());
         instproxy_client_options_add(client_opts, "ApplicationSINF", sinf,
                                      NULL);
+        plist_free(sinf);
     }
-    if (meta) {
-        instproxy_client_options_add(client_opts, "iTunesMetadata", meta, NULL);
-    }
-
-zip_cleanup:
-    if (zf) {
-        zip_unchange_all(zf);
-        zip_close(zf);
-    }
-    if (err != INSTPROXY_E_SUCCESS) {
-        goto leave_cleanup;
+    if (!metadata.iTunesMetadata.isEmpty()) {
+        plist_t meta = plist_new_data(metadata.iTunesMetadata.constData(),
+                                      metadata.iTunesMetadata.size());
+        instproxy_client_options_add(client_opts, "iTunesMetadata", meta,
+                                     NULL);
+        plist_free(meta);
     }
 
-    /* perform installation */
-    printf("Installing '%s'\n", bundleidentifier);
-    instproxy_install(ipc, pkgname, client_opts, status_cb, &status_data);
-
+    // Completion is signalled by the status callback
+    InstallStatus status;
+    status.progress = &progress;
+    qDebug() << "Installing" << metadata.bundleIdentifier.c_str();
+    err = instproxy_install(ipc, pkgname.constData(), client_opts, status_cb,
+                            &status);
     instproxy_client_options_free(client_opts);
-    free(pkgname);
 
-    while (!status_data.command_completed && !status_data.err_occurred) {
-        wait_ms(50);
-    }
+    if (err == INSTPROXY_E_SUCCESS) {
+        std::unique_lock<std::mutex> lock(status.mutex);
+        auto lastUpdate = std::chrono::steady_clock::now();
+        auto lastCheck = lastUpdate;
+        uint64_t seen = status.updates;
+        bool lost = false;
+        while (!status.completed && !status.failed) {
+            status.changed.wait_for(
+                lock, std::chrono::milliseconds(INSTALL_IPA_STATUS_POLL_MS));
+            if (status.completed || status.failed) {
+                break;
+            }
 
-    if (status_data.err_occurred) {
-        err = INSTPROXY_E_OP_FAILED;
+            const auto now = std::chrono::steady_clock::now();
+            if (status.updates != seen) {
+                seen = status.updates;
+                lastUpdate = now;
+            } else if (now - lastUpdate >= std::chrono::milliseconds(
+                                               INSTALL_IPA_STATUS_TIMEOUT_MS)) {
+                qWarning() << "installation_proxy stopped reporting status";
+                break;
+            }
+
+            if (aborted()) {
+                qWarning() << "Installation of" << filePath << "was aborted";
+                lost = true;
+                break;
+            }
+            if (now - lastCheck >=
+                std::chrono::milliseconds(INSTALL_IPA_CONNECTION_CHECK_MS)) {
+                lastCheck = now;
+                lock.unlock();
+                const bool attached = device_attached(device);
+                lock.lock();
+                if (!attached) {
+                    qWarning() << "Device went away while installing";
+                    lost = true;
+                    break;
+                }
+            }
+        }
+        if (status.completed) {
+            err = INSTPROXY_E_SUCCESS;
+        } else if (status.failed) {
+            err = INSTPROXY_E_OP_FAILED;
+        } else {
+            err = lost ? INSTPROXY_E_CONN_FAILED : INSTPROXY_E_RECEIVE_TIMEOUT;
+        }
     } else {
-        err = INSTPROXY_E_SUCCESS;
+        qWarning() << "instproxy_install failed:" << err;
+        afc_remove_path(afc, pkgname.constData());
     }
 
-leave_cleanup:
+    // Joins the status thread, so status outlives every callback
     instproxy_client_free(ipc);
-    lockdownd_client_free(client);
-    free(bundleidentifier);
-    free(status_data.last_status);
-
     return err;
-}
\ No newline at end of file
+}
+
+instproxy_error_t install_IPA(idevice_t device, afc_client_t afc,
+                              const char *filePath,
+                              const InstallIpaProgress &progress,
+                              const InstallIpaAbort &abort)
+{
+    return install_package(device, afc, filePath, nullptr, progress, abort);
+}
+
+instproxy_error_t install_IPA(idevice_t device, afc_client_t afc,
+                              const char *filePath,
+                              const IpaMetadata &metadata,
+                              const InstallIpaProgress &progress,
+                              const InstallIpaAbort &abort)
+{
+    return install_package(device, afc, filePath, &metadata, progress, abort);
+}
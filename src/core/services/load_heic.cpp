@@ -20,9 +20,102 @@
 #include "../../iDescriptor.h"
 #include <QByteArray>
 #include <QDebug>
+#include <QIODevice>
 #include <QImage>
 #include <QPixmap>
 #include <libheif/heif.h>
+#include <vector>
+
+namespace
+{
+
+// heif_reader callbacks on a random access QIODevice, libheif then only pulls
+// the boxes and item data it needs
+int64_t heifGetPosition(void *userdata)
+{
+    return static_cast<QIODevice *>(userdata)->pos();
+}
+
+int heifRead(void *data, size_t size, void *userdata)
+{
+    auto *source = static_cast<QIODevice *>(userdata);
+    return source->read(static_cast<char *>(data), size) ==
+                   static_cast<qint64>(size)
+               ? 0
+               : -1;
+}
+
+int heifSeek(int64_t position, void *userdata)
+{
+    return static_cast<QIODevice *>(userdata)->seek(position) ? 0 : -1;
+}
+
+heif_reader_grow_status heifWaitForFileSize(int64_t targetSize, void *userdata)
+{
+    return targetSize > static_cast<QIODevice *>(userdata)->size()
+               ? heif_reader_grow_status_size_beyond_eof
+               : heif_reader_grow_status_size_reached;
+}
+
+heif_reader qiodeviceReader()
+{
+    heif_reader reader{};
+    reader.reader_api_version = 1;
+    reader.get_position = heifGetPosition;
+    reader.read = heifRead;
+    reader.seek = heifSeek;
+    reader.wait_for_file_size = heifWaitForFileSize;
+    return reader;
+}
+
+QImage decodeHeicImage(heif_image_handle *handle)
+{
+    heif_image *img;
+    heif_error err = heif_decode_image(handle, &img, heif_colorspace_RGB,
+                                       heif_chroma_interleaved_RGB, nullptr);
+    if (err.code != heif_error_Ok) {
+        qWarning() << "Failed to decode HEIC image:" << err.message;
+        return QImage();
+    }
+
+    int width = heif_image_get_width(img, heif_channel_interleaved);
+    int height = heif_image_get_height(img, heif_channel_interleaved);
+    int stride;
+    /*
+     FIXME: use heif_image_get_plane_readonly2 in future, on ubuntu 24 it's not
+     available yet
+    */
+    const uint8_t *data =
+        heif_image_get_plane_readonly(img, heif_channel_interleaved, &stride);
+
+    if (!data) {
+        qWarning() << "Failed to get image plane data";
+        heif_image_release(img);
+        return QImage();
+    }
+
+    // Deep copy, the plane is freed with the heif image
+    QImage result =
+        QImage(data, width, height, stride, QImage::Format_RGB888).copy();
+    heif_image_release(img);
+    return result;
+}
+
+QPixmap decodeHeicPrimary(heif_context *ctx)
+{
+    heif_image_handle *handle;
+    heif_error err = heif_context_get_primary_image_handle(ctx, &handle);
+    if (err.code != heif_error_Ok) {
+        qWarning() << "Failed to get primary image handle:" << err.message;
+        return QPixmap();
+    }
+
+    QImage image = decodeHeicImage(handle);
+    heif_image_handle_release(handle);
+    return image.isNull() ? QPixmap() : QPixmap::fromImage(image);
+}
+
+} // namespace
 
 QPixmap load_heic(const QByteArray &imageData)
 {
@@ -40,48 +133,92 @@ QPixmap load_heic(const QByteArray &imageData)
         return QPixmap();
     }
 
-    heif_image_handle *handle;
-    err = heif_context_get_primary_image_handle(ctx, &handle);
-    if (err.code != heif_error_Ok) {
-        qWarning() << "Failed to get primary image handle:" << err.message;
-        heif_context_free(ctx);
+    QPixmap result = decodeHeicPrimary(ctx);
+    heif_context_free(ctx);
+    return result;
+}
+
+QPixmap load_heic(QIODevice *source)
+{
+    heif_context *ctx = heif_context_alloc();
+    if (!ctx) {
+        qWarning() << "Failed to allocate heif_context";
         return QPixmap();
     }
 
-    heif_image *img;
-    err = heif_decode_image(handle, &img, heif_colorspace_RGB,
-                            heif_chroma_interleaved_RGB, nullptr);
+    heif_reader reader = qiodeviceReader();
+    heif_error err =
+        heif_context_read_from_reader(ctx, &reader, source, nullptr);
     if (err.code != heif_error_Ok) {
-        qWarning() << "Failed to decode HEIC image:" << err.message;
-        heif_image_handle_release(handle);
+        qWarning() << "Failed to read HEIC from stream:" << err.message;
         heif_context_free(ctx);
         return QPixmap();
     }
 
-    int width = heif_image_get_width(img, heif_channel_interleaved);
-    int height = heif_image_get_height(img, heif_channel_interleaved);
-    int stride;
-    /*
-     FIXME: use heif_image_get_plane_readonly2 in future, on ubuntu 24 it's not
-     available yet
-    */
-    const uint8_t *data =
-        heif_image_get_plane_readonly(img, heif_channel_interleaved, &stride);
+    QPixmap result = decodeHeicPrimary(ctx);
+    heif_context_free(ctx);
+    return result;
+}
 
-    if (!data) {
-        qWarning() << "Failed to get image plane data";
-        heif_image_release(img);
-        heif_image_handle_release(handle);
+QImage load_heic_thumbnail(QIODevice *source, const QSize &minSize)
+{
+    heif_context *ctx = heif_context_alloc();
+    if (!ctx) {
+        qWarning() << "Failed to allocate heif_context";
+        return QImage();
+    }
+
+    // Only the boxes describing the items are read here, image data is
+    // fetched when an item is decoded
+    heif_reader reader = qiodeviceReader();
+    heif_error err =
+        heif_context_read_from_reader(ctx, &reader, source, nullptr);
+    if (err.code != heif_error_Ok) {
+        qDebug() << "Failed to read HEIC container:" << err.message;
         heif_context_free(ctx);
-        return QPixmap();
+        return QImage();
     }
 
-    QImage qimg(data, width, height, stride, QImage::Format_RGB888);
-    QPixmap result = QPixmap::fromImage(qimg);
+    heif_image_handle *primary = nullptr;
+    err = heif_context_get_primary_image_handle(ctx, &primary);
+    if (err.code != heif_error_Ok) {
+        heif_context_free(ctx);
+        return QImage();
+    }
 
-    heif_image_release(img);
-    heif_image_handle_release(handle);
-    heif_context_free(ctx);
+    const int count = heif_image_handle_get_number_of_thumbnails(primary);
+    std::vector<heif_item_id> ids(count);
+    heif_image_handle_get_list_of_thumbnail_IDs(primary, ids.data(), count);
+
+    // Smallest thumbnail that still covers the requested size
+    heif_image_handle *thumbnail = nullptr;
+    for (heif_item_id id : ids) {
+        heif_image_handle *candidate = nullptr;
+        if (heif_image_handle_get_thumbnail(primary, id, &candidate).code !=
+            heif_error_Ok) {
+            continue;
+        }
+        const int width = heif_image_handle_get_width(candidate);
+        const int height = heif_image_handle_get_height(candidate);
+        const bool covers =
+            width >= minSize.width() || height >= minSize.height();
+        if (covers &&
+            (!thumbnail || width < heif_image_handle_get_width(thumbnail))) {
+            if (thumbnail) {
+                heif_image_handle_release(thumbnail);
+            }
+            thumbnail = candidate;
+        } else {
+            heif_image_handle_release(candidate);
+        }
+    }
+    heif_image_handle_release(primary);
 
+    QImage result;
+    if (thumbnail) {
+        result = decodeHeicImage(thumbnail);
+        heif_image_handle_release(thumbnail);
+    }
+    heif_context_free(ctx);
     return result;
 }
@@ -0,0 +1,168 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../../iDescriptor.h"
+#include <QByteArray>
+#include <QIODevice>
+#include <QImage>
+#include <QTransform>
+
+namespace
+{
+
+quint16 readU16(const uchar *p, bool littleEndian)
+{
+    return littleEndian ? quint16(p[0] | p[1] << 8) : quint16(p[0] << 8 | p[1]);
+}
+
+quint32 readU32(const uchar *p, bool littleEndian)
+{
+    return littleEndian ? quint32(p[0]) | quint32(p[1]) << 8 |
+                              quint32(p[2]) << 16 | quint32(p[3]) << 24
+                        : quint32(p[0]) << 24 | quint32(p[1]) << 16 |
+                              quint32(p[2]) << 8 | quint32(p[3]);
+}
+
+// Applies an EXIF orientation, the embedded thumbnail is stored unrotated
+QImage applyExifOrientation(const QImage &image, int orientation)
+{
+    switch (orientation) {
+    case 2:
+        return image.mirrored(true, false);
+    case 3:
+        return image.transformed(QTransform().rotate(180));
+    case 4:
+        return image.mirrored(false, true);
+    case 5:
+        return image.mirrored(true, false).transformed(
+            QTransform().rotate(270));
+    case 6:
+        return image.transformed(QTransform().rotate(90));
+    case 7:
+        return image.mirrored(true, false).transformed(QTransform().rotate(90));
+    case 8:
+        return image.transformed(QTransform().rotate(270));
+    default:
+        return image;
+    }
+}
+
+} // namespace
+
+QImage load_jpeg_thumbnail(QIODevice *source)
+{
+    auto readAt = [source](qint64 offset, char *data, qint64 length) {
+        return source->seek(offset) && source->read(data, length) == length;
+    };
+    const qint64 fileSize = source->size();
+
+    // Walk the markers up to the EXIF segment
+    qint64 offset = 2;
+    uchar marker[4];
+    if (!readAt(0, reinterpret_cast<char *>(marker), 2) ||
+        marker[0] != 0xFF || marker[1] != 0xD8) {
+        return QImage();
+    }
+
+    QByteArray exif;
+    while (offset + 4 <= fileSize) {
+        if (!readAt(offset, reinterpret_cast<char *>(marker), 4) ||
+            marker[0] != 0xFF) {
+            return QImage();
+        }
+        const quint16 length = readU16(marker + 2, false);
+        // Image data starts, there is no EXIF segment
+        if (marker[1] == 0xDA || marker[1] == 0xD9 || length < 2) {
+            return QImage();
+        }
+        if (marker[1] == 0xE1 && length > 8) {
+            exif.resize(length - 2);
+            if (!readAt(offset + 4, exif.data(), exif.size())) {
+                return QImage();
+            }
+            if (exif.startsWith(QByteArrayView("Exif\0\0", 6))) {
+                break;
+            }
+            exif.clear();
+        }
+        offset += 2 + length;
+    }
+    if (exif.isEmpty()) {
+        return QImage();
+    }
+
+    // TIFF structure: IFD0 holds the orientation, IFD1 the thumbnail
+    const uchar *tiff = reinterpret_cast<const uchar *>(exif.constData()) + 6;
+    const qint64 tiffSize = exif.size() - 6;
+    if (tiffSize < 8 || (tiff[0] != 'I' && tiff[0] != 'M')) {
+        return QImage();
+    }
+    const bool le = tiff[0] == 'I';
+
+    auto entryCount = [&](quint32 ifd) -> int {
+        if (ifd == 0 || ifd + 2 > tiffSize) {
+            return -1;
+        }
+        const int count = readU16(tiff + ifd, le);
+        return ifd + 2 + 12 * count + 4 <= tiffSize ? count : -1;
+    };
+
+    const quint32 ifd0 = readU32(tiff + 4, le);
+    const int count0 = entryCount(ifd0);
+    if (count0 < 0) {
+        return QImage();
+    }
+    int orientation = 1;
+    for (int i = 0; i < count0; ++i) {
+        const uchar *entry = tiff + ifd0 + 2 + 12 * i;
+        if (readU16(entry, le) == 0x0112) {
+            orientation = readU16(entry + 8, le);
+        }
+    }
+
+    const quint32 ifd1 = readU32(tiff + ifd0 + 2 + 12 * count0, le);
+    const int count1 = entryCount(ifd1);
+    if (count1 < 0) {
+        return QImage();
+    }
+    quint32 thumbnailOffset = 0;
+    quint32 thumbnailLength = 0;
+    for (int i = 0; i < count1; ++i) {
+        const uchar *entry = tiff + ifd1 + 2 + 12 * i;
+        switch (readU16(entry, le)) {
+        case 0x0201: // JPEGInterchangeFormat
+            thumbnailOffset = readU32(entry + 8, le);
+            break;
+        case 0x0202: // JPEGInterchangeFormatLength
+            thumbnailLength = readU32(entry + 8, le);
+            break;
+        }
+    }
+    if (thumbnailOffset == 0 || thumbnailLength == 0 ||
+        qint64(thumbnailOffset) + thumbnailLength > tiffSize) {
+        return QImage();
+    }
+
+    QImage thumbnail = QImage::fromData(tiff + thumbnailOffset,
+                                        thumbnailLength, "JPG");
+    if (thumbnail.isNull()) {
+        return QImage();
+    }
+    return applyExifOrientation(thumbnail, orientation);
+}
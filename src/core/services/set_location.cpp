@@ -20,16 +20,12 @@
  */
 
 #include "../../iDescriptor.h"
-#define DT_SIMULATELOCATION_SERVICE "com.apple.dt.simulatelocation"
+#include "../../servicesessioncache.h"
 
-#include <errno.h>
-#include <getopt.h>
-#include <libimobiledevice/libimobiledevice.h>
-#include <libimobiledevice/lockdown.h>
+#include <QByteArray>
+#include <QDebug>
 #include <libimobiledevice/service.h>
 #include <stdint.h>
-#include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
 #if defined(__APPLE__)
 #include <libkern/OSByteOrder.h>
@@ -41,80 +37,62 @@
 #else
 #include <endian.h>
 #endif
-#include <QDebug>
 
 enum { SET_LOCATION = 0, RESET_LOCATION = 1 };
-bool set_location(idevice_t device, char *lat, char *lon)
-{
-    uint32_t mode = 0;
-    lockdownd_client_t lockdown = NULL;
-    lockdownd_error_t lerr =
-        lockdownd_client_new_with_handshake(device, &lockdown, TOOL_NAME);
-    try {
-        /* code */
-
-        if (lerr != LOCKDOWN_E_SUCCESS) {
-            idevice_free(device);
-            printf("ERROR: Could not connect to lockdownd: %s (%d)\n",
-                   lockdownd_strerror(lerr), lerr);
-            return false;
-        }
-
-        lockdownd_service_descriptor_t svc = NULL;
-        lerr = lockdownd_start_service(lockdown, DT_SIMULATELOCATION_SERVICE,
-                                       &svc);
-        if (lerr != LOCKDOWN_E_SUCCESS) {
-            unsigned int device_version = idevice_get_device_version(device);
-            lockdownd_client_free(lockdown);
-            idevice_free(device);
-
-            return false;
-        }
-        lockdownd_client_free(lockdown);
-
-        service_client_t service = NULL;
-
-        service_error_t serr = service_client_new(device, svc, &service);
-
-        lockdownd_service_descriptor_free(svc);
 
-        if (serr != SERVICE_E_SUCCESS) {
-            idevice_free(device);
-            return false;
-        }
+static void append_be32(QByteArray &message, uint32_t value)
+{
+    uint32_t l = htobe32(value);
+    message.append(reinterpret_cast<const char *>(&l), 4);
+}
 
-        uint32_t l;
-        uint32_t s = 0;
+static bool send_location_message(iDescriptorDevice *device,
+                                  const QByteArray &message)
+{
+    // The session stays open, so continuous updates cost one send each
+    return ServiceSessionCache::sharedInstance()->withSimulateLocation(
+        device, [&message](service_client_t service) {
+            uint32_t sent = 0;
+            service_error_t err = service_send(service, message.constData(),
+                                               message.size(), &sent);
+            if (err != SERVICE_E_SUCCESS || sent != (uint32_t)message.size()) {
+                qDebug() << "Failed to send location message:" << err;
+                return false;
+            }
+            return true;
+        });
+}
 
-        l = htobe32(mode);
-        service_send(service, (const char *)&l, 4, &s);
-        if (mode == SET_LOCATION) {
-            int len = 4 + strlen(lat) + 4 + strlen(lon);
-            char *buf = (char *)malloc(len);
-            uint32_t latlen;
-            latlen = strlen(lat);
-            l = htobe32(latlen);
-            memcpy(buf, &l, 4);
-            memcpy(buf + 4, lat, latlen);
-            uint32_t longlen = strlen(lon);
-            l = htobe32(longlen);
-            memcpy(buf + 4 + latlen, &l, 4);
-            memcpy(buf + 4 + latlen + 4, lon, longlen);
+bool set_location(iDescriptorDevice *device, const char *lat, const char *lon)
+{
+    if (!device || !lat || !lon) {
+        return false;
+    }
 
-            s = 0;
-            service_send(service, buf, len, &s);
-            free(buf); // <-- free the buffer after use
-        }
+    // Mode, then the length-prefixed latitude and longitude strings
+    QByteArray message;
+    append_be32(message, SET_LOCATION);
+    append_be32(message, strlen(lat));
+    message.append(lat);
+    append_be32(message, strlen(lon));
+    message.append(lon);
 
+    if (send_location_message(device, message)) {
         return true;
-    } catch (...) {
-        if (lockdown) {
-            lockdownd_client_free(lockdown);
-        }
-        if (device) {
-            idevice_free(device);
-        }
-        qDebug() << "Exception occurred while setting location.";
+    }
+    // A cached session may have been closed by the device, retry once on a
+    // fresh one
+    return send_location_message(device, message);
+}
+
+bool reset_location(iDescriptorDevice *device)
+{
+    if (!device) {
         return false;
     }
-}
\ No newline at end of file
+
+    QByteArray message;
+    append_be32(message, RESET_LOCATION);
+    return send_location_message(device, message) ||
+           send_location_message(device, message);
+}
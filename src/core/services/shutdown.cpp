@@ -35,7 +35,6 @@ bool shutdown(idevice_t device)
 
     if (LOCKDOWN_E_SUCCESS != (ret = lockdownd_client_new_with_handshake(
                                    device, &lockdown_client, TOOL_NAME))) {
-        idevice_free(device);
         printf("ERROR: Could not connect to lockdownd, error code %d\n", ret);
         return false;
     }
@@ -51,7 +50,6 @@ bool shutdown(idevice_t device)
     lockdownd_client_free(lockdown_client);
 
     if (ret != LOCKDOWN_E_SUCCESS) {
-        idevice_free(device);
         printf("ERROR: Could not start diagnostics relay service: %s\n",
                lockdownd_strerror(ret));
         return false;
@@ -18,10 +18,17 @@
  */
 
 #include "devicedatabase.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <utility>
 
+namespace
+{
 // https://github.com/libimobiledevice/libirecovery/blob/master/src/libirecovery.c
-const DeviceDatabaseInfo DeviceDatabase::m_devices[] = {
+constexpr DeviceDatabaseInfo kDevices[] = {
     /* iPhone */
     {"iPhone1,1", "m68ap", 0x00, 0x8900, "iPhone 2G", "iPhone 2G"},
     {"iPhone1,2", "n82ap", 0x04, 0x8900, "iPhone 3G", "iPhone 3G"},
@@ -430,34 +437,83 @@ const DeviceDatabaseInfo DeviceDatabase::m_devices[] = {
     {"AppleDisplay2,1", "j327ap", 0x22, 0x8030, "Studio Display"},
     /* Apple Vision Pro */
     {"RealityDevice14,1", "n301ap", 0x42, 0x8112, "Apple Vision Pro"},
-    {NULL, NULL, -1, -1, NULL}};
+};
+
+constexpr size_t kDeviceCount = std::size(kDevices);
+using DeviceIndex = std::array<uint16_t, kDeviceCount>;
+
+/*
+    Indexes into kDevices sorted by a key, generated at compile time so
+    lookups are a binary search with no runtime initialization. Ties keep
+    table order, so duplicate keys resolve to the first entry like the
+    linear scans they replace.
+*/
+template <typename Key> constexpr DeviceIndex makeIndex(Key key)
+{
+    DeviceIndex index{};
+    for (size_t i = 0; i < kDeviceCount; ++i) {
+        index[i] = static_cast<uint16_t>(i);
+    }
+    std::sort(index.begin(), index.end(), [key](uint16_t a, uint16_t b) {
+        const auto keyA = key(kDevices[a]);
+        const auto keyB = key(kDevices[b]);
+        return keyA < keyB || (keyA == keyB && a < b);
+    });
+    return index;
+}
+
+constexpr std::string_view identifierKey(const DeviceDatabaseInfo &device)
+{
+    return device.modelIdentifier;
+}
+
+constexpr std::string_view boardIdKey(const DeviceDatabaseInfo &device)
+{
+    return device.boardId;
+}
+
+constexpr std::pair<int, int> chipKey(const DeviceDatabaseInfo &device)
+{
+    return {device.chipId, device.boardNumber};
+}
+
+constexpr DeviceIndex kByIdentifier = makeIndex(identifierKey);
+constexpr DeviceIndex kByBoardId = makeIndex(boardIdKey);
+constexpr DeviceIndex kByChip = makeIndex(chipKey);
+
+template <typename Key, typename Value>
+const DeviceDatabaseInfo *findInIndex(const DeviceIndex &index, Key key,
+                                      const Value &value)
+{
+    auto it = std::lower_bound(
+        index.begin(), index.end(), value,
+        [key](uint16_t entry, const Value &v) {
+            return key(kDevices[entry]) < v;
+        });
+    if (it == index.end() || !(key(kDevices[*it]) == value)) {
+        return nullptr;
+    }
+    return &kDevices[*it];
+}
+} // namespace
 
 const DeviceDatabaseInfo *
 DeviceDatabase::findByIdentifier(const std::string &identifier)
 {
-    for (const auto &device : m_devices) {
-        if (device.modelIdentifier == nullptr) {
-            break;
-        }
-        if (identifier == device.modelIdentifier) {
-            return &device;
-        }
-    }
-    return nullptr;
+    return findInIndex(kByIdentifier, identifierKey,
+                       std::string_view(identifier));
 }
 
 const DeviceDatabaseInfo *
 DeviceDatabase::findByHwModel(const std::string &hwModel)
 {
-    for (const auto &device : m_devices) {
-        if (device.boardId == nullptr) {
-            break;
-        }
-        if (hwModel == device.boardId) {
-            return &device;
-        }
-    }
-    return nullptr;
+    return findInIndex(kByBoardId, boardIdKey, std::string_view(hwModel));
+}
+
+const DeviceDatabaseInfo *DeviceDatabase::findByChipId(int chipId,
+                                                       int boardNumber)
+{
+    return findInIndex(kByChip, chipKey, std::make_pair(chipId, boardNumber));
 }
 
 std::string DeviceDatabase::parseRegionInfo(const std::string &code)
@@ -39,10 +39,10 @@ public:
     static const DeviceDatabaseInfo *
     findByIdentifier(const std::string &identifier);
     static const DeviceDatabaseInfo *findByHwModel(const std::string &hwModel);
+    // Lookup by chip ID (CPID) and board number (BDID) as reported in DFU
+    // and recovery mode
+    static const DeviceDatabaseInfo *findByChipId(int chipId, int boardNumber);
     static std::string parseRegionInfo(const std::string &code);
-
-private:
-    static const DeviceDatabaseInfo m_devices[];
 };
 
 #endif // DEVICEDATABASE_H
@@ -18,6 +18,8 @@
  */
 
 #include "deviceinfowidget.h"
+#include "batteryhistorydialog.h"
+#include "batterytelemetry.h"
 #include "batterywidget.h"
 #include "diskusagewidget.h"
 #include "fileexplorerwidget.h"
@@ -243,9 +245,9 @@ DeviceInfoWidget::DeviceInfoWidget(iDescriptorDevice *device, QWidget *parent)
                                            device->deviceInfo.deviceClass))});
     infoItems.append({"Device Color:", createValueLabel(QString::fromStdString(
                                            device->deviceInfo.deviceColor))});
-    infoItems.append(
-        {"Jailbroken:", createValueLabel(QString::fromStdString(
-                            device->deviceInfo.jailbroken ? "Yes" : "No"))});
+    m_jailbrokenLabel = createValueLabel(
+        QString::fromStdString(device->deviceInfo.jailbroken ? "Yes" : "No"));
+    infoItems.append({"Jailbroken:", m_jailbrokenLabel});
     infoItems.append({"Model Number:", createValueLabel(QString::fromStdString(
                                            device->deviceInfo.modelNumber))});
     infoItems.append(
@@ -261,9 +263,9 @@ DeviceInfoWidget::DeviceInfoWidget(iDescriptorDevice *device, QWidget *parent)
     infoItems.append(
         {"Hardware Platform:", createValueLabel(QString::fromStdString(
                                    device->deviceInfo.hardwarePlatform))});
-    infoItems.append(
-        {"Battery Cycle:", createValueLabel(QString::number(
-                               m_device->deviceInfo.batteryInfo.cycleCount))});
+    m_batteryCycleLabel = createValueLabel(
+        QString::number(m_device->deviceInfo.batteryInfo.cycleCount));
+    infoItems.append({"Battery Cycle:", m_batteryCycleLabel});
     infoItems.append(
         {"Firmware Version:", createValueLabel(QString::fromStdString(
                                   device->deviceInfo.firmwareVersion))});
@@ -273,11 +275,16 @@ DeviceInfoWidget::DeviceInfoWidget(iDescriptorDevice *device, QWidget *parent)
     QHBoxLayout *batteryLayout = new QHBoxLayout(batteryWidget);
     batteryLayout->setContentsMargins(0, 0, 0, 0);
     batteryLayout->setSpacing(5);
-    batteryLayout->addWidget(new QLabel(device->deviceInfo.batteryInfo.health));
+    m_batteryHealthLabel = new QLabel(device->deviceInfo.batteryInfo.health);
+    batteryLayout->addWidget(m_batteryHealthLabel);
     QPushButton *moreButton = new QPushButton("More");
     connect(moreButton, &QPushButton::clicked, this,
             &DeviceInfoWidget::onBatteryMoreClicked);
     batteryLayout->addWidget(moreButton);
+    QPushButton *historyButton = new QPushButton("History");
+    connect(historyButton, &QPushButton::clicked, this,
+            &DeviceInfoWidget::onBatteryHistoryClicked);
+    batteryLayout->addWidget(historyButton);
     batteryLayout->addStretch();
     infoItems.append({"Battery Health:", batteryWidget});
 
@@ -340,7 +347,8 @@ DeviceInfoWidget::DeviceInfoWidget(iDescriptorDevice *device, QWidget *parent)
     rightSideLayout->addStretch();
 
     rightSideLayout->addWidget(infoContainer);
-    rightSideLayout->addWidget(new DiskUsageWidget(device, this));
+    m_diskUsageWidget = new DiskUsageWidget(device, this);
+    rightSideLayout->addWidget(m_diskUsageWidget);
 
     rightSideLayout->addStretch();
     // TODO: layout shift cause ?
@@ -349,10 +357,14 @@ DeviceInfoWidget::DeviceInfoWidget(iDescriptorDevice *device, QWidget *parent)
     mainLayout->addLayout(rightSideLayout);
     mainLayout->addStretch();
 
-    m_updateTimer = new QTimer(this);
-    connect(m_updateTimer, &QTimer::timeout, this,
-            &DeviceInfoWidget::updateBatteryInfo);
-    m_updateTimer->start(30000); // Update every 30 seconds
+    // Sampled in the background, only changes are delivered
+    connect(BatteryTelemetry::sharedInstance(),
+            &BatteryTelemetry::batteryInfoChanged, this,
+            [this](iDescriptorDevice *device) {
+                if (device == m_device) {
+                    updateBatteryUI();
+                }
+            });
 }
 
 DeviceInfoWidget::~DeviceInfoWidget() {}
@@ -370,26 +382,44 @@ void DeviceInfoWidget::onBatteryMoreClicked()
     msgBox.exec();
 }
 
-void DeviceInfoWidget::updateBatteryInfo()
+void DeviceInfoWidget::onBatteryHistoryClicked()
+{
+    BatteryHistoryDialog *dialog = new BatteryHistoryDialog(m_device, this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->show();
+}
+
+void DeviceInfoWidget::refreshDeviceInfo(DeviceInitStage stage)
 {
-    qDebug() << "Updating battery info...";
-    plist_t diagnostics = nullptr;
-    get_battery_info(m_device->deviceInfo.rawProductType, m_device->device,
-                     m_device->deviceInfo.is_iPhone, diagnostics);
-
-    if (!diagnostics) {
-        qDebug() << "Failed to get diagnostics plist.";
-        return;
+    const DeviceInfo &d = m_device->deviceInfo;
+    switch (stage) {
+    case DeviceInitStage::Battery: {
+        updateBatteryUI();
+        m_batteryHealthLabel->setText(d.batteryInfo.health);
+        const QString cycles = QString::number(d.batteryInfo.cycleCount);
+        m_batteryCycleLabel->setText(cycles);
+        m_batteryCycleLabel->setOriginalText(cycles);
+        m_batteryCycleLabel->setTextToCopy(cycles);
+        break;
+    }
+    case DeviceInitStage::Jailbreak: {
+        const QString jailbroken = d.jailbroken ? "Yes" : "No";
+        m_jailbrokenLabel->setText(jailbroken);
+        m_jailbrokenLabel->setOriginalText(jailbroken);
+        m_jailbrokenLabel->setTextToCopy(jailbroken);
+        break;
     }
-    /*DATA*/
-    DeviceInfo &d = m_device->deviceInfo;
-    qDebug() << "old device" << d.oldDevice;
-    PlistNavigator ioreg = PlistNavigator(diagnostics)["IORegistry"];
-    if (d.oldDevice)
-        parseOldDeviceBattery(ioreg, d);
-    else
-        parseDeviceBattery(ioreg, d);
-    /*UI*/
+    case DeviceInitStage::Storage:
+        m_diskUsageWidget->refresh();
+        break;
+    default:
+        break;
+    }
+}
+
+void DeviceInfoWidget::updateBatteryUI()
+{
+    const DeviceInfo &d = m_device->deviceInfo;
     updateChargingStatusIcon();
     m_chargingWattsWithCableTypeLabel->setText(
         QString::number(d.batteryInfo.watts) + "W" + "/" +
@@ -21,10 +21,11 @@
 #define DEVICEINFOWIDGET_H
 #include "batterywidget.h"
 #include "deviceimagewidget.h"
+#include "diskusagewidget.h"
 #include "iDescriptor-ui.h"
 #include "iDescriptor.h"
+#include "infolabel.h"
 #include <QLabel>
-#include <QTimer>
 #include <QWidget>
 
 class DeviceInfoWidget : public QWidget
@@ -34,21 +35,27 @@ public:
     explicit DeviceInfoWidget(iDescriptorDevice *device,
                               QWidget *parent = nullptr);
     ~DeviceInfoWidget(); // added destructor
+    // Show details from a bring-up stage that finished after construction
+    void refreshDeviceInfo(DeviceInitStage stage);
 
 private slots:
     void onBatteryMoreClicked();
+    void onBatteryHistoryClicked();
 
 private:
     iDescriptorDevice *m_device;
-    QTimer *m_updateTimer;
-    void updateBatteryInfo();
+    void updateBatteryUI();
     void updateChargingStatusIcon();
     QLabel *m_chargingStatusLabel;
     QLabel *m_chargingWattsWithCableTypeLabel;
     BatteryWidget *m_batteryWidget;
     ZIconLabel *m_lightningIconLabel;
+    QLabel *m_batteryHealthLabel;
+    InfoLabel *m_batteryCycleLabel;
+    InfoLabel *m_jailbrokenLabel;
 
     DeviceImageWidget *m_deviceImageWidget;
+    DiskUsageWidget *m_diskUsageWidget;
 };
 
 #endif // DEVICEINFOWIDGET_H
@@ -47,6 +47,15 @@ DeviceManagerWidget::DeviceManagerWidget(QWidget *parent)
                 emit updateNoDevicesConnected();
             });
 
+    // Details arrive in stages after the device was added
+    connect(AppContext::sharedInstance(), &AppContext::deviceInfoUpdated, this,
+            [this](iDescriptorDevice *device, DeviceInitStage stage) {
+                if (m_deviceWidgets.contains(device->udid)) {
+                    m_deviceWidgets[device->udid].first->refreshDeviceInfo(
+                        stage);
+                }
+            });
+
     connect(AppContext::sharedInstance(), &AppContext::deviceRemoved, this,
             [this](const std::string &uuid) {
                 removeDevice(uuid);
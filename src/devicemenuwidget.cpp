@@ -85,6 +85,14 @@ void DeviceMenuWidget::init()
     loadingWidget->deleteLater();
 }
 
+void DeviceMenuWidget::refreshDeviceInfo(DeviceInitStage stage)
+{
+    // Widgets created after this point read the updated info themselves
+    if (m_deviceInfoWidget) {
+        m_deviceInfoWidget->refreshDeviceInfo(stage);
+    }
+}
+
 void DeviceMenuWidget::switchToTab(const QString &tabName)
 {
     if (tabName == "Info") {
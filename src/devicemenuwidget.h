@@ -35,12 +35,13 @@ public:
                               QWidget *parent = nullptr);
     void switchToTab(const QString &tabName);
     void init();
+    void refreshDeviceInfo(DeviceInitStage stage);
     ~DeviceMenuWidget();
 
 private:
     QStackedWidget *stackedWidget; // Pointer to the stacked widget
     iDescriptorDevice *device;     // Pointer to the iDescriptor device
-    DeviceInfoWidget *m_deviceInfoWidget;
+    DeviceInfoWidget *m_deviceInfoWidget = nullptr;
     InstalledAppsWidget *m_installedAppsWidget;
     GalleryWidget *m_galleryWidget;
     FileExplorerWidget *m_fileExplorerWidget;
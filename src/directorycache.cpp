@@ -0,0 +1,181 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "directorycache.h"
+#include <algorithm>
+
+DirectoryCache *DirectoryCache::sharedInstance()
+{
+    static DirectoryCache self;
+    return &self;
+}
+
+std::string DirectoryCache::normalizedPath(const std::string &path)
+{
+    std::string normalized;
+    normalized.reserve(path.size() + 1);
+    for (char c : path) {
+        if (c == '/' && !normalized.empty() && normalized.back() == '/')
+            continue;
+        normalized += c;
+    }
+    if (normalized.empty() || normalized.front() != '/')
+        normalized.insert(normalized.begin(), '/');
+    if (normalized.size() > 1 && normalized.back() == '/')
+        normalized.pop_back();
+    return normalized;
+}
+
+std::string DirectoryCache::parentPath(const std::string &path)
+{
+    size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos || slash == 0)
+        return "/";
+    return path.substr(0, slash);
+}
+
+bool DirectoryCache::listing(const std::string &udid, const std::string &path,
+                             bool needStat, std::vector<MediaEntry> *entries)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto device = m_devices.find(udid);
+    if (device == m_devices.end())
+        return false;
+
+    auto it = device->second.find(normalizedPath(path));
+    if (it == device->second.end())
+        return false;
+
+    if (it->second.expiresAt <= Clock::now()) {
+        device->second.erase(it);
+        return false;
+    }
+    if (needStat && !it->second.hasStat)
+        return false;
+
+    if (entries)
+        *entries = it->second.entries;
+    return true;
+}
+
+uint64_t DirectoryCache::generation()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_generation;
+}
+
+void DirectoryCache::storeListing(const std::string &udid,
+                                  const std::string &path,
+                                  const std::vector<MediaEntry> &entries,
+                                  bool hasStat, uint64_t generation)
+{
+    const std::string normalized = normalizedPath(path);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Whatever was invalidated meanwhile may have been forgotten already
+    if (generation < m_forgottenGeneration)
+        return;
+
+    auto invalidated = m_invalidated.find(udid);
+    if (invalidated != m_invalidated.end()) {
+        // The path or one of its ancestors changed while we were listing
+        std::string current = normalized;
+        for (;;) {
+            auto it = invalidated->second.find(current);
+            if (it != invalidated->second.end() &&
+                it->second.generation > generation)
+                return;
+            if (current == "/")
+                break;
+            current = parentPath(current);
+        }
+    }
+
+    auto &listings = m_devices[udid];
+    const Clock::time_point now = Clock::now();
+
+    if (listings.size() >= DIRECTORY_CACHE_MAX_LISTINGS) {
+        for (auto it = listings.begin(); it != listings.end();) {
+            it = it->second.expiresAt <= now ? listings.erase(it) : ++it;
+        }
+    }
+    if (listings.size() >= DIRECTORY_CACHE_MAX_LISTINGS) {
+        // Still full, drop the listing that was stored first
+        auto oldest = std::min_element(
+            listings.begin(), listings.end(), [](const auto &a, const auto &b) {
+                return a.second.expiresAt < b.second.expiresAt;
+            });
+        listings.erase(oldest);
+    }
+
+    Listing &listing = listings[normalized];
+    listing.entries = entries;
+    listing.hasStat = hasStat;
+    listing.expiresAt = now + std::chrono::milliseconds(DIRECTORY_CACHE_TTL_MS);
+}
+
+void DirectoryCache::invalidate(const std::string &udid,
+                                const std::string &path)
+{
+    const std::string normalized = normalizedPath(path);
+    const std::string prefix = normalized == "/" ? "/" : normalized + "/";
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const Clock::time_point now = Clock::now();
+    auto &invalidated = m_invalidated[udid];
+    // Listings are only checked against invalidations that happened while
+    // they were fetched, older ones would pile up for the device's lifetime
+    for (auto it = invalidated.begin(); it != invalidated.end();) {
+        if (it->second.at + std::chrono::milliseconds(DIRECTORY_CACHE_TTL_MS) <=
+            now) {
+            m_forgottenGeneration =
+                std::max(m_forgottenGeneration, it->second.generation);
+            it = invalidated.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    const Invalidation invalidation = {++m_generation, now};
+    invalidated[normalized] = invalidation;
+    invalidated[parentPath(normalized)] = invalidation;
+
+    auto device = m_devices.find(udid);
+    if (device == m_devices.end())
+        return;
+
+    auto &listings = device->second;
+    listings.erase(parentPath(normalized));
+    for (auto it = listings.begin(); it != listings.end();) {
+        const std::string &cached = it->first;
+        if (cached == normalized ||
+            cached.compare(0, prefix.size(), prefix) == 0)
+            it = listings.erase(it);
+        else
+            ++it;
+    }
+}
+
+void DirectoryCache::removeDevice(const std::string &udid)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_devices.erase(udid);
+    m_invalidated.erase(udid);
+}
@@ -0,0 +1,107 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DIRECTORYCACHE_H
+#define DIRECTORYCACHE_H
+
+#include "iDescriptor.h"
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// How long a listing is trusted. The device itself can add files at any time
+// (camera, downloads), so cached listings must not live forever.
+#define DIRECTORY_CACHE_TTL_MS 30000
+// Listings kept per device, the oldest are dropped beyond this
+#define DIRECTORY_CACHE_MAX_LISTINGS 256
+
+/**
+ * @brief Per-device cache of AFC directory listings and their stat results
+ *
+ * Only the media AFC domain (the device's primary client and its pool) is
+ * cached, listings of house_arrest or afc2 clients are always fetched. Our
+ * own writes invalidate the written path and its parent directory, and
+ * everything cached for a device is dropped when it is removed.
+ */
+class DirectoryCache
+{
+public:
+    static DirectoryCache *sharedInstance();
+
+    /**
+     * @brief Look up a listing that has not expired yet
+     * @param needStat Only accept listings whose entries were stat'ed
+     */
+    bool listing(const std::string &udid, const std::string &path,
+                 bool needStat, std::vector<MediaEntry> *entries);
+
+    // Taken before fetching a listing and handed to storeListing
+    uint64_t generation();
+    /**
+     * @brief Cache a fetched listing
+     * @param generation What generation() returned before the fetch started,
+     * the listing is dropped if the path was invalidated since then
+     */
+    void storeListing(const std::string &udid, const std::string &path,
+                      const std::vector<MediaEntry> &entries, bool hasStat,
+                      uint64_t generation);
+
+    // Drop the path (and anything below it) and its parent's listing
+    void invalidate(const std::string &udid, const std::string &path);
+    void removeDevice(const std::string &udid);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Listing {
+        std::vector<MediaEntry> entries;
+        bool hasStat = false;
+        Clock::time_point expiresAt;
+    };
+
+    struct Invalidation {
+        uint64_t generation = 0;
+        Clock::time_point at;
+    };
+
+    DirectoryCache() = default;
+    DirectoryCache(const DirectoryCache &) = delete;
+    DirectoryCache &operator=(const DirectoryCache &) = delete;
+
+    static std::string normalizedPath(const std::string &path);
+    static std::string parentPath(const std::string &path);
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, std::unordered_map<std::string, Listing>>
+        m_devices;
+    // Bumped by every invalidate, each invalidated path remembers the value.
+    // Paths are forgotten after DIRECTORY_CACHE_TTL_MS, listings started
+    // before the newest forgotten generation are not cached.
+    uint64_t m_generation = 0;
+    uint64_t m_forgottenGeneration = 0;
+    std::unordered_map<std::string,
+                       std::unordered_map<std::string, Invalidation>>
+        m_invalidated;
+};
+
+#endif // DIRECTORYCACHE_H
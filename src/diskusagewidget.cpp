@@ -18,6 +18,7 @@
  */
 
 #include "diskusagewidget.h"
+#include "appinventory.h"
 #include "diskusagebar.h"
 #include "iDescriptor.h"
 
@@ -27,7 +28,6 @@
 #include <QVariantMap>
 #include <QtConcurrent/QtConcurrent>
 
-#include <libimobiledevice/installation_proxy.h>
 #include <libimobiledevice/libimobiledevice.h>
 #include <libimobiledevice/lockdown.h>
 
@@ -38,6 +38,8 @@ DiskUsageWidget::DiskUsageWidget(iDescriptorDevice *device, QWidget *parent)
 {
     setMinimumHeight(80);
     setupUI();
+    connect(AppInventory::sharedInstance(), &AppInventory::refreshFinished,
+            this, &DiskUsageWidget::onAppsRefreshFinished);
     fetchData();
 }
 
@@ -366,11 +368,22 @@ void DiskUsageWidget::updateUI()
     // m_freeBar->setVisible(m_freeSpace > 0);
 }
 
+void DiskUsageWidget::refresh() { fetchData(); }
+
 void DiskUsageWidget::fetchData()
 {
+    m_state = Loading;
+    m_detailsPending = true;
+    m_appsPending = true;
+    const quint64 fetchId = ++m_fetchId;
+
     auto *watcher = new QFutureWatcher<QVariantMap>(this);
     connect(watcher, &QFutureWatcher<QVariantMap>::finished, this,
-            [this, watcher]() {
+            [this, watcher, fetchId]() {
+                watcher->deleteLater();
+                if (fetchId != m_fetchId) {
+                    return;
+                }
                 QVariantMap result = watcher->result();
                 if (result.contains("error")) {
                     m_state = Error;
@@ -378,119 +391,39 @@ void DiskUsageWidget::fetchData()
                 } else {
                     m_totalCapacity = result["totalCapacity"].toULongLong();
                     m_systemUsage = result["systemUsage"].toULongLong();
-                    m_appsUsage = result["appsUsage"].toULongLong();
                     m_mediaUsage = result["mediaUsage"].toULongLong();
                     m_freeSpace = result["freeSpace"].toULongLong();
-
-                    uint64_t usedKnown =
-                        m_systemUsage + m_appsUsage + m_mediaUsage;
-                    if (m_totalCapacity > (m_freeSpace + usedKnown)) {
-                        m_othersUsage =
-                            m_totalCapacity - m_freeSpace - usedKnown;
-                    } else {
-                        m_othersUsage = 0;
-                    }
-
-                    m_state = Ready;
                 }
-                updateUI(); // Update the UI instead of triggering repaint
-                watcher->deleteLater();
+                m_detailsPending = false;
+                finishFetch();
             });
 
-    QFuture<QVariantMap> future = QtConcurrent::run([this]() {
+    // deviceInfo is written on the GUI thread, copy it before going off it
+    const DiskInfo diskInfo =
+        m_device ? m_device->deviceInfo.diskInfo : DiskInfo();
+    idevice_t idevice = m_device ? m_device->device : nullptr;
+
+    QFuture<QVariantMap> future = QtConcurrent::run([diskInfo, idevice]() {
         QVariantMap result;
-        if (!m_device || !m_device->device) {
+        if (!idevice) {
             result["error"] = "Invalid device.";
             return result;
         }
 
-        result["totalCapacity"] = QVariant::fromValue(
-            m_device->deviceInfo.diskInfo.totalDiskCapacity);
-        result["freeSpace"] = QVariant::fromValue(
-            m_device->deviceInfo.diskInfo.totalDataAvailable);
-        result["systemUsage"] = QVariant::fromValue(
-            m_device->deviceInfo.diskInfo.totalSystemCapacity);
+        result["totalCapacity"] =
+            QVariant::fromValue(diskInfo.totalDiskCapacity);
+        result["freeSpace"] = QVariant::fromValue(diskInfo.totalDataAvailable);
+        result["systemUsage"] =
+            QVariant::fromValue(diskInfo.totalSystemCapacity);
 
-        // Apps usage
-        uint64_t totalAppsSpace = 0;
-        instproxy_client_t instproxy = nullptr;
         lockdownd_client_t lockdownClient = nullptr;
-        lockdownd_service_descriptor_t lockdowndService = nullptr;
-
-        if (lockdownd_client_new_with_handshake(m_device->device,
-                                                &lockdownClient, APP_LABEL) !=
+        if (lockdownd_client_new_with_handshake(idevice, &lockdownClient,
+                                                APP_LABEL) !=
             LOCKDOWN_E_SUCCESS) {
             result["error"] = "Could not connect to lockdown service.";
             return result;
         }
 
-        if (lockdownd_start_service(lockdownClient,
-                                    "com.apple.mobile.installation_proxy",
-                                    &lockdowndService) != LOCKDOWN_E_SUCCESS) {
-            result["error"] = "Could not start installation proxy service.";
-            lockdownd_client_free(lockdownClient);
-            return result;
-        }
-
-        if (instproxy_client_new(m_device->device, lockdowndService,
-                                 &instproxy) != INSTPROXY_E_SUCCESS) {
-            result["error"] = "Could not connect to installation proxy.";
-            lockdownd_service_descriptor_free(lockdowndService);
-            lockdownd_client_free(lockdownClient);
-            return result;
-        }
-
-        // The service descriptor is no longer needed after the client is
-        // created
-        lockdownd_service_descriptor_free(lockdowndService);
-        lockdowndService = nullptr;
-
-        plist_t client_opts = instproxy_client_options_new();
-        plist_dict_set_item(client_opts, "ApplicationType",
-                            plist_new_string("User"));
-
-        plist_t return_attrs = plist_new_array();
-        plist_array_append_item(return_attrs,
-                                plist_new_string("StaticDiskUsage"));
-        plist_array_append_item(return_attrs,
-                                plist_new_string("DynamicDiskUsage"));
-        plist_dict_set_item(client_opts, "ReturnAttributes", return_attrs);
-
-        plist_t apps = nullptr;
-        if (instproxy_browse(instproxy, client_opts, &apps) ==
-                INSTPROXY_E_SUCCESS &&
-            apps) {
-            if (plist_get_node_type(apps) == PLIST_ARRAY) {
-                for (uint32_t i = 0; i < plist_array_get_size(apps); i++) {
-                    plist_t app_info = plist_array_get_item(apps, i);
-                    if (!app_info)
-                        continue;
-
-                    plist_t static_usage =
-                        plist_dict_get_item(app_info, "StaticDiskUsage");
-                    if (static_usage &&
-                        plist_get_node_type(static_usage) == PLIST_UINT) {
-                        uint64_t static_size = 0;
-                        plist_get_uint_val(static_usage, &static_size);
-                        totalAppsSpace += static_size;
-                    }
-
-                    plist_t dynamic_usage =
-                        plist_dict_get_item(app_info, "DynamicDiskUsage");
-                    if (dynamic_usage &&
-                        plist_get_node_type(dynamic_usage) == PLIST_UINT) {
-                        uint64_t dynamic_size = 0;
-                        plist_get_uint_val(dynamic_usage, &dynamic_size);
-                        totalAppsSpace += dynamic_size;
-                    }
-                }
-            }
-            plist_free(apps);
-        }
-        result["appsUsage"] = QVariant::fromValue(totalAppsSpace);
-        plist_free(client_opts);
-        instproxy_client_free(instproxy);
-
         // Media usage
         uint64_t mediaSpace = 0;
         plist_t node = nullptr;
@@ -509,4 +442,41 @@ void DiskUsageWidget::fetchData()
         return result;
     });
     watcher->setFuture(future);
+
+    // Apps usage comes from the shared app inventory, the apps page reuses
+    // the same browse
+    if (m_device && m_device->device)
+        AppInventory::sharedInstance()->refresh(m_device);
+    else
+        m_appsPending = false;
+}
+
+void DiskUsageWidget::onAppsRefreshFinished(const QString &udid)
+{
+    if (!m_appsPending || !m_device ||
+        udid != QString::fromStdString(m_device->udid))
+        return;
+
+    // A failed browse still leaves the apps known from earlier ones
+    m_appsUsage = AppInventory::sharedInstance()->userAppsDiskUsage(udid);
+    m_appsPending = false;
+    finishFetch();
+}
+
+void DiskUsageWidget::finishFetch()
+{
+    if (m_detailsPending || m_appsPending)
+        return;
+
+    if (m_state != Error) {
+        uint64_t usedKnown = m_systemUsage + m_appsUsage + m_mediaUsage;
+        if (m_totalCapacity > (m_freeSpace + usedKnown)) {
+            m_othersUsage = m_totalCapacity - m_freeSpace - usedKnown;
+        } else {
+            m_othersUsage = 0;
+        }
+
+        m_state = Ready;
+    }
+    updateUI(); // Update the UI instead of triggering repaint
 }
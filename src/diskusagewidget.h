@@ -37,9 +37,15 @@ class DiskUsageWidget : public QWidget
 public:
     explicit DiskUsageWidget(iDescriptorDevice *device,
                              QWidget *parent = nullptr);
+    // Re-reads the usage, e.g. once the Storage bring-up stage has finished
+    void refresh();
+
+private slots:
+    void onAppsRefreshFinished(const QString &udid);
 
 private:
     void fetchData();
+    void finishFetch();
     void setupUI();
     void updateUI();
 
@@ -93,6 +99,10 @@ private:
     uint64_t m_mediaUsage;
     uint64_t m_othersUsage;
     uint64_t m_freeSpace;
+    bool m_detailsPending = false;
+    bool m_appsPending = false;
+    // Only the newest fetch is applied
+    quint64 m_fetchId = 0;
 };
 
 #endif // DISKUSAGEWIDGET_H
@@ -19,13 +19,14 @@
 
 #include "exportmanager.h"
 #include "exportprogressdialog.h"
+#include "ringcopy.h"
 #include "servicemanager.h"
+#include "settingsmanager.h"
 #include <QDebug>
 #include <QDir>
 #include <QFileInfo>
 #include <QMutexLocker>
 #include <QStandardPaths>
-#include <QtConcurrent/QtConcurrent>
 
 ExportManager *ExportManager::sharedInstance()
 {
@@ -35,6 +36,8 @@ ExportManager *ExportManager::sharedInstance()
 
 ExportManager::ExportManager(QObject *parent) : QObject(parent)
 {
+    m_workerPool.setMaxThreadCount(EXPORT_MAX_WORKERS);
+
     // The singleton now creates and owns the dialog.
     // No parent is passed, so it's a top-level window.
     m_exportProgressDialog = new ExportProgressDialog(this, nullptr);
@@ -43,15 +46,16 @@ ExportManager::ExportManager(QObject *parent) : QObject(parent)
 ExportManager::~ExportManager()
 {
     // Cancel all active jobs
-    QMutexLocker locker(&m_jobsMutex);
-    for (auto jobPtr : m_activeJobs) {
-        jobPtr->cancelRequested = true;
-        if (jobPtr->watcher) {
-            jobPtr->watcher->cancel();
-            jobPtr->watcher->waitForFinished();
+    {
+        QMutexLocker locker(&m_jobsMutex);
+        for (auto jobPtr : m_activeJobs) {
+            jobPtr->cancelRequested = true;
         }
-        delete jobPtr;
     }
+    m_workerPool.waitForDone();
+
+    QMutexLocker locker(&m_jobsMutex);
+    qDeleteAll(m_activeJobs);
     m_activeJobs.clear();
 
     // The dialog will be deleted automatically due to parent-child relationship
@@ -60,7 +64,8 @@ ExportManager::~ExportManager()
 QUuid ExportManager::startExport(iDescriptorDevice *device,
                                  const QList<ExportItem> &items,
                                  const QString &destinationPath,
-                                 std::optional<afc_client_t> altAfc)
+                                 std::optional<afc_client_t> altAfc,
+                                 int concurrency)
 {
     if (!device) {
         qWarning() << "Invalid device provided to ExportManager";
@@ -82,19 +87,47 @@ QUuid ExportManager::startExport(iDescriptorDevice *device,
         }
     }
 
+    // The primary client is only a fallback, pooled connections are faster
+    if (altAfc && *altAfc == device->afcClient) {
+        altAfc = std::nullopt;
+    }
+
+    if (concurrency <= 0) {
+        concurrency = SettingsManager::sharedInstance()->exportConcurrency();
+    }
+
     // Create new job
     auto job = new ExportJob();
     job->jobId = QUuid::createUuid();
     job->device = device;
+    job->afcPool = device->afcPool;
     job->items = items;
     job->destinationPath = destinationPath;
     job->altAfc = altAfc;
-    job->watcher = new QFutureWatcher<void>(this);
+    // Every worker needs its own pooled connection, an alternative client
+    // such as AFC2 is a single connection
+    job->maxConcurrency =
+        altAfc ? 1
+               : qBound(1, concurrency,
+                        job->afcPool ? job->afcPool->maxClients() : 1);
+    job->maxConcurrency = qMin(job->maxConcurrency, items.size());
+    SettingsManager *settings = SettingsManager::sharedInstance();
+    if (settings->incrementalExport()) {
+        job->manifest = manifestFor(destDir.absolutePath());
+        job->udid = QString::fromStdString(device->udid);
+    }
+    job->verifyChecksum = settings->verifyExportChecksum();
+    job->summary.jobId = job->jobId;
+    job->summary.totalItems = items.size();
+    job->summary.destinationPath = destinationPath;
+    for (int i = 0; i < items.size(); ++i) {
+        ExportUnit unit;
+        unit.itemIndex = i;
+        job->pendingUnits.push_back(unit);
+    }
 
     const QUuid jobId = job->jobId;
-
-    connect(job->watcher, &QFutureWatcher<void>::finished, this,
-            [this, jobId]() { cleanupJob(jobId); });
+    const int workerCount = job->maxConcurrency;
 
     // Store job before starting
     {
@@ -107,13 +140,12 @@ QUuid ExportManager::startExport(iDescriptorDevice *device,
     // The manager now shows its own dialog
     m_exportProgressDialog->showForJob(jobId);
 
-    ExportJob *jobPtr = m_activeJobs[jobId];
-    jobPtr->future =
-        QtConcurrent::run([this, jobPtr]() { executeExportJob(jobPtr); });
-    jobPtr->watcher->setFuture(jobPtr->future);
+    for (int i = 0; i < workerCount; ++i) {
+        m_workerPool.start([this, jobId]() { runWorker(jobId); });
+    }
 
     qDebug() << "Started export job" << jobId << "for" << items.size()
-             << "items";
+             << "items with" << workerCount << "workers";
     return jobId;
 }
 
@@ -139,75 +171,199 @@ bool ExportManager::isJobRunning(const QUuid &jobId) const
     return m_activeJobs.contains(jobId);
 }
 
-void ExportManager::executeExportJob(ExportJob *job)
+void ExportManager::runWorker(const QUuid &homeJobId, AfcClientLease lease)
 {
-    ExportJobSummary summary;
-    summary.jobId = job->jobId;
-    summary.totalItems = job->items.size();
-    summary.destinationPath = job->destinationPath;
-
-    qDebug() << "Executing export job" << job->jobId << "with"
-             << job->items.size() << "items";
-
-    for (int i = 0; i < job->items.size(); ++i) {
-        // Check for cancellation
-        if (job->cancelRequested.load()) {
-            summary.wasCancelled = true;
-            qDebug() << "Export job" << job->jobId << "was cancelled";
-            emit exportCancelled(job->jobId);
-            return;
+    // Transfer blocks are allocated once and reused for every unit
+    BlockRingBuffer ring(EXPORT_BLOCK_COUNT, EXPORT_BLOCK_SIZE);
+    std::shared_ptr<AfcClientPool> leasePool = lease.pool();
+
+    ExportJob *job = nullptr;
+    QList<ExportUnit> units;
+    while (takeUnits(homeJobId, job, units)) {
+        // Keep the connection while consecutive units come from one device
+        if (!job->altAfc && (!lease || leasePool != job->afcPool)) {
+            lease.release();
+            leasePool = job->afcPool;
+            if (leasePool) {
+                lease = leasePool->acquire();
+            }
         }
 
-        const ExportItem &item = job->items.at(i);
+        for (const ExportUnit &unit : units) {
+            if (unit.stripedFile) {
+                exportStripe(job, unit, lease, ring);
+            } else {
+                exportItem(job, unit.itemIndex, lease, ring);
+            }
+        }
+        releaseWorker(job);
+    }
+}
 
-        emit exportProgress(job->jobId, i + 1, job->items.size(),
-                            item.suggestedFileName);
+bool ExportManager::hasAvailableWork(const ExportJob *job) const
+{
+    return job && !job->completed && !job->cancelRequested.load() &&
+           !job->pendingUnits.empty() &&
+           job->activeWorkers < job->maxConcurrency;
+}
 
-        ExportResult result =
-            exportSingleItem(job->device, item, job->destinationPath,
-                             job->altAfc, job->cancelRequested, job->jobId);
+bool ExportManager::takeUnits(const QUuid &homeJobId, ExportJob *&job,
+                              QList<ExportUnit> &units)
+{
+    QMutexLocker locker(&m_jobsMutex);
+    units.clear();
 
-        if (result.success) {
-            summary.successfulItems++;
-            summary.totalBytesTransferred += result.bytesTransferred;
-        } else {
-            summary.failedItems++;
+    // Prefer the job the worker was started for, otherwise steal from the
+    // job with the most queued work
+    ExportJob *candidate = m_activeJobs.value(homeJobId, nullptr);
+    if (!hasAvailableWork(candidate)) {
+        candidate = nullptr;
+        for (ExportJob *other : m_activeJobs) {
+            if (hasAvailableWork(other) &&
+                (!candidate || other->pendingUnits.size() >
+                                   candidate->pendingUnits.size())) {
+                candidate = other;
+            }
         }
+    }
+    if (!candidate) {
+        return false;
+    }
 
-        emit itemExported(job->jobId, result);
+    // Claim small items in batches while there is plenty of queued work,
+    // stripes are always taken one at a time
+    const int batchSize = qBound<int>(
+        1, candidate->pendingUnits.size() / candidate->maxConcurrency,
+        EXPORT_BATCH_SIZE);
+    do {
+        units.append(candidate->pendingUnits.front());
+        candidate->pendingUnits.pop_front();
+    } while (units.size() < batchSize && !units.first().stripedFile &&
+             !candidate->pendingUnits.empty() &&
+             !candidate->pendingUnits.front().stripedFile);
 
-        // Check for cancellation again after potentially long file operation
-        if (job->cancelRequested.load()) {
-            summary.wasCancelled = true;
-            qDebug() << "Export job" << job->jobId
-                     << "was cancelled during execution";
-            emit exportCancelled(job->jobId);
-            return;
+    candidate->activeWorkers++;
+    job = candidate;
+    return true;
+}
+
+void ExportManager::releaseWorker(ExportJob *job)
+{
+    // Queued stripes of a cancelled job still have to finalize their file
+    std::deque<ExportUnit> droppedUnits;
+    if (job->cancelRequested.load()) {
+        QMutexLocker locker(&m_jobsMutex);
+        droppedUnits.swap(job->pendingUnits);
+    }
+    for (const ExportUnit &unit : droppedUnits) {
+        if (unit.stripedFile) {
+            unit.stripedFile->failed = true;
+            finishStripe(job, unit.stripedFile);
         }
     }
 
-    qDebug() << "Export job" << job->jobId
-             << "completed - Success:" << summary.successfulItems
-             << "Failed:" << summary.failedItems
-             << "Bytes:" << summary.totalBytesTransferred;
+    bool jobDone = false;
+    {
+        QMutexLocker locker(&m_jobsMutex);
+        job->activeWorkers--;
+        if (!job->completed && job->activeWorkers == 0 &&
+            job->pendingUnits.empty()) {
+            job->completed = true;
+            jobDone = true;
+        }
+    }
 
-    emit exportFinished(job->jobId, summary);
+    if (jobDone) {
+        finishJob(job);
+    }
 }
 
-ExportResult ExportManager::exportSingleItem(iDescriptorDevice *device,
-                                             const ExportItem &item,
-                                             const QString &destinationDir,
-                                             std::optional<afc_client_t> altAfc,
-                                             std::atomic<bool> &cancelRequested,
-                                             const QUuid &jobId)
+void ExportManager::finishJob(ExportJob *job)
 {
+    const QUuid jobId = job->jobId;
+    if (job->manifest) {
+        job->manifest->save(true);
+    }
+
+    ExportJobSummary summary;
+    {
+        QMutexLocker locker(&m_jobsMutex);
+        job->summary.wasCancelled = job->cancelRequested.load();
+        summary = job->summary;
+    }
+
+    if (summary.wasCancelled) {
+        qDebug() << "Export job" << jobId << "was cancelled";
+        emit exportCancelled(jobId);
+    } else {
+        qDebug() << "Export job" << jobId
+                 << "completed - Success:" << summary.successfulItems
+                 << "Failed:" << summary.failedItems
+                 << "Skipped:" << summary.skippedItems
+                 << "Bytes:" << summary.totalBytesTransferred;
+        emit exportFinished(jobId, summary);
+    }
+
+    QMetaObject::invokeMethod(
+        this, [this, jobId]() { cleanupJob(jobId); }, Qt::QueuedConnection);
+}
+
+void ExportManager::completeItem(ExportJob *job, const ExportResult &result)
+{
+    {
+        QMutexLocker locker(&m_jobsMutex);
+        if (result.skipped) {
+            job->summary.skippedItems++;
+        }
+        if (result.success) {
+            job->summary.successfulItems++;
+            job->summary.totalBytesTransferred += result.bytesTransferred;
+        } else {
+            job->summary.failedItems++;
+        }
+    }
+    emit itemExported(job->jobId, result);
+}
+
+afc_error_t ExportManager::afcCall(ExportJob *job, const AfcClientLease &lease,
+                                   const AfcOperation &operation)
+{
+    if (job->altAfc) {
+        return ServiceManager::executeAfcOperation(job->device, operation,
+                                                   job->altAfc);
+    }
+    if (lease) {
+        return ServiceManager::executeAfcOperation(lease, operation);
+    }
+    // A shut down pool means the device is gone, otherwise no extra
+    // connection could be made and the primary client is used
+    if (!job->afcPool || job->afcPool->isShutdown()) {
+        return AFC_E_NO_DEVICE;
+    }
+    return ServiceManager::executeAfcOperation(job->device, operation);
+}
+
+void ExportManager::exportItem(ExportJob *job, int itemIndex,
+                               const AfcClientLease &lease,
+                               BlockRingBuffer &ring)
+{
+    const ExportItem &item = job->items.at(itemIndex);
+
     ExportResult result;
     result.sourceFilePath = item.sourcePathOnDevice;
 
-    // Generate output path
-    QString outputPath = QDir(destinationDir).filePath(item.suggestedFileName);
-    outputPath = generateUniqueOutputPath(outputPath);
-    result.outputFilePath = outputPath;
+    if (job->cancelRequested.load()) {
+        return;
+    }
+
+    int currentItem = 0;
+    {
+        QMutexLocker locker(&m_jobsMutex);
+        currentItem = ++job->startedItems;
+    }
+    emit exportProgress(job->jobId, currentItem, job->items.size(),
+                        item.suggestedFileName);
+
     QDateTime modificationTime;
     QDateTime birthTime;
     // Get file size first
@@ -220,124 +376,255 @@ ExportResult ExportManager::exportSingleItem(iDescriptorDevice *device,
     //   "st_birthtime": 1754987735633715011
     // }
 
+    const QByteArray sourcePath = item.sourcePathOnDevice.toUtf8();
     plist_t info = nullptr;
-    afc_error_t infoResult = ServiceManager::safeAfcGetFileInfoPlist(
-        device, item.sourcePathOnDevice.toUtf8().constData(), &info, altAfc);
+    afc_error_t infoResult = afcCall(job, lease, [&](afc_client_t client) {
+        return afc_get_file_info_plist(client, sourcePath.constData(), &info);
+    });
     quint64 totalFileSize = 0;
     if (infoResult != AFC_E_SUCCESS || !info) {
         qDebug() << "File info retrieval failed for" << item.sourcePathOnDevice;
-        return result;
+        result.errorMessage = "Failed to get file info from device";
+        completeItem(job, result);
+        return;
     }
 
     PlistNavigator fileInfo = PlistNavigator(info);
-
-    bool valid = fileInfo["st_size"].valid();
-    if (!valid) {
-        qDebug() << "File size info not valid for" << item.sourcePathOnDevice;
-        if (info)
-            plist_free(info);
-        return result;
+    if (!fileInfo["st_size"].valid() || !fileInfo["st_mtime"].valid() ||
+        !fileInfo["st_birthtime"].valid()) {
+        qDebug() << "File info not valid for" << item.sourcePathOnDevice;
+        plist_free(info);
+        result.errorMessage = "Invalid file info from device";
+        completeItem(job, result);
+        return;
     }
 
     totalFileSize = fileInfo["st_size"].getUInt();
+    // The timestamp from the device is in nanoseconds, convert to seconds (UTC)
+    uint64_t modTimeNs = fileInfo["st_mtime"].getUInt();
+    modificationTime =
+        QDateTime::fromSecsSinceEpoch(modTimeNs / 1000000000, Qt::UTC);
+    uint64_t birthTimeNs = fileInfo["st_birthtime"].getUInt();
+    birthTime = QDateTime::fromSecsSinceEpoch(birthTimeNs / 1000000000, Qt::UTC);
+
+    plist_free(info);
+
+    const bool striped =
+        totalFileSize > EXPORT_STRIPE_THRESHOLD &&
+        (job->manifest || (!job->altAfc && job->maxConcurrency > 1));
 
-    valid = fileInfo["st_mtime"].valid();
-    if (!valid) {
-        qDebug() << "File modification time info not valid for"
-                 << item.sourcePathOnDevice;
-        if (info)
-            plist_free(info);
-        return result;
+    // Look up the previous export of this file in the manifest
+    QString outputPath;
+    std::optional<ExportManifestEntry> previous;
+    bool resume = false;
+    if (job->manifest) {
+        previous = job->manifest->entry(job->udid, item.sourcePathOnDevice);
+        if (!previous) {
+            // Adopt a copy from an export that ran without a manifest, it
+            // carries the device's modification time
+            QFileInfo existing(
+                QDir(job->destinationPath).filePath(item.suggestedFileName));
+            if (existing.exists() &&
+                existing.size() == static_cast<qint64>(totalFileSize) &&
+                existing.lastModified().toSecsSinceEpoch() ==
+                    modificationTime.toSecsSinceEpoch()) {
+                ExportManifestEntry adopted;
+                adopted.fileName = item.suggestedFileName;
+                adopted.size = totalFileSize;
+                adopted.modificationTime = modTimeNs;
+                adopted.birthTime = birthTimeNs;
+                adopted.complete = true;
+                adopted.segments.append({0, adopted.size, QByteArray()});
+                job->manifest->setEntry(job->udid, item.sourcePathOnDevice,
+                                        adopted);
+                previous = adopted;
+            }
+        }
     }
 
-    uint64_t modTimeNs = fileInfo["st_mtime"].getUInt();
-    // The timestamp from the device is in nanoseconds, convert to seconds (UTC)
-    modificationTime = QDateTime::fromSecsSinceEpoch(modTimeNs / 1000000000, Qt::UTC);
+    // The manifest comes from disk, never let it point outside the
+    // destination since the previous copy gets overwritten
+    const QDir destination(job->destinationPath);
+    if (previous) {
+        const QFileInfo previousFile(destination.filePath(previous->fileName));
+        if (QDir::cleanPath(previousFile.absolutePath()) !=
+            QDir::cleanPath(destination.absolutePath())) {
+            qWarning() << "Ignoring manifest entry outside the destination:"
+                       << previous->fileName;
+            previous.reset();
+        }
+    }
+
+    if (previous) {
+        const QString previousPath = destination.filePath(previous->fileName);
+        QFileInfo previousFile(previousPath);
+        const bool unchanged =
+            previous->matches(totalFileSize, modTimeNs, birthTimeNs) &&
+            previousFile.exists() &&
+            previousFile.size() == static_cast<qint64>(totalFileSize);
+
+        if (unchanged && previous->complete &&
+            (!job->verifyChecksum || verifyLocalCopy(previousPath, *previous))) {
+            result.success = true;
+            result.skipped = true;
+            result.outputFilePath = previousPath;
+            completeItem(job, result);
+            return;
+        }
 
-    valid = fileInfo["st_birthtime"].valid();
-    if (!valid) {
-        qDebug() << "File birth time info not valid for"
-                 << item.sourcePathOnDevice;
-        if (info)
-            plist_free(info);
-        return result;
+        // Interrupted striped copies continue with their missing stripes,
+        // anything else replaces the previous copy
+        resume = unchanged && !previous->complete && striped;
+        outputPath = previousPath;
+    } else {
+        outputPath = reserveOutputPath(
+            QDir(job->destinationPath).filePath(item.suggestedFileName));
     }
-    uint64_t birthTimeNs = fileInfo["st_birthtime"].getUInt();
-    birthTime = QDateTime::fromSecsSinceEpoch(birthTimeNs / 1000000000, Qt::UTC);
+    result.outputFilePath = outputPath;
 
-    plist_free(info);
+    if (job->manifest && !resume) {
+        ExportManifestEntry entry;
+        entry.fileName = QFileInfo(outputPath).fileName();
+        entry.size = totalFileSize;
+        entry.modificationTime = modTimeNs;
+        entry.birthTime = birthTimeNs;
+        job->manifest->setEntry(job->udid, item.sourcePathOnDevice, entry);
+    }
+
+    // Large files are split into stripes so idle workers can help copying,
+    // incremental exports also use them as resume points
+    if (striped) {
+        if (!resume) {
+            QFile outputFile(outputPath);
+            bool created = outputFile.open(QIODevice::WriteOnly) &&
+                           outputFile.resize(totalFileSize);
+            QString createError = outputFile.errorString();
+            outputFile.close();
+            releaseOutputPath(outputPath);
+            if (!created) {
+                QFile::remove(outputPath);
+                if (job->manifest) {
+                    job->manifest->removeEntry(job->udid,
+                                               item.sourcePathOnDevice);
+                }
+                result.errorMessage =
+                    QString("Failed to create local file: %1 (%2)")
+                        .arg(outputPath)
+                        .arg(createError);
+                completeItem(job, result);
+                return;
+            }
+        }
+
+        auto stripedFile = std::make_shared<StripedFile>();
+        stripedFile->itemIndex = itemIndex;
+        stripedFile->outputPath = outputPath;
+        stripedFile->totalSize = totalFileSize;
+        stripedFile->modificationTime = modificationTime;
+        stripedFile->birthTime = birthTime;
+
+        QList<ExportUnit> stripes =
+            planStripes(job, stripedFile, resume ? &*previous : nullptr);
+        if (stripes.isEmpty()) {
+            // Every stripe was already on disk, only the manifest was behind
+            stripedFile->remainingStripes = 1;
+            finishStripe(job, stripedFile);
+            return;
+        }
+        runStripes(job, stripes, lease, ring);
+        return;
+    }
 
     // Open file on device
     uint64_t handle = 0;
-    afc_error_t openResult = ServiceManager::safeAfcFileOpen(
-        device, item.sourcePathOnDevice.toUtf8().constData(), AFC_FOPEN_RDONLY,
-        &handle, altAfc);
+    afc_error_t openResult = afcCall(job, lease, [&](afc_client_t client) {
+        return afc_file_open(client, sourcePath.constData(), AFC_FOPEN_RDONLY,
+                             &handle);
+    });
+
+    auto closeHandle = [&]() {
+        afcCall(job, lease, [handle](afc_client_t client) {
+            return afc_file_close(client, handle);
+        });
+    };
+
+    // Failed copies are not kept, so they must not stay in the manifest
+    auto forgetItem = [&]() {
+        if (job->manifest) {
+            job->manifest->removeEntry(job->udid, item.sourcePathOnDevice);
+        }
+    };
 
     if (openResult != AFC_E_SUCCESS) {
+        releaseOutputPath(outputPath);
         result.errorMessage =
             QString("Failed to open file on device: %1 (AFC error: %2)")
                 .arg(item.sourcePathOnDevice)
                 .arg(static_cast<int>(openResult));
-        return result;
+        forgetItem();
+        completeItem(job, result);
+        return;
     }
 
     // Open local output file
     QFile outputFile(outputPath);
-    if (!outputFile.open(QIODevice::WriteOnly)) {
+    bool opened = outputFile.open(QIODevice::WriteOnly);
+    releaseOutputPath(outputPath);
+    if (!opened) {
         result.errorMessage = QString("Failed to create local file: %1 (%2)")
                                   .arg(outputPath)
                                   .arg(outputFile.errorString());
-        ServiceManager::safeAfcFileClose(device, handle, altAfc);
-        return result;
+        closeHandle();
+        forgetItem();
+        completeItem(job, result);
+        return;
     }
 
-    char buffer[8192];
-    uint32_t bytesRead = 0;
-    quint64 totalBytes = 0;
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    QString copyError;
+    qint64 totalBytes = copyRange(
+        job, lease, handle, outputFile, -1, ring,
+        job->verifyChecksum ? &hash : nullptr,
+        [&](qint64 bytesCopied) {
+            emit fileTransferProgress(job->jobId, item.suggestedFileName,
+                                      bytesCopied, totalFileSize);
+        },
+        copyError);
 
-    while (true) {
-        // Check for cancellation during file copy
-        if (cancelRequested.load()) {
-            outputFile.close();
-            outputFile.remove(); // Clean up partial file
-            ServiceManager::safeAfcFileClose(device, handle, altAfc);
-            result.errorMessage = "Export cancelled by user";
-            return result;
-        }
+    closeHandle();
 
-        afc_error_t readResult = ServiceManager::safeAfcFileRead(
-            device, handle, buffer, sizeof(buffer), &bytesRead, altAfc);
+    if (totalBytes < 0 || totalBytes != static_cast<qint64>(totalFileSize)) {
+        outputFile.close();
+        outputFile.remove(); // Clean up partial file
+        result.errorMessage =
+            totalBytes < 0 ? copyError
+                           : QString("Short read: got %1 of %2 bytes")
+                                 .arg(totalBytes)
+                                 .arg(totalFileSize);
+        forgetItem();
+        completeItem(job, result);
+        return;
+    }
 
-        if (readResult != AFC_E_SUCCESS || bytesRead == 0) {
-            break; // End of file or error
-        }
+    outputFile.flush();
 
-        qint64 bytesWritten = outputFile.write(buffer, bytesRead);
-        if (bytesWritten != bytesRead) {
-            result.errorMessage =
-                QString("Write error: only wrote %1 of %2 bytes")
-                    .arg(bytesWritten)
-                    .arg(bytesRead);
+    QByteArray digest;
+    if (job->verifyChecksum) {
+        digest = hash.result();
+        if (hashLocalRange(outputPath, 0, totalBytes) != digest) {
             outputFile.close();
-            outputFile.remove(); // Clean up partial file
-            ServiceManager::safeAfcFileClose(device, handle, altAfc);
-            return result;
-        }
-
-        totalBytes += bytesRead;
-
-        // Emit progress update every 64KB or at end of file
-        if (totalBytes % (64 * 1024) == 0 || totalBytes == totalFileSize) {
-            emit fileTransferProgress(jobId, item.suggestedFileName, totalBytes,
-                                      totalFileSize);
+            outputFile.remove();
+            result.errorMessage =
+                QString("Checksum mismatch after writing %1").arg(outputPath);
+            forgetItem();
+            completeItem(job, result);
+            return;
         }
     }
 
-    ServiceManager::safeAfcFileClose(device, handle, altAfc);
-
-    outputFile.flush();
     if (modificationTime.isValid()) {
-        if (!outputFile.setFileTime(modificationTime, QFileDevice::FileModificationTime)) {
+        if (!outputFile.setFileTime(modificationTime,
+                                    QFileDevice::FileModificationTime)) {
             qWarning() << "Could not set modification time for" << outputPath;
         }
     }
@@ -351,17 +638,355 @@ ExportResult ExportManager::exportSingleItem(iDescriptorDevice *device,
     if (totalBytes == 0) {
         result.errorMessage = "No data read from device file";
         QFile::remove(outputPath); // Clean up empty file
-        return result;
+        forgetItem();
+        completeItem(job, result);
+        return;
+    }
+
+    if (job->manifest) {
+        recordSegment(job, itemIndex, 0, totalBytes, digest);
+        job->manifest->markComplete(job->udid, item.sourcePathOnDevice);
     }
 
     result.success = true;
     result.bytesTransferred = totalBytes;
-    return result;
+    completeItem(job, result);
+}
+
+void ExportManager::exportStripe(ExportJob *job, const ExportUnit &unit,
+                                 const AfcClientLease &lease,
+                                 BlockRingBuffer &ring)
+{
+    const std::shared_ptr<StripedFile> &stripedFile = unit.stripedFile;
+    const ExportItem &item = job->items.at(stripedFile->itemIndex);
+
+    auto failStripe = [&](const QString &message) {
+        QMutexLocker locker(&stripedFile->errorMutex);
+        if (!stripedFile->failed.exchange(true)) {
+            stripedFile->errorMessage = message;
+        }
+    };
+
+    if (stripedFile->failed.load() || job->cancelRequested.load()) {
+        failStripe("Export cancelled by user");
+        finishStripe(job, stripedFile);
+        return;
+    }
+
+    const QByteArray sourcePath = item.sourcePathOnDevice.toUtf8();
+    uint64_t handle = 0;
+    afc_error_t openResult = afcCall(job, lease, [&](afc_client_t client) {
+        return afc_file_open(client, sourcePath.constData(), AFC_FOPEN_RDONLY,
+                             &handle);
+    });
+    if (openResult != AFC_E_SUCCESS) {
+        failStripe(QString("Failed to open file on device: %1 (AFC error: %2)")
+                       .arg(item.sourcePathOnDevice)
+                       .arg(static_cast<int>(openResult)));
+        finishStripe(job, stripedFile);
+        return;
+    }
+
+    QFile outputFile(stripedFile->outputPath);
+    afc_error_t seekResult = afcCall(job, lease, [&](afc_client_t client) {
+        return afc_file_seek(client, handle, unit.offset, SEEK_SET);
+    });
+    if (seekResult != AFC_E_SUCCESS) {
+        failStripe(QString("Failed to seek in file on device: %1")
+                       .arg(item.sourcePathOnDevice));
+    } else if (!outputFile.open(QIODevice::ReadWrite) ||
+               !outputFile.seek(unit.offset)) {
+        failStripe(QString("Failed to open local file: %1 (%2)")
+                       .arg(stripedFile->outputPath)
+                       .arg(outputFile.errorString()));
+    } else {
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        QString copyError;
+        qint64 copied = copyRange(
+            job, lease, handle, outputFile, unit.length, ring,
+            job->verifyChecksum ? &hash : nullptr,
+            [&, lastCopied = qint64(0)](qint64 bytesCopied) mutable {
+                qint64 total = stripedFile->bytesTransferred.fetch_add(
+                                   bytesCopied - lastCopied) +
+                               bytesCopied - lastCopied;
+                lastCopied = bytesCopied;
+                emit fileTransferProgress(job->jobId, item.suggestedFileName,
+                                          total, stripedFile->totalSize);
+            },
+            copyError);
+        if (copied < 0) {
+            failStripe(copyError);
+        } else if (copied != unit.length) {
+            failStripe(QString("Short read: got %1 of %2 bytes")
+                           .arg(copied)
+                           .arg(unit.length));
+        } else {
+            outputFile.flush();
+            QByteArray digest;
+            if (job->verifyChecksum) {
+                digest = hash.result();
+            }
+            if (!digest.isEmpty() &&
+                hashLocalRange(stripedFile->outputPath, unit.offset,
+                               unit.length) != digest) {
+                failStripe(QString("Checksum mismatch after writing %1")
+                               .arg(stripedFile->outputPath));
+            } else if (job->manifest) {
+                recordSegment(job, stripedFile->itemIndex, unit.offset,
+                              unit.length, digest);
+            }
+        }
+        outputFile.close();
+    }
+
+    afcCall(job, lease, [handle](afc_client_t client) {
+        return afc_file_close(client, handle);
+    });
+    finishStripe(job, stripedFile);
+}
+
+void ExportManager::finishStripe(
+    ExportJob *job, const std::shared_ptr<StripedFile> &stripedFile)
+{
+    // The worker that completes the last stripe finalizes the item
+    if (stripedFile->remainingStripes.fetch_sub(1) != 1) {
+        return;
+    }
+
+    const ExportItem &item = job->items.at(stripedFile->itemIndex);
+    ExportResult result;
+    result.sourceFilePath = item.sourcePathOnDevice;
+    result.outputFilePath = stripedFile->outputPath;
+
+    if (stripedFile->failed.load()) {
+        // Incremental exports keep the partial file, its completed stripes
+        // are in the manifest and the next run resumes from there
+        if (!job->manifest) {
+            QFile::remove(stripedFile->outputPath); // Clean up partial file
+        }
+        QMutexLocker locker(&stripedFile->errorMutex);
+        result.errorMessage = stripedFile->errorMessage.isEmpty()
+                                  ? QString("Export cancelled by user")
+                                  : stripedFile->errorMessage;
+        locker.unlock();
+        completeItem(job, result);
+        return;
+    }
+
+    QFile outputFile(stripedFile->outputPath);
+    if (outputFile.open(QIODevice::ReadWrite)) {
+        if (stripedFile->modificationTime.isValid() &&
+            !outputFile.setFileTime(stripedFile->modificationTime,
+                                    QFileDevice::FileModificationTime)) {
+            qWarning() << "Could not set modification time for"
+                       << stripedFile->outputPath;
+        }
+        if (stripedFile->birthTime.isValid() &&
+            !outputFile.setFileTime(stripedFile->birthTime,
+                                    QFileDevice::FileBirthTime)) {
+            qWarning() << "Could not set birth time for"
+                       << stripedFile->outputPath;
+        }
+        outputFile.close();
+    }
+
+    if (job->manifest) {
+        job->manifest->markComplete(job->udid, item.sourcePathOnDevice);
+    }
+
+    result.success = true;
+    result.bytesTransferred = stripedFile->totalSize - stripedFile->resumedBytes;
+    completeItem(job, result);
 }
 
+QList<ExportManager::ExportUnit>
+ExportManager::planStripes(ExportJob *job,
+                           const std::shared_ptr<StripedFile> &file,
+                           const ExportManifestEntry *previous)
+{
+    QList<ExportUnit> stripes;
+    for (qint64 offset = 0; offset < file->totalSize;
+         offset += EXPORT_STRIPE_SIZE) {
+        const qint64 length =
+            qMin<qint64>(EXPORT_STRIPE_SIZE, file->totalSize - offset);
+
+        // Stripes of an interrupted export that are already on disk
+        const ExportManifestSegment *done =
+            previous ? previous->segmentAt(offset) : nullptr;
+        if (done && done->length == length &&
+            (!job->verifyChecksum || done->sha256.isEmpty() ||
+             hashLocalRange(file->outputPath, offset, length) ==
+                 done->sha256)) {
+            file->resumedBytes += length;
+            continue;
+        }
+
+        ExportUnit stripe;
+        stripe.itemIndex = file->itemIndex;
+        stripe.stripedFile = file;
+        stripe.offset = offset;
+        stripe.length = length;
+        stripes.append(stripe);
+    }
+
+    if (file->resumedBytes > 0) {
+        qDebug() << "Resuming" << file->outputPath << "with"
+                 << file->resumedBytes << "of" << file->totalSize
+                 << "bytes already exported";
+    }
+    file->bytesTransferred = file->resumedBytes;
+    file->remainingStripes = stripes.size();
+    return stripes;
+}
+
+void ExportManager::runStripes(ExportJob *job, const QList<ExportUnit> &stripes,
+                               const AfcClientLease &lease,
+                               BlockRingBuffer &ring)
+{
+    // Queue the other stripes in front so they are picked up right away
+    int freeWorkers = 0;
+    {
+        QMutexLocker locker(&m_jobsMutex);
+        for (int i = stripes.size() - 1; i > 0; --i) {
+            job->pendingUnits.push_front(stripes.at(i));
+        }
+        freeWorkers = job->maxConcurrency - job->activeWorkers;
+    }
+
+    // Only start a helper for every connection that is free right now, one
+    // without a connection would just block in the pool. Stripes no helper
+    // takes are copied by the running workers once their unit is done.
+    QList<std::shared_ptr<AfcClientLease>> helperLeases;
+    if (lease && job->afcPool) {
+        while (helperLeases.size() + 1 < stripes.size() &&
+               helperLeases.size() < freeWorkers) {
+            AfcClientLease helper = job->afcPool->tryAcquire();
+            if (!helper) {
+                break;
+            }
+            helperLeases.append(
+                std::make_shared<AfcClientLease>(std::move(helper)));
+        }
+    }
+    for (const std::shared_ptr<AfcClientLease> &helper : helperLeases) {
+        m_workerPool.start([this, jobId = job->jobId, helper]() {
+            runWorker(jobId, std::move(*helper));
+        });
+    }
+    exportStripe(job, stripes.first(), lease, ring);
+}
+
+bool ExportManager::verifyLocalCopy(const QString &path,
+                                    const ExportManifestEntry &entry) const
+{
+    for (const ExportManifestSegment &segment : entry.segments) {
+        if (!segment.sha256.isEmpty() &&
+            hashLocalRange(path, segment.offset, segment.length) !=
+                segment.sha256) {
+            qDebug() << "Checksum of" << path
+                     << "no longer matches the export manifest";
+            return false;
+        }
+    }
+    return true;
+}
+
+void ExportManager::recordSegment(ExportJob *job, int itemIndex, qint64 offset,
+                                  qint64 length, const QByteArray &sha256)
+{
+    job->manifest->addSegment(job->udid,
+                              job->items.at(itemIndex).sourcePathOnDevice,
+                              {offset, length, sha256});
+    job->manifest->save();
+}
+
+QByteArray ExportManager::hashLocalRange(const QString &path, qint64 offset,
+                                         qint64 length)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(offset)) {
+        return QByteArray();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    QByteArray buffer(qMin<qint64>(length, EXPORT_BLOCK_SIZE), Qt::Uninitialized);
+    qint64 remaining = length;
+    while (remaining > 0) {
+        qint64 bytesRead =
+            file.read(buffer.data(), qMin<qint64>(remaining, buffer.size()));
+        if (bytesRead <= 0) {
+            return QByteArray();
+        }
+        hash.addData(QByteArrayView(buffer.constData(), bytesRead));
+        remaining -= bytesRead;
+    }
+    return hash.result();
+}
+
+std::shared_ptr<ExportManifest>
+ExportManager::manifestFor(const QString &directory)
+{
+    QMutexLocker locker(&m_pathsMutex);
+    std::shared_ptr<ExportManifest> manifest = m_manifests.value(directory).lock();
+    if (!manifest) {
+        manifest = std::make_shared<ExportManifest>(directory);
+        m_manifests[directory] = manifest;
+    }
+    return manifest;
+}
+
+qint64 ExportManager::copyRange(ExportJob *job, const AfcClientLease &lease,
+                                uint64_t handle, QFile &outputFile,
+                                qint64 length, BlockRingBuffer &ring,
+                                QCryptographicHash *hash,
+                                const std::function<void(qint64)> &onProgress,
+                                QString &errorMessage)
+{
+    // Large block reads keep the AFC connection busy while the ring's writer
+    // thread flushes to disk
+    afc_error_t readError = AFC_E_SUCCESS;
+    auto read = [&](char *data, qint64 maxSize) -> qint64 {
+        uint32_t bytesRead = 0;
+        readError = afcCall(job, lease, [&](afc_client_t client) {
+            return afc_file_read(client, handle, data,
+                                 static_cast<uint32_t>(maxSize), &bytesRead);
+        });
+        return readError == AFC_E_SUCCESS ? bytesRead : -1;
+    };
+
+    qint64 totalBytes =
+        copyThroughRing(read, outputFile, length, ring, hash,
+                        job->cancelRequested, onProgress, errorMessage);
+    if (totalBytes < 0 && readError != AFC_E_SUCCESS) {
+        errorMessage =
+            QString("Failed to read file from device (AFC error: %1)")
+                .arg(static_cast<int>(readError));
+    }
+    return totalBytes;
+}
+
+QString ExportManager::reserveOutputPath(const QString &basePath)
+{
+    QMutexLocker locker(&m_pathsMutex);
+    QString path = generateUniqueOutputPath(basePath);
+    m_reservedPaths.insert(path);
+    return path;
+}
+
+void ExportManager::releaseOutputPath(const QString &path)
+{
+    QMutexLocker locker(&m_pathsMutex);
+    m_reservedPaths.remove(path);
+}
+
+// Callers hold m_pathsMutex, paths reserved by other workers count as taken
 QString ExportManager::generateUniqueOutputPath(const QString &basePath) const
 {
-    if (!QFile::exists(basePath)) {
+    auto isTaken = [this](const QString &path) {
+        return QFile::exists(path) || m_reservedPaths.contains(path);
+    };
+
+    if (!isTaken(basePath)) {
         return basePath;
     }
 
@@ -380,7 +1005,7 @@ QString ExportManager::generateUniqueOutputPath(const QString &basePath) const
         }
         uniquePath = QDir(directory).filePath(newName);
         counter++;
-    } while (QFile::exists(uniquePath) && counter < 10000);
+    } while (isTaken(uniquePath) && counter < 10000);
 
     return uniquePath;
 }
@@ -399,10 +1024,6 @@ void ExportManager::cleanupJob(const QUuid &jobId)
     QMutexLocker locker(&m_jobsMutex);
     auto it = m_activeJobs.find(jobId);
     if (it != m_activeJobs.end()) {
-        if (it.value()->watcher) {
-            it.value()->watcher->deleteLater();
-        }
-
         delete it.value();
         m_activeJobs.erase(it);
         qDebug() << "Cleaned up export job" << jobId;
@@ -20,18 +20,37 @@
 #ifndef EXPORTMANAGER_H
 #define EXPORTMANAGER_H
 
+#include "afcclientpool.h"
+#include "blockringbuffer.h"
+#include "exportmanifest.h"
 #include "iDescriptor.h"
-#include <QFuture>
-#include <QFutureWatcher>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
 #include <QMap>
 #include <QMutex>
 #include <QObject>
+#include <QSet>
 #include <QString>
+#include <QThreadPool>
 #include <QUuid>
 #include <atomic>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <optional>
 
+// Size and number of the reusable transfer blocks of an export worker
+#define EXPORT_BLOCK_SIZE (4 * 1024 * 1024)
+#define EXPORT_BLOCK_COUNT 4
+// Files above the threshold are split into stripes copied by several workers
+#define EXPORT_STRIPE_THRESHOLD (64 * 1024 * 1024)
+#define EXPORT_STRIPE_SIZE (32 * 1024 * 1024)
+// Maximum number of queued items a worker claims at once
+#define EXPORT_BATCH_SIZE 8
+// Upper bound of export workers across all jobs and devices
+#define EXPORT_MAX_WORKERS 8
+
 // Forward declaration
 class ExportProgressDialog;
 
@@ -50,6 +69,8 @@ struct ExportResult {
     QString sourceFilePath;
     QString outputFilePath;
     bool success = false;
+    // Unchanged since the last incremental export, nothing was copied
+    bool skipped = false;
     QString errorMessage;
     qint64 bytesTransferred = 0;
 };
@@ -59,6 +80,7 @@ struct ExportJobSummary {
     int totalItems = 0;
     int successfulItems = 0;
     int failedItems = 0;
+    int skippedItems = 0;
     qint64 totalBytesTransferred = 0;
     QString destinationPath;
     bool wasCancelled = false;
@@ -76,9 +98,15 @@ public:
     ExportManager(const ExportManager &) = delete;
     ExportManager &operator=(const ExportManager &) = delete;
 
+    /**
+     * @brief Start exporting items from the device
+     * @param concurrency Number of files copied at the same time, 0 uses the
+     * value from the settings
+     */
     QUuid startExport(iDescriptorDevice *device, const QList<ExportItem> &items,
                       const QString &destinationPath,
-                      std::optional<afc_client_t> altAfc = std::nullopt);
+                      std::optional<afc_client_t> altAfc = std::nullopt,
+                      int concurrency = 0);
 
     void cancelExport(const QUuid &jobId);
 
@@ -108,25 +136,103 @@ private:
     explicit ExportManager(QObject *parent = nullptr);
     ~ExportManager();
 
+    // A large file that is copied in stripes by several workers
+    struct StripedFile {
+        int itemIndex = -1;
+        QString outputPath;
+        qint64 totalSize = 0;
+        QDateTime modificationTime;
+        QDateTime birthTime;
+        // Bytes already on disk from an interrupted incremental export
+        qint64 resumedBytes = 0;
+        std::atomic<qint64> bytesTransferred{0};
+        std::atomic<int> remainingStripes{0};
+        std::atomic<bool> failed{false};
+        QMutex errorMutex;
+        QString errorMessage;
+    };
+
+    // Whole item, or one stripe of a StripedFile
+    struct ExportUnit {
+        int itemIndex = -1;
+        std::shared_ptr<StripedFile> stripedFile;
+        qint64 offset = 0;
+        qint64 length = 0;
+    };
+
     struct ExportJob {
         QUuid jobId;
         iDescriptorDevice *device = nullptr;
+        std::shared_ptr<AfcClientPool> afcPool;
         QList<ExportItem> items;
         QString destinationPath;
         std::optional<afc_client_t> altAfc;
         std::atomic<bool> cancelRequested{false};
-        QFuture<void> future;
-        QFutureWatcher<void> *watcher = nullptr;
+        int maxConcurrency = 1;
+        // Incremental exports record every file in the directory's manifest
+        std::shared_ptr<ExportManifest> manifest;
+        QString udid;
+        bool verifyChecksum = false;
+
+        // Scheduler state, guarded by m_jobsMutex
+        std::deque<ExportUnit> pendingUnits;
+        int activeWorkers = 0;
+        int startedItems = 0;
+        bool completed = false;
+        ExportJobSummary summary;
     };
 
-    void executeExportJob(ExportJob *job);
+    using AfcOperation = std::function<afc_error_t(afc_client_t)>;
+
+    // A worker started with a lease keeps using it while units come from
+    // the lease's pool
+    void runWorker(const QUuid &homeJobId,
+                   AfcClientLease lease = AfcClientLease());
+    bool takeUnits(const QUuid &homeJobId, ExportJob *&job,
+                   QList<ExportUnit> &units);
+    bool hasAvailableWork(const ExportJob *job) const;
+    void releaseWorker(ExportJob *job);
+    void finishJob(ExportJob *job);
 
-    ExportResult exportSingleItem(iDescriptorDevice *device,
-                                  const ExportItem &item,
-                                  const QString &destinationDir,
-                                  std::optional<afc_client_t> altAfc,
-                                  std::atomic<bool> &cancelRequested,
-                                  const QUuid &jobId);
+    void exportItem(ExportJob *job, int itemIndex, const AfcClientLease &lease,
+                    BlockRingBuffer &ring);
+    void exportStripe(ExportJob *job, const ExportUnit &unit,
+                      const AfcClientLease &lease, BlockRingBuffer &ring);
+    void finishStripe(ExportJob *job,
+                      const std::shared_ptr<StripedFile> &stripedFile);
+    void completeItem(ExportJob *job, const ExportResult &result);
+    QList<ExportUnit> planStripes(ExportJob *job,
+                                  const std::shared_ptr<StripedFile> &file,
+                                  const ExportManifestEntry *previous);
+    void runStripes(ExportJob *job, const QList<ExportUnit> &stripes,
+                    const AfcClientLease &lease, BlockRingBuffer &ring);
+    bool verifyLocalCopy(const QString &path,
+                         const ExportManifestEntry &entry) const;
+    void recordSegment(ExportJob *job, int itemIndex, qint64 offset,
+                       qint64 length, const QByteArray &sha256);
+
+    afc_error_t afcCall(ExportJob *job, const AfcClientLease &lease,
+                        const AfcOperation &operation);
+
+    /**
+     * @brief Copy length bytes (or up to EOF if length < 0) from an open AFC
+     * handle to the current position of outputFile
+     * @param hash If set, receives every byte read from the device
+     * @return Bytes copied, or -1 with errorMessage set
+     */
+    qint64 copyRange(ExportJob *job, const AfcClientLease &lease,
+                     uint64_t handle, QFile &outputFile, qint64 length,
+                     BlockRingBuffer &ring, QCryptographicHash *hash,
+                     const std::function<void(qint64)> &onProgress,
+                     QString &errorMessage);
+
+    static QByteArray hashLocalRange(const QString &path, qint64 offset,
+                                     qint64 length);
+
+    std::shared_ptr<ExportManifest> manifestFor(const QString &directory);
+
+    QString reserveOutputPath(const QString &basePath);
+    void releaseOutputPath(const QString &path);
 
     QString generateUniqueOutputPath(const QString &basePath) const;
 
@@ -138,6 +244,15 @@ private:
     mutable QMutex m_jobsMutex;
     QMap<QUuid, ExportJob *> m_activeJobs;
 
+    // Output paths picked by a worker but not created on disk yet
+    mutable QMutex m_pathsMutex;
+    QSet<QString> m_reservedPaths;
+    // Open manifests by directory, shared by jobs exporting to the same place
+    QMap<QString, std::weak_ptr<ExportManifest>> m_manifests;
+
+    // Shared by every job so idle workers can steal from other devices' jobs
+    QThreadPool m_workerPool;
+
     // Manager owns the dialog
     ExportProgressDialog *m_exportProgressDialog;
 };
@@ -0,0 +1,235 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "exportmanifest.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+// Entries name a file directly inside the export directory
+static bool isPlainFileName(const QString &name)
+{
+    return !name.isEmpty() && name != "." && name != ".." &&
+           !name.contains('/') && !name.contains('\\') &&
+           !QDir::isAbsolutePath(name);
+}
+
+const ExportManifestSegment *ExportManifestEntry::segmentAt(qint64 offset) const
+{
+    for (const ExportManifestSegment &segment : segments) {
+        if (segment.offset == offset) {
+            return &segment;
+        }
+    }
+    return nullptr;
+}
+
+ExportManifest::ExportManifest(const QString &directory)
+    : m_directory(directory),
+      m_filePath(QDir(directory).filePath(EXPORT_MANIFEST_FILE_NAME))
+{
+    load();
+    m_lastSave.start();
+}
+
+ExportManifest::~ExportManifest() { save(true); }
+
+std::optional<ExportManifestEntry>
+ExportManifest::entry(const QString &udid, const QString &sourcePath) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto device = m_devices.constFind(udid);
+    if (device == m_devices.constEnd()) {
+        return std::nullopt;
+    }
+    auto it = device->constFind(sourcePath);
+    if (it == device->constEnd()) {
+        return std::nullopt;
+    }
+    return it.value();
+}
+
+void ExportManifest::setEntry(const QString &udid, const QString &sourcePath,
+                              const ExportManifestEntry &entry)
+{
+    QMutexLocker locker(&m_mutex);
+    m_devices[udid][sourcePath] = entry;
+    m_dirty = true;
+}
+
+void ExportManifest::addSegment(const QString &udid, const QString &sourcePath,
+                                const ExportManifestSegment &segment)
+{
+    QMutexLocker locker(&m_mutex);
+    auto device = m_devices.find(udid);
+    if (device == m_devices.end() || !device->contains(sourcePath)) {
+        return;
+    }
+    ExportManifestEntry &entry = (*device)[sourcePath];
+    entry.segments.removeIf([&](const ExportManifestSegment &existing) {
+        return existing.offset == segment.offset;
+    });
+    entry.segments.append(segment);
+    m_dirty = true;
+}
+
+void ExportManifest::markComplete(const QString &udid,
+                                  const QString &sourcePath)
+{
+    QMutexLocker locker(&m_mutex);
+    auto device = m_devices.find(udid);
+    if (device == m_devices.end() || !device->contains(sourcePath)) {
+        return;
+    }
+    (*device)[sourcePath].complete = true;
+    m_dirty = true;
+}
+
+void ExportManifest::removeEntry(const QString &udid,
+                                 const QString &sourcePath)
+{
+    QMutexLocker locker(&m_mutex);
+    auto device = m_devices.find(udid);
+    if (device != m_devices.end() && device->remove(sourcePath) > 0) {
+        m_dirty = true;
+    }
+}
+
+bool ExportManifest::save(bool force)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_dirty ||
+        (!force && m_lastSave.elapsed() < EXPORT_MANIFEST_SAVE_INTERVAL_MS)) {
+        return true;
+    }
+
+    QJsonObject devices;
+    for (auto device = m_devices.constBegin(); device != m_devices.constEnd();
+         ++device) {
+        QJsonObject files;
+        for (auto it = device->constBegin(); it != device->constEnd(); ++it) {
+            const ExportManifestEntry &entry = it.value();
+            QJsonArray segments;
+            for (const ExportManifestSegment &segment : entry.segments) {
+                QJsonObject segmentObject;
+                segmentObject["offset"] = segment.offset;
+                segmentObject["length"] = segment.length;
+                if (!segment.sha256.isEmpty()) {
+                    segmentObject["sha256"] =
+                        QString::fromLatin1(segment.sha256.toHex());
+                }
+                segments.append(segmentObject);
+            }
+
+            QJsonObject entryObject;
+            entryObject["file"] = entry.fileName;
+            entryObject["size"] = entry.size;
+            // Nanosecond timestamps do not fit in a JSON double
+            entryObject["mtime"] = QString::number(entry.modificationTime);
+            entryObject["birthtime"] = QString::number(entry.birthTime);
+            entryObject["complete"] = entry.complete;
+            entryObject["segments"] = segments;
+            files[it.key()] = entryObject;
+        }
+        devices[device.key()] = files;
+    }
+
+    QJsonObject root;
+    root["version"] = EXPORT_MANIFEST_VERSION;
+    root["devices"] = devices;
+
+    // Written atomically so an interrupted export never leaves a torn file
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) < 0 ||
+        !file.commit()) {
+        qWarning() << "Could not write export manifest" << m_filePath << ":"
+                   << file.errorString();
+        return false;
+    }
+
+    m_dirty = false;
+    m_lastSave.restart();
+    return true;
+}
+
+void ExportManifest::load()
+{
+    QFile file(m_filePath);
+    if (!file.exists()) {
+        return;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not read export manifest" << m_filePath;
+        return;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
+        qWarning() << "Ignoring invalid export manifest" << m_filePath << ":"
+                   << parseError.errorString();
+        return;
+    }
+
+    QJsonObject root = document.object();
+    if (root["version"].toInt() != EXPORT_MANIFEST_VERSION) {
+        qWarning() << "Ignoring export manifest with unknown version"
+                   << m_filePath;
+        return;
+    }
+
+    QJsonObject devices = root["devices"].toObject();
+    for (auto device = devices.constBegin(); device != devices.constEnd();
+         ++device) {
+        QJsonObject files = device.value().toObject();
+        QHash<QString, ExportManifestEntry> &entries = m_devices[device.key()];
+        for (auto it = files.constBegin(); it != files.constEnd(); ++it) {
+            QJsonObject entryObject = it.value().toObject();
+            ExportManifestEntry entry;
+            entry.fileName = entryObject["file"].toString();
+            entry.size = entryObject["size"].toInteger();
+            entry.modificationTime =
+                entryObject["mtime"].toString().toULongLong();
+            entry.birthTime = entryObject["birthtime"].toString().toULongLong();
+            entry.complete = entryObject["complete"].toBool();
+            for (const QJsonValue &value : entryObject["segments"].toArray()) {
+                QJsonObject segmentObject = value.toObject();
+                ExportManifestSegment segment;
+                segment.offset = segmentObject["offset"].toInteger();
+                segment.length = segmentObject["length"].toInteger();
+                segment.sha256 = QByteArray::fromHex(
+                    segmentObject["sha256"].toString().toLatin1());
+                entry.segments.append(segment);
+            }
+            if (isPlainFileName(entry.fileName)) {
+                entries.insert(it.key(), entry);
+            } else {
+                qWarning() << "Dropping export manifest entry with invalid "
+                              "file name"
+                           << entry.fileName;
+            }
+        }
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXPORTMANIFEST_H
+#define EXPORTMANIFEST_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <optional>
+
+#define EXPORT_MANIFEST_FILE_NAME ".idescriptor-export.json"
+#define EXPORT_MANIFEST_VERSION 1
+// Minimum time between two manifest writes while an export is running
+#define EXPORT_MANIFEST_SAVE_INTERVAL_MS 5000
+
+// A range of the output file that was copied and flushed to disk
+struct ExportManifestSegment {
+    qint64 offset = 0;
+    qint64 length = 0;
+    QByteArray sha256; // empty if the export ran without verification
+};
+
+struct ExportManifestEntry {
+    QString fileName; // relative to the manifest's directory
+    qint64 size = 0;
+    // Nanosecond timestamps as reported by AFC
+    quint64 modificationTime = 0;
+    quint64 birthTime = 0;
+    bool complete = false;
+    QList<ExportManifestSegment> segments;
+
+    bool matches(qint64 fileSize, quint64 mtime, quint64 birthtime) const
+    {
+        return size == fileSize && modificationTime == mtime &&
+               birthTime == birthtime;
+    }
+    const ExportManifestSegment *segmentAt(qint64 offset) const;
+};
+
+/**
+ * @brief Record of the files exported into one directory
+ *
+ * Entries are keyed by device UDID and source path on the device, so an
+ * export can skip files that did not change since the last run and resume
+ * large files from their last completed segment. The manifest is stored as
+ * JSON next to the exported files and is safe to use from several export
+ * workers at once.
+ */
+class ExportManifest
+{
+public:
+    explicit ExportManifest(const QString &directory);
+    ~ExportManifest();
+
+    ExportManifest(const ExportManifest &) = delete;
+    ExportManifest &operator=(const ExportManifest &) = delete;
+
+    QString directory() const { return m_directory; }
+
+    std::optional<ExportManifestEntry> entry(const QString &udid,
+                                             const QString &sourcePath) const;
+    void setEntry(const QString &udid, const QString &sourcePath,
+                  const ExportManifestEntry &entry);
+    void addSegment(const QString &udid, const QString &sourcePath,
+                    const ExportManifestSegment &segment);
+    void markComplete(const QString &udid, const QString &sourcePath);
+    void removeEntry(const QString &udid, const QString &sourcePath);
+
+    // Writes pending changes, at most once per save interval unless forced
+    bool save(bool force = false);
+
+private:
+    void load();
+
+    const QString m_directory;
+    const QString m_filePath;
+
+    mutable QMutex m_mutex;
+    // UDID -> source path -> entry
+    QHash<QString, QHash<QString, ExportManifestEntry>> m_devices;
+    bool m_dirty = false;
+    QElapsedTimer m_lastSave;
+};
+
+#endif // EXPORTMANIFEST_H
@@ -328,6 +328,10 @@ void ExportProgressDialog::onExportFinished(const QUuid &jobId,
         m_titleLabel->setText("Export Completed with Errors");
     }
 
+    if (summary.skippedItems > 0) {
+        message += QString(", %1 already up to date").arg(summary.skippedItems);
+    }
+
     m_statusLabel->setText(message);
     m_transferRateLabel->setText(
         QString("Total: %1")
@@ -0,0 +1,100 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "framering.h"
+#include <QMutexLocker>
+
+FrameRing::FrameRing() {}
+
+FrameRing::Frame *FrameRing::beginWrite(int width, int height)
+{
+    Frame *frame = &m_frames[m_writeIndex];
+    const qsizetype size =
+        (qsizetype)width * height * FRAME_RING_BYTES_PER_PIXEL;
+    // resize() keeps the capacity, so this only allocates when frames grow
+    if (frame->data.size() != size) {
+        frame->data.resize(size);
+    }
+    frame->width = width;
+    frame->height = height;
+    return frame;
+}
+
+void FrameRing::publish()
+{
+    m_frames[m_writeIndex].sequence = ++m_sequence;
+    // Sequentially consistent, pairs with the waiter flag in waitForLatest()
+    const int previous = m_middle.exchange(m_writeIndex | FreshBit);
+    if (previous & FreshBit) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_writeIndex = previous & IndexMask;
+
+    /* Only lock when the consumer is blocked or about to block. It holds the
+       lock from raising the flag until it waits, so the wake up cannot be
+       missed. */
+    if (m_waiting.load()) {
+        QMutexLocker locker(&m_waitMutex);
+        m_frameAvailable.wakeOne();
+    }
+}
+
+const FrameRing::Frame *FrameRing::acquireLatest()
+{
+    if (!(m_middle.load(std::memory_order_relaxed) & FreshBit)) {
+        return nullptr;
+    }
+    const int previous =
+        m_middle.exchange(m_readIndex, std::memory_order_acq_rel);
+    m_readIndex = previous & IndexMask;
+    return &m_frames[m_readIndex];
+}
+
+const FrameRing::Frame *
+FrameRing::waitForLatest(int timeoutMs, const std::atomic<bool> &cancelled)
+{
+    if (const Frame *frame = acquireLatest()) {
+        return frame;
+    }
+
+    {
+        QMutexLocker locker(&m_waitMutex);
+        m_waiting.store(true);
+        if (!(m_middle.load() & FreshBit) && !cancelled) {
+            m_frameAvailable.wait(&m_waitMutex, timeoutMs);
+        }
+        m_waiting.store(false);
+    }
+
+    if (cancelled) {
+        return nullptr;
+    }
+    return acquireLatest();
+}
+
+void FrameRing::wakeConsumer()
+{
+    QMutexLocker locker(&m_waitMutex);
+    m_frameAvailable.wakeAll();
+}
+
+quint64 FrameRing::droppedFrames() const
+{
+    return m_dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,92 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+
+// Frames are packed RGB888
+#define FRAME_RING_BYTES_PER_PIXEL 3
+
+/**
+ * @brief Lock-free triple buffer of video frames between one producer and one
+ * consumer thread
+ *
+ * The producer always owns one slot to decode into and the consumer owns
+ * another one to read from; the third slot holds the most recently published
+ * frame. Publishing swaps the write slot with that middle slot, so the
+ * producer never waits and a frame the consumer did not pick up in time is
+ * simply overwritten. The producer only takes the wait mutex while the
+ * consumer is blocked in waitForLatest(). Slots are reused and only
+ * reallocated when the frame size grows.
+ */
+class FrameRing
+{
+public:
+    struct Frame {
+        QByteArray data;
+        int width = 0;
+        int height = 0;
+        quint64 sequence = 0;
+    };
+
+    FrameRing();
+
+    FrameRing(const FrameRing &) = delete;
+    FrameRing &operator=(const FrameRing &) = delete;
+
+    // Producer side, the returned slot stays valid until publish()
+    Frame *beginWrite(int width, int height);
+    void publish();
+
+    // Consumer side, returns the newest frame not seen yet or nullptr. The
+    // frame stays valid until the next acquire call.
+    const Frame *acquireLatest();
+    // Like acquireLatest() but blocks for up to timeoutMs, returns early with
+    // nullptr once cancelled is set and wakeConsumer() was called
+    const Frame *waitForLatest(int timeoutMs,
+                               const std::atomic<bool> &cancelled);
+    void wakeConsumer();
+
+    // Frames that were overwritten before the consumer picked them up
+    quint64 droppedFrames() const;
+
+private:
+    static constexpr int FreshBit = 0x4;
+    static constexpr int IndexMask = 0x3;
+
+    Frame m_frames[3];
+    // Index of the middle slot, FreshBit is set while it holds an unread frame
+    std::atomic<int> m_middle{1};
+    int m_writeIndex = 0; // producer only
+    int m_readIndex = 2;  // consumer only
+    quint64 m_sequence = 0;
+    std::atomic<quint64> m_dropped{0};
+
+    QMutex m_waitMutex;
+    QWaitCondition m_frameAvailable;
+    // Set by the consumer under m_waitMutex while it waits
+    std::atomic<bool> m_waiting{false};
+};
+
+#endif // FRAMERING_H
@@ -531,29 +531,9 @@ QIcon GalleryWidget::loadAlbumThumbnail(const QString &albumPath)
         return QIcon();
     }
 
-    // Load the thumbnail using ServiceManager
-    QByteArray imageData = ServiceManager::safeReadAfcFileToByteArray(
-        m_device, firstImagePath.toUtf8().constData());
-
-    if (imageData.isEmpty()) {
-        qDebug() << "Could not read image data for thumbnail:"
-                 << firstImagePath;
-        return QIcon();
-    }
-
-    QPixmap thumbnail;
-
-    if (firstImagePath.endsWith(".HEIC", Qt::CaseInsensitive)) {
-        qDebug() << "Loading HEIC thumbnail from:" << firstImagePath;
-        thumbnail = load_heic(imageData);
-    } else {
-        // Load regular image formats
-        if (!thumbnail.loadFromData(imageData)) {
-            qDebug() << "Could not decode image data for thumbnail:"
-                     << firstImagePath;
-            return QIcon();
-        }
-    }
+    // Uses the embedded thumbnail when the file has one
+    QPixmap thumbnail = PhotoModel::loadThumbnailFromDevice(
+        m_device, firstImagePath, QSize(120, 120));
 
     if (thumbnail.isNull()) {
         qDebug() << "Failed to load thumbnail from:" << firstImagePath;
@@ -0,0 +1,370 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "httpconnections.h"
+#include <QDebug>
+#include <QStringList>
+#include <QTcpSocket>
+#include <QTimer>
+
+HttpRange resolveHttpRange(const HttpRequest &request, qint64 size,
+                           qint64 &start, qint64 &end)
+{
+    start = 0;
+    end = size - 1;
+
+    // Only single ranges, "bytes=start-", "bytes=start-end" and "bytes=-N"
+    const QString rangeHeader = request.headers.value("range");
+    if (!rangeHeader.startsWith("bytes=") || rangeHeader.contains(','))
+        return HttpRange::Full;
+
+    const QStringList rangeParts = rangeHeader.mid(6).split('-');
+    if (rangeParts.size() != 2)
+        return HttpRange::Full;
+
+    bool startOk = false;
+    bool endOk = false;
+    const qint64 first = rangeParts[0].toLongLong(&startOk);
+    const qint64 last = rangeParts[1].toLongLong(&endOk);
+    if (rangeParts[0].isEmpty() && endOk) {
+        start = last > 0 ? qMax<qint64>(0, size - last) : size;
+    } else if (startOk) {
+        start = first;
+        if (endOk && last < size)
+            end = last;
+    } else {
+        return HttpRange::Full;
+    }
+
+    if (start >= size || start > end)
+        return HttpRange::Unsatisfiable;
+    return HttpRange::Partial;
+}
+
+static QString statusText(int statusCode)
+{
+    switch (statusCode) {
+    case 200:
+        return "OK";
+    case 206:
+        return "Partial Content";
+    case 404:
+        return "Not Found";
+    case 405:
+        return "Method Not Allowed";
+    case 416:
+        return "Range Not Satisfiable";
+    case 431:
+        return "Request Header Fields Too Large";
+    case 500:
+        return "Internal Server Error";
+    default:
+        return "Unknown";
+    }
+}
+
+HttpConnections::HttpConnections(const Options &options,
+                                 RequestHandler handler, QObject *parent)
+    : QObject(parent), m_options(options), m_handler(std::move(handler))
+{
+}
+
+void HttpConnections::addConnection(QTcpSocket *socket)
+{
+    Connection &connection = m_connections[socket];
+    connection.socket = socket;
+    connection.idleTimer = new QTimer(socket);
+    connection.idleTimer->setSingleShot(true);
+    connection.idleTimer->setInterval(m_options.keepAliveMs);
+    connection.idleTimer->start();
+
+    connect(connection.idleTimer, &QTimer::timeout, this,
+            [this, socket]() { closeConnection(socket); });
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+        auto it = m_connections.find(socket);
+        if (it == m_connections.end())
+            return;
+        it->pending += socket->readAll();
+        processPending(socket);
+    });
+    connect(socket, &QTcpSocket::bytesWritten, this, [this, socket]() {
+        auto it = m_connections.find(socket);
+        if (it == m_connections.end() || !it->body)
+            return;
+        reportDelivered(*it, false);
+        schedulePump(*it);
+    });
+    connect(socket, &QTcpSocket::disconnected, this,
+            [this, socket]() { closeConnection(socket); });
+    connect(socket, &QAbstractSocket::errorOccurred, this,
+            [this, socket](QAbstractSocket::SocketError error) {
+                if (error != QAbstractSocket::RemoteHostClosedError) {
+                    qWarning() << "HTTP socket error:" << error
+                               << socket->errorString();
+                }
+                closeConnection(socket);
+            });
+}
+
+void HttpConnections::closeAll()
+{
+    const QList<QTcpSocket *> sockets = m_connections.keys();
+    for (QTcpSocket *socket : sockets) {
+        closeConnection(socket);
+    }
+}
+
+void HttpConnections::closeConnection(QTcpSocket *socket)
+{
+    auto it = m_connections.find(socket);
+    if (it == m_connections.end())
+        return;
+
+    it->idleTimer->stop();
+    m_connections.erase(it);
+
+    socket->disconnect(this);
+    if (socket->state() == QAbstractSocket::ConnectedState &&
+        socket->bytesToWrite() > 0) {
+        // Let the rest of a "Connection: close" response go out first
+        connect(socket, &QAbstractSocket::disconnected, socket,
+                &QObject::deleteLater);
+        socket->disconnectFromHost();
+        return;
+    }
+    socket->disconnectFromHost();
+    socket->deleteLater();
+}
+
+HttpRequest HttpConnections::parseRequest(const QByteArray &data)
+{
+    HttpRequest request;
+
+    const QStringList lines = QString::fromUtf8(data).split("\r\n");
+    if (lines.isEmpty())
+        return request;
+
+    // "GET /path HTTP/1.1"
+    const QStringList parts = lines.first().split(" ");
+    if (parts.size() >= 2) {
+        request.method = parts[0];
+        request.path = parts[1];
+    }
+    if (parts.size() >= 3)
+        request.httpVersion = parts[2];
+
+    for (int i = 1; i < lines.size(); ++i) {
+        const QString &line = lines[i];
+        if (line.isEmpty())
+            break;
+
+        const int colonPos = line.indexOf(':');
+        if (colonPos > 0) {
+            request.headers[line.left(colonPos).trimmed().toLower()] =
+                line.mid(colonPos + 1).trimmed();
+        }
+    }
+
+    return request;
+}
+
+void HttpConnections::processPending(QTcpSocket *socket)
+{
+    auto it = m_connections.find(socket);
+    // Requests are answered in order, the next one waits for the body of
+    // the current response
+    while (it != m_connections.end() && !it->body) {
+        const int headerEnd = it->pending.indexOf("\r\n\r\n");
+        if (headerEnd < 0) {
+            if (it->pending.size() > m_options.maxHeaderSize) {
+                it->keepAlive = false;
+                sendResponse(socket, 431, QByteArray());
+            }
+            return;
+        }
+
+        const QByteArray data = it->pending.left(headerEnd + 4);
+        it->pending.remove(0, headerEnd + 4);
+        it->idleTimer->stop();
+
+        const HttpRequest request = parseRequest(data);
+        // HTTP/1.1 keeps the connection unless told otherwise, 1.0 the reverse
+        const QString connectionHeader =
+            request.headers.value("connection").toLower();
+        if (request.httpVersion == "HTTP/1.0") {
+            it->keepAlive = connectionHeader == "keep-alive";
+        } else {
+            it->keepAlive = connectionHeader != "close";
+        }
+
+        if (request.method == "GET" || request.method == "HEAD") {
+            m_handler(socket, request);
+        } else {
+            sendResponse(socket, 405, QByteArray());
+        }
+        // The connection may have been closed while answering
+        it = m_connections.find(socket);
+    }
+}
+
+QByteArray HttpConnections::responseHeader(const Connection &connection,
+                                           int statusCode,
+                                           const QByteArray &extraHeaders,
+                                           qint64 contentLength) const
+{
+    QByteArray header = QString("HTTP/1.1 %1 %2\r\n")
+                            .arg(statusCode)
+                            .arg(statusText(statusCode))
+                            .toUtf8();
+    header += QString("Content-Length: %1\r\n").arg(contentLength).toUtf8();
+    header += extraHeaders;
+    if (connection.keepAlive) {
+        header += "Connection: keep-alive\r\n";
+        header += QString("Keep-Alive: timeout=%1\r\n")
+                      .arg(m_options.keepAliveMs / 1000)
+                      .toUtf8();
+    } else {
+        header += "Connection: close\r\n";
+    }
+    header += "\r\n";
+    return header;
+}
+
+void HttpConnections::sendResponse(QTcpSocket *socket, int statusCode,
+                                   const QByteArray &extraHeaders,
+                                   const QByteArray &body, bool headOnly)
+{
+    auto it = m_connections.find(socket);
+    if (it == m_connections.end())
+        return;
+
+    socket->write(responseHeader(*it, statusCode, extraHeaders, body.size()));
+    if (!headOnly)
+        socket->write(body);
+    finishResponse(*it);
+}
+
+void HttpConnections::sendBody(QTcpSocket *socket, int statusCode,
+                               const QByteArray &extraHeaders,
+                               qint64 contentLength,
+                               std::unique_ptr<HttpBodySource> source)
+{
+    auto it = m_connections.find(socket);
+    if (it == m_connections.end())
+        return;
+
+    socket->write(responseHeader(*it, statusCode, extraHeaders, contentLength));
+    // HEAD requests pass no source
+    if (!source || contentLength <= 0) {
+        finishResponse(*it);
+        return;
+    }
+
+    it->body = std::move(source);
+    it->remaining = contentLength;
+    it->queued = 0;
+    schedulePump(*it);
+}
+
+void HttpConnections::schedulePump(Connection &connection)
+{
+    if (connection.pumpScheduled || !connection.body)
+        return;
+
+    // One chunk per connection and event loop pass, concurrent downloads
+    // take turns instead of one starving the others
+    connection.pumpScheduled = true;
+    QTcpSocket *socket = connection.socket;
+    QMetaObject::invokeMethod(
+        this, [this, socket]() { pump(socket); }, Qt::QueuedConnection);
+}
+
+void HttpConnections::pump(QTcpSocket *socket)
+{
+    auto it = m_connections.find(socket);
+    if (it == m_connections.end())
+        return;
+
+    Connection &connection = *it;
+    connection.pumpScheduled = false;
+    if (!connection.body)
+        return;
+
+    if (connection.remaining == 0) {
+        // Everything is queued, wait for the socket to drain
+        if (socket->bytesToWrite() == 0) {
+            reportDelivered(connection, true);
+            finishResponse(connection);
+        }
+        return;
+    }
+
+    // bytesWritten schedules the next chunk once the socket drains
+    if (socket->bytesToWrite() >= m_options.socketBuffer)
+        return;
+
+    const qint64 length =
+        qMin<qint64>(m_options.chunkSize, connection.remaining);
+    m_readBuffer.resize(length);
+    const qint64 bytesRead = connection.body->read(m_readBuffer.data(), length);
+    if (bytesRead <= 0) {
+        qWarning() << "HTTP body read failed, closing the connection";
+        closeConnection(socket);
+        return;
+    }
+
+    if (socket->write(m_readBuffer.constData(), bytesRead) == -1) {
+        qWarning() << "HTTP socket write error" << socket->errorString();
+        closeConnection(socket);
+        return;
+    }
+
+    connection.remaining -= bytesRead;
+    connection.queued += bytesRead;
+    schedulePump(connection);
+}
+
+void HttpConnections::reportDelivered(Connection &connection, bool complete)
+{
+    // Bytes still in the socket's buffer have not left yet
+    const qint64 delivered =
+        complete ? connection.queued
+                 : qMax<qint64>(0, connection.queued -
+                                       connection.socket->bytesToWrite());
+    connection.body->delivered(delivered, complete);
+}
+
+void HttpConnections::finishResponse(Connection &connection)
+{
+    connection.body.reset();
+    connection.remaining = 0;
+
+    if (!connection.keepAlive) {
+        // Queued data is still flushed before the socket closes
+        closeConnection(connection.socket);
+        return;
+    }
+
+    connection.idleTimer->start();
+    // Pipelined requests that arrived while the body was sent
+    QTcpSocket *socket = connection.socket;
+    QMetaObject::invokeMethod(
+        this, [this, socket]() { processPending(socket); },
+        Qt::QueuedConnection);
+}
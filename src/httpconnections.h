@@ -0,0 +1,147 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPCONNECTIONS_H
+#define HTTPCONNECTIONS_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <functional>
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+class QTcpSocket;
+class QTimer;
+QT_END_NAMESPACE
+
+struct HttpRequest {
+    QString method;
+    QString path;
+    QString httpVersion;
+    // Keys are lower case
+    QMap<QString, QString> headers;
+};
+
+enum class HttpRange { Full, Partial, Unsatisfiable };
+
+/*
+    Resolves a single "Range: bytes=" header against a body of size bytes.
+    start and end are the first and last byte to send. Multiple ranges are
+    not supported and answered with the full body.
+*/
+HttpRange resolveHttpRange(const HttpRequest &request, qint64 size,
+                           qint64 &start, qint64 &end);
+
+// Produces the body of one response, chunk by chunk as the socket drains
+class HttpBodySource
+{
+public:
+    virtual ~HttpBodySource() = default;
+    // Reads the next chunk, returns the bytes read or <= 0 on failure
+    virtual qint64 read(char *data, qint64 maxSize) = 0;
+    // Body bytes that left the socket, complete is set once all of them did
+    virtual void delivered(qint64 bytes, bool complete)
+    {
+        Q_UNUSED(bytes);
+        Q_UNUSED(complete);
+    }
+};
+
+/**
+ * @brief Keep-alive HTTP/1.x connection handling shared by the servers
+ *
+ * Reads requests, answers them in order (pipelined requests wait for the
+ * body of the current response), applies the HTTP/1.0 and 1.1 keep-alive
+ * rules and closes connections that stay idle for keepAliveMs. Bodies are
+ * pulled from an HttpBodySource one chunk per connection and event loop
+ * pass, so concurrent downloads take turns, and only while the socket has
+ * less than socketBuffer bytes queued.
+ *
+ * The owner hands over accepted sockets and answers every GET and HEAD
+ * request in its handler with sendResponse(), sendBody() or
+ * closeConnection(). Lives on the owner's thread.
+ */
+class HttpConnections : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        qint64 chunkSize;
+        qint64 socketBuffer;
+        int keepAliveMs;
+        int maxHeaderSize;
+    };
+
+    using RequestHandler =
+        std::function<void(QTcpSocket *socket, const HttpRequest &request)>;
+
+    HttpConnections(const Options &options, RequestHandler handler,
+                    QObject *parent = nullptr);
+
+    void addConnection(QTcpSocket *socket);
+    void closeAll();
+
+    /*
+        extraHeaders are complete "Name: value\r\n" lines, Content-Length
+        and the Connection headers are added here.
+    */
+    void sendResponse(QTcpSocket *socket, int statusCode,
+                      const QByteArray &extraHeaders,
+                      const QByteArray &body = QByteArray(),
+                      bool headOnly = false);
+    void sendBody(QTcpSocket *socket, int statusCode,
+                  const QByteArray &extraHeaders, qint64 contentLength,
+                  std::unique_ptr<HttpBodySource> source);
+    void closeConnection(QTcpSocket *socket);
+
+private:
+    struct Connection {
+        QTcpSocket *socket = nullptr;
+        QTimer *idleTimer = nullptr;
+        QByteArray pending;
+        bool keepAlive = true;
+        // Body being sent, null between responses
+        std::unique_ptr<HttpBodySource> body;
+        qint64 remaining = 0;
+        // Body bytes handed to the socket
+        qint64 queued = 0;
+        bool pumpScheduled = false;
+    };
+
+    static HttpRequest parseRequest(const QByteArray &data);
+    QByteArray responseHeader(const Connection &connection, int statusCode,
+                              const QByteArray &extraHeaders,
+                              qint64 contentLength) const;
+    void processPending(QTcpSocket *socket);
+    void schedulePump(Connection &connection);
+    void pump(QTcpSocket *socket);
+    void reportDelivered(Connection &connection, bool complete);
+    void finishResponse(Connection &connection);
+
+    const Options m_options;
+    RequestHandler m_handler;
+    QHash<QTcpSocket *, Connection> m_connections;
+    QByteArray m_readBuffer;
+};
+
+#endif // HTTPCONNECTIONS_H
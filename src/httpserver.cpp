@@ -29,21 +29,75 @@
 #include <QMimeDatabase>
 #include <QNetworkInterface>
 #include <QRandomGenerator>
+#include <QTcpSocket>
 #include <QUrl>
+#include <memory>
+
+namespace
+{
+// Streams one file, or a range of it, and reports how much was downloaded
+class FileBodySource : public HttpBodySource
+{
+public:
+    FileBodySource(std::unique_ptr<QFile> file, const QString &fileName,
+                   qint64 size, HttpServerWorker *worker)
+        : m_file(std::move(file)), m_fileName(fileName), m_size(size),
+          m_worker(worker)
+    {
+    }
+
+    qint64 read(char *data, qint64 maxSize) override
+    {
+        const qint64 bytesRead = m_file->read(data, maxSize);
+        if (bytesRead <= 0) {
+            qWarning() << "HttpServer: read failed for" << m_fileName
+                       << m_file->errorString();
+        }
+        return bytesRead;
+    }
+
+    void delivered(qint64 bytes, bool complete) override
+    {
+        // About once per percent keeps the GUI thread out of the hot path
+        const qint64 step = qMax<qint64>(HTTP_SERVER_CHUNK_SIZE, m_size / 100);
+        if (!complete && bytes - m_reported < step)
+            return;
+
+        m_reported = bytes;
+        emit m_worker->downloadProgress(m_fileName, bytes, m_size);
+    }
+
+private:
+    std::unique_ptr<QFile> m_file;
+    QString m_fileName;
+    qint64 m_size;
+    qint64 m_reported = 0;
+    HttpServerWorker *m_worker;
+};
+} // namespace
 
 HttpServer::HttpServer(QObject *parent)
-    : QObject(parent), server(new QTcpServer(this)), port(8080)
+    : QObject(parent), ioThread(new QThread(this)),
+      worker(new HttpServerWorker()), port(8080)
 {
-    connect(server, &QTcpServer::newConnection, this,
-            &HttpServer::onNewConnection);
+    ioThread->setObjectName("HttpServer I/O");
+    worker->moveToThread(ioThread);
+    connect(ioThread, &QThread::finished, worker, &QObject::deleteLater);
+    // Queued, the worker emits on the I/O thread
+    connect(worker, &HttpServerWorker::downloadProgress, this,
+            &HttpServer::downloadProgress);
+    ioThread->start();
 }
 
-HttpServer::~HttpServer() { stop(); }
+HttpServer::~HttpServer()
+{
+    stop();
+    ioThread->quit();
+    ioThread->wait();
+}
 
 void HttpServer::start(const QStringList &files)
 {
-    fileList = files;
-
     // Generate unique JSON filename
     QString timestamp =
         QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss");
@@ -52,12 +106,21 @@ void HttpServer::start(const QStringList &files)
     // Try to bind to port from settings, if fails try other ports
     int startPort = SettingsManager::sharedInstance()->wirelessFileServerPort();
     qDebug() << "Starting HTTP server on port" << startPort;
-    for (int tryPort = startPort; tryPort <= startPort + 10; ++tryPort) {
-        if (server->listen(QHostAddress::Any, tryPort)) {
-            port = tryPort;
-            emit serverStarted();
-            return;
-        }
+
+    int boundPort = -1;
+    const QString manifestName = jsonFileName;
+    QMetaObject::invokeMethod(
+        worker,
+        [this, startPort, files, manifestName, &boundPort]() {
+            boundPort = worker->listen(startPort, startPort + 10, files,
+                                       manifestName);
+        },
+        Qt::BlockingQueuedConnection);
+
+    if (boundPort > 0) {
+        port = boundPort;
+        emit serverStarted();
+        return;
     }
 
     emit serverError(QString("Could not bind to any port between %1-%2")
@@ -67,63 +130,76 @@ void HttpServer::start(const QStringList &files)
 
 void HttpServer::stop()
 {
-    if (server->isListening()) {
-        server->close();
-    }
+    if (!ioThread->isRunning())
+        return;
+
+    QMetaObject::invokeMethod(
+        worker, [this]() { worker->stop(); }, Qt::BlockingQueuedConnection);
 }
 
 int HttpServer::getPort() const { return port; }
 
-void HttpServer::onNewConnection()
+HttpServerWorker::HttpServerWorker(QObject *parent)
+    : QObject(parent), server(new QTcpServer(this))
 {
-    QTcpSocket *socket = server->nextPendingConnection();
-    connect(socket, &QTcpSocket::readyRead, this, &HttpServer::onReadyRead);
-    connect(socket, &QTcpSocket::disconnected, this,
-            &HttpServer::onDisconnected);
+    const HttpConnections::Options options = {
+        HTTP_SERVER_CHUNK_SIZE, HTTP_SERVER_SOCKET_BUFFER,
+        HTTP_SERVER_KEEP_ALIVE_MS, HTTP_SERVER_MAX_HEADER_SIZE};
+    http = new HttpConnections(
+        options,
+        [this](QTcpSocket *socket, const HttpRequest &request) {
+            handleRequest(socket, request);
+        },
+        this);
+
+    connect(server, &QTcpServer::newConnection, this,
+            &HttpServerWorker::onNewConnection);
 }
 
-void HttpServer::onReadyRead()
+int HttpServerWorker::listen(int startPort, int endPort,
+                             const QStringList &files,
+                             const QString &manifestName)
 {
-    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
-    if (!socket)
-        return;
-
-    QByteArray data = socket->readAll();
-    QString request = QString::fromUtf8(data);
-
-    // Parse HTTP request
-    QStringList lines = request.split("\r\n");
-    if (lines.isEmpty())
-        return;
-
-    QString requestLine = lines.first();
-    QStringList parts = requestLine.split(" ");
-    if (parts.size() < 2)
-        return;
+    fileList = files;
+    jsonFileName = manifestName;
 
-    QString method = parts[0];
-    QString path = parts[1];
+    for (int tryPort = startPort; tryPort <= endPort; ++tryPort) {
+        if (server->listen(QHostAddress::Any, tryPort)) {
+            port = tryPort;
+            return port;
+        }
+    }
+    return -1;
+}
 
-    if (method == "GET") {
-        handleRequest(socket, path);
-    } else {
-        sendResponse(socket, 405, "text/plain", "Method Not Allowed");
+void HttpServerWorker::stop()
+{
+    if (server->isListening()) {
+        server->close();
     }
+
+    http->closeAll();
 }
 
-void HttpServer::onDisconnected()
+void HttpServerWorker::onNewConnection()
 {
-    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
-    if (socket) {
-        socket->deleteLater();
+    while (QTcpSocket *socket = server->nextPendingConnection()) {
+        http->addConnection(socket);
     }
 }
 
-void HttpServer::handleRequest(QTcpSocket *socket, const QString &path)
+void HttpServerWorker::handleRequest(QTcpSocket *socket,
+                                     const HttpRequest &request)
 {
+    const bool headOnly = request.method == "HEAD";
+    const QString path = request.path;
+
     // Serve JSON manifest
     if (path == QString("/%1").arg(jsonFileName)) {
-        sendJsonManifest(socket);
+        http->sendResponse(socket, 200,
+                           "Content-Type: application/json\r\n"
+                           "Access-Control-Allow-Origin: *\r\n",
+                           generateJsonManifest().toUtf8(), headOnly);
         return;
     }
 
@@ -143,77 +219,79 @@ void HttpServer::handleRequest(QTcpSocket *socket, const QString &path)
         }
 
         if (!targetFile.isEmpty()) {
-            sendFile(socket, targetFile);
+            sendFile(socket, request, targetFile);
             return;
         }
     }
 
-    sendResponse(socket, 404, "text/html",
-                 "<html><body><h1>404 Not Found</h1><p>The requested file was "
-                 "not found.</p></body></html>");
+    http->sendResponse(socket, 404,
+                       "Content-Type: text/html\r\n"
+                       "Access-Control-Allow-Origin: *\r\n",
+                       "<html><body><h1>404 Not Found</h1><p>The requested "
+                       "file was not found.</p></body></html>",
+                       headOnly);
 }
 
-void HttpServer::sendResponse(QTcpSocket *socket, int statusCode,
-                              const QString &contentType,
-                              const QByteArray &data)
+void HttpServerWorker::sendFile(QTcpSocket *socket,
+                                const HttpRequest &request,
+                                const QString &filePath)
 {
-    QString statusText;
-    switch (statusCode) {
-    case 200:
-        statusText = "OK";
-        break;
-    case 404:
-        statusText = "Not Found";
-        break;
-    case 405:
-        statusText = "Method Not Allowed";
-        break;
-    case 500:
-        statusText = "Internal Server Error";
-        break;
-    default:
-        statusText = "Unknown";
-        break;
+    auto file = std::make_unique<QFile>(filePath);
+    if (!file->open(QIODevice::ReadOnly)) {
+        http->sendResponse(socket, 404,
+                           "Content-Type: text/plain\r\n"
+                           "Access-Control-Allow-Origin: *\r\n",
+                           "File not found");
+        return;
     }
 
-    QString response =
-        QString("HTTP/1.1 %1 %2\r\n").arg(statusCode).arg(statusText);
-    response += QString("Content-Type: %1\r\n").arg(contentType);
-    response += QString("Content-Length: %1\r\n").arg(data.size());
-    response += "Access-Control-Allow-Origin: *\r\n";
-    response += "Connection: close\r\n";
-    response += "\r\n";
-
-    socket->write(response.toUtf8());
-    socket->write(data);
-    socket->disconnectFromHost();
-}
-
-void HttpServer::sendFile(QTcpSocket *socket, const QString &filePath)
-{
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        sendResponse(socket, 404, "text/plain", "File not found");
+    const qint64 fileSize = file->size();
+    qint64 rangeStart = 0;
+    qint64 rangeEnd = 0;
+    const HttpRange range =
+        resolveHttpRange(request, fileSize, rangeStart, rangeEnd);
+    if (range == HttpRange::Unsatisfiable) {
+        http->sendResponse(socket, 416,
+                           QString("Access-Control-Allow-Origin: *\r\n"
+                                   "Content-Range: bytes */%1\r\n")
+                               .arg(fileSize)
+                               .toUtf8());
         return;
     }
 
-    QByteArray data = file.readAll();
-    QString mimeType = getMimeType(filePath);
+    const bool partial = range == HttpRange::Partial;
+    const qint64 contentLength = rangeEnd - rangeStart + 1;
+    QByteArray headers =
+        QString("Content-Type: %1\r\n").arg(getMimeType(filePath)).toUtf8();
+    headers += "Access-Control-Allow-Origin: *\r\n";
+    headers += "Accept-Ranges: bytes\r\n";
+    if (partial) {
+        headers += QString("Content-Range: bytes %1-%2/%3\r\n")
+                       .arg(rangeStart)
+                       .arg(rangeEnd)
+                       .arg(fileSize)
+                       .toUtf8();
+    }
 
-    // Emit progress signal
-    QFileInfo info(filePath);
-    emit downloadProgress(info.fileName(), data.size(), data.size());
+    if (request.method == "HEAD" || contentLength <= 0) {
+        http->sendBody(socket, partial ? 206 : 200, headers, contentLength,
+                       nullptr);
+        return;
+    }
 
-    sendResponse(socket, 200, mimeType, data);
-}
+    if (!file->seek(rangeStart)) {
+        http->closeConnection(socket);
+        return;
+    }
 
-void HttpServer::sendJsonManifest(QTcpSocket *socket)
-{
-    QString jsonContent = generateJsonManifest();
-    sendResponse(socket, 200, "application/json", jsonContent.toUtf8());
+    const QString fileName = QFileInfo(filePath).fileName();
+    emit downloadProgress(fileName, 0, contentLength);
+    http->sendBody(socket, partial ? 206 : 200, headers, contentLength,
+                   std::make_unique<FileBodySource>(std::move(file), fileName,
+                                                    contentLength, this));
 }
 
-QString HttpServer::generateJsonManifest() const
+QString HttpServerWorker::generateJsonManifest() const
 {
     QString serverIP = getLocalIP();
 
@@ -237,7 +315,7 @@ QString HttpServer::generateJsonManifest() const
     return doc.toJson();
 }
 
-QString HttpServer::getLocalIP() const
+QString HttpServerWorker::getLocalIP() const
 {
     foreach (const QNetworkInterface &interface,
              QNetworkInterface::allInterfaces()) {
@@ -254,7 +332,7 @@ QString HttpServer::getLocalIP() const
     return "127.0.0.1";
 }
 
-QString HttpServer::getMimeType(const QString &filePath) const
+QString HttpServerWorker::getMimeType(const QString &filePath) const
 {
     QMimeDatabase db;
     QMimeType type = db.mimeTypeForFile(filePath);
@@ -20,12 +20,58 @@
 #ifndef HTTPSERVER_H
 #define HTTPSERVER_H
 
-#include <QMap>
+#include "httpconnections.h"
 #include <QObject>
 #include <QStringList>
 #include <QTcpServer>
-#include <QTcpSocket>
-#include <QTimer>
+#include <QThread>
+
+// Size of a file read, at most HTTP_SERVER_SOCKET_BUFFER is queued per socket
+#define HTTP_SERVER_CHUNK_SIZE (256 * 1024)
+#define HTTP_SERVER_SOCKET_BUFFER (1024 * 1024)
+// Idle keep-alive connections are closed after this long
+#define HTTP_SERVER_KEEP_ALIVE_MS 30000
+// Requests with larger headers are rejected
+#define HTTP_SERVER_MAX_HEADER_SIZE (16 * 1024)
+
+/*
+    Serves the files on HttpServer's I/O thread. Files are streamed in
+    chunks as the sockets drain, so memory stays bounded no matter how large
+    or how many the downloads are.
+*/
+class HttpServerWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HttpServerWorker(QObject *parent = nullptr);
+
+    // Returns the port that was bound, -1 if none in the range was free
+    int listen(int startPort, int endPort, const QStringList &files,
+               const QString &jsonFileName);
+    void stop();
+
+signals:
+    void downloadProgress(const QString &fileName, qint64 bytesDownloaded,
+                          qint64 totalBytes);
+
+private slots:
+    void onNewConnection();
+
+private:
+    void handleRequest(QTcpSocket *socket, const HttpRequest &request);
+    void sendFile(QTcpSocket *socket, const HttpRequest &request,
+                  const QString &filePath);
+    QString generateJsonManifest() const;
+    QString getMimeType(const QString &filePath) const;
+    QString getLocalIP() const;
+
+    QTcpServer *server;
+    QStringList fileList;
+    QString jsonFileName;
+    int port = -1;
+    HttpConnections *http;
+};
 
 class HttpServer : public QObject
 {
@@ -42,29 +88,17 @@ public:
 signals:
     void serverStarted();
     void serverError(const QString &error);
-    void downloadProgress(const QString &fileName, int bytesDownloaded,
-                          int totalBytes);
-
-private slots:
-    void onNewConnection();
-    void onReadyRead();
-    void onDisconnected();
+    // Emitted while a file is sent, bytesDownloaded counts what the socket
+    // has actually written
+    void downloadProgress(const QString &fileName, qint64 bytesDownloaded,
+                          qint64 totalBytes);
 
 private:
-    QTcpServer *server;
-    QStringList fileList;
+    // Sockets and file reads live here, the GUI thread only starts and stops
+    QThread *ioThread;
+    HttpServerWorker *worker;
     int port;
     QString jsonFileName;
-    QMap<QString, int> downloadTracker;
-
-    void handleRequest(QTcpSocket *socket, const QString &path);
-    void sendResponse(QTcpSocket *socket, int statusCode,
-                      const QString &contentType, const QByteArray &data);
-    void sendFile(QTcpSocket *socket, const QString &filePath);
-    void sendJsonManifest(QTcpSocket *socket);
-    QString generateJsonManifest() const;
-    QString getMimeType(const QString &filePath) const;
-    QString getLocalIP() const;
 };
 
 #endif // HTTPSERVER_H
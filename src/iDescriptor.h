@@ -19,6 +19,7 @@
 
 #pragma once
 #include <QDebug>
+#include <QIODevice>
 #include <QImage>
 #include <QJsonObject>
 #include <QNetworkAccessManager>
@@ -33,6 +34,8 @@
 #ifdef ENABLE_RECOVERY_DEVICE_SUPPORT
 #include <libirecovery.h>
 #endif
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <pugixml.hpp>
 #include <string>
@@ -176,6 +179,8 @@ struct DeviceInfo {
     unsigned int parsedDeviceVersion;
 };
 
+class AfcClientPool;
+
 struct iDescriptorDevice {
     std::string udid;
     idevice_connection_type conn_type;
@@ -183,6 +188,8 @@ struct iDescriptorDevice {
     DeviceInfo deviceInfo;
     afc_client_t afcClient;
     afc_client_t afc2Client;
+    // Extra AFC connections for operations that can run in parallel
+    std::shared_ptr<AfcClientPool> afcPool;
     bool is_iPhone;
     std::recursive_mutex mutex;
 };
@@ -228,6 +235,12 @@ void warn(const QString &message, const QString &title = "Warning",
 
 enum class AddType { Regular, Pairing };
 
+/*
+    Device bring-up runs in stages, identity is known when the device is
+    added, the others fill in DeviceInfo as they complete
+*/
+enum class DeviceInitStage { Identity, Storage, Battery, Jailbreak };
+
 class PlistNavigator
 {
 private:
@@ -281,6 +294,9 @@ public:
         return value;
     }
 
+    // Negative integers are stored two's complement in the same node type
+    int64_t getInt() const { return static_cast<int64_t>(getUInt()); }
+
     std::string getString() const
     {
         if (!current_node)
@@ -307,6 +323,11 @@ std::string parse_recovery_mode(irecv_mode productType);
 struct MediaEntry {
     std::string name;
     bool isDir;
+    // Only filled in when the entry was stat'ed
+    uint64_t size = 0;
+    uint64_t modificationTime = 0; // nanoseconds since epoch
+    uint64_t birthTime = 0;        // nanoseconds since epoch
+    bool isSymlink = false;
 };
 
 struct AFCFileTree {
@@ -318,10 +339,15 @@ struct AFCFileTree {
 AFCFileTree get_file_tree(afc_client_t afcClient,
                           const std::string &path = "/", bool checkDir = true);
 
+// Stat a single directory entry, symlinks to directories count as directories
+MediaEntry afc_stat_entry(afc_client_t afcClient, const std::string &dirPath,
+                          const std::string &name);
+
 bool detect_jailbroken(afc_client_t afc);
 
-void get_device_info_xml(const char *udid, lockdownd_client_t client,
-                         idevice_t device, pugi::xml_document &infoXml);
+// Lockdown values of the global domain merged with com.apple.disk_usage
+plist_t get_device_info(const char *udid, lockdownd_client_t client,
+                        idevice_t device);
 
 iDescriptorInitDeviceResult init_idescriptor_device(const char *udid);
 
@@ -329,7 +355,9 @@ iDescriptorInitDeviceResult init_idescriptor_device(const char *udid);
 iDescriptorInitDeviceResultRecovery
 init_idescriptor_recovery_device(uint64_t ecid);
 #endif
-bool set_location(idevice_t device, char *lat, char *lon);
+// Location updates reuse the device's cached simulatelocation session
+bool set_location(iDescriptorDevice *device, const char *lat, const char *lon);
+bool reset_location(iDescriptorDevice *device);
 
 bool shutdown(idevice_t device);
 
@@ -410,19 +438,26 @@ bool query_mobile_gestalt(iDescriptorDevice *id_device, const QStringList &keys,
 
 std::string safeGetXML(const char *key, pugi::xml_node dict);
 
-void get_battery_info(std::string productType, idevice_t idevice,
-                      bool is_iphone, plist_t &diagnostics);
+// Queries IOPMPowerSource over the device's cached diagnostics_relay session
+void get_battery_info(iDescriptorDevice *device, plist_t &diagnostics);
 
 void parseOldDeviceBattery(PlistNavigator &ioreg, DeviceInfo &d);
 void parseDeviceBattery(PlistNavigator &ioreg, DeviceInfo &d);
 
+// Fills result.deviceInfo from the lockdown dict read during bring-up
+DeviceInfo fullDeviceInfo(plist_t info, iDescriptorInitDeviceResult &result);
+
+// Bring-up stages that run after init_idescriptor_device
+bool load_device_storage_info(afc_client_t afcClient, DiskInfo &diskInfo);
+bool load_device_battery_info(iDescriptorDevice *device, DeviceInfo &d);
+
 void fetchAppIconFromApple(QNetworkAccessManager *manager,
                            const QString &bundleId,
                            std::function<void(const QPixmap &)> callback);
 
 afc_error_t afc2_client_new(idevice_t device, afc_client_t *afc);
 
-void get_cable_info(idevice_t device, plist_t &response);
+void get_cable_info(iDescriptorDevice *device, plist_t &response);
 
 struct NetworkDevice {
     QString name;                           // service name
@@ -439,13 +474,69 @@ struct NetworkDevice {
 
 QPixmap load_heic(const QByteArray &data);
 
+// Streaming decode from a random access device, e.g. an AfcInputStream
+QPixmap load_heic(QIODevice *source);
+
+/*
+ * Decode the thumbnail embedded in a HEIC file (thumbnail item of the primary
+ * image) or a JPEG file (EXIF IFD1), reading only the byte ranges needed.
+ * Returns a null image if the file has no usable embedded thumbnail.
+ */
+QImage load_heic_thumbnail(QIODevice *source, const QSize &minSize);
+QImage load_jpeg_thumbnail(QIODevice *source);
+
+// Loads the whole file, media and other large files should be read through
+// an AfcInputStream instead
 QByteArray read_afc_file_to_byte_array(afc_client_t afcClient,
                                        const char *path);
 
 bool isDarkMode();
 
+// What installation_proxy needs to know about an IPA besides the archive
+struct IpaMetadata {
+    std::string bundleIdentifier;
+    std::string bundleExecutable;
+    QByteArray sinf;           // Payload/<app>.app/SC_Info/<exe>.sinf
+    QByteArray iTunesMetadata; // iTunesMetadata.plist, optional
+};
+
+enum class InstallIpaStage { Uploading, Installing };
+
+/*
+ * Progress of install_IPA: bytes while uploading, percent out of 100 while
+ * installing. Called from the installing thread and from the
+ * installation_proxy status thread.
+ */
+using InstallIpaProgress =
+    std::function<void(InstallIpaStage stage, uint64_t done, uint64_t total)>;
+// Polled during the upload and while waiting for installd, true stops both
+using InstallIpaAbort = std::function<bool()>;
+
+/*
+ * Reads the metadata from the zip central directory and the few small entries
+ * it needs, without touching the rest of the archive.
+ */
+bool read_ipa_metadata(const char *filePath, IpaMetadata &metadata,
+                       std::string &error);
+
+/*
+ * Streams the IPA to PublicStaging while its metadata is validated, then
+ * installs it. Returns INSTPROXY_E_INVALID_ARG for archives that are not a
+ * valid IPA, INSTPROXY_E_CONN_FAILED when the upload failed, the device
+ * went away or abort returned true, INSTPROXY_E_RECEIVE_TIMEOUT when
+ * installation_proxy stopped reporting and INSTPROXY_E_OP_FAILED when the
+ * device rejected the app.
+ */
+instproxy_error_t install_IPA(idevice_t device, afc_client_t afc,
+                              const char *filePath,
+                              const InstallIpaProgress &progress = nullptr,
+                              const InstallIpaAbort &abort = nullptr);
+// Same as install_IPA for metadata that was already read
 instproxy_error_t install_IPA(idevice_t device, afc_client_t afc,
-                              const char *filePath);
+                              const char *filePath,
+                              const IpaMetadata &metadata,
+                              const InstallIpaProgress &progress = nullptr,
+                              const InstallIpaAbort &abort = nullptr);
 
 // Helper struct for semantic version comparison
 struct AppVersion {
@@ -0,0 +1,363 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "installedappsmodel.h"
+#include "appiconstore.h"
+#include "iDescriptor-ui.h"
+#include "iDescriptor.h"
+#include <QApplication>
+#include <QDebug>
+#include <QPainter>
+#include <QPainterPath>
+#include <QStyle>
+#include <algorithm>
+
+InstalledAppsModel::InstalledAppsModel(iDescriptorDevice *device,
+                                       QObject *parent)
+    : QAbstractListModel(parent), m_device(device),
+      m_iconCache(INSTALLED_APPS_ICON_CACHE_SIZE)
+{
+    connect(AppIconStore::sharedInstance(), &AppIconStore::iconReady, this,
+            &InstalledAppsModel::onIconReady);
+}
+
+int InstalledAppsModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return m_apps.size();
+}
+
+QVariant InstalledAppsModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_apps.size())
+        return QVariant();
+
+    const InstalledApp &app = m_apps.at(index.row()).app;
+
+    switch (role) {
+    case Qt::DisplayRole:
+        if (app.type == "System")
+            return app.displayName + " (System)";
+        return app.displayName;
+    case Qt::ToolTipRole:
+        return app.bundleId;
+    case Qt::DecorationRole: {
+        if (QPixmap *cached = m_iconCache.object(app.bundleId))
+            return *cached;
+
+        // Icons are only requested for rows the view actually paints
+        QPixmap icon = AppIconStore::sharedInstance()->icon(
+            m_device, app.bundleId, app.version);
+        if (icon.isNull())
+            return QVariant();
+
+        QPixmap rounded = roundedIcon(icon);
+        m_iconCache.insert(app.bundleId, new QPixmap(rounded));
+        return rounded;
+    }
+    case BundleIdRole:
+        return app.bundleId;
+    case VersionRole:
+        return app.version;
+    case TypeRole:
+        return app.type;
+    case FileSharingEnabledRole:
+        return app.fileSharingEnabled;
+    case SearchKeyRole:
+        return m_apps.at(index.row()).searchKey;
+    default:
+        return QVariant();
+    }
+}
+
+InstalledAppRow InstalledAppsModel::makeRow(const InstalledApp &app)
+{
+    InstalledAppRow row;
+    row.app = app;
+    row.searchKey =
+        (app.displayName + QLatin1Char('\n') + app.bundleId).toLower();
+    return row;
+}
+
+bool InstalledAppsModel::lessThan(const InstalledAppRow &a,
+                                  const InstalledAppRow &b)
+{
+    return a.app.displayName.compare(b.app.displayName,
+                                     Qt::CaseInsensitive) < 0;
+}
+
+void InstalledAppsModel::setApps(const QList<InstalledApp> &apps)
+{
+    QList<InstalledAppRow> rows;
+    rows.reserve(apps.size());
+    for (const InstalledApp &app : apps)
+        rows.append(makeRow(app));
+    std::sort(rows.begin(), rows.end(), lessThan);
+
+    beginResetModel();
+    m_apps = std::move(rows);
+    rebuildRowIndex();
+    endResetModel();
+}
+
+void InstalledAppsModel::addApps(const QList<InstalledApp> &apps)
+{
+    if (m_apps.isEmpty()) {
+        setApps(apps);
+        return;
+    }
+
+    QList<InstalledAppRow> rows;
+    rows.reserve(apps.size());
+    for (const InstalledApp &app : apps) {
+        if (!m_rowByBundleId.contains(app.bundleId))
+            rows.append(makeRow(app));
+    }
+    std::sort(rows.begin(), rows.end(), lessThan);
+
+    // Pages are small, each app goes to its sorted position. The row index
+    // is only rebuilt once the whole page is in.
+    auto from = m_apps.begin();
+    for (InstalledAppRow &row : rows) {
+        from = std::upper_bound(from, m_apps.end(), row, lessThan);
+        int position = from - m_apps.begin();
+        beginInsertRows(QModelIndex(), position, position);
+        from = m_apps.insert(from, std::move(row)) + 1;
+        endInsertRows();
+    }
+    rebuildRowIndex();
+}
+
+void InstalledAppsModel::updateApps(const QList<InstalledApp> &apps)
+{
+    QList<InstalledApp> moved;
+    QStringList movedIds;
+
+    for (const InstalledApp &app : apps) {
+        int row = rowForBundleId(app.bundleId);
+        if (row < 0)
+            continue;
+
+        // A renamed app has to move to its new sorted position
+        if (m_apps.at(row).app.displayName != app.displayName) {
+            moved.append(app);
+            movedIds.append(app.bundleId);
+            continue;
+        }
+
+        if (m_apps.at(row).app.version != app.version)
+            m_iconCache.remove(app.bundleId);
+        m_apps[row] = makeRow(app);
+        QModelIndex idx = index(row);
+        emit dataChanged(idx, idx);
+    }
+
+    if (!moved.isEmpty()) {
+        removeApps(movedIds);
+        addApps(moved);
+    }
+}
+
+void InstalledAppsModel::removeApps(const QStringList &bundleIds)
+{
+    for (const QString &bundleId : bundleIds) {
+        int row = rowForBundleId(bundleId);
+        if (row < 0)
+            continue;
+
+        beginRemoveRows(QModelIndex(), row, row);
+        m_apps.removeAt(row);
+        rebuildRowIndex();
+        endRemoveRows();
+        m_iconCache.remove(bundleId);
+    }
+}
+
+void InstalledAppsModel::clear()
+{
+    beginResetModel();
+    m_apps.clear();
+    m_rowByBundleId.clear();
+    endResetModel();
+}
+
+void InstalledAppsModel::rebuildRowIndex()
+{
+    m_rowByBundleId.clear();
+    m_rowByBundleId.reserve(m_apps.size());
+    for (int i = 0; i < m_apps.size(); ++i)
+        m_rowByBundleId.insert(m_apps.at(i).app.bundleId, i);
+}
+
+int InstalledAppsModel::rowForBundleId(const QString &bundleId) const
+{
+    return m_rowByBundleId.value(bundleId, -1);
+}
+
+QPixmap InstalledAppsModel::roundedIcon(const QPixmap &icon)
+{
+    const int size = INSTALLED_APPS_ICON_SIZE;
+    QPixmap scaled = icon.scaled(size, size, Qt::KeepAspectRatioByExpanding,
+                                 Qt::SmoothTransformation);
+    QPixmap rounded(size, size);
+    rounded.fill(Qt::transparent);
+
+    QPainter painter(&rounded);
+    painter.setRenderHint(QPainter::Antialiasing);
+    QPainterPath path;
+    path.addRoundedRect(QRectF(0, 0, size, size), 8, 8);
+    painter.setClipPath(path);
+    painter.drawPixmap(0, 0, scaled);
+    painter.end();
+
+    return rounded;
+}
+
+void InstalledAppsModel::onIconReady(const QString &bundleId,
+                                     const QPixmap &icon)
+{
+    if (icon.isNull())
+        return;
+
+    int row = rowForBundleId(bundleId);
+    if (row < 0)
+        return;
+
+    m_iconCache.insert(bundleId, new QPixmap(roundedIcon(icon)));
+    QModelIndex idx = index(row);
+    emit dataChanged(idx, idx, {Qt::DecorationRole});
+}
+
+InstalledAppsFilterModel::InstalledAppsFilterModel(QObject *parent)
+    : QSortFilterProxyModel(parent)
+{
+}
+
+void InstalledAppsFilterModel::setSearchText(const QString &text)
+{
+    QString searchText = text.trimmed().toLower();
+    if (searchText == m_searchText)
+        return;
+
+    m_searchText = searchText;
+    invalidateRowsFilter();
+}
+
+void InstalledAppsFilterModel::setFileSharingOnly(bool enabled)
+{
+    if (enabled == m_fileSharingOnly)
+        return;
+
+    m_fileSharingOnly = enabled;
+    invalidateRowsFilter();
+}
+
+bool InstalledAppsFilterModel::filterAcceptsRow(
+    int sourceRow, const QModelIndex &sourceParent) const
+{
+    QModelIndex idx = sourceModel()->index(sourceRow, 0, sourceParent);
+
+    if (m_fileSharingOnly &&
+        !idx.data(InstalledAppsModel::FileSharingEnabledRole).toBool())
+        return false;
+
+    if (m_searchText.isEmpty())
+        return true;
+
+    return idx.data(InstalledAppsModel::SearchKeyRole)
+        .toString()
+        .contains(m_searchText);
+}
+
+void InstalledAppDelegate::paint(QPainter *painter,
+                                 const QStyleOptionViewItem &option,
+                                 const QModelIndex &index) const
+{
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+
+    QColor bgColor = isDarkMode() ? qApp->palette().color(QPalette::Light)
+                                  : qApp->palette().color(QPalette::Dark);
+    bool selected = option.state & QStyle::State_Selected;
+
+    // Leave room on the right like the old tab layout did
+    QRectF card = QRectF(option.rect).adjusted(0.5, 0.5, -10.5, -0.5);
+    painter->setPen(QPen(bgColor.lighter(), 1));
+    painter->setBrush(selected ? COLOR_ACCENT_BLUE : bgColor);
+    painter->drawRoundedRect(card, 10, 10);
+
+    const int iconSize = INSTALLED_APPS_ICON_SIZE;
+    QRect iconRect(option.rect.left() + 10,
+                   option.rect.top() + (option.rect.height() - iconSize) / 2,
+                   iconSize, iconSize);
+    QPixmap icon = index.data(Qt::DecorationRole).value<QPixmap>();
+    if (icon.isNull()) {
+        icon = QApplication::style()
+                   ->standardIcon(QStyle::SP_ComputerIcon)
+                   .pixmap(iconSize, iconSize);
+    }
+    painter->drawPixmap(iconRect, icon);
+
+    QRect textRect(iconRect.right() + 11, option.rect.top() + 8,
+                   card.toRect().right() - iconRect.right() - 21,
+                   option.rect.height() - 16);
+    QString version =
+        index.data(InstalledAppsModel::VersionRole).toString();
+
+    QFont nameFont = option.font;
+    nameFont.setWeight(QFont::Medium);
+    QFontMetrics nameMetrics(nameFont);
+    QFont versionFont = option.font;
+    versionFont.setPixelSize(11);
+    QFontMetrics versionMetrics(versionFont);
+
+    int textHeight = nameMetrics.height();
+    if (!version.isEmpty())
+        textHeight += 2 + versionMetrics.height();
+    int y = textRect.top() + (textRect.height() - textHeight) / 2;
+
+    painter->setPen(option.palette.color(QPalette::Text));
+    painter->setFont(nameFont);
+    QString name = nameMetrics.elidedText(
+        index.data(Qt::DisplayRole).toString(), Qt::ElideRight,
+        textRect.width());
+    painter->drawText(QRect(textRect.left(), y, textRect.width(),
+                            nameMetrics.height()),
+                      Qt::AlignLeft | Qt::AlignVCenter, name);
+
+    if (!version.isEmpty()) {
+        y += nameMetrics.height() + 2;
+        painter->setFont(versionFont);
+        painter->drawText(QRect(textRect.left(), y, textRect.width(),
+                                versionMetrics.height()),
+                          Qt::AlignLeft | Qt::AlignVCenter,
+                          versionMetrics.elidedText(version, Qt::ElideRight,
+                                                    textRect.width()));
+    }
+
+    painter->restore();
+}
+
+QSize InstalledAppDelegate::sizeHint(const QStyleOptionViewItem &option,
+                                     const QModelIndex &index) const
+{
+    Q_UNUSED(index)
+    return QSize(option.rect.width(), INSTALLED_APPS_ROW_HEIGHT);
+}
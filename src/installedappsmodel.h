@@ -0,0 +1,122 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef INSTALLEDAPPSMODEL_H
+#define INSTALLEDAPPSMODEL_H
+
+#include "appinventory.h"
+#include "iDescriptor.h"
+#include <QAbstractListModel>
+#include <QCache>
+#include <QPixmap>
+#include <QSortFilterProxyModel>
+#include <QStyledItemDelegate>
+
+// Rounded row icons kept in memory, independent of how many apps there are
+#define INSTALLED_APPS_ICON_CACHE_SIZE 256
+#define INSTALLED_APPS_ICON_SIZE 32
+#define INSTALLED_APPS_ROW_HEIGHT 60
+
+struct InstalledAppRow {
+    InstalledApp app;
+    // Lower-cased name and bundle id, so filtering never allocates
+    QString searchKey;
+};
+
+class InstalledAppsModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        BundleIdRole = Qt::UserRole + 1,
+        VersionRole,
+        TypeRole,
+        FileSharingEnabledRole,
+        SearchKeyRole
+    };
+
+    explicit InstalledAppsModel(iDescriptorDevice *device,
+                                QObject *parent = nullptr);
+
+    // QAbstractItemModel interface
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index,
+                  int role = Qt::DisplayRole) const override;
+
+    // Mirror the AppInventory signals, rows stay sorted by display name
+    void setApps(const QList<InstalledApp> &apps);
+    void addApps(const QList<InstalledApp> &apps);
+    void updateApps(const QList<InstalledApp> &apps);
+    void removeApps(const QStringList &bundleIds);
+    void clear();
+
+private slots:
+    void onIconReady(const QString &bundleId, const QPixmap &icon);
+
+private:
+    int rowForBundleId(const QString &bundleId) const;
+    void rebuildRowIndex();
+    static InstalledAppRow makeRow(const InstalledApp &app);
+    static bool lessThan(const InstalledAppRow &a, const InstalledAppRow &b);
+    static QPixmap roundedIcon(const QPixmap &icon);
+
+    QList<InstalledAppRow> m_apps;
+    QHash<QString, int> m_rowByBundleId;
+
+    iDescriptorDevice *m_device;
+    // Rounded icons of the rows painted recently
+    mutable QCache<QString, QPixmap> m_iconCache;
+};
+
+// Filters on the search text and the file sharing flag
+class InstalledAppsFilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit InstalledAppsFilterModel(QObject *parent = nullptr);
+
+    void setSearchText(const QString &text);
+    void setFileSharingOnly(bool enabled);
+
+protected:
+    bool filterAcceptsRow(int sourceRow,
+                          const QModelIndex &sourceParent) const override;
+
+private:
+    QString m_searchText;
+    bool m_fileSharingOnly = false;
+};
+
+// Paints a row the way the old per-app group boxes looked
+class InstalledAppDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    using QStyledItemDelegate::QStyledItemDelegate;
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option,
+               const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option,
+                   const QModelIndex &index) const override;
+};
+
+#endif // INSTALLEDAPPSMODEL_H
@@ -26,8 +26,6 @@
 #include <QAction>
 #include <QApplication>
 #include <QDebug>
-#include <QEnterEvent>
-#include <QGroupBox>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -36,140 +34,31 @@
 #include <QtConcurrent/QtConcurrent>
 #include <libimobiledevice/afc.h>
 #include <libimobiledevice/house_arrest.h>
-#include <libimobiledevice/installation_proxy.h>
 #include <libimobiledevice/lockdown.h>
 #include <plist/plist.h>
 
-AppTabWidget::AppTabWidget(const QString &appName, const QString &bundleId,
-                           const QString &version, QWidget *parent)
-    : QGroupBox(parent), m_appName(appName), m_bundleId(bundleId),
-      m_version(version), m_selected(false)
-{
-    setFixedHeight(60);
-    setMinimumWidth(100);
-    setCursor(Qt::PointingHandCursor);
-
-    setupUI();
-    fetchAppIcon();
-}
-
-void AppTabWidget::fetchAppIcon()
-{
-    ::fetchAppIconFromApple(
-        m_networkManager, m_bundleId, [this](const QPixmap &pixmap) {
-            if (!pixmap.isNull()) {
-                QPixmap scaled =
-                    pixmap.scaled(32, 32, Qt::KeepAspectRatioByExpanding,
-                                  Qt::SmoothTransformation);
-                QPixmap rounded(32, 32);
-                rounded.fill(Qt::transparent);
-
-                QPainter painter(&rounded);
-                painter.setRenderHint(QPainter::Antialiasing);
-                QPainterPath path;
-                path.addRoundedRect(QRectF(0, 0, 32, 32), 8, 8);
-                painter.setClipPath(path);
-                painter.drawPixmap(0, 0, scaled);
-                painter.end();
-
-                m_iconLabel->setPixmap(rounded);
-            }
-        });
-}
-
-void AppTabWidget::setSelected(bool selected)
-{
-    m_selected = selected;
-    updateStyles();
-}
-
-void AppTabWidget::setupUI()
-{
-    QHBoxLayout *mainLayout = new QHBoxLayout(this);
-    mainLayout->setContentsMargins(10, 8, 10, 8);
-    mainLayout->setSpacing(10);
-    // m_defaultBg = this->palette().color(QPalette::Window);
-    // Icon label
-    m_iconLabel = new QLabel();
-    m_iconLabel->setFixedSize(32, 32);
-    m_iconLabel->setScaledContents(true);
-
-    QPixmap placeholderIcon = QApplication::style()
-                                  ->standardIcon(QStyle::SP_ComputerIcon)
-                                  .pixmap(32, 32);
-    m_iconLabel->setPixmap(placeholderIcon);
-    mainLayout->addWidget(m_iconLabel);
-
-    // Text container
-    QVBoxLayout *textLayout = new QVBoxLayout();
-    textLayout->setContentsMargins(0, 0, 0, 0);
-    textLayout->setSpacing(2);
-
-    // App name label
-    m_nameLabel = new QLabel();
-    QFont nameFont = m_nameLabel->font();
-    nameFont.setWeight(QFont::Medium);
-    m_nameLabel->setFont(nameFont);
-
-    QString displayText = m_appName;
-    if (displayText.length() > 20) {
-        displayText = displayText.left(17) + "...";
-    }
-    m_nameLabel->setText(displayText);
-    textLayout->addWidget(m_nameLabel);
-
-    // Version label
-    if (!m_version.isEmpty()) {
-        m_versionLabel = new QLabel(m_version);
-        m_versionLabel->setStyleSheet("font-size: 11px;");
-        textLayout->addWidget(m_versionLabel);
-    } else {
-        m_versionLabel = nullptr;
-    }
-
-    mainLayout->addLayout(textLayout);
-    mainLayout->addStretch();
-
-    updateStyles();
-}
-
-void AppTabWidget::mousePressEvent(QMouseEvent *event)
-{
-    Q_UNUSED(event)
-    emit clicked();
-}
-
-void AppTabWidget::updateStyles()
-{
-    QString style;
-    QColor bgColor = isDarkMode() ? qApp->palette().color(QPalette::Light)
-                                  : qApp->palette().color(QPalette::Dark);
-    if (m_selected) {
-        style = "QGroupBox { background-color: " + COLOR_ACCENT_BLUE.name() +
-                "; border-radius: "
-                "10px; border : 1px solid " +
-                bgColor.lighter().name() + "; }";
-    } else {
-        style = "QGroupBox { background-color: " + bgColor.name() +
-                "; border-radius: 10px; border: 1px solid " +
-                bgColor.lighter().name() + "; }";
-    }
-    // prevent infinite loop
-    if (style != styleSheet()) {
-        setStyleSheet(style);
-    }
-}
-
 InstalledAppsWidget::InstalledAppsWidget(iDescriptorDevice *device,
                                          QWidget *parent)
     : QWidget(parent), m_device(device)
 {
-    m_watcher = new QFutureWatcher<QVariantMap>(this);
     m_containerWatcher = new QFutureWatcher<QVariantMap>(this);
     setupUI();
 
-    connect(m_watcher, &QFutureWatcher<QVariantMap>::finished, this,
-            &InstalledAppsWidget::onAppsDataReady);
+    AppInventory *inventory = AppInventory::sharedInstance();
+    connect(inventory, &AppInventory::appsAdded, this,
+            &InstalledAppsWidget::onAppsAdded);
+    connect(inventory, &AppInventory::appsUpdated, this,
+            [this](const QString &udid, const QList<InstalledApp> &apps) {
+                if (isOwnDevice(udid))
+                    m_appsModel->updateApps(apps);
+            });
+    connect(inventory, &AppInventory::appsRemoved, this,
+            [this](const QString &udid, const QStringList &bundleIds) {
+                if (isOwnDevice(udid))
+                    m_appsModel->removeApps(bundleIds);
+            });
+    connect(inventory, &AppInventory::refreshFinished, this,
+            &InstalledAppsWidget::onAppsRefreshFinished);
     connect(m_containerWatcher, &QFutureWatcher<QVariantMap>::finished, this,
             &InstalledAppsWidget::onContainerDataReady);
     setStyleSheet("InstalledAppsWidget { background: transparent; }");
@@ -277,7 +166,9 @@ void InstalledAppsWidget::createContentWidget()
     m_splitter->setSizes({400, 600});
 
     // Connect signals
-    connect(m_searchEdit, &QLineEdit::textChanged, this,
+    connect(m_searchEdit, &QLineEdit::textChanged, m_searchTimer,
+            qOverload<>(&QTimer::start));
+    connect(m_searchTimer, &QTimer::timeout, this,
             &InstalledAppsWidget::filterApps);
     connect(m_fileSharingCheckBox, &QCheckBox::toggled, this,
             &InstalledAppsWidget::onFileSharingFilterChanged);
@@ -285,7 +176,6 @@ void InstalledAppsWidget::createContentWidget()
     m_stackedWidget->addWidget(m_contentWidget);
 }
 
-// todo: move to services
 void InstalledAppsWidget::fetchInstalledApps()
 {
     if (!m_device || !m_device->device) {
@@ -293,312 +183,73 @@ void InstalledAppsWidget::fetchInstalledApps()
         return;
     }
 
-    QFuture<QVariantMap> future = QtConcurrent::run([this]() -> QVariantMap {
-        QVariantMap result;
-        QVariantList apps;
-
-        // result["success"] = true;
-        // result["apps"] = apps;
-        // return result;
-
-        instproxy_client_t instproxy = nullptr;
-        lockdownd_client_t lockdownClient = nullptr;
-        lockdownd_service_descriptor_t lockdowndService = nullptr;
-
-        try {
-            if (lockdownd_client_new_with_handshake(
-                    m_device->device, &lockdownClient, APP_LABEL) !=
-                LOCKDOWN_E_SUCCESS) {
-                result["error"] = "Could not connect to lockdown service";
-                return result;
-            }
-
-            if (lockdownd_start_service(
-                    lockdownClient, "com.apple.mobile.installation_proxy",
-                    &lockdowndService) != LOCKDOWN_E_SUCCESS) {
-                result["error"] = "Could not start installation proxy service";
-                lockdownd_client_free(lockdownClient);
-                return result;
-            }
-
-            if (instproxy_client_new(m_device->device, lockdowndService,
-                                     &instproxy) != INSTPROXY_E_SUCCESS) {
-                result["error"] = "Could not connect to installation proxy";
-                lockdownd_service_descriptor_free(lockdowndService);
-                lockdownd_client_free(lockdownClient);
-                return result;
-            }
-
-            lockdownd_service_descriptor_free(lockdowndService);
-            lockdowndService = nullptr;
-
-            // Get both User and System apps
-            QStringList appTypes = {"User", "System"};
-
-            for (const QString &appType : appTypes) {
-                plist_t client_opts = plist_new_dict();
-                plist_dict_set_item(
-                    client_opts, "ApplicationType",
-                    plist_new_string(appType.toUtf8().constData()));
-
-                plist_t return_attrs = plist_new_array();
-                plist_array_append_item(return_attrs,
-                                        plist_new_string("CFBundleIdentifier"));
-                plist_array_append_item(
-                    return_attrs, plist_new_string("CFBundleDisplayName"));
-                plist_array_append_item(
-                    return_attrs,
-                    plist_new_string("CFBundleShortVersionString"));
-                plist_array_append_item(return_attrs,
-                                        plist_new_string("CFBundleVersion"));
-                plist_array_append_item(
-                    return_attrs, plist_new_string("UIFileSharingEnabled"));
-
-                plist_dict_set_item(client_opts, "ReturnAttributes",
-                                    return_attrs);
-
-                plist_t apps_plist = nullptr;
-                if (instproxy_browse(instproxy, client_opts, &apps_plist) ==
-                        INSTPROXY_E_SUCCESS &&
-                    apps_plist) {
-                    if (plist_get_node_type(apps_plist) == PLIST_ARRAY) {
-                        for (uint32_t i = 0;
-                             i < plist_array_get_size(apps_plist); i++) {
-                            plist_t app_info =
-                                plist_array_get_item(apps_plist, i);
-                            if (!app_info)
-                                continue;
-
-                            QVariantMap appData;
-
-                            // Get bundle identifier
-                            plist_t bundle_id = plist_dict_get_item(
-                                app_info, "CFBundleIdentifier");
-                            if (bundle_id && plist_get_node_type(bundle_id) ==
-                                                 PLIST_STRING) {
-                                char *bundle_id_str = nullptr;
-                                plist_get_string_val(bundle_id, &bundle_id_str);
-                                if (bundle_id_str) {
-                                    appData["bundleId"] =
-                                        QString(bundle_id_str);
-                                    free(bundle_id_str);
-                                }
-                            }
-
-                            // Get display name
-                            plist_t display_name = plist_dict_get_item(
-                                app_info, "CFBundleDisplayName");
-                            if (display_name &&
-                                plist_get_node_type(display_name) ==
-                                    PLIST_STRING) {
-                                char *display_name_str = nullptr;
-                                plist_get_string_val(display_name,
-                                                     &display_name_str);
-                                if (display_name_str) {
-                                    appData["displayName"] =
-                                        QString(display_name_str);
-                                    free(display_name_str);
-                                }
-                            }
-
-                            // Get version
-                            plist_t version = plist_dict_get_item(
-                                app_info, "CFBundleShortVersionString");
-                            if (version &&
-                                plist_get_node_type(version) == PLIST_STRING) {
-                                char *version_str = nullptr;
-                                plist_get_string_val(version, &version_str);
-                                if (version_str) {
-                                    appData["version"] = QString(version_str);
-                                    free(version_str);
-                                }
-                            }
-
-                            // Get file sharing enabled status
-                            plist_t file_sharing = plist_dict_get_item(
-                                app_info, "UIFileSharingEnabled");
-                            if (file_sharing &&
-                                plist_get_node_type(file_sharing) ==
-                                    PLIST_BOOLEAN) {
-                                uint8_t file_sharing_enabled = 0;
-                                plist_get_bool_val(file_sharing,
-                                                   &file_sharing_enabled);
-                                appData["fileSharingEnabled"] =
-                                    (file_sharing_enabled != 0);
-                            } else {
-                                appData["fileSharingEnabled"] = false;
-                            }
-
-                            appData["type"] = appType;
-
-                            if (!appData["bundleId"].toString().isEmpty()) {
-                                apps.append(appData);
-                            }
-                        }
-                    }
-                    plist_free(apps_plist);
-                }
-                plist_free(client_opts);
-            }
-
-            instproxy_client_free(instproxy);
-            lockdownd_client_free(lockdownClient);
-
-            result["apps"] = apps;
-            result["success"] = true;
-
-        } catch (const std::exception &e) {
-            if (instproxy)
-                instproxy_client_free(instproxy);
-            if (lockdownClient)
-                lockdownd_client_free(lockdownClient);
-            if (lockdowndService)
-                lockdownd_service_descriptor_free(lockdowndService);
-
-            result["error"] = QString("Exception: %1").arg(e.what());
-        }
-
-        return result;
-    });
+    // Show the last known list right away, the refresh only sends changes
+    AppInventory *inventory = AppInventory::sharedInstance();
+    QList<InstalledApp> apps =
+        inventory->apps(QString::fromStdString(m_device->udid));
+    m_appsModel->setApps(apps);
+    if (apps.isEmpty()) {
+        showLoadingState();
+    } else {
+        m_stackedWidget->setCurrentWidget(m_contentWidget);
+        selectFirstAppIfNone();
+    }
 
-    m_watcher->setFuture(future);
+    inventory->refresh(m_device);
 }
 
-void InstalledAppsWidget::onAppsDataReady()
+bool InstalledAppsWidget::isOwnDevice(const QString &udid) const
 {
-    QVariantMap result = m_watcher->result();
+    return m_device && udid == QString::fromStdString(m_device->udid);
+}
 
-    if (!result.value("success", false).toBool()) {
-        showErrorState(result.value("error", "Unknown error").toString());
+void InstalledAppsWidget::onAppsAdded(const QString &udid,
+                                      const QList<InstalledApp> &apps)
+{
+    if (!isOwnDevice(udid))
         return;
-    }
 
-    QVariantList apps = result.value("apps").toList();
-    if (apps.isEmpty()) {
-        showErrorState("No apps found");
-        return;
-    }
+    m_appsModel->addApps(apps);
 
-    // Switch to content view once data is loaded
+    // Switch to content view as soon as the first page is in
     m_stackedWidget->setCurrentWidget(m_contentWidget);
 
-    // Sort apps by display name
-    std::sort(apps.begin(), apps.end(),
-              [](const QVariant &a, const QVariant &b) {
-                  QString nameA = a.toMap().value("displayName").toString();
-                  QString nameB = b.toMap().value("displayName").toString();
-                  if (nameA.isEmpty())
-                      nameA = a.toMap().value("bundleId").toString();
-                  if (nameB.isEmpty())
-                      nameB = b.toMap().value("bundleId").toString();
-                  return nameA.compare(nameB, Qt::CaseInsensitive) < 0;
-              });
-
-    // Clear existing tabs
-    qDeleteAll(m_appTabs);
-    m_appTabs.clear();
-    m_selectedTab = nullptr;
-
-    // Create tabs for each app
-    for (const QVariant &appVariant : apps) {
-        QVariantMap appData = appVariant.toMap();
-        QString displayName = appData.value("displayName").toString();
-        QString bundleId = appData.value("bundleId").toString();
-        QString version = appData.value("version").toString();
-        QString appType = appData.value("type").toString();
-        bool fileSharingEnabled =
-            appData.value("fileSharingEnabled", false).toBool();
-
-        // Filter by file sharing status if checkbox is checked
-        if (m_fileSharingCheckBox->isChecked() && !fileSharingEnabled) {
-            continue;
-        }
-
-        if (displayName.isEmpty()) {
-            displayName = bundleId;
-        }
-
-        // Create tab name with type indicator
-        QString tabName = displayName;
-        if (appType == "System") {
-            tabName += " (System)";
-        }
-
-        createAppTab(tabName, bundleId, version);
-    }
-
-    // m_contentLabel->setText(
-    //     QString("Found %1 installed apps").arg(apps.count()));
-
-    // Select first tab if available
-    if (!m_appTabs.isEmpty()) {
-        selectAppTab(m_appTabs.first());
-    }
+    // Select first app if available
+    selectFirstAppIfNone();
 }
 
-void InstalledAppsWidget::createAppTab(const QString &appName,
-                                       const QString &bundleId,
-                                       const QString &version)
+void InstalledAppsWidget::onAppsRefreshFinished(const QString &udid,
+                                                bool success,
+                                                const QString &error)
 {
-    AppTabWidget *tabWidget =
-        new AppTabWidget(appName, bundleId, version, this);
-    connect(tabWidget, &AppTabWidget::clicked, this,
-            &InstalledAppsWidget::onAppTabClicked);
-
-    // Remove the stretch before adding the new tab
-    m_tabLayout->removeItem(m_tabLayout->itemAt(m_tabLayout->count() - 1));
-
-    m_tabLayout->addWidget(tabWidget);
-    m_tabLayout->addStretch(); // Add stretch back at the end
-
-    m_appTabs.append(tabWidget);
-}
+    if (!isOwnDevice(udid) || m_appsModel->rowCount() > 0)
+        return;
 
-void InstalledAppsWidget::onAppTabClicked()
-{
-    AppTabWidget *clickedTab = qobject_cast<AppTabWidget *>(sender());
-    if (clickedTab) {
-        selectAppTab(clickedTab);
-    }
+    showErrorState(success ? QString("No apps found") : error);
 }
 
-void InstalledAppsWidget::selectAppTab(AppTabWidget *tab)
+void InstalledAppsWidget::onCurrentAppChanged(const QModelIndex &current)
 {
-    // Deselect previous tab
-    if (m_selectedTab) {
-        m_selectedTab->setSelected(false);
-    }
-
-    // Select new tab
-    m_selectedTab = tab;
-    tab->setSelected(true);
-
-    QString bundleId = tab->getBundleId();
+    if (!current.isValid())
+        return;
 
     // Load app container data
-    loadAppContainer(bundleId);
+    loadAppContainer(
+        current.data(InstalledAppsModel::BundleIdRole).toString());
 }
 
-void InstalledAppsWidget::filterApps(const QString &searchText)
+void InstalledAppsWidget::selectFirstAppIfNone()
 {
-    QString lowerSearchText = searchText.toLower();
-
-    for (AppTabWidget *tab : m_appTabs) {
-        bool shouldShow = false;
-
-        if (lowerSearchText.isEmpty()) {
-            shouldShow = true;
-        } else {
-            // Search in app name and bundle ID
-            QString appName = tab->getAppName().toLower();
-            QString bundleId = tab->getBundleId().toLower();
+    if (m_appList->currentIndex().isValid() ||
+        m_filterModel->rowCount() == 0)
+        return;
 
-            shouldShow = appName.contains(lowerSearchText) ||
-                         bundleId.contains(lowerSearchText);
-        }
+    m_appList->setCurrentIndex(m_filterModel->index(0, 0));
+}
 
-        tab->setVisible(shouldShow);
-    }
+void InstalledAppsWidget::filterApps()
+{
+    m_filterModel->setSearchText(m_searchEdit->text());
 }
 
 /*
@@ -808,9 +459,9 @@ void InstalledAppsWidget::onContainerDataReady()
 
 void InstalledAppsWidget::onFileSharingFilterChanged(bool enabled)
 {
-    Q_UNUSED(enabled)
-    // Refresh the apps list when filter changes
-    fetchInstalledApps();
+    // The list already holds every app, no need to ask the device again
+    m_filterModel->setFileSharingOnly(enabled);
+    selectFirstAppIfNone();
 }
 
 void InstalledAppsWidget::cleanupHouseArrestClients()
@@ -855,24 +506,34 @@ void InstalledAppsWidget::createLeftPanel()
 
     tabWidgetLayout->addWidget(searchContainer);
 
-    // App list scroll area
-    m_tabScrollArea = new QScrollArea();
-    m_tabScrollArea->setWidgetResizable(true);
-    m_tabScrollArea->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    m_tabScrollArea->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    m_tabScrollArea->setStyleSheet(
-        "QScrollArea { background: transparent; border: none; }");
-    m_tabScrollArea->viewport()->setStyleSheet("background: transparent;");
-
-    m_tabContainer = new QWidget();
-    m_tabContainer->setStyleSheet("QWidget { background: transparent; }");
-    m_tabLayout = new QVBoxLayout(m_tabContainer);
-    m_tabLayout->setContentsMargins(0, 0, 10, 0);
-    m_tabLayout->setSpacing(10);
-    m_tabLayout->addStretch();
-
-    m_tabScrollArea->setWidget(m_tabContainer);
-    tabWidgetLayout->addWidget(m_tabScrollArea);
+    m_searchTimer = new QTimer(this);
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(INSTALLED_APPS_SEARCH_DEBOUNCE_MS);
+
+    // App list, only the visible rows are ever painted
+    m_appsModel = new InstalledAppsModel(m_device, this);
+    m_filterModel = new InstalledAppsFilterModel(this);
+    m_filterModel->setSourceModel(m_appsModel);
+    m_filterModel->setFileSharingOnly(m_fileSharingCheckBox->isChecked());
+
+    m_appList = new QListView();
+    m_appList->setModel(m_filterModel);
+    m_appList->setItemDelegate(new InstalledAppDelegate(m_appList));
+    m_appList->setUniformItemSizes(true);
+    m_appList->setSpacing(5);
+    m_appList->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_appList->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_appList->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    m_appList->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    m_appList->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    m_appList->setCursor(Qt::PointingHandCursor);
+    m_appList->setStyleSheet(
+        "QListView { background: transparent; border: none; }");
+    m_appList->viewport()->setStyleSheet("background: transparent;");
+    connect(m_appList->selectionModel(),
+            &QItemSelectionModel::currentChanged, this,
+            &InstalledAppsWidget::onCurrentAppChanged);
+    tabWidgetLayout->addWidget(m_appList);
 
     m_splitter->addWidget(tabWidget);
 }
@@ -20,75 +20,29 @@
 #ifndef INSTALLEDAPPSWIDGET_H
 #define INSTALLEDAPPSWIDGET_H
 
+#include "appinventory.h"
 #include "iDescriptor.h"
+#include "installedappsmodel.h"
 #include "zlineedit.h"
 #include <QCheckBox>
-#include <QEnterEvent>
-#include <QEvent>
 #include <QFrame>
 #include <QFutureWatcher>
-#include <QGroupBox>
 #include <QHBoxLayout>
 #include <QLabel>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
-#include <QPainter>
-#include <QPainterPath>
-#include <QPixmap>
+#include <QListView>
 #include <QProgressBar>
 #include <QPushButton>
 #include <QScrollArea>
 #include <QSplitter>
 #include <QStackedWidget>
+#include <QTimer>
 #include <QVBoxLayout>
 #include <QWidget>
 #include <libimobiledevice/afc.h>
 #include <libimobiledevice/house_arrest.h>
 
-// Custom App Tab Widget
-class AppTabWidget : public QGroupBox
-{
-    Q_OBJECT
-
-public:
-    AppTabWidget(const QString &appName, const QString &bundleId,
-                 const QString &version, QWidget *parent = nullptr);
-
-    void setSelected(bool selected);
-    bool isSelected() const { return m_selected; }
-
-    QString getBundleId() const { return m_bundleId; }
-    QString getAppName() const { return m_appName; }
-    QString getVersion() const { return m_version; }
-    void updateStyles();
-
-signals:
-    void clicked();
-
-protected:
-    void mousePressEvent(QMouseEvent *event) override;
-    void changeEvent(QEvent *event) override
-    {
-        if (event->type() == QEvent::PaletteChange) {
-            updateStyles();
-        }
-        QGroupBox::changeEvent(event);
-    };
-
-private:
-    void fetchAppIcon();
-    void setupUI();
-
-    QString m_appName;
-    QString m_bundleId;
-    QString m_version;
-    bool m_selected = false;
-
-    QLabel *m_iconLabel;
-    QLabel *m_nameLabel;
-    QLabel *m_versionLabel;
-    QNetworkAccessManager *m_networkManager = new QNetworkAccessManager(this);
-};
+// Wait for typing to pause before filtering the app list
+#define INSTALLED_APPS_SEARCH_DEBOUNCE_MS 150
 
 class InstalledAppsWidget : public QWidget
 {
@@ -100,8 +54,10 @@ public:
     ~InstalledAppsWidget();
 
 private slots:
-    void onAppsDataReady();
-    void onAppTabClicked();
+    void onAppsAdded(const QString &udid, const QList<InstalledApp> &apps);
+    void onAppsRefreshFinished(const QString &udid, bool success,
+                               const QString &error);
+    void onCurrentAppChanged(const QModelIndex &current);
     void onContainerDataReady();
     void onFileSharingFilterChanged(bool enabled);
 
@@ -113,12 +69,11 @@ private:
     void createLeftPanel();
     void createRightPanel();
     void fetchInstalledApps();
-    void createAppTab(const QString &appName, const QString &bundleId,
-                      const QString &version);
+    bool isOwnDevice(const QString &udid) const;
     void showLoadingState();
     void showErrorState(const QString &error);
-    void selectAppTab(AppTabWidget *tab);
-    void filterApps(const QString &searchText);
+    void selectFirstAppIfNone();
+    void filterApps();
     void loadAppContainer(const QString &bundleId);
     void cleanupHouseArrestClients();
 
@@ -131,21 +86,19 @@ private:
     QLabel *m_errorLabel;
     ZLineEdit *m_searchEdit;
     QCheckBox *m_fileSharingCheckBox;
-    QScrollArea *m_tabScrollArea;
-    QWidget *m_tabContainer;
-    QVBoxLayout *m_tabLayout;
+    QTimer *m_searchTimer;
+    QListView *m_appList;
     QProgressBar *m_progressBar;
     QScrollArea *m_containerScrollArea;
     QWidget *m_containerWidget;
     QVBoxLayout *m_containerLayout;
-    QFutureWatcher<QVariantMap> *m_watcher;
     QFutureWatcher<QVariantMap> *m_containerWatcher;
     QSplitter *m_splitter;
     house_arrest_client_t m_houseArrestClient = nullptr;
     afc_client_t m_houseArrestAfcClient = nullptr;
     // App data storage
-    QList<AppTabWidget *> m_appTabs;
-    AppTabWidget *m_selectedTab = nullptr;
+    InstalledAppsModel *m_appsModel;
+    InstalledAppsFilterModel *m_filterModel;
 };
 
 #endif // INSTALLEDAPPSWIDGET_H
\ No newline at end of file
@@ -0,0 +1,585 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ipadeploymentengine.h"
+#include "servicemanager.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+
+double IpaDeviceStatus::progress() const
+{
+    switch (state) {
+    case IpaDeployState::Succeeded:
+    case IpaDeployState::Failed:
+        return 1.0;
+    case IpaDeployState::Installing:
+        return IPA_DEPLOY_UPLOAD_WEIGHT +
+               (1.0 - IPA_DEPLOY_UPLOAD_WEIGHT) * installPercent / 100.0;
+    default:
+        if (totalBytes == 0) {
+            return 0.0;
+        }
+        return IPA_DEPLOY_UPLOAD_WEIGHT * uploadedBytes / double(totalBytes);
+    }
+}
+
+IpaDeploymentEngine *IpaDeploymentEngine::sharedInstance()
+{
+    static IpaDeploymentEngine self;
+    return &self;
+}
+
+IpaDeploymentEngine::IpaDeploymentEngine(QObject *parent)
+    : QObject(parent),
+      m_cacheDirectory(
+          QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+              .filePath("ipa-metadata"))
+{
+    m_pool.setMaxThreadCount(IPA_DEPLOY_MAX_PARALLEL_DEVICES);
+    QDir().mkpath(m_cacheDirectory);
+}
+
+IpaDeploymentEngine::~IpaDeploymentEngine()
+{
+    for (Running &running : m_running) {
+        running.cancelled->store(true);
+    }
+    for (Deployment &deployment : m_deployments) {
+        deployment.preparing.waitForFinished();
+    }
+    m_pool.waitForDone();
+}
+
+quint64 IpaDeploymentEngine::deploy(const QString &ipaPath,
+                                    const QList<iDescriptorDevice *> &devices)
+{
+    Deployment deployment;
+    deployment.ipaPath = ipaPath;
+
+    QSet<QString> seen;
+    for (iDescriptorDevice *device : devices) {
+        if (!device) {
+            continue;
+        }
+        const QString udid = QString::fromStdString(device->udid);
+        if (seen.contains(udid)) {
+            continue;
+        }
+        seen.insert(udid);
+
+        IpaDeviceStatus status;
+        status.udid = udid;
+        status.deviceName =
+            QString::fromStdString(device->deviceInfo.deviceName);
+        deployment.devices.append(status);
+        deployment.waiting.append(device);
+    }
+    if (deployment.devices.isEmpty()) {
+        return 0;
+    }
+
+    const quint64 id = m_nextDeploymentId++;
+    m_deployments.insert(id, deployment);
+    prepare(id, ipaPath);
+    return id;
+}
+
+void IpaDeploymentEngine::prepare(quint64 deploymentId, const QString &ipaPath)
+{
+    // Hash and parse on the global pool, the engine's pool is for devices
+    QFuture<void> future = QtConcurrent::run([this, deploymentId, ipaPath]() {
+        std::shared_ptr<const IpaMetadata> metadata;
+        QString error;
+
+        QFile file(ipaPath);
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        if (!file.open(QIODevice::ReadOnly) || !hash.addData(&file)) {
+            error = QString("Could not read %1: %2")
+                        .arg(ipaPath, file.errorString());
+        } else {
+            const QByteArray digest = hash.result();
+            metadata = cachedMetadata(digest);
+            if (!metadata) {
+                IpaMetadata parsed;
+                std::string parseError;
+                if (read_ipa_metadata(ipaPath.toUtf8().constData(), parsed,
+                                      parseError)) {
+                    metadata =
+                        std::make_shared<const IpaMetadata>(std::move(parsed));
+                    storeMetadata(digest, metadata);
+                } else {
+                    error = QString::fromStdString(parseError);
+                }
+            }
+        }
+
+        QMetaObject::invokeMethod(
+            this,
+            [this, deploymentId, metadata, error]() {
+                onPrepared(deploymentId, metadata, error);
+            },
+            Qt::QueuedConnection);
+    });
+    m_deployments[deploymentId].preparing = future;
+}
+
+void IpaDeploymentEngine::onPrepared(
+    quint64 deploymentId, std::shared_ptr<const IpaMetadata> metadata,
+    const QString &error)
+{
+    auto it = m_deployments.find(deploymentId);
+    if (it == m_deployments.end()) {
+        return;
+    }
+
+    const QList<iDescriptorDevice *> waiting = it->waiting;
+    it->waiting.clear();
+
+    if (!metadata) {
+        qWarning() << "IpaDeploymentEngine: invalid archive" << it->ipaPath
+                   << error;
+        emit metadataReady(deploymentId, false, error);
+        for (iDescriptorDevice *device : waiting) {
+            failDevice(deploymentId, QString::fromStdString(device->udid),
+                       error);
+        }
+        finishIfDone(deploymentId);
+        return;
+    }
+
+    it->metadata = metadata;
+    const bool cancelled = it->cancelled;
+    for (iDescriptorDevice *device : waiting) {
+        if (cancelled) {
+            failDevice(deploymentId, QString::fromStdString(device->udid),
+                       "Cancelled");
+            continue;
+        }
+        m_queue.enqueue(Job{deploymentId, device});
+    }
+    emit metadataReady(deploymentId, true,
+                       QString::fromStdString(metadata->bundleIdentifier));
+    schedule();
+    finishIfDone(deploymentId);
+}
+
+void IpaDeploymentEngine::schedule()
+{
+    for (int i = 0; i < m_queue.size();) {
+        if (m_running.size() >= IPA_DEPLOY_MAX_PARALLEL_DEVICES) {
+            return;
+        }
+        const QString udid = QString::fromStdString(m_queue[i].device->udid);
+        // A device that is busy with another deployment waits its turn
+        if (m_running.contains(udid)) {
+            ++i;
+            continue;
+        }
+        startJob(m_queue.takeAt(i));
+    }
+}
+
+void IpaDeploymentEngine::startJob(const Job &job)
+{
+    const Deployment &deployment = m_deployments[job.deploymentId];
+    const QString udid = QString::fromStdString(job.device->udid);
+    const quint64 deploymentId = job.deploymentId;
+
+    IpaDeviceStatus status;
+    for (const IpaDeviceStatus &entry : deployment.devices) {
+        if (entry.udid == udid) {
+            status = entry;
+            break;
+        }
+    }
+
+    auto report = [this, deploymentId](const IpaDeviceStatus &status) {
+        QMetaObject::invokeMethod(
+            this,
+            [this, deploymentId, status]() {
+                updateStatus(deploymentId, status);
+            },
+            Qt::QueuedConnection);
+    };
+
+    Running running;
+    running.deploymentId = deploymentId;
+    running.cancelled = std::make_shared<std::atomic<bool>>(false);
+    running.future = QtConcurrent::run(
+        &m_pool,
+        [this, device = job.device, ipaPath = deployment.ipaPath,
+         metadata = deployment.metadata, cancelled = running.cancelled, status,
+         report, deploymentId, udid]() {
+            installOnDevice(device, ipaPath, metadata, cancelled, status,
+                            report);
+            QMetaObject::invokeMethod(
+                this,
+                [this, deploymentId, udid]() {
+                    onJobFinished(deploymentId, udid);
+                },
+                Qt::QueuedConnection);
+        });
+    m_running.insert(udid, running);
+}
+
+void IpaDeploymentEngine::installOnDevice(
+    iDescriptorDevice *device, const QString &ipaPath,
+    std::shared_ptr<const IpaMetadata> metadata,
+    std::shared_ptr<std::atomic<bool>> cancelled, IpaDeviceStatus status,
+    const std::function<void(const IpaDeviceStatus &)> &report)
+{
+    const QByteArray path = ipaPath.toUtf8();
+
+    for (int attempt = 1; attempt <= IPA_DEPLOY_MAX_ATTEMPTS; ++attempt) {
+        status.attempt = attempt;
+        status.state = IpaDeployState::Uploading;
+        status.uploadedBytes = 0;
+        status.installPercent = 0;
+        report(status);
+
+        instproxy_error_t err = INSTPROXY_E_CONN_FAILED;
+        if (AfcClientLease lease = ServiceManager::leaseAfcClient(device)) {
+            // Only report whole percent steps, every device posts to the GUI
+            int lastKey = -1;
+            auto onProgress = [&status, &report, &lastKey](
+                                  InstallIpaStage stage, uint64_t done,
+                                  uint64_t total) {
+                int key;
+                if (stage == InstallIpaStage::Uploading) {
+                    status.uploadedBytes = done;
+                    status.totalBytes = total;
+                    key = total > 0 ? int(done * 100 / total) : 0;
+                } else {
+                    status.state = IpaDeployState::Installing;
+                    status.installPercent = int(done);
+                    key = 101 + int(done);
+                }
+                if (key != lastKey) {
+                    lastKey = key;
+                    report(status);
+                }
+            };
+            err = install_IPA(
+                device->device, lease.client(), path.constData(), *metadata,
+                onProgress, [&cancelled]() { return cancelled->load(); });
+        }
+
+        if (err == INSTPROXY_E_SUCCESS) {
+            status.state = IpaDeployState::Succeeded;
+            status.error.clear();
+            report(status);
+            return;
+        }
+
+        status.error = errorString(err);
+        qWarning() << "IpaDeploymentEngine: attempt" << attempt << "on"
+                   << status.udid << "failed:" << status.error;
+        if (!isTransient(err) || attempt == IPA_DEPLOY_MAX_ATTEMPTS ||
+            cancelled->load()) {
+            break;
+        }
+
+        status.state = IpaDeployState::Retrying;
+        report(status);
+        for (int waited = 0;
+             waited < IPA_DEPLOY_RETRY_DELAY_MS * attempt && !cancelled->load();
+             waited += 100) {
+            QThread::msleep(100);
+        }
+        if (cancelled->load()) {
+            break;
+        }
+    }
+
+    if (cancelled->load()) {
+        status.error = "Device disconnected";
+    }
+    status.state = IpaDeployState::Failed;
+    report(status);
+}
+
+bool IpaDeploymentEngine::isTransient(instproxy_error_t error)
+{
+    // Connection problems are worth another try, anything installd
+    // rejected will be rejected again
+    switch (error) {
+    case INSTPROXY_E_CONN_FAILED:
+    case INSTPROXY_E_OP_IN_PROGRESS:
+    case INSTPROXY_E_RECEIVE_TIMEOUT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+QString IpaDeploymentEngine::errorString(instproxy_error_t error)
+{
+    switch (error) {
+    case INSTPROXY_E_INVALID_ARG:
+        return "Invalid IPA";
+    case INSTPROXY_E_CONN_FAILED:
+        return "Could not copy the app to the device";
+    case INSTPROXY_E_OP_IN_PROGRESS:
+        return "Another installation is in progress";
+    case INSTPROXY_E_RECEIVE_TIMEOUT:
+        return "The device stopped responding";
+    case INSTPROXY_E_OP_FAILED:
+        return "The device rejected the app";
+    default:
+        return QString("Installation failed with error code: %1").arg(error);
+    }
+}
+
+void IpaDeploymentEngine::updateStatus(quint64 deploymentId,
+                                       const IpaDeviceStatus &status)
+{
+    auto it = m_deployments.find(deploymentId);
+    if (it == m_deployments.end()) {
+        return;
+    }
+    for (IpaDeviceStatus &entry : it->devices) {
+        if (entry.udid == status.udid) {
+            // A device failed on removal stays failed
+            if (entry.isFinished() && !status.isFinished()) {
+                return;
+            }
+            entry = status;
+            break;
+        }
+    }
+    emit deviceStatusChanged(deploymentId, status);
+    emit progressChanged(deploymentId, progress(deploymentId));
+}
+
+void IpaDeploymentEngine::failDevice(quint64 deploymentId, const QString &udid,
+                                     const QString &error)
+{
+    auto it = m_deployments.find(deploymentId);
+    if (it == m_deployments.end()) {
+        return;
+    }
+    for (const IpaDeviceStatus &entry : it->devices) {
+        if (entry.udid == udid) {
+            IpaDeviceStatus status = entry;
+            status.state = IpaDeployState::Failed;
+            status.error = error;
+            updateStatus(deploymentId, status);
+            return;
+        }
+    }
+}
+
+void IpaDeploymentEngine::onJobFinished(quint64 deploymentId,
+                                        const QString &udid)
+{
+    auto it = m_running.find(udid);
+    if (it != m_running.end() && it->deploymentId == deploymentId) {
+        m_running.erase(it);
+    }
+    schedule();
+    finishIfDone(deploymentId);
+}
+
+void IpaDeploymentEngine::finishIfDone(quint64 deploymentId)
+{
+    auto it = m_deployments.find(deploymentId);
+    if (it == m_deployments.end()) {
+        return;
+    }
+
+    int succeeded = 0;
+    int failed = 0;
+    for (const IpaDeviceStatus &status : it->devices) {
+        if (!status.isFinished()) {
+            return;
+        }
+        if (status.state == IpaDeployState::Succeeded) {
+            ++succeeded;
+        } else {
+            ++failed;
+        }
+    }
+    for (const Running &running : m_running) {
+        if (running.deploymentId == deploymentId) {
+            return; // its final report is still queued
+        }
+    }
+
+    m_deployments.erase(it);
+    emit deploymentFinished(deploymentId, succeeded, failed);
+}
+
+void IpaDeploymentEngine::cancel(quint64 deploymentId)
+{
+    auto it = m_deployments.find(deploymentId);
+    if (it == m_deployments.end()) {
+        return;
+    }
+    it->cancelled = true;
+
+    for (int i = 0; i < m_queue.size();) {
+        if (m_queue[i].deploymentId != deploymentId) {
+            ++i;
+            continue;
+        }
+        const Job job = m_queue.takeAt(i);
+        failDevice(deploymentId, QString::fromStdString(job.device->udid),
+                   "Cancelled");
+    }
+    finishIfDone(deploymentId);
+}
+
+QList<IpaDeviceStatus>
+IpaDeploymentEngine::deviceStatus(quint64 deploymentId) const
+{
+    auto it = m_deployments.constFind(deploymentId);
+    return it == m_deployments.constEnd() ? QList<IpaDeviceStatus>()
+                                          : it->devices;
+}
+
+double IpaDeploymentEngine::progress(quint64 deploymentId) const
+{
+    auto it = m_deployments.constFind(deploymentId);
+    if (it == m_deployments.constEnd() || it->devices.isEmpty()) {
+        return 0.0;
+    }
+    double sum = 0.0;
+    for (const IpaDeviceStatus &status : it->devices) {
+        sum += status.progress();
+    }
+    return sum / it->devices.size();
+}
+
+QFuture<void> IpaDeploymentEngine::removeDevice(const std::string &udid)
+{
+    const QString key = QString::fromStdString(udid);
+
+    // Deployments still reading the archive
+    QList<quint64> affected;
+    for (auto it = m_deployments.begin(); it != m_deployments.end(); ++it) {
+        for (int i = 0; i < it->waiting.size(); ++i) {
+            if (it->waiting[i]->udid == udid) {
+                it->waiting.removeAt(i);
+                affected.append(it.key());
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < m_queue.size();) {
+        if (m_queue[i].device->udid != udid) {
+            ++i;
+            continue;
+        }
+        affected.append(m_queue.takeAt(i).deploymentId);
+    }
+
+    for (quint64 deploymentId : affected) {
+        failDevice(deploymentId, key, "Device disconnected");
+    }
+
+    for (quint64 deploymentId : affected) {
+        finishIfDone(deploymentId);
+    }
+
+    // The install stops at its next abort check and is not retried,
+    // onJobFinished cleans up after it
+    auto running = m_running.find(key);
+    if (running == m_running.end()) {
+        return QFuture<void>();
+    }
+    running->cancelled->store(true);
+    return running->future;
+}
+
+QString IpaDeploymentEngine::cachePath(const QByteArray &hash) const
+{
+    return QDir(m_cacheDirectory)
+        .filePath(QString::fromLatin1(hash.toHex()) + ".json");
+}
+
+std::shared_ptr<const IpaMetadata>
+IpaDeploymentEngine::cachedMetadata(const QByteArray &hash)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        auto it = m_metadataCache.constFind(hash);
+        if (it != m_metadataCache.constEnd()) {
+            return it.value();
+        }
+    }
+
+    QFile file(cachePath(hash));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+    const QJsonObject json = QJsonDocument::fromJson(file.readAll()).object();
+    IpaMetadata metadata;
+    metadata.bundleIdentifier =
+        json.value("bundleIdentifier").toString().toStdString();
+    metadata.bundleExecutable =
+        json.value("bundleExecutable").toString().toStdString();
+    metadata.sinf =
+        QByteArray::fromBase64(json.value("sinf").toString().toLatin1());
+    metadata.iTunesMetadata = QByteArray::fromBase64(
+        json.value("iTunesMetadata").toString().toLatin1());
+    if (metadata.bundleIdentifier.empty() ||
+        metadata.bundleExecutable.empty()) {
+        return nullptr;
+    }
+
+    auto shared = std::make_shared<const IpaMetadata>(std::move(metadata));
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    m_metadataCache.insert(hash, shared);
+    return shared;
+}
+
+void IpaDeploymentEngine::storeMetadata(
+    const QByteArray &hash, std::shared_ptr<const IpaMetadata> metadata)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        m_metadataCache.insert(hash, metadata);
+    }
+
+    QJsonObject json;
+    json["bundleIdentifier"] =
+        QString::fromStdString(metadata->bundleIdentifier);
+    json["bundleExecutable"] =
+        QString::fromStdString(metadata->bundleExecutable);
+    json["sinf"] = QString::fromLatin1(metadata->sinf.toBase64());
+    json["iTunesMetadata"] =
+        QString::fromLatin1(metadata->iTunesMetadata.toBase64());
+
+    QSaveFile file(cachePath(hash));
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(QJsonDocument(json).toJson(QJsonDocument::Compact)) < 0 ||
+        !file.commit()) {
+        qWarning() << "IpaDeploymentEngine: could not cache metadata in"
+                   << file.fileName();
+    }
+}
@@ -0,0 +1,181 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IPADEPLOYMENTENGINE_H
+#define IPADEPLOYMENTENGINE_H
+
+#include "iDescriptor.h"
+#include <QFuture>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QQueue>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+// Devices installed to at the same time, each device gets one install at a
+// time
+#define IPA_DEPLOY_MAX_PARALLEL_DEVICES 4
+// Attempts per device for transient AFC and installation_proxy errors
+#define IPA_DEPLOY_MAX_ATTEMPTS 3
+#define IPA_DEPLOY_RETRY_DELAY_MS 2000
+// Share of a device's progress taken by the upload, the rest is installd
+#define IPA_DEPLOY_UPLOAD_WEIGHT 0.8
+
+enum class IpaDeployState {
+    Pending,
+    Uploading,
+    Installing,
+    Retrying,
+    Succeeded,
+    Failed
+};
+
+struct IpaDeviceStatus {
+    QString udid;
+    QString deviceName;
+    IpaDeployState state = IpaDeployState::Pending;
+    quint64 uploadedBytes = 0;
+    quint64 totalBytes = 0;
+    int installPercent = 0;
+    int attempt = 0;
+    QString error;
+
+    bool isFinished() const
+    {
+        return state == IpaDeployState::Succeeded ||
+               state == IpaDeployState::Failed;
+    }
+    // 0 to 1, upload and install weighted by IPA_DEPLOY_UPLOAD_WEIGHT
+    double progress() const;
+};
+
+/**
+ * @brief Installs one IPA on many devices at once
+ *
+ * The archive is hashed and its metadata read once per deployment. Metadata is
+ * cached in memory and on disk keyed by the SHA-256 of the archive, so
+ * deploying the same file again skips parsing it. Every device then gets its
+ * own upload over a leased AFC client, at most IPA_DEPLOY_MAX_PARALLEL_DEVICES
+ * at a time and never two on the same device. Transient failures are retried
+ * up to IPA_DEPLOY_MAX_ATTEMPTS times.
+ *
+ * Must only be used from the GUI thread, all signals are emitted there.
+ */
+class IpaDeploymentEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    static IpaDeploymentEngine *sharedInstance();
+
+    // Returns the id of the new deployment, 0 if there is nothing to deploy
+    quint64 deploy(const QString &ipaPath,
+                   const QList<iDescriptorDevice *> &devices);
+    // Devices that did not start yet are skipped, running installs finish
+    void cancel(quint64 deploymentId);
+
+    QList<IpaDeviceStatus> deviceStatus(quint64 deploymentId) const;
+    // Average over all devices of the deployment, 0 to 1
+    double progress(quint64 deploymentId) const;
+
+    /*
+     * Aborts a running install without waiting for it. The device must not be
+     * freed before the returned future has finished.
+     */
+    QFuture<void> removeDevice(const std::string &udid);
+
+signals:
+    void metadataReady(quint64 deploymentId, bool success,
+                       const QString &bundleIdOrError);
+    void deviceStatusChanged(quint64 deploymentId,
+                             const IpaDeviceStatus &status);
+    void progressChanged(quint64 deploymentId, double progress);
+    void deploymentFinished(quint64 deploymentId, int succeeded, int failed);
+
+private:
+    struct Job {
+        quint64 deploymentId = 0;
+        iDescriptorDevice *device = nullptr;
+    };
+
+    struct Running {
+        quint64 deploymentId = 0;
+        QFuture<void> future;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+    };
+
+    struct Deployment {
+        QString ipaPath;
+        QFuture<void> preparing;
+        std::shared_ptr<const IpaMetadata> metadata;
+        // Devices waiting for the metadata, before they are queued as jobs
+        QList<iDescriptorDevice *> waiting;
+        bool cancelled = false;
+        QList<IpaDeviceStatus> devices;
+    };
+
+    explicit IpaDeploymentEngine(QObject *parent = nullptr);
+    ~IpaDeploymentEngine();
+
+    void prepare(quint64 deploymentId, const QString &ipaPath);
+    void onPrepared(quint64 deploymentId,
+                    std::shared_ptr<const IpaMetadata> metadata,
+                    const QString &error);
+    void schedule();
+    void startJob(const Job &job);
+    void updateStatus(quint64 deploymentId, const IpaDeviceStatus &status);
+    void onJobFinished(quint64 deploymentId, const QString &udid);
+    void finishIfDone(quint64 deploymentId);
+
+    // Runs on the pool
+    static void installOnDevice(
+        iDescriptorDevice *device, const QString &ipaPath,
+        std::shared_ptr<const IpaMetadata> metadata,
+        std::shared_ptr<std::atomic<bool>> cancelled, IpaDeviceStatus status,
+        const std::function<void(const IpaDeviceStatus &)> &report);
+    static bool isTransient(instproxy_error_t error);
+    static QString errorString(instproxy_error_t error);
+    void failDevice(quint64 deploymentId, const QString &udid,
+                    const QString &error);
+
+    // Metadata cache, safe to use from any thread
+    std::shared_ptr<const IpaMetadata> cachedMetadata(const QByteArray &hash);
+    void storeMetadata(const QByteArray &hash,
+                       std::shared_ptr<const IpaMetadata> metadata);
+    QString cachePath(const QByteArray &hash) const;
+
+    QThreadPool m_pool;
+    QHash<quint64, Deployment> m_deployments;
+    QQueue<Job> m_queue;
+    // Keyed by device udid, one install per device at a time
+    QHash<QString, Running> m_running;
+    quint64 m_nextDeploymentId = 1;
+
+    const QString m_cacheDirectory;
+    mutable std::mutex m_cacheMutex;
+    QHash<QByteArray, std::shared_ptr<const IpaMetadata>> m_metadataCache;
+};
+
+#endif // IPADEPLOYMENTENGINE_H
@@ -22,6 +22,7 @@
 #include "devdiskimagehelper.h"
 #include "devdiskmanager.h"
 #include "iDescriptor.h"
+#include "servicesessioncache.h"
 #include <QDebug>
 #include <QLabel>
 #include <QMessageBox>
@@ -33,8 +34,8 @@
 #include <libimobiledevice/screenshotr.h>
 // todo add a retry button when failed
 LiveScreenWidget::LiveScreenWidget(iDescriptorDevice *device, QWidget *parent)
-    : QWidget{parent}, m_device(device), m_timer(nullptr),
-      m_shotrClient(nullptr), m_fps(20)
+    : QWidget{parent}, m_device(device), m_pipeline(nullptr),
+      m_metricsLabel(nullptr), m_fps(20)
 {
     setWindowTitle("Live Screen - iDescriptor");
 
@@ -55,6 +56,9 @@ LiveScreenWidget::LiveScreenWidget(iDescriptorDevice *device, QWidget *parent)
     connect(AppContext::sharedInstance(), &AppContext::deviceRemoved, this,
             [this, device](const std::string &removed_uuid) {
                 if (device->udid == removed_uuid) {
+                    // The capture thread must be done with the device before
+                    // it gets freed
+                    stopCapturing();
                     this->close();
                     this->deleteLater();
                 }
@@ -77,11 +81,18 @@ LiveScreenWidget::LiveScreenWidget(iDescriptorDevice *device, QWidget *parent)
     m_imageLabel->setFrameStyle(QFrame::Box | QFrame::Plain);
     mainLayout->addWidget(m_imageLabel, 1);
 
-    // Timer for periodic screenshots
-    m_timer = new QTimer(this);
-    m_timer->setInterval(1000 / m_fps);
-    connect(m_timer, &QTimer::timeout, this,
+    // Capture statistics
+    m_metricsLabel = new QLabel();
+    m_metricsLabel->setAlignment(Qt::AlignCenter);
+    m_metricsLabel->setStyleSheet("color: #666; font-size: 12px;");
+    mainLayout->addWidget(m_metricsLabel);
+
+    // Screenshots are captured and decoded on worker threads
+    m_pipeline = new ScreenCapturePipeline(this);
+    connect(m_pipeline, &ScreenCapturePipeline::frameAvailable, this,
             &LiveScreenWidget::updateScreenshot);
+    connect(m_pipeline, &ScreenCapturePipeline::metricsChanged, this,
+            &LiveScreenWidget::updateMetrics);
 
     // Defer the initialization to allow the main widget to show first
     QTimer::singleShot(0, this, &LiveScreenWidget::startInitialization);
@@ -116,130 +127,85 @@ void LiveScreenWidget::startInitialization()
     helper->start();
 }
 
-LiveScreenWidget::~LiveScreenWidget()
-{
-    if (m_timer) {
-        m_timer->stop();
-    }
-
-    if (m_shotrClient) {
-        screenshotr_client_free(m_shotrClient);
-        m_shotrClient = nullptr;
-    }
-}
+LiveScreenWidget::~LiveScreenWidget() { stopCapturing(); }
 
 bool LiveScreenWidget::initializeScreenshotService(bool notify)
 {
-    lockdownd_client_t lockdownClient = nullptr;
-    lockdownd_service_descriptor_t service = nullptr;
-
-    try {
-        m_statusLabel->setText("Connecting to screenshot service...");
-
-        lockdownd_error_t ldret = lockdownd_client_new_with_handshake(
-            m_device->device, &lockdownClient, APP_LABEL);
-
-        if (ldret != LOCKDOWN_E_SUCCESS) {
-            m_statusLabel->setText("Failed to connect to lockdown service");
-            if (notify)
-                QMessageBox::critical(this, "Connection Failed",
-                                      "Could not connect to lockdown service.\n"
-                                      "Error code: " +
-                                          QString::number(ldret));
-            return false;
-        }
-
-        lockdownd_error_t lerr = lockdownd_start_service(
-            lockdownClient, SCREENSHOTR_SERVICE_NAME, &service);
-
-        lockdownd_client_free(lockdownClient);
-        lockdownClient = nullptr;
-
-        if (lerr != LOCKDOWN_E_SUCCESS) {
-            m_statusLabel->setText("Failed to start screenshot service");
-            qDebug() << lerr << "lockdownd_start_service";
-            if (notify)
-                QMessageBox::critical(
-                    this, "Service Failed",
-                    "Could not start screenshot service on device.\n"
-                    "Please ensure the developer disk image is properly "
-                    "mounted.");
-            if (service) {
-                lockdownd_service_descriptor_free(service);
-            }
-            return false;
-        }
-
-        screenshotr_error_t screrr =
-            screenshotr_client_new(m_device->device, service, &m_shotrClient);
-
-        lockdownd_service_descriptor_free(service);
-        service = nullptr;
-        qDebug() << screrr << "screenshotr_client_new";
-        if (screrr != SCREENSHOTR_E_SUCCESS) {
-            m_statusLabel->setText("Failed to create screenshot client");
-            if (notify)
-                QMessageBox::critical(this, "Client Failed",
-                                      "Could not create screenshot client.\n"
-                                      "Error code: " +
-                                          QString::number(screrr));
-            return false;
-        }
-
-        // Successfully initialized, start capturing
-        m_statusLabel->setText("Capturing");
-        startCapturing();
-        return true;
-    } catch (const std::exception &e) {
-        m_statusLabel->setText("Exception occurred");
+    m_statusLabel->setText("Connecting to screenshot service...");
+
+    // Starts the cached screenshotr session the capture thread will reuse
+    const bool connected =
+        ServiceSessionCache::sharedInstance()->withScreenshotr(
+            m_device, [](screenshotr_client_t) { return true; });
+    if (!connected) {
+        m_statusLabel->setText("Failed to start screenshot service");
         if (notify)
             QMessageBox::critical(
-                this, "Exception",
-                QString("Exception occurred: %1").arg(e.what()));
-
-        if (lockdownClient) {
-            lockdownd_client_free(lockdownClient);
-        }
-        if (service) {
-            lockdownd_service_descriptor_free(service);
-        }
+                this, "Service Failed",
+                "Could not start screenshot service on device.\n"
+                "Please ensure the developer disk image is properly "
+                "mounted.");
+        return false;
     }
+
+    // Successfully initialized, start capturing
+    m_statusLabel->setText("Capturing");
+    startCapturing();
+    return true;
 }
 
 void LiveScreenWidget::startCapturing()
 {
-    if (!m_shotrClient) {
-        qWarning()
-            << "Cannot start capturing: screenshot client not initialized";
-        return;
+    m_pipeline->setDisplaySize(m_imageLabel->contentsRect().size());
+    m_pipeline->start(m_device, m_fps);
+    qDebug() << "Started capturing";
+}
+
+void LiveScreenWidget::stopCapturing()
+{
+    if (m_pipeline) {
+        m_pipeline->stop();
     }
+}
 
-    if (m_timer) {
-        m_timer->start();
-        qDebug() << "Started capturing";
+ScreenCaptureMetrics LiveScreenWidget::metrics() const
+{
+    return m_pipeline ? m_pipeline->metrics() : ScreenCaptureMetrics();
+}
+
+void LiveScreenWidget::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    if (m_pipeline && m_imageLabel) {
+        m_pipeline->setDisplaySize(m_imageLabel->contentsRect().size());
     }
 }
 
 void LiveScreenWidget::updateScreenshot()
 {
-    if (!m_shotrClient) {
-        qWarning() << "Screenshot client not initialized";
+    // Already decoded and scaled to the label on the pipeline's threads
+    QImage image = m_pipeline->takeLatestFrame();
+    if (image.isNull()) {
         return;
     }
+    m_imageLabel->setPixmap(QPixmap::fromImage(std::move(image)));
+}
 
-    try {
-        TakeScreenshotResult result = take_screenshot(m_shotrClient);
-
-        if (result.success && !result.img.isNull()) {
-            QPixmap pixmap = QPixmap::fromImage(result.img);
-            m_imageLabel->setPixmap(pixmap.scaled(m_imageLabel->size(),
-                                                  Qt::KeepAspectRatio,
-                                                  Qt::SmoothTransformation));
-        } else {
-            qWarning() << "Failed to capture screenshot";
-        }
-    } catch (const std::exception &e) {
-        qWarning() << "Exception in updateScreenshot:" << e.what();
-        m_statusLabel->setText("Error capturing screenshot");
+void LiveScreenWidget::updateMetrics()
+{
+    ScreenCaptureMetrics metrics = m_pipeline->metrics();
+    QString text =
+        QString("%1 fps (target %2) | capture %3 ms | decode %4 ms | "
+                "%5 dropped")
+            .arg(metrics.effectiveFps, 0, 'f', 1)
+            .arg(metrics.targetFps)
+            .arg(metrics.captureLatencyMs, 0, 'f', 0)
+            .arg(metrics.decodeTimeMs, 0, 'f', 0)
+            .arg(metrics.framesDropped);
+    if (metrics.consecutiveErrors > 0) {
+        text += QString(" | %1 failed captures, retrying every %2 ms")
+                    .arg(metrics.consecutiveErrors)
+                    .arg(metrics.pacedIntervalMs, 0, 'f', 0);
     }
+    m_metricsLabel->setText(text);
 }
@@ -21,7 +21,9 @@
 #define LIVESCREEN_H
 
 #include "iDescriptor.h"
+#include "screencapturepipeline.h"
 #include <QLabel>
+#include <QResizeEvent>
 #include <QTimer>
 #include <QWidget>
 #include <libimobiledevice/libimobiledevice.h>
@@ -35,16 +37,26 @@ public:
                               QWidget *parent = nullptr);
     ~LiveScreenWidget();
 
+    // Capture latency, decode time and effective frame rate of the stream
+    ScreenCaptureMetrics metrics() const;
+
+protected:
+    void resizeEvent(QResizeEvent *event) override;
+
+private slots:
+    void updateScreenshot();
+    void updateMetrics();
+
 private:
     bool initializeScreenshotService(bool notify);
-    void updateScreenshot();
     void startCapturing();
+    void stopCapturing();
 
     iDescriptorDevice *m_device;
-    QTimer *m_timer;
+    ScreenCapturePipeline *m_pipeline;
     QLabel *m_imageLabel;
     QLabel *m_statusLabel;
-    screenshotr_client_t m_shotrClient;
+    QLabel *m_metricsLabel;
     int m_fps;
 
 private:
@@ -20,28 +20,37 @@
 #ifndef MEDIASTREAMER_H
 #define MEDIASTREAMER_H
 
+#include "afcinputstream.h"
+#include "httpconnections.h"
 #include "iDescriptor.h"
-#include <QMap>
-#include <QMutex>
 #include <QTcpServer>
 #include <QUrl>
+#include <atomic>
 #include <libimobiledevice/afc.h>
-
-QT_BEGIN_NAMESPACE
-class QTcpSocket;
-QT_END_NAMESPACE
+#include <memory>
+
+// Blocks of AFC_STREAM_BLOCK_SIZE kept per streamer, shared by all of its
+// connections so scrubbing back over a video is served from memory
+#define MEDIA_STREAMER_CACHE_BLOCKS 128
+// Stop pulling from the device while a socket has this much queued
+#define MEDIA_STREAMER_SOCKET_BUFFER (1024 * 1024)
+// Idle keep-alive connections are closed after this long
+#define MEDIA_STREAMER_KEEP_ALIVE_MS 15000
+// Requests with larger headers are rejected
+#define MEDIA_STREAMER_MAX_HEADER_SIZE (16 * 1024)
 
 /**
  * @brief A lightweight HTTP server for streaming media files from iOS devices
  *
  * This class implements an HTTP server that supports:
- * - Basic HTTP GET requests
- * - HTTP Range requests for video scrubbing
- * - Streaming from AFC (Apple File Conduit) without loading entire file into
- * memory
- * - Thread-safe operation
+ * - HTTP GET and HEAD requests with keep-alive and pipelining
+ * - HTTP Range requests for video scrubbing, on several connections at once
+ * - Streaming from AFC (Apple File Conduit) through one AfcInputStream whose
+ *   LRU block cache and sequential read-ahead are shared by all connections
  *
- * The server automatically shuts down when the client disconnects.
+ * A streamer lives on its own I/O thread, MediaStreamerManager moves it
+ * there and calls start(). Everything but getUrl() and isListening() must
+ * run on that thread.
  */
 class MediaStreamer : public QTcpServer
 {
@@ -52,6 +61,12 @@ public:
                            const QString &filePath, QObject *parent = nullptr);
     ~MediaStreamer();
 
+    /**
+     * @brief Start listening on localhost, call on the streamer's thread
+     * @return true if the server is listening
+     */
+    bool start();
+
     /**
      * @brief Get the URL that clients should use to connect to this server
      * @return URL in format http://127.0.0.1:port
@@ -67,54 +82,24 @@ public:
 protected:
     void incomingConnection(qintptr socketDescriptor) override;
 
-private slots:
-    void handleClientDisconnected();
-
 private:
-    struct HttpRequest {
-        QString method;
-        QString path;
-        QString httpVersion;
-        QMap<QString, QString> headers;
-        bool hasRange = false;
-        qint64 rangeStart = 0;
-        qint64 rangeEnd = -1;
-    };
-
-    struct StreamingContext {
-        QTcpSocket *socket;
-        iDescriptorDevice *device;
-        QString filePath;
-        qint64 startByte;
-        qint64 endByte;
-        qint64 bytesRemaining;
-        uint64_t afcHandle;
-    };
-
-    HttpRequest parseHttpRequest(const QByteArray &requestData);
     void handleRequest(QTcpSocket *socket, const HttpRequest &request);
-    void sendErrorResponse(QTcpSocket *socket, int statusCode,
-                           const QString &statusText);
-    void streamFileRange(QTcpSocket *socket, qint64 startByte, qint64 endByte);
-    void streamNextChunk(StreamingContext *context);
-    void cleanupStreamingContext(StreamingContext *context);
-    qint64 getFileSize();
+    bool ensureStream();
     QString getMimeType() const;
 
     // Core data
     iDescriptorDevice *m_device;
+    afc_client_t m_afcClient;
     QString m_filePath;
 
-    // File info cache
-    mutable QMutex m_fileSizeMutex;
-    mutable qint64 m_cachedFileSize;
-    mutable bool m_fileSizeCached;
+    // Opened on the first request and kept for the streamer's lifetime
+    std::unique_ptr<AfcInputStream> m_stream;
 
-    // Connection management
-    QList<QTcpSocket *> m_activeConnections;
-    QMutex m_connectionsMutex;
+    HttpConnections *m_http;
 
-    afc_client_t m_afcClient;
+    // Written once by start(), read from any thread
+    QUrl m_url;
+    std::atomic<bool> m_listening{false};
 };
 
-#endif // MEDIASTREAMER_H
\ No newline at end of file
+#endif // MEDIASTREAMER_H
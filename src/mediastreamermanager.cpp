@@ -49,27 +49,36 @@ QUrl MediaStreamerManager::getStreamUrl(iDescriptorDevice *device,
             // Clean up invalid streamer
             qDebug() << "MediaStreamerManager: Cleaning up invalid streamer for"
                      << filePath;
-            if (it->streamer) {
-                it->streamer->deleteLater();
-            }
+            destroyStreamer(*it);
             m_streamers.erase(it);
         }
     }
 
-    // Create new streamer without a QObject parent
-    auto *streamer = new MediaStreamer(device, afcClient, filePath, nullptr);
-    if (!streamer->isListening()) {
+    // Create new streamer without a QObject parent and hand it to its own
+    // I/O thread, its sockets and AFC reads never touch the GUI thread
+    StreamerInfo info;
+    info.streamer = new MediaStreamer(device, afcClient, filePath, nullptr);
+    info.thread = new QThread();
+    info.thread->setObjectName("MediaStreamer I/O");
+    info.device = device;
+    info.refCount = 1;
+
+    info.streamer->moveToThread(info.thread);
+    info.thread->start();
+
+    MediaStreamer *streamer = info.streamer;
+    bool listening = false;
+    QMetaObject::invokeMethod(
+        streamer, [streamer, &listening]() { listening = streamer->start(); },
+        Qt::BlockingQueuedConnection);
+    if (!listening) {
         qWarning() << "MediaStreamerManager: Failed to create streamer for"
                    << filePath;
-        delete streamer;
+        destroyStreamer(info);
         return QUrl();
     }
 
     // Store the streamer info
-    StreamerInfo info;
-    info.streamer = streamer;
-    info.device = device;
-    info.refCount = 1;
     m_streamers[filePath] = info;
 
     qDebug() << "MediaStreamerManager: Created new streamer for" << filePath
@@ -87,12 +96,11 @@ void MediaStreamerManager::releaseStreamer(const QString &filePath)
         qDebug() << "MediaStreamerManager: Released streamer for" << filePath
                  << "refCount:" << it->refCount;
 
-        // If no more references, delete it immediately.
-        // deleteLater() will not work in a thread without an event loop.
+        // If no more references, delete it immediately
         if (it->refCount <= 0) {
             qDebug() << "MediaStreamerManager: Deleting streamer for"
                      << filePath;
-            delete it->streamer;
+            destroyStreamer(*it);
             m_streamers.erase(it);
         }
     }
@@ -105,9 +113,22 @@ void MediaStreamerManager::cleanup()
     while (it != m_streamers.end()) {
         qDebug() << "MediaStreamerManager: Cleaning up streamer for"
                  << it.key();
-        if (it->streamer) {
-            delete it->streamer;
-        }
+        destroyStreamer(*it);
         it = m_streamers.erase(it);
     }
-}
\ No newline at end of file
+}
+
+void MediaStreamerManager::destroyStreamer(const StreamerInfo &info)
+{
+    // The streamer's sockets belong to its thread, delete it there
+    MediaStreamer *streamer = info.streamer;
+    if (streamer) {
+        QMetaObject::invokeMethod(
+            streamer, [streamer]() { delete streamer; },
+            Qt::BlockingQueuedConnection);
+    }
+
+    info.thread->quit();
+    info.thread->wait();
+    delete info.thread;
+}
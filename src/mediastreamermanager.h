@@ -25,6 +25,7 @@
 #include <QMap>
 #include <QMutex>
 #include <QObject>
+#include <QThread>
 #include <QUrl>
 #include <libimobiledevice/afc.h>
 
@@ -32,8 +33,8 @@
  * @brief Singleton manager for MediaStreamer instances
  *
  * This class manages MediaStreamer instances to avoid creating multiple
- * streamers for the same file. It automatically cleans up unused streamers
- * and provides thread-safe access.
+ * streamers for the same file. Each streamer gets its own I/O thread. It
+ * automatically cleans up unused streamers and provides thread-safe access.
  */
 class MediaStreamerManager
 {
@@ -70,10 +71,14 @@ private:
 private:
     struct StreamerInfo {
         MediaStreamer *streamer;
+        // I/O thread the streamer runs on, keeps device reads off the GUI
+        QThread *thread;
         iDescriptorDevice *device;
         int refCount;
     };
 
+    static void destroyStreamer(const StreamerInfo &info);
+
     static MediaStreamerManager *s_instance;
     static QMutex s_instanceMutex;
 
@@ -22,6 +22,7 @@
 #include <QApplication>
 #include <QDateTime>
 #include <QFileInfo>
+#include <QLocale>
 #include <QMessageBox>
 #include <QNetworkInterface>
 #include <QPainter>
@@ -228,11 +229,18 @@ void PhotoImportDialog::onServerStarted()
 }
 
 void PhotoImportDialog::onDownloadProgress(const QString &fileName,
-                                           int bytesDownloaded, int totalBytes)
+                                           qint64 bytesDownloaded,
+                                           qint64 totalBytes)
 {
-    m_progressLabel->setText(QString("Downloaded: %1 (%2 KB)")
-                                 .arg(fileName)
-                                 .arg(bytesDownloaded / 1024));
+    const int percent =
+        totalBytes > 0 ? static_cast<int>(bytesDownloaded * 100 / totalBytes)
+                       : 100;
+    m_progressLabel->setText(
+        QString("Downloading: %1 (%2 of %3, %4%)")
+            .arg(fileName)
+            .arg(QLocale().formattedDataSize(bytesDownloaded))
+            .arg(QLocale().formattedDataSize(totalBytes))
+            .arg(percent));
 }
 
 void PhotoImportDialog::onServerError(const QString &error)
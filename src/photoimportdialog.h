@@ -46,8 +46,8 @@ private slots:
     void init();
     void onServerStarted();
     void onServerError(const QString &error);
-    void onDownloadProgress(const QString &fileName, int bytesDownloaded,
-                            int totalBytes);
+    void onDownloadProgress(const QString &fileName, qint64 bytesDownloaded,
+                            qint64 totalBytes);
     void toggleInstructionMode();
 
 private:
@@ -18,9 +18,11 @@
  */
 
 #include "photomodel.h"
+#include "afcinputstream.h"
 #include "iDescriptor.h"
 #include "mediastreamermanager.h"
 #include "servicemanager.h"
+#include "thumbnailstore.h"
 #include <QDebug>
 #include <QEventLoop>
 #include <QIcon>
@@ -34,6 +36,7 @@
 #include <QVideoFrame>
 #include <QVideoSink>
 #include <QtConcurrent/QtConcurrent>
+#include <algorithm>
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
@@ -75,6 +78,8 @@ void PhotoModel::clear()
 PhotoModel::~PhotoModel()
 {
     qDebug() << "PhotoModel destructor called";
+    cancelPopulation();
+    m_populateFuture.waitForFinished();
     clear();
 }
 
@@ -84,140 +89,71 @@ QPixmap PhotoModel::generateVideoThumbnailFFmpeg(iDescriptorDevice *device,
 {
     QPixmap thumbnail;
 
-    uint64_t fileHandle = 0;
-
-    afc_error_t openResult = ServiceManager::safeAfcFileOpen(
-        device, filePath.toUtf8().constData(), AFC_FOPEN_RDONLY, &fileHandle);
-
-    if (openResult != AFC_E_SUCCESS || fileHandle == 0) {
+    // The stream's block cache absorbs the many small reads and seeks of the
+    // container parser. Released on every return path, which also closes the
+    // AFC file handle.
+    auto stream = std::make_unique<AfcInputStream>(device, filePath);
+    if (!stream->open(QIODevice::ReadOnly) || stream->size() == 0) {
         qWarning() << "Failed to open video file for thumbnail:" << filePath;
         return {};
     }
 
-    // Get file size
-    char **fileInfo = nullptr;
-    afc_error_t infoResult = ServiceManager::safeAfcGetFileInfo(
-        device, filePath.toUtf8().constData(), &fileInfo);
-
-    uint64_t fileSize = 0;
-    if (infoResult == AFC_E_SUCCESS && fileInfo) {
-        for (int i = 0; fileInfo[i]; i += 2) {
-            if (strcmp(fileInfo[i], "st_size") == 0) {
-                fileSize = strtoull(fileInfo[i + 1], nullptr, 10);
-                break;
-            }
-        }
-        afc_dictionary_free(fileInfo);
-    }
-
-    if (fileSize == 0) {
-        ServiceManager::safeAfcFileClose(device, fileHandle);
-        qWarning() << "Invalid video file size for thumbnail:" << filePath;
-        return {};
-    }
-
     // Create custom AVIOContext for reading from device on-demand
     AVFormatContext *formatCtx = avformat_alloc_context();
     if (!formatCtx) {
-        ServiceManager::safeAfcFileClose(device, fileHandle);
         qWarning() << "Failed to allocate format context";
         return {};
     }
 
-    // Context for streaming read from device
-    struct StreamContext {
-        iDescriptorDevice *device;
-        uint64_t fileHandle;
-        uint64_t fileSize;
-        uint64_t currentPos;
-    };
-
-    StreamContext *streamCtx =
-        new StreamContext{device, fileHandle, fileSize, 0};
-
     // Custom read function that reads from device on-demand
     auto readPacket = [](void *opaque, uint8_t *buf, int bufSize) -> int {
-        StreamContext *ctx = static_cast<StreamContext *>(opaque);
-
-        if (ctx->currentPos >= ctx->fileSize) {
+        auto *stream = static_cast<AfcInputStream *>(opaque);
+        if (stream->atEnd()) {
             return AVERROR_EOF;
         }
-
-        uint32_t toRead =
-            std::min(static_cast<uint32_t>(bufSize),
-                     static_cast<uint32_t>(ctx->fileSize - ctx->currentPos));
-        uint32_t bytesRead = 0;
-
-        afc_error_t result = ServiceManager::safeAfcFileRead(
-            ctx->device, ctx->fileHandle, reinterpret_cast<char *>(buf), toRead,
-            &bytesRead);
-
-        if (result != AFC_E_SUCCESS || bytesRead == 0) {
-            return AVERROR(EIO);
-        }
-
-        ctx->currentPos += bytesRead;
-        return static_cast<int>(bytesRead);
+        qint64 bytesRead = stream->read(reinterpret_cast<char *>(buf), bufSize);
+        return bytesRead > 0 ? static_cast<int>(bytesRead) : AVERROR(EIO);
     };
 
-    // Custom seek function using AFC seek
     auto seekPacket = [](void *opaque, int64_t offset, int whence) -> int64_t {
-        StreamContext *ctx = static_cast<StreamContext *>(opaque);
+        auto *stream = static_cast<AfcInputStream *>(opaque);
 
         if (whence == AVSEEK_SIZE) {
-            return static_cast<int64_t>(ctx->fileSize);
+            return stream->size();
         }
 
         int64_t newPos = 0;
-        int seekWhence = SEEK_SET;
-
-        if (whence == SEEK_SET) {
+        switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET:
             newPos = offset;
-            seekWhence = SEEK_SET;
-        } else if (whence == SEEK_CUR) {
-            newPos = static_cast<int64_t>(ctx->currentPos) + offset;
-            seekWhence = SEEK_SET;
-        } else if (whence == SEEK_END) {
-            newPos = static_cast<int64_t>(ctx->fileSize) + offset;
-            seekWhence = SEEK_SET;
-        } else {
-            return -1;
-        }
-
-        if (newPos < 0 || newPos > static_cast<int64_t>(ctx->fileSize)) {
-            return -1;
-        }
-
-        // Use AFC seek
-        afc_error_t result = ServiceManager::safeAfcFileSeek(
-            ctx->device, ctx->fileHandle, newPos, seekWhence);
-
-        if (result != AFC_E_SUCCESS) {
+            break;
+        case SEEK_CUR:
+            newPos = stream->pos() + offset;
+            break;
+        case SEEK_END:
+            newPos = stream->size() + offset;
+            break;
+        default:
             return -1;
         }
 
-        ctx->currentPos = static_cast<uint64_t>(newPos);
-        return newPos;
+        return stream->seek(newPos) ? newPos : -1;
     };
 
     const int avioBufferSize = 32768; // 32KB buffer for streaming
     unsigned char *avioBuffer =
         static_cast<unsigned char *>(av_malloc(avioBufferSize));
     if (!avioBuffer) {
-        delete streamCtx;
-        ServiceManager::safeAfcFileClose(device, fileHandle);
         avformat_free_context(formatCtx);
         return {};
     }
 
     AVIOContext *avioCtx =
-        avio_alloc_context(avioBuffer, avioBufferSize, 0, streamCtx, readPacket,
-                           nullptr, seekPacket);
+        avio_alloc_context(avioBuffer, avioBufferSize, 0, stream.get(),
+                           readPacket, nullptr, seekPacket);
 
     if (!avioCtx) {
         av_free(avioBuffer);
-        delete streamCtx;
-        ServiceManager::safeAfcFileClose(device, fileHandle);
         avformat_free_context(formatCtx);
         return {};
     }
@@ -369,13 +305,9 @@ QPixmap PhotoModel::generateVideoThumbnailFFmpeg(iDescriptorDevice *device,
     avcodec_free_context(&codecCtx);
     avformat_close_input(&formatCtx);
 
-    // Close the AFC file handle
-    ServiceManager::safeAfcFileClose(device, fileHandle);
-
-    // Free AVIO context and stream context
+    // Free AVIO context
     av_free(avioCtx->buffer);
     avio_context_free(&avioCtx);
-    delete streamCtx;
 
     return thumbnail;
 }
@@ -428,7 +360,7 @@ QVariant PhotoModel::data(const QModelIndex &index, int role) const
         if (!m_loadingPaths.contains(info.filePath)) {
             qDebug() << "Starting load for:" << info.fileName;
             emit const_cast<PhotoModel *>(this)->thumbnailNeedsToBeLoaded(
-                index.row());
+                info.filePath);
         }
 
         // Return placeholder while loading
@@ -451,12 +383,16 @@ QVariant PhotoModel::data(const QModelIndex &index, int role) const
     }
 }
 
-void PhotoModel::requestThumbnail(int index)
+void PhotoModel::requestThumbnail(const QString &filePath)
 {
-    if (index < 0 || index >= m_photos.size())
+    auto it = std::find_if(m_photos.begin(), m_photos.end(),
+                           [&filePath](const PhotoInfo &info) {
+                               return info.filePath == filePath;
+                           });
+    if (it == m_photos.end())
         return;
 
-    PhotoInfo &info = m_photos[index];
+    PhotoInfo &info = *it;
     info.thumbnailRequested = true;
 
     if (m_loadingPaths.contains(info.filePath))
@@ -498,9 +434,25 @@ void PhotoModel::requestThumbnail(int index)
                    info.fileName.endsWith(".MP4", Qt::CaseInsensitive) ||
                    info.fileName.endsWith(".M4V", Qt::CaseInsensitive);
 
+    // Thumbnails of files seen before come from the on-disk store, the key
+    // changes whenever the file on the device does
+    QByteArray storeKey;
+    if (info.modificationTime != 0) {
+        storeKey = ThumbnailStore::makeKey(m_device->udid, info.filePath,
+                                           info.fileSize, info.modificationTime,
+                                           m_thumbnailSize);
+    }
+
     QFuture<QPixmap> future;
     if (isVideo) {
-        future = QtConcurrent::run([this, info]() {
+        future = QtConcurrent::run([this, info, storeKey]() {
+            if (!storeKey.isEmpty()) {
+                QImage stored = ThumbnailStore::sharedInstance()->find(storeKey);
+                if (!stored.isNull()) {
+                    return QPixmap::fromImage(stored);
+                }
+            }
+
             // Acquire semaphore FIRST to limit concurrent video processing
             qDebug() << "Waiting for semaphore for:" << info.fileName;
             m_videoThumbnailSemaphore.acquire();
@@ -513,45 +465,86 @@ void PhotoModel::requestThumbnail(int index)
             // Release semaphore
             qDebug() << "Releasing semaphore for:" << info.fileName;
             m_videoThumbnailSemaphore.release();
+
+            if (!storeKey.isEmpty() && !thumbnail.isNull()) {
+                ThumbnailStore::sharedInstance()->insert(storeKey,
+                                                         thumbnail.toImage());
+            }
             return thumbnail;
         });
     } else {
-        future = QtConcurrent::run([info, this]() {
-            return loadThumbnailFromDevice(m_device, info.filePath,
-                                           m_thumbnailSize);
+        future = QtConcurrent::run([info, this, storeKey]() {
+            if (!storeKey.isEmpty()) {
+                QImage stored = ThumbnailStore::sharedInstance()->find(storeKey);
+                if (!stored.isNull()) {
+                    return QPixmap::fromImage(stored);
+                }
+            }
+
+            QPixmap thumbnail = loadThumbnailFromDevice(m_device, info.filePath,
+                                                        m_thumbnailSize);
+            if (!storeKey.isEmpty() && !thumbnail.isNull()) {
+                ThumbnailStore::sharedInstance()->insert(storeKey,
+                                                         thumbnail.toImage());
+            }
+            return thumbnail;
         });
     }
 
     watcher->setFuture(future);
 }
 
+// Reads only the container headers and the embedded thumbnail over AFC
+QImage PhotoModel::loadEmbeddedThumbnail(AfcInputStream *stream,
+                                         const QString &filePath,
+                                         const QSize &size)
+{
+    const bool heic = filePath.endsWith(".HEIC", Qt::CaseInsensitive);
+    const bool jpeg = filePath.endsWith(".JPG", Qt::CaseInsensitive) ||
+                      filePath.endsWith(".JPEG", Qt::CaseInsensitive);
+    if (!heic && !jpeg) {
+        return QImage();
+    }
+
+    return heic ? load_heic_thumbnail(stream, size)
+                : load_jpeg_thumbnail(stream);
+}
+
 // Static function that runs in worker thread
 QPixmap PhotoModel::loadThumbnailFromDevice(iDescriptorDevice *device,
                                             const QString &filePath,
                                             const QSize &size)
 {
-    // Load from device using ServiceManager
-    QByteArray imageData = ServiceManager::safeReadAfcFileToByteArray(
-        device, filePath.toUtf8().constData());
-
-    if (imageData.isEmpty()) {
+    // Decoders pull the bytes they need from the device on demand
+    AfcInputStream stream(device, filePath);
+    if (!stream.open(QIODevice::ReadOnly)) {
         qDebug() << "Could not read from device:" << filePath;
         return {}; // Return empty pixmap on error
     }
 
+    // Most camera files carry a small preview, decoding it avoids pulling
+    // and decoding the full resolution image
+    QImage embedded = loadEmbeddedThumbnail(&stream, filePath, size);
+    if (!embedded.isNull()) {
+        return QPixmap::fromImage(
+            embedded.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    }
+
+    // The same stream serves the full decode, its cached blocks included
+    if (!stream.seek(0)) {
+        qDebug() << "Could not rewind stream for:" << filePath;
+        return {};
+    }
+
     if (filePath.endsWith(".HEIC", Qt::CaseInsensitive)) {
-        qDebug() << "Loading HEIC image from data for:" << filePath;
-        QPixmap img = load_heic(imageData);
+        qDebug() << "Loading HEIC image from stream for:" << filePath;
+        QPixmap img = load_heic(&stream);
         return img.isNull() ? QPixmap()
                             : img.scaled(size, Qt::KeepAspectRatio,
                                          Qt::SmoothTransformation);
     }
 
-    // Use QImageReader for efficient, low-memory scaled loading
-    QBuffer buffer(&imageData);
-    buffer.open(QIODevice::ReadOnly);
-
-    QImageReader reader(&buffer);
+    QImageReader reader(&stream);
     if (reader.canRead()) {
         // This is the key optimization: it decodes a smaller image directly,
         // saving a massive amount of memory.
@@ -564,13 +557,6 @@ QPixmap PhotoModel::loadThumbnailFromDevice(iDescriptorDevice *device,
                  << "Error:" << reader.errorString();
     }
 
-    // Fallback for formats QImageReader might struggle with
-    QPixmap original;
-    if (original.loadFromData(imageData)) {
-        return original.scaled(size, Qt::KeepAspectRatio,
-                               Qt::SmoothTransformation);
-    }
-
     qDebug() << "Could not decode image data for:" << filePath;
     return {};
 }
@@ -578,99 +564,194 @@ QPixmap PhotoModel::loadThumbnailFromDevice(iDescriptorDevice *device,
 QPixmap PhotoModel::loadImage(iDescriptorDevice *device,
                               const QString &filePath)
 {
-    QByteArray imageData = ServiceManager::safeReadAfcFileToByteArray(
-        device, filePath.toUtf8().constData());
-
-    if (imageData.isEmpty()) {
+    AfcInputStream stream(device, filePath);
+    if (!stream.open(QIODevice::ReadOnly)) {
         qDebug() << "Could not read from device:" << filePath;
         return QPixmap(); // Return empty pixmap on error
     }
 
-    if (filePath.endsWith(".HEIC")) {
-        qDebug() << "Loading HEIC image from data for:" << filePath;
-        QPixmap img = load_heic(imageData);
+    if (filePath.endsWith(".HEIC", Qt::CaseInsensitive)) {
+        qDebug() << "Loading HEIC image from stream for:" << filePath;
+        QPixmap img = load_heic(&stream);
         return img.isNull() ? QPixmap() : img;
     }
 
-    QPixmap original;
-    if (!original.loadFromData(imageData)) {
-        qDebug() << "Could not decode image data for:" << filePath;
+    QImageReader reader(&stream);
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qDebug() << "Could not decode image data for:" << filePath
+                 << "Error:" << reader.errorString();
         return QPixmap();
     }
 
-    return original;
+    return QPixmap::fromImage(image);
 }
 
 void PhotoModel::populatePhotoPaths()
 {
-    // TODO:beginResetModel called on PhotoModel(0x600002d12a40) without calling
-    // endResetModel first
     if (m_albumPath.isEmpty()) {
         qDebug() << "No album path set, skipping population";
         return;
     }
 
+    cancelPopulation();
+
+    beginResetModel();
     m_allPhotos.clear();
+    m_photos.clear();
+    endResetModel();
 
-    QByteArray albumPathBytes = m_albumPath.toUtf8();
-    const char *albumPathCStr = albumPathBytes.constData();
+    // The album is listed in the background. Entries are stat'ed in batches
+    // across pooled AFC clients and each batch is published as soon as it
+    // arrives, so large albums become scrollable after the first batch.
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    m_populateCancelled = cancelled;
+
+    iDescriptorDevice *device = m_device;
+    const QString albumPath = m_albumPath;
+    m_populateFuture = QtConcurrent::run([this, device, albumPath,
+                                          cancelled]() {
+        bool success = ServiceManager::safeListDirectory(
+            device, albumPath.toStdString(),
+            [this, cancelled](const std::vector<MediaEntry> &batch) {
+                QMetaObject::invokeMethod(
+                    this,
+                    [this, batch, cancelled]() {
+                        if (!cancelled->load()) {
+                            appendEntries(batch);
+                        }
+                    },
+                    Qt::QueuedConnection);
+            },
+            std::nullopt, cancelled.get());
 
-    char **albumInfo = nullptr;
-    afc_error_t infoResult =
-        ServiceManager::safeAfcGetFileInfo(m_device, albumPathCStr, &albumInfo);
-    if (infoResult != AFC_E_SUCCESS) {
-        qDebug() << "Album path does not exist or cannot be accessed:"
-                 << m_albumPath << "Error:" << infoResult;
-        return;
+        if (cancelled->load()) {
+            return;
+        }
+        if (!success) {
+            qDebug() << "Failed to read photo directory:" << albumPath;
+        }
+    });
+}
+
+void PhotoModel::cancelPopulation()
+{
+    if (m_populateCancelled) {
+        m_populateCancelled->store(true);
+        m_populateCancelled.reset();
     }
-    if (albumInfo) {
-        afc_dictionary_free(albumInfo);
+}
+
+void PhotoModel::appendEntries(const std::vector<MediaEntry> &entries)
+{
+    QList<PhotoInfo> visible;
+    for (const MediaEntry &entry : entries) {
+        if (entry.isDir) {
+            continue;
+        }
+        QString fileName = QString::fromStdString(entry.name);
+        if (fileName.endsWith(".JPG", Qt::CaseInsensitive) ||
+            fileName.endsWith(".PNG", Qt::CaseInsensitive) ||
+            fileName.endsWith(".HEIC", Qt::CaseInsensitive) ||
+            fileName.endsWith(".MOV", Qt::CaseInsensitive) ||
+            fileName.endsWith(".MP4", Qt::CaseInsensitive) ||
+            fileName.endsWith(".M4V", Qt::CaseInsensitive)) {
+
+            PhotoInfo info;
+            info.filePath = m_albumPath + "/" + fileName;
+            info.fileName = fileName;
+            info.thumbnailRequested = false;
+            info.fileType = determineFileType(fileName);
+            info.fileSize = static_cast<qint64>(entry.size);
+            info.modificationTime = entry.modificationTime;
+            info.dateTime = extractDateTime(entry, info.filePath);
+
+            m_allPhotos.append(info);
+            if (matchesFilter(info)) {
+                visible.append(info);
+            }
+        }
     }
 
-    // Fix: Store the QByteArray to keep the C string valid
-    QByteArray photoDirBytes = m_albumPath.toUtf8();
-    const char *photoDir = photoDirBytes.constData();
-    qDebug() << "Photo directory:" << m_albumPath;
-    qDebug() << "Photo directory C string:" << photoDir;
+    sortPhotos(visible);
+    insertSorted(visible);
+}
 
-    // Use ServiceManager for thread-safe AFC operations
-    char **files = nullptr;
-    afc_error_t readResult =
-        ServiceManager::safeAfcReadDirectory(m_device, photoDir, &files);
-    if (readResult != AFC_E_SUCCESS) {
-        qDebug() << "Failed to read photo directory:" << photoDir
-                 << "Error:" << readResult;
+void PhotoModel::insertSorted(QList<PhotoInfo> &photos)
+{
+    if (photos.isEmpty()) {
         return;
     }
 
-    if (files) {
-        for (int i = 0; files[i]; i++) {
-            QString fileName = QString::fromUtf8(files[i]);
-            if (fileName.endsWith(".JPG", Qt::CaseInsensitive) ||
-                fileName.endsWith(".PNG", Qt::CaseInsensitive) ||
-                fileName.endsWith(".HEIC", Qt::CaseInsensitive) ||
-                fileName.endsWith(".MOV", Qt::CaseInsensitive) ||
-                fileName.endsWith(".MP4", Qt::CaseInsensitive) ||
-                fileName.endsWith(".M4V", Qt::CaseInsensitive)) {
-
-                PhotoInfo info;
-                info.filePath = m_albumPath + "/" + fileName;
-                info.fileName = fileName;
-                info.thumbnailRequested = false;
-                info.fileType = determineFileType(fileName);
-                info.dateTime = extractDateTimeFromFile(info.filePath);
-
-                m_allPhotos.append(info);
+    // Row each new photo lands on, new photos go after equal existing ones
+    QList<qsizetype> positions;
+    positions.reserve(photos.size());
+    int groups = 0;
+    for (const PhotoInfo &info : photos) {
+        qsizetype position =
+            std::upper_bound(m_photos.begin(), m_photos.end(), info,
+                             [this](const PhotoInfo &a, const PhotoInfo &b) {
+                                 return lessThan(a, b);
+                             }) -
+            m_photos.begin();
+        if (positions.isEmpty() || positions.last() != position) {
+            ++groups;
+        }
+        positions.append(position);
+    }
+
+    if (groups <= PHOTO_MODEL_MAX_INSERT_GROUPS) {
+        // Usual case, the directory order follows the capture order and a
+        // batch lands in one block at either end. Insert blocks back to front
+        // so the positions of earlier blocks stay valid.
+        qsizetype end = photos.size();
+        while (end > 0) {
+            const qsizetype position = positions[end - 1];
+            qsizetype begin = end - 1;
+            while (begin > 0 && positions[begin - 1] == position) {
+                --begin;
+            }
+            const qsizetype count = end - begin;
+
+            beginInsertRows(QModelIndex(), position, position + count - 1);
+            m_photos.insert(position, count, PhotoInfo());
+            for (qsizetype i = 0; i < count; ++i) {
+                m_photos[position + i] = std::move(photos[begin + i]);
             }
+            endInsertRows();
+            end = begin;
         }
-        afc_dictionary_free(files);
+        return;
     }
 
-    // Apply initial filtering and sorting, which will also reset the model
-    applyFilterAndSort();
+    // Scattered batch, merge it in one pass and move the persistent indexes
+    emit layoutAboutToBeChanged();
 
-    qDebug() << "Loaded" << m_allPhotos.size() << "media files from device";
-    qDebug() << "After filtering:" << m_photos.size() << "items shown";
+    QList<PhotoInfo> merged;
+    merged.reserve(m_photos.size() + photos.size());
+    QList<qsizetype> newRows(m_photos.size());
+    qsizetype next = 0;
+    for (qsizetype i = 0; i < m_photos.size(); ++i) {
+        while (next < photos.size() && lessThan(photos[next], m_photos[i])) {
+            merged.append(std::move(photos[next++]));
+        }
+        newRows[i] = merged.size();
+        merged.append(std::move(m_photos[i]));
+    }
+    while (next < photos.size()) {
+        merged.append(std::move(photos[next++]));
+    }
+    m_photos = std::move(merged);
+
+    const QModelIndexList from = persistentIndexList();
+    QModelIndexList to;
+    to.reserve(from.size());
+    for (const QModelIndex &index : from) {
+        to.append(createIndex(newRows[index.row()], index.column()));
+    }
+    changePersistentIndexList(from, to);
+
+    emit layoutChanged();
 }
 
 // Sorting and filtering methods
@@ -716,16 +797,21 @@ void PhotoModel::applyFilterAndSort()
              << m_allPhotos.size() << "items";
 }
 
+bool PhotoModel::lessThan(const PhotoInfo &a, const PhotoInfo &b) const
+{
+    if (m_sortOrder == NewestFirst) {
+        return a.dateTime > b.dateTime;
+    } else {
+        return a.dateTime < b.dateTime;
+    }
+}
+
 void PhotoModel::sortPhotos(QList<PhotoInfo> &photos) const
 {
-    std::sort(photos.begin(), photos.end(),
-              [this](const PhotoInfo &a, const PhotoInfo &b) {
-                  if (m_sortOrder == NewestFirst) {
-                      return a.dateTime > b.dateTime;
-                  } else {
-                      return a.dateTime < b.dateTime;
-                  }
-              });
+    std::stable_sort(photos.begin(), photos.end(),
+                     [this](const PhotoInfo &a, const PhotoInfo &b) {
+                         return lessThan(a, b);
+                     });
 }
 
 bool PhotoModel::matchesFilter(const PhotoInfo &info) const
@@ -790,49 +876,25 @@ QStringList PhotoModel::getFilteredFilePaths() const
 }
 
 // Helper methods
-QDateTime PhotoModel::extractDateTimeFromFile(const QString &filePath) const
+QDateTime PhotoModel::extractDateTime(const MediaEntry &entry,
+                                      const QString &filePath) const
 {
-    plist_t info = nullptr;
-    afc_error_t afc_err = ServiceManager::safeAfcGetFileInfoPlist(
-        m_device, filePath.toUtf8().constData(), &info);
-
-    if (afc_err == AFC_E_SUCCESS && info) {
-        plist_t birthtime_node = plist_dict_get_item(info, "st_birthtime");
-        if (birthtime_node &&
-            plist_get_node_type(birthtime_node) == PLIST_UINT) {
-            uint64_t birthtime_ns = 0;
-            plist_get_uint_val(birthtime_node, &birthtime_ns);
-
-            // Convert nanoseconds since epoch to QDateTime
-            // The timestamp appears to be in nanoseconds since Unix epoch
-            uint64_t seconds = birthtime_ns / 1000000000ULL;
-            QDateTime dateTime =
-                QDateTime::fromSecsSinceEpoch(seconds, Qt::UTC);
-
-            plist_free(info);
-            if (dateTime.isValid()) {
-                return dateTime;
-            }
+    // AFC timestamps are nanoseconds since the Unix epoch
+    if (entry.birthTime) {
+        QDateTime dateTime = QDateTime::fromSecsSinceEpoch(
+            entry.birthTime / 1000000000ULL, Qt::UTC);
+        if (dateTime.isValid()) {
+            return dateTime;
         }
+    }
 
-        // Fallback to st_mtime (modification time) if birthtime not available
-        plist_t mtime_node = plist_dict_get_item(info, "st_mtime");
-        if (mtime_node && plist_get_node_type(mtime_node) == PLIST_UINT) {
-            uint64_t mtime_ns = 0;
-            plist_get_uint_val(mtime_node, &mtime_ns);
-
-            // Convert nanoseconds since epoch to QDateTime
-            uint64_t seconds = mtime_ns / 1000000000ULL;
-            QDateTime dateTime =
-                QDateTime::fromSecsSinceEpoch(seconds, Qt::UTC);
-
-            plist_free(info);
-            if (dateTime.isValid()) {
-                return dateTime;
-            }
+    // Fallback to st_mtime (modification time) if birthtime not available
+    if (entry.modificationTime) {
+        QDateTime dateTime = QDateTime::fromSecsSinceEpoch(
+            entry.modificationTime / 1000000000ULL, Qt::UTC);
+        if (dateTime.isValid()) {
+            return dateTime;
         }
-
-        plist_free(info);
     }
 
     // Final fallback: try to extract date from filename pattern like
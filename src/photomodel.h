@@ -25,16 +25,28 @@
 #include <QCache>
 #include <QCryptographicHash>
 #include <QDateTime>
+#include <QFuture>
 #include <QFutureWatcher>
 #include <QPixmap>
 #include <QSemaphore>
 #include <QSize>
 #include <QStandardPaths>
+#include <atomic>
+#include <memory>
+
+// A listing batch that would land in more places than this is merged in with
+// a single layout change instead of separate row inserts
+#define PHOTO_MODEL_MAX_INSERT_GROUPS 8
+
+class AfcInputStream;
 
 struct PhotoInfo {
     QString filePath;
     QString fileName;
     QDateTime dateTime;
+    // Identify the file version in the persistent thumbnail store
+    qint64 fileSize = 0;
+    quint64 modificationTime = 0;
     bool thumbnailRequested = false;
 
     enum FileType { Image, Video };
@@ -87,11 +99,12 @@ public:
                                            const QSize &size);
     void clear();
 signals:
-    void thumbnailNeedsToBeLoaded(int index);
+    // Keyed by path, rows shift while an album is still being listed
+    void thumbnailNeedsToBeLoaded(const QString &filePath);
     void exportRequested(const QStringList &filePaths);
 
 private slots:
-    void requestThumbnail(int index);
+    void requestThumbnail(const QString &filePath);
 
 private:
     // Data members
@@ -110,15 +123,28 @@ private:
     SortOrder m_sortOrder;
     FilterType m_filterType;
 
+    // Background listing of the current album
+    QFuture<void> m_populateFuture;
+    std::shared_ptr<std::atomic<bool>> m_populateCancelled;
+
     // Helper methods
     void populatePhotoPaths();
+    void cancelPopulation();
+    void appendEntries(const std::vector<MediaEntry> &entries);
+    void insertSorted(QList<PhotoInfo> &photos);
     void applyFilterAndSort();
+    bool lessThan(const PhotoInfo &a, const PhotoInfo &b) const;
     void sortPhotos(QList<PhotoInfo> &photos) const;
     bool matchesFilter(const PhotoInfo &info) const;
 
-    QDateTime extractDateTimeFromFile(const QString &filePath) const;
+    QDateTime extractDateTime(const MediaEntry &entry,
+                              const QString &filePath) const;
     PhotoInfo::FileType determineFileType(const QString &fileName) const;
 
+    // Reads from the stream's current position, callers seek back to reuse it
+    static QImage loadEmbeddedThumbnail(AfcInputStream *stream,
+                                        const QString &filePath,
+                                        const QSize &size);
     static QPixmap generateVideoThumbnailFFmpeg(iDescriptorDevice *device,
                                                 const QString &filePath,
                                                 const QSize &requestedSize);
@@ -0,0 +1,144 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ringcopy.h"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QThread>
+
+qint64 copyThroughRing(const RingCopyReader &read, QFile &outputFile,
+                       qint64 length, BlockRingBuffer &ring,
+                       QCryptographicHash *hash,
+                       const std::atomic<bool> &cancelled,
+                       const std::function<void(qint64)> &onProgress,
+                       QString &errorMessage)
+{
+    ring.reset();
+    const bool pipelined = length < 0 || length > ring.blockSize();
+    QString writeError;
+
+    auto writeBlock = [&](const BlockRingBuffer::Block *block) {
+        qint64 bytesWritten =
+            outputFile.write(block->data.constData(), block->size);
+        if (bytesWritten != block->size) {
+            writeError = QString("Write error: only wrote %1 of %2 bytes")
+                             .arg(bytesWritten)
+                             .arg(block->size);
+            return false;
+        }
+        return true;
+    };
+
+    QThread *writer = nullptr;
+    if (pipelined) {
+        writer = QThread::create([&ring, &writeBlock]() {
+            while (BlockRingBuffer::Block *block = ring.acquireFilled()) {
+                bool ok = writeBlock(block);
+                ring.recycle(block);
+                if (!ok) {
+                    ring.abort();
+                    return;
+                }
+            }
+        });
+        writer->start();
+    }
+
+    qint64 totalBytes = 0;
+    bool wasCancelled = false;
+    bool endOfFile = false;
+    bool readFailed = false;
+
+    while (!endOfFile && (length < 0 || totalBytes < length)) {
+        if (cancelled.load()) {
+            wasCancelled = true;
+            break;
+        }
+
+        BlockRingBuffer::Block *block = ring.acquireFree();
+        if (!block) {
+            break; // Writer failed
+        }
+
+        qint64 blockLimit = ring.blockSize();
+        if (length >= 0) {
+            blockLimit = qMin(blockLimit, length - totalBytes);
+        }
+        while (block->size < blockLimit) {
+            qint64 bytesRead = read(block->data.data() + block->size,
+                                    blockLimit - block->size);
+            if (bytesRead < 0) {
+                readFailed = true;
+                endOfFile = true;
+                break;
+            }
+            if (bytesRead == 0) {
+                endOfFile = true;
+                break;
+            }
+            block->size += bytesRead;
+        }
+
+        if (block->size == 0) {
+            ring.recycle(block);
+            break;
+        }
+
+        if (hash) {
+            hash->addData(QByteArrayView(block->data.constData(), block->size));
+        }
+
+        totalBytes += block->size;
+        if (pipelined) {
+            ring.commit(block);
+        } else {
+            bool ok = writeBlock(block);
+            ring.recycle(block);
+            if (!ok) {
+                break;
+            }
+        }
+
+        onProgress(totalBytes);
+    }
+
+    if (writer) {
+        if (wasCancelled) {
+            ring.abort();
+        } else {
+            ring.finish();
+        }
+        writer->wait();
+        delete writer;
+    }
+
+    if (wasCancelled) {
+        errorMessage = "Export cancelled by user";
+        return -1;
+    }
+    if (readFailed) {
+        errorMessage = "Read error";
+        return -1;
+    }
+    if (!writeError.isEmpty()) {
+        errorMessage = writeError;
+        return -1;
+    }
+    return totalBytes;
+}
@@ -0,0 +1,52 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RINGCOPY_H
+#define RINGCOPY_H
+
+#include "blockringbuffer.h"
+#include <QString>
+#include <atomic>
+#include <functional>
+
+class QCryptographicHash;
+class QFile;
+
+// Reads up to maxSize bytes into data. Returns the number of bytes read, 0 at
+// the end of the source or -1 on failure.
+using RingCopyReader = std::function<qint64(char *data, qint64 maxSize)>;
+
+/**
+ * @brief Copy length bytes (or up to the end if length < 0) from read to the
+ * current position of outputFile, staged through ring
+ *
+ * The reader runs on the calling thread and fills whole blocks while a writer
+ * thread flushes filled blocks to disk, so reads and local writes overlap.
+ * Ranges that fit in a single block are written inline.
+ * @param hash If set, receives every byte read
+ * @return Bytes copied, or -1 with errorMessage set
+ */
+qint64 copyThroughRing(const RingCopyReader &read, QFile &outputFile,
+                       qint64 length, BlockRingBuffer &ring,
+                       QCryptographicHash *hash,
+                       const std::atomic<bool> &cancelled,
+                       const std::function<void(qint64)> &onProgress,
+                       QString &errorMessage);
+
+#endif // RINGCOPY_H
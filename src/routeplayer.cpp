@@ -0,0 +1,400 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "routeplayer.h"
+#include <QDeadlineTimer>
+#include <QDebug>
+#include <QFile>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QThread>
+#include <QXmlStreamReader>
+#include <algorithm>
+
+RoutePlayer::RoutePlayer(QObject *parent) : QObject(parent)
+{
+    m_clock.start();
+}
+
+RoutePlayer::~RoutePlayer() { stop(); }
+
+static bool parseGpxPoint(const QXmlStreamAttributes &attributes,
+                          QGeoCoordinate &coordinate)
+{
+    bool latOk = false, lonOk = false;
+    const double latitude = attributes.value("lat").toDouble(&latOk);
+    const double longitude = attributes.value("lon").toDouble(&lonOk);
+    coordinate = QGeoCoordinate(latitude, longitude);
+    return latOk && lonOk && coordinate.isValid();
+}
+
+static const QRegularExpression kmlWhitespace("\\s+");
+
+// Takes the longitude and latitude of one KML tuple, altitude is ignored
+static void appendKmlPoint(const QStringList &values,
+                           QList<QGeoCoordinate> &points)
+{
+    if (values.size() < 2) {
+        return;
+    }
+    bool latOk = false, lonOk = false;
+    const double longitude = values[0].toDouble(&lonOk);
+    const double latitude = values[1].toDouble(&latOk);
+    const QGeoCoordinate coordinate(latitude, longitude);
+    if (latOk && lonOk && coordinate.isValid()) {
+        points.append(coordinate);
+    }
+}
+
+QList<QGeoCoordinate> RoutePlayer::loadRouteFile(const QString &path,
+                                                 QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return {};
+    }
+
+    QList<QGeoCoordinate> trackPoints, routePoints, waypoints, kmlPoints;
+    QXmlStreamReader reader(&file);
+    while (!reader.atEnd()) {
+        if (reader.readNext() != QXmlStreamReader::StartElement) {
+            continue;
+        }
+        const QStringView name = reader.name();
+        QGeoCoordinate coordinate;
+        if (name == QLatin1String("trkpt")) {
+            if (parseGpxPoint(reader.attributes(), coordinate)) {
+                trackPoints.append(coordinate);
+            }
+        } else if (name == QLatin1String("rtept")) {
+            if (parseGpxPoint(reader.attributes(), coordinate)) {
+                routePoints.append(coordinate);
+            }
+        } else if (name == QLatin1String("wpt")) {
+            if (parseGpxPoint(reader.attributes(), coordinate)) {
+                waypoints.append(coordinate);
+            }
+        } else if (name == QLatin1String("coordinates")) {
+            // Whitespace separated "lon,lat[,alt]" tuples
+            const QStringList tuples = reader.readElementText().split(
+                kmlWhitespace, Qt::SkipEmptyParts);
+            for (const QString &tuple : tuples) {
+                appendKmlPoint(tuple.split(','), kmlPoints);
+            }
+        } else if (name == QLatin1String("coord")) {
+            // gx:Track uses a single "lon lat alt" per element
+            appendKmlPoint(reader.readElementText().split(kmlWhitespace,
+                                                          Qt::SkipEmptyParts),
+                           kmlPoints);
+        }
+    }
+
+    if (reader.hasError()) {
+        if (error) {
+            *error = QString("%1 (line %2)")
+                         .arg(reader.errorString())
+                         .arg(reader.lineNumber());
+        }
+        return {};
+    }
+
+    // A track is the recorded path, prefer it over planned routes and
+    // loose waypoints
+    for (const QList<QGeoCoordinate> *points :
+         {&trackPoints, &routePoints, &kmlPoints, &waypoints}) {
+        if (!points->isEmpty()) {
+            return *points;
+        }
+    }
+    if (error) {
+        *error = "The file does not contain any route points.";
+    }
+    return {};
+}
+
+void RoutePlayer::setRoute(const QList<QGeoCoordinate> &route)
+{
+    stop();
+
+    QMutexLocker locker(&m_mutex);
+    m_route.clear();
+    m_cumulative.clear();
+    for (const QGeoCoordinate &coordinate : route) {
+        if (!coordinate.isValid()) {
+            continue;
+        }
+        const double distance =
+            m_route.isEmpty()
+                ? 0
+                : m_cumulative.last() + m_route.last().distanceTo(coordinate);
+        m_route.append(coordinate);
+        m_cumulative.append(distance);
+    }
+    m_baseDistance = 0;
+    m_baseTimeNs = m_clock.nsecsElapsed();
+}
+
+QList<QGeoCoordinate> RoutePlayer::route() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_route;
+}
+
+double RoutePlayer::routeLength() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cumulative.isEmpty() ? 0 : m_cumulative.last();
+}
+
+void RoutePlayer::setSpeed(double metersPerSecond)
+{
+    QMutexLocker locker(&m_mutex);
+    rebase();
+    m_speed = qMax(0.0, metersPerSecond);
+}
+
+double RoutePlayer::speed() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_speed;
+}
+
+void RoutePlayer::setUpdateRate(int hz)
+{
+    QMutexLocker locker(&m_mutex);
+    m_rateHz = qBound(ROUTE_PLAYER_MIN_RATE_HZ, hz, ROUTE_PLAYER_MAX_RATE_HZ);
+    m_wake.wakeAll(); // re-evaluate the current wait right away
+}
+
+int RoutePlayer::updateRate() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_rateHz;
+}
+
+void RoutePlayer::play(iDescriptorDevice *device)
+{
+    // Reap the worker of a playback that ran to the end
+    if (state() == Stopped) {
+        stop();
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_route.isEmpty() || m_state == Playing) {
+            return;
+        }
+        if (m_state == Stopped && m_baseDistance >= m_cumulative.last()) {
+            m_baseDistance = 0;
+        }
+        m_baseTimeNs = m_clock.nsecsElapsed();
+        m_state = Playing;
+        m_wake.wakeAll();
+    }
+
+    if (!m_thread) {
+        m_device = device;
+        m_stopRequested = false;
+        m_seeked = false;
+        m_thread = QThread::create([this]() { playbackLoop(); });
+        m_thread->start();
+    }
+    emit stateChanged();
+}
+
+void RoutePlayer::pause()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_state != Playing) {
+            return;
+        }
+        rebase();
+        m_state = Paused;
+        m_wake.wakeAll();
+    }
+    emit stateChanged();
+}
+
+void RoutePlayer::stop()
+{
+    if (m_thread) {
+        {
+            QMutexLocker locker(&m_mutex);
+            rebase();
+            m_stopRequested = true;
+            m_wake.wakeAll();
+        }
+        // A location update in flight can not be interrupted, wait it out
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+        m_device = nullptr;
+    }
+
+    bool changed = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        changed = m_state != Stopped;
+        m_state = Stopped;
+    }
+    if (changed) {
+        emit stateChanged();
+    }
+}
+
+void RoutePlayer::seek(double distance)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_cumulative.isEmpty()) {
+        return;
+    }
+    m_baseDistance = qBound(0.0, distance, m_cumulative.last());
+    m_baseTimeNs = m_clock.nsecsElapsed();
+    // Send the new position right away, also while paused
+    if (m_thread) {
+        m_seeked = true;
+        m_wake.wakeAll();
+    }
+}
+
+RoutePlayer::State RoutePlayer::state() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_state;
+}
+
+double RoutePlayer::position() const
+{
+    QMutexLocker locker(&m_mutex);
+    return distanceNow();
+}
+
+double RoutePlayer::distanceNow() const
+{
+    double distance = m_baseDistance;
+    if (m_state == Playing) {
+        distance += m_speed * (m_clock.nsecsElapsed() - m_baseTimeNs) / 1e9;
+    }
+    return m_cumulative.isEmpty() ? 0 : qMin(distance, m_cumulative.last());
+}
+
+void RoutePlayer::rebase()
+{
+    m_baseDistance = distanceNow();
+    m_baseTimeNs = m_clock.nsecsElapsed();
+}
+
+QGeoCoordinate RoutePlayer::coordinateAt(double distance) const
+{
+    if (m_route.isEmpty()) {
+        return QGeoCoordinate();
+    }
+    auto next =
+        std::upper_bound(m_cumulative.cbegin(), m_cumulative.cend(), distance);
+    if (next == m_cumulative.cbegin()) {
+        return m_route.first();
+    }
+    if (next == m_cumulative.cend()) {
+        return m_route.last();
+    }
+
+    const int index = next - m_cumulative.cbegin();
+    const QGeoCoordinate &from = m_route[index - 1];
+    const QGeoCoordinate &to = m_route[index];
+    return from.atDistanceAndAzimuth(distance - m_cumulative[index - 1],
+                                     from.azimuthTo(to));
+}
+
+void RoutePlayer::playbackLoop()
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 nextTickNs = m_clock.nsecsElapsed();
+
+    while (!m_stopRequested) {
+        if (m_state != Playing && !m_seeked) {
+            m_wake.wait(&m_mutex);
+            // Resume on a fresh schedule instead of catching up
+            nextTickNs = m_clock.nsecsElapsed();
+            continue;
+        }
+
+        const qint64 nowNs = m_clock.nsecsElapsed();
+        if (!m_seeked && nowNs < nextTickNs) {
+            QDeadlineTimer deadline(Qt::PreciseTimer);
+            deadline.setPreciseRemainingTime(0, nextTickNs - nowNs,
+                                             Qt::PreciseTimer);
+            // Woken early on stop, pause, seek or a rate change
+            m_wake.wait(&m_mutex, deadline);
+            continue;
+        }
+        m_seeked = false;
+
+        /* Step from the previous deadline so the time spent sending does not
+           add up over the ticks. After a stall longer than a period the
+           missed ticks are dropped, the position is time based anyway. */
+        const qint64 periodNs = 1000000000LL / m_rateHz;
+        nextTickNs += periodNs;
+        if (nextTickNs <= nowNs) {
+            nextTickNs = nowNs + periodNs;
+        }
+
+        const double distance = distanceNow();
+        const QGeoCoordinate coordinate = coordinateAt(distance);
+        const bool atEnd =
+            m_state == Playing && distance >= m_cumulative.last();
+        locker.unlock();
+
+        const QByteArray lat =
+            QByteArray::number(coordinate.latitude(), 'f', 6);
+        const QByteArray lon =
+            QByteArray::number(coordinate.longitude(), 'f', 6);
+        const bool sent =
+            set_location(m_device, lat.constData(), lon.constData());
+
+        if (!sent) {
+            qDebug() << "Route playback paused, failed to set location";
+            locker.relock();
+            if (m_state == Playing) {
+                rebase();
+                m_state = Paused;
+            }
+            locker.unlock();
+            emit sendFailed();
+            emit stateChanged();
+            locker.relock();
+            continue;
+        }
+
+        emit positionChanged(coordinate.latitude(), coordinate.longitude(),
+                             distance);
+        locker.relock();
+        if (atEnd && m_state == Playing && !m_seeked) {
+            m_state = Stopped;
+            m_baseDistance = m_cumulative.last();
+            locker.unlock();
+            emit stateChanged();
+            emit finished();
+            return;
+        }
+    }
+}
@@ -0,0 +1,127 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ROUTEPLAYER_H
+#define ROUTEPLAYER_H
+
+#include "iDescriptor.h"
+#include <QElapsedTimer>
+#include <QGeoCoordinate>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QVector>
+#include <QWaitCondition>
+
+class QThread;
+
+#define ROUTE_PLAYER_MIN_RATE_HZ 1
+#define ROUTE_PLAYER_MAX_RATE_HZ 10
+#define ROUTE_PLAYER_DEFAULT_RATE_HZ 1
+// Walking pace
+#define ROUTE_PLAYER_DEFAULT_SPEED_MPS 1.4
+
+/**
+ * @brief Plays a route back as a stream of simulated locations
+ *
+ * Positions are interpolated along the route at a constant speed and sent at
+ * a fixed update rate from a worker thread, over the device's cached
+ * simulatelocation session. Ticks are scheduled against absolute deadlines
+ * and the position is derived from the elapsed play time rather than the
+ * number of ticks, so a slow send delays one update but never makes the
+ * playback fall behind. Ticks that were missed entirely are skipped instead
+ * of being sent in a burst.
+ *
+ * The device must outlive stop(). Signals are emitted from the worker
+ * thread.
+ */
+class RoutePlayer : public QObject
+{
+    Q_OBJECT
+public:
+    enum State { Stopped, Playing, Paused };
+
+    explicit RoutePlayer(QObject *parent = nullptr);
+    ~RoutePlayer();
+
+    /*
+     * Reads track points, route points or waypoints from a GPX file, or the
+     * coordinates of a KML file, whichever comes first. Returns an empty list
+     * and sets error when the file has no usable points.
+     */
+    static QList<QGeoCoordinate> loadRouteFile(const QString &path,
+                                               QString *error = nullptr);
+
+    // Stops playback
+    void setRoute(const QList<QGeoCoordinate> &route);
+    QList<QGeoCoordinate> route() const;
+    // In meters
+    double routeLength() const;
+
+    void setSpeed(double metersPerSecond);
+    double speed() const;
+    // Clamped to ROUTE_PLAYER_MIN_RATE_HZ..ROUTE_PLAYER_MAX_RATE_HZ
+    void setUpdateRate(int hz);
+    int updateRate() const;
+
+    // Starts from the current position, or resumes when paused
+    void play(iDescriptorDevice *device);
+    void pause();
+    // Blocks until the worker has exited, the position is kept
+    void stop();
+    // Distance along the route in meters, works in every state
+    void seek(double distance);
+
+    State state() const;
+    double position() const;
+
+signals:
+    // Emitted for every location sent to the device
+    void positionChanged(double latitude, double longitude, double distance);
+    void stateChanged();
+    void finished();
+    void sendFailed();
+
+private:
+    void playbackLoop();
+    QGeoCoordinate coordinateAt(double distance) const;
+    double distanceNow() const;
+    void rebase();
+
+    iDescriptorDevice *m_device = nullptr;
+    QThread *m_thread = nullptr;
+
+    // Guards everything below
+    mutable QMutex m_mutex;
+    QWaitCondition m_wake;
+    QList<QGeoCoordinate> m_route;
+    QVector<double> m_cumulative; // distance from the start to each point
+    double m_speed = ROUTE_PLAYER_DEFAULT_SPEED_MPS;
+    int m_rateHz = ROUTE_PLAYER_DEFAULT_RATE_HZ;
+    State m_state = Stopped;
+    bool m_stopRequested = false;
+    bool m_seeked = false;
+    /* The position is m_baseDistance + m_speed * (now - m_baseTimeNs) while
+       playing, rebased whenever the speed, position or state changes. */
+    QElapsedTimer m_clock;
+    double m_baseDistance = 0;
+    qint64 m_baseTimeNs = 0;
+};
+
+#endif // ROUTEPLAYER_H
@@ -0,0 +1,271 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "screencapturepipeline.h"
+#include "servicesessioncache.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QThread>
+#include <cstdlib>
+
+static double smooth(double current, double sample)
+{
+    if (current <= 0) {
+        return sample;
+    }
+    return current + SCREEN_CAPTURE_SMOOTHING * (sample - current);
+}
+
+/* Capture and decode overlap, so the slower of the two bounds the achievable
+   rate. Asking the device any faster would only produce frames that get
+   dropped. Every failed capture in a row doubles the interval, up to
+   SCREEN_CAPTURE_ERROR_BACKOFF_MAX_MS. */
+static double pacedInterval(const ScreenCaptureMetrics &metrics)
+{
+    const double interval =
+        qMax(1000.0 / metrics.targetFps, metrics.decodeTimeMs);
+    if (metrics.consecutiveErrors == 0) {
+        return interval;
+    }
+    const double backoff =
+        interval * double(1 << qMin(metrics.consecutiveErrors, 16));
+    return qMax(interval,
+                qMin<double>(backoff, SCREEN_CAPTURE_ERROR_BACKOFF_MAX_MS));
+}
+
+ScreenCapturePipeline::ScreenCapturePipeline(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ScreenCapturePipeline::~ScreenCapturePipeline() { stop(); }
+
+void ScreenCapturePipeline::start(iDescriptorDevice *device, int targetFps)
+{
+    if (isRunning()) {
+        return;
+    }
+
+    m_device = device;
+    m_stopRequested = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_pendingRaw.clear();
+        m_latestFrame = QImage();
+        m_frameNotified = false;
+        m_metrics = ScreenCaptureMetrics();
+        m_metrics.targetFps = qMax(1, targetFps);
+    }
+
+    m_captureThread = QThread::create([this]() { captureLoop(); });
+    m_decodeThread = QThread::create([this]() { decodeLoop(); });
+    m_decodeThread->start();
+    m_captureThread->start();
+}
+
+void ScreenCapturePipeline::stop()
+{
+    if (!isRunning()) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopRequested = true;
+        m_rawAvailable.wakeAll();
+        m_stopWake.wakeAll();
+    }
+
+    // A screenshotr request in flight can not be interrupted, wait it out
+    m_captureThread->wait();
+    m_decodeThread->wait();
+    delete m_captureThread;
+    delete m_decodeThread;
+    m_captureThread = nullptr;
+    m_decodeThread = nullptr;
+    m_device = nullptr;
+}
+
+bool ScreenCapturePipeline::isRunning() const
+{
+    return m_captureThread != nullptr;
+}
+
+void ScreenCapturePipeline::setTargetFps(int fps)
+{
+    QMutexLocker locker(&m_mutex);
+    m_metrics.targetFps = qMax(1, fps);
+    m_stopWake.wakeAll(); // re-evaluate the current wait right away
+}
+
+void ScreenCapturePipeline::setDisplaySize(const QSize &size)
+{
+    QMutexLocker locker(&m_mutex);
+    m_displaySize = size;
+}
+
+QImage ScreenCapturePipeline::takeLatestFrame()
+{
+    QMutexLocker locker(&m_mutex);
+    m_frameNotified = false;
+    return std::move(m_latestFrame);
+}
+
+ScreenCaptureMetrics ScreenCapturePipeline::metrics() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_metrics;
+}
+
+void ScreenCapturePipeline::captureLoop()
+{
+    QElapsedTimer frameTimer;
+    while (!m_stopRequested) {
+        frameTimer.start();
+
+        QByteArray raw;
+        ServiceSessionCache::sharedInstance()->withScreenshotr(
+            m_device, [&raw](screenshotr_client_t client) {
+                char *imgdata = nullptr;
+                uint64_t imgsize = 0;
+                screenshotr_error_t err =
+                    screenshotr_take_screenshot(client, &imgdata, &imgsize);
+                if (err == SCREENSHOTR_E_SUCCESS && imgdata) {
+                    raw = QByteArray(imgdata, static_cast<qsizetype>(imgsize));
+                } else {
+                    qWarning() << "Failed to capture screenshot, error:"
+                               << err;
+                }
+                free(imgdata);
+                return !raw.isEmpty();
+            });
+        const double captureMs = frameTimer.nsecsElapsed() / 1e6;
+
+        QMutexLocker locker(&m_mutex);
+        // The decoder reports the metrics while frames arrive, errors and the
+        // recovery from them are reported here
+        bool report = false;
+        if (raw.isEmpty()) {
+            ++m_metrics.captureErrors;
+            ++m_metrics.consecutiveErrors;
+            report = true;
+        } else {
+            report = m_metrics.consecutiveErrors > 0;
+            m_metrics.consecutiveErrors = 0;
+            m_metrics.captureLatencyMs =
+                smooth(m_metrics.captureLatencyMs, captureMs);
+            ++m_metrics.framesCaptured;
+            // The decoder is still busy with an older frame, replace it
+            if (!m_pendingRaw.isEmpty()) {
+                ++m_metrics.framesDropped;
+            }
+            m_pendingRaw = std::move(raw);
+            m_rawAvailable.wakeOne();
+        }
+
+        m_metrics.pacedIntervalMs = pacedInterval(m_metrics);
+        if (report) {
+            locker.unlock();
+            emit metricsChanged();
+            locker.relock();
+        }
+
+        while (!m_stopRequested) {
+            const double interval = pacedInterval(m_metrics);
+            m_metrics.pacedIntervalMs = interval;
+            const qint64 remaining = qint64(interval) - frameTimer.elapsed();
+            if (remaining <= 0 || !m_stopWake.wait(&m_mutex, remaining)) {
+                break;
+            }
+        }
+    }
+}
+
+void ScreenCapturePipeline::decodeLoop()
+{
+    QElapsedTimer metricsTimer;
+    metricsTimer.start();
+    int framesSinceReport = 0;
+
+    while (true) {
+        QByteArray raw;
+        QSize displaySize;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_pendingRaw.isEmpty() && !m_stopRequested) {
+                m_rawAvailable.wait(&m_mutex);
+            }
+            if (m_stopRequested) {
+                return;
+            }
+            raw = std::move(m_pendingRaw);
+            m_pendingRaw.clear();
+            displaySize = m_displaySize;
+        }
+
+        QElapsedTimer decodeTimer;
+        decodeTimer.start();
+        QImage image;
+        image.loadFromData(raw);
+        if (image.isNull()) {
+            qWarning() << "Could not decode screenshot image";
+            continue;
+        }
+        if (displaySize.isValid() && !displaySize.isEmpty()) {
+            image = image.scaled(displaySize, Qt::KeepAspectRatio,
+                                 Qt::SmoothTransformation);
+        }
+        const double decodeMs = decodeTimer.nsecsElapsed() / 1e6;
+
+        publishFrame(std::move(image));
+        ++framesSinceReport;
+
+        bool report = false;
+        {
+            QMutexLocker locker(&m_mutex);
+            m_metrics.decodeTimeMs = smooth(m_metrics.decodeTimeMs, decodeMs);
+            const qint64 elapsed = metricsTimer.elapsed();
+            if (elapsed >= SCREEN_CAPTURE_METRICS_INTERVAL_MS) {
+                m_metrics.effectiveFps = framesSinceReport * 1000.0 / elapsed;
+                framesSinceReport = 0;
+                metricsTimer.restart();
+                report = true;
+            }
+        }
+        if (report) {
+            emit metricsChanged();
+        }
+    }
+}
+
+void ScreenCapturePipeline::publishFrame(QImage image)
+{
+    bool notify = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_latestFrame = std::move(image);
+        notify = !m_frameNotified;
+        m_frameNotified = true;
+    }
+    // One queued notification at a time, the GUI always takes the newest
+    if (notify) {
+        emit frameAvailable();
+    }
+}
@@ -0,0 +1,112 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCREENCAPTUREPIPELINE_H
+#define SCREENCAPTUREPIPELINE_H
+
+#include "iDescriptor.h"
+#include <QByteArray>
+#include <QImage>
+#include <QMutex>
+#include <QObject>
+#include <QSize>
+#include <QWaitCondition>
+#include <atomic>
+
+class QThread;
+
+// Weight of the newest sample in the smoothed timings
+#define SCREEN_CAPTURE_SMOOTHING 0.2
+// How often the effective frame rate is recomputed and reported
+#define SCREEN_CAPTURE_METRICS_INTERVAL_MS 1000
+// Failed captures double the interval between requests up to this limit
+#define SCREEN_CAPTURE_ERROR_BACKOFF_MAX_MS 5000
+
+struct ScreenCaptureMetrics {
+    double captureLatencyMs = 0; // screenshotr round trip, smoothed
+    double decodeTimeMs = 0;     // decode and scale, smoothed
+    double effectiveFps = 0;     // frames delivered per second
+    double pacedIntervalMs = 0;  // current time between capture requests
+    int targetFps = 0;
+    quint64 framesCaptured = 0;
+    quint64 framesDropped = 0; // superseded before they were decoded
+    quint64 captureErrors = 0;
+    int consecutiveErrors = 0; // failed captures in a row, backing off if > 0
+};
+
+/**
+ * @brief Captures and decodes device screenshots off the GUI thread
+ *
+ * A capture thread keeps one screenshotr request in flight while a decode
+ * thread turns the previous one into a QImage scaled to the display size.
+ * Requests are paced to the target frame rate, or slower when decoding can
+ * not keep up, so the device is not asked for frames that would be dropped.
+ * Failed captures back off exponentially until one succeeds again.
+ * Only the newest decoded frame is kept; frameAvailable() is emitted once
+ * until takeLatestFrame() picks it up.
+ *
+ * Captures go through the device's cached screenshotr session, the device
+ * must outlive stop().
+ */
+class ScreenCapturePipeline : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ScreenCapturePipeline(QObject *parent = nullptr);
+    ~ScreenCapturePipeline();
+
+    void start(iDescriptorDevice *device, int targetFps);
+    // Blocks until both threads have exited
+    void stop();
+    bool isRunning() const;
+
+    void setTargetFps(int fps);
+    // Frames are scaled to fit this size while decoding, empty keeps the
+    // device resolution
+    void setDisplaySize(const QSize &size);
+
+    QImage takeLatestFrame();
+    ScreenCaptureMetrics metrics() const;
+
+signals:
+    void frameAvailable();
+    void metricsChanged();
+
+private:
+    void captureLoop();
+    void decodeLoop();
+    void publishFrame(QImage image);
+
+    iDescriptorDevice *m_device = nullptr;
+    QThread *m_captureThread = nullptr;
+    QThread *m_decodeThread = nullptr;
+    std::atomic<bool> m_stopRequested{false};
+
+    // Guards everything below
+    mutable QMutex m_mutex;
+    QWaitCondition m_rawAvailable;
+    QWaitCondition m_stopWake;
+    QByteArray m_pendingRaw;
+    QImage m_latestFrame;
+    bool m_frameNotified = false;
+    QSize m_displaySize;
+    ScreenCaptureMetrics m_metrics;
+};
+
+#endif // SCREENCAPTUREPIPELINE_H
@@ -18,12 +18,36 @@
  */
 
 #include "servicemanager.h"
+#include "directorycache.h"
+#include <QThread>
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+AfcClientLease ServiceManager::leaseAfcClient(iDescriptorDevice *device,
+                                              bool wait)
+{
+    if (!device) {
+        return AfcClientLease();
+    }
+    std::shared_ptr<AfcClientPool> pool = device->afcPool;
+    if (!pool) {
+        return AfcClientLease();
+    }
+    return wait ? pool->acquire() : pool->tryAcquire();
+}
 
 afc_error_t
 ServiceManager::safeAfcReadDirectory(iDescriptorDevice *device,
                                      const char *path, char ***dirs,
                                      std::optional<afc_client_t> altAfc)
 {
+    if (!altAfc) {
+        // Stateless request, run it on a pooled client when one is free
+        if (AfcClientLease lease = leaseAfcClient(device, false)) {
+            return safeAfcReadDirectory(lease, path, dirs);
+        }
+    }
     return executeAfcOperation(
         device,
         [path, dirs](afc_client_t client) {
@@ -37,6 +61,11 @@ ServiceManager::safeAfcGetFileInfo(iDescriptorDevice *device, const char *path,
                                    char ***info,
                                    std::optional<afc_client_t> altAfc)
 {
+    if (!altAfc) {
+        if (AfcClientLease lease = leaseAfcClient(device, false)) {
+            return safeAfcGetFileInfo(lease, path, info);
+        }
+    }
     return executeAfcOperation(
         device,
         [path, info](afc_client_t client) {
@@ -50,6 +79,11 @@ ServiceManager::safeAfcGetFileInfoPlist(iDescriptorDevice *device,
                                         const char *path, plist_t *info,
                                         std::optional<afc_client_t> altAfc)
 {
+    if (!altAfc) {
+        if (AfcClientLease lease = leaseAfcClient(device, false)) {
+            return safeAfcGetFileInfoPlist(lease, path, info);
+        }
+    }
     return executeAfcOperation(
         device,
         [path, info](afc_client_t client) {
@@ -64,12 +98,16 @@ afc_error_t ServiceManager::safeAfcFileOpen(iDescriptorDevice *device,
                                             uint64_t *handle,
                                             std::optional<afc_client_t> altAfc)
 {
-    return executeAfcOperation(
+    afc_error_t err = executeAfcOperation(
         device,
         [path, mode, handle](afc_client_t client) {
             return afc_file_open(client, path, mode, handle);
         },
         altAfc);
+    if (mode != AFC_FOPEN_RDONLY && usesMediaDomain(device, altAfc)) {
+        DirectoryCache::sharedInstance()->invalidate(device->udid, path);
+    }
+    return err;
 }
 
 afc_error_t ServiceManager::safeAfcFileRead(iDescriptorDevice *device,
@@ -142,6 +180,11 @@ ServiceManager::safeReadAfcFileToByteArray(iDescriptorDevice *device,
                                            const char *path,
                                            std::optional<afc_client_t> altAfc)
 {
+    if (!altAfc) {
+        if (AfcClientLease lease = leaseAfcClient(device, false)) {
+            return safeReadAfcFileToByteArray(lease, path);
+        }
+    }
     return executeOperation<QByteArray>(
         device,
         [path](afc_client_t client) -> QByteArray {
@@ -150,14 +193,312 @@ ServiceManager::safeReadAfcFileToByteArray(iDescriptorDevice *device,
         altAfc);
 }
 
+bool ServiceManager::usesMediaDomain(iDescriptorDevice *device,
+                                     std::optional<afc_client_t> &altAfc)
+{
+    if (!device) {
+        return false;
+    }
+    // The primary client is what the device path uses anyway
+    if (altAfc && *altAfc == device->afcClient) {
+        altAfc = std::nullopt;
+    }
+    return !altAfc;
+}
+
 AFCFileTree ServiceManager::safeGetFileTree(iDescriptorDevice *device,
                                             const std::string &path, bool checkDir,
                                             std::optional<afc_client_t> altAfc)
+{
+    const bool cacheable = usesMediaDomain(device, altAfc);
+    if (cacheable) {
+        AFCFileTree cached;
+        if (DirectoryCache::sharedInstance()->listing(
+                device->udid, path, checkDir, &cached.entries)) {
+            cached.success = true;
+            cached.currentPath = path;
+            return cached;
+        }
+    }
+
+    const uint64_t generation = DirectoryCache::sharedInstance()->generation();
+    AFCFileTree tree;
+    AfcClientLease lease;
+    if (!altAfc) {
+        lease = leaseAfcClient(device, false);
+    }
+    if (lease) {
+        tree = safeGetFileTree(lease, path, checkDir);
+    } else {
+        tree = executeOperation<AFCFileTree>(
+            device,
+            [path, checkDir](afc_client_t client) -> AFCFileTree {
+                return get_file_tree(client, path.c_str(), checkDir);
+            },
+            altAfc);
+    }
+
+    if (cacheable && tree.success) {
+        DirectoryCache::sharedInstance()->storeListing(
+            device->udid, path, tree.entries, checkDir, generation);
+    }
+    return tree;
+}
+
+bool ServiceManager::safeListDirectory(
+    iDescriptorDevice *device, const std::string &path,
+    const std::function<void(const std::vector<MediaEntry> &)> &onBatch,
+    std::optional<afc_client_t> altAfc, const std::atomic<bool> *cancelled)
+{
+    if (!device) {
+        return false;
+    }
+
+    const bool cacheable = usesMediaDomain(device, altAfc);
+    if (cacheable) {
+        std::vector<MediaEntry> cached;
+        if (DirectoryCache::sharedInstance()->listing(device->udid, path, true,
+                                                      &cached)) {
+            if (!cached.empty()) {
+                onBatch(cached);
+            }
+            return true;
+        }
+    }
+
+    const uint64_t generation = DirectoryCache::sharedInstance()->generation();
+    AfcClientLease lease;
+    if (!altAfc) {
+        lease = leaseAfcClient(device, false);
+    }
+    auto runOn = [device, &altAfc](
+                     const AfcClientLease &client,
+                     std::function<afc_error_t(afc_client_t)> operation) {
+        return client ? executeAfcOperation(client, operation)
+                      : executeAfcOperation(device, operation, altAfc);
+    };
+
+    std::vector<std::string> names;
+    afc_error_t err = runOn(lease, [&path, &names](afc_client_t client) {
+        char **dirs = nullptr;
+        afc_error_t result = afc_read_directory(client, path.c_str(), &dirs);
+        if (result == AFC_E_SUCCESS && dirs) {
+            for (int i = 0; dirs[i]; i++) {
+                if (strcmp(dirs[i], ".") != 0 && strcmp(dirs[i], "..") != 0) {
+                    names.emplace_back(dirs[i]);
+                }
+            }
+            afc_dictionary_free(dirs);
+        }
+        return result;
+    });
+    if (err != AFC_E_SUCCESS) {
+        qDebug() << "safeListDirectory: failed to read" << path.c_str()
+                 << "error:" << err;
+        return false;
+    }
+
+    const size_t batchCount =
+        (names.size() + AFC_LIST_BATCH_SIZE - 1) / AFC_LIST_BATCH_SIZE;
+    std::atomic<size_t> nextBatch{0};
+
+    // Workers finish batches out of order, hold them back until every
+    // earlier batch has been delivered
+    std::mutex deliveryMutex;
+    std::map<size_t, std::vector<MediaEntry>> finished;
+    size_t nextToDeliver = 0;
+    std::vector<MediaEntry> listed;
+    // Entries of a failed batch carry no stat info and must not be cached
+    std::atomic<bool> statFailed{false};
+
+    auto worker = [&](const AfcClientLease &client) {
+        for (;;) {
+            if (cancelled && cancelled->load()) {
+                return;
+            }
+            const size_t batch = nextBatch.fetch_add(1);
+            if (batch >= batchCount) {
+                return;
+            }
+            const size_t begin = batch * AFC_LIST_BATCH_SIZE;
+            const size_t end =
+                std::min(begin + AFC_LIST_BATCH_SIZE, names.size());
+
+            std::vector<MediaEntry> entries;
+            entries.reserve(end - begin);
+            afc_error_t statErr = runOn(client, [&](afc_client_t afc) {
+                for (size_t i = begin; i < end; ++i) {
+                    entries.push_back(afc_stat_entry(afc, path, names[i]));
+                }
+                return AFC_E_SUCCESS;
+            });
+            if (statErr != AFC_E_SUCCESS || entries.size() < end - begin) {
+                statFailed = true;
+            }
+            // The device went away mid batch, report names without stat info
+            for (size_t i = begin + entries.size(); i < end; ++i) {
+                entries.push_back({names[i], false});
+            }
+
+            std::lock_guard<std::mutex> lock(deliveryMutex);
+            finished.emplace(batch, std::move(entries));
+            while (!finished.empty() &&
+                   finished.begin()->first == nextToDeliver) {
+                const std::vector<MediaEntry> &entries =
+                    finished.begin()->second;
+                if (!cancelled || !cancelled->load()) {
+                    onBatch(entries);
+                }
+                if (cacheable) {
+                    listed.insert(listed.end(), entries.begin(),
+                                  entries.end());
+                }
+                finished.erase(finished.begin());
+                ++nextToDeliver;
+            }
+        }
+    };
+
+    // One extra worker per free pooled client, never more than there are
+    // batches. The calling thread is always a worker itself.
+    std::vector<AfcClientLease> helperLeases;
+    if (lease) {
+        while (helperLeases.size() + 1 < batchCount) {
+            AfcClientLease helper = leaseAfcClient(device, false);
+            if (!helper) {
+                break;
+            }
+            helperLeases.push_back(std::move(helper));
+        }
+    }
+
+    std::vector<QThread *> helpers;
+    for (const AfcClientLease &helperLease : helperLeases) {
+        QThread *thread =
+            QThread::create([&worker, &helperLease]() { worker(helperLease); });
+        thread->start();
+        helpers.push_back(thread);
+    }
+
+    worker(lease);
+
+    for (QThread *thread : helpers) {
+        thread->wait();
+        delete thread;
+    }
+
+    if (cancelled && cancelled->load()) {
+        return false;
+    }
+    if (statFailed) {
+        qDebug() << "safeListDirectory: stat failed for part of" << path.c_str()
+                 << ", not caching the listing";
+    } else if (cacheable) {
+        DirectoryCache::sharedInstance()->storeListing(
+            device->udid, path, listed, true, generation);
+    }
+    return true;
+}
+
+afc_error_t ServiceManager::safeAfcReadDirectory(const AfcClientLease &lease,
+                                                 const char *path, char ***dirs)
+{
+    return executeAfcOperation(lease, [path, dirs](afc_client_t client) {
+        return afc_read_directory(client, path, dirs);
+    });
+}
+
+afc_error_t ServiceManager::safeAfcGetFileInfo(const AfcClientLease &lease,
+                                               const char *path, char ***info)
+{
+    return executeAfcOperation(lease, [path, info](afc_client_t client) {
+        return afc_get_file_info(client, path, info);
+    });
+}
+
+afc_error_t ServiceManager::safeAfcGetFileInfoPlist(const AfcClientLease &lease,
+                                                    const char *path,
+                                                    plist_t *info)
+{
+    return executeAfcOperation(lease, [path, info](afc_client_t client) {
+        return afc_get_file_info_plist(client, path, info);
+    });
+}
+
+afc_error_t ServiceManager::safeAfcFileOpen(const AfcClientLease &lease,
+                                            const char *path,
+                                            afc_file_mode_t mode,
+                                            uint64_t *handle)
+{
+    return executeAfcOperation(lease, [path, mode, handle](afc_client_t client) {
+        return afc_file_open(client, path, mode, handle);
+    });
+}
+
+afc_error_t ServiceManager::safeAfcFileRead(const AfcClientLease &lease,
+                                            uint64_t handle, char *data,
+                                            uint32_t length,
+                                            uint32_t *bytes_read)
+{
+    return executeAfcOperation(
+        lease, [handle, data, length, bytes_read](afc_client_t client) {
+            return afc_file_read(client, handle, data, length, bytes_read);
+        });
+}
+
+afc_error_t ServiceManager::safeAfcFileWrite(const AfcClientLease &lease,
+                                             uint64_t handle, const char *data,
+                                             uint32_t length,
+                                             uint32_t *bytes_written)
+{
+    return executeAfcOperation(
+        lease, [handle, data, length, bytes_written](afc_client_t client) {
+            return afc_file_write(client, handle, data, length, bytes_written);
+        });
+}
+
+afc_error_t ServiceManager::safeAfcFileClose(const AfcClientLease &lease,
+                                             uint64_t handle)
+{
+    return executeAfcOperation(lease, [handle](afc_client_t client) {
+        return afc_file_close(client, handle);
+    });
+}
+
+afc_error_t ServiceManager::safeAfcFileSeek(const AfcClientLease &lease,
+                                            uint64_t handle, int64_t offset,
+                                            int whence)
+{
+    return executeAfcOperation(
+        lease, [handle, offset, whence](afc_client_t client) {
+            return afc_file_seek(client, handle, offset, whence);
+        });
+}
+
+afc_error_t ServiceManager::safeAfcFileTell(const AfcClientLease &lease,
+                                            uint64_t handle, uint64_t *position)
+{
+    return executeAfcOperation(lease, [handle, position](afc_client_t client) {
+        return afc_file_tell(client, handle, position);
+    });
+}
+
+QByteArray
+ServiceManager::safeReadAfcFileToByteArray(const AfcClientLease &lease,
+                                           const char *path)
+{
+    return executeOperation<QByteArray>(
+        lease, [path](afc_client_t client) -> QByteArray {
+            return read_afc_file_to_byte_array(client, path);
+        });
+}
+
+AFCFileTree ServiceManager::safeGetFileTree(const AfcClientLease &lease,
+                                            const std::string &path,
+                                            bool checkDir)
 {
     return executeOperation<AFCFileTree>(
-        device,
-        [path, checkDir](afc_client_t client) -> AFCFileTree {
+        lease, [path, checkDir](afc_client_t client) -> AFCFileTree {
             return get_file_tree(client, path.c_str(), checkDir);
-        },
-        altAfc);
-}
\ No newline at end of file
+        });
+}
@@ -20,13 +20,18 @@
 #ifndef SERVICEMANAGER_H
 #define SERVICEMANAGER_H
 
+#include "afcclientpool.h"
 #include "iDescriptor.h"
 #include <QDebug>
+#include <atomic>
 #include <functional>
 #include <libimobiledevice/afc.h>
 #include <mutex>
 #include <optional>
 
+// Number of directory entries stat'ed per request batch in safeListDirectory
+#define AFC_LIST_BATCH_SIZE 64
+
 /**
  * @brief Centralized manager for device service operations with thread safety
  *
@@ -34,6 +39,10 @@
  * crashes when devices are unplugged during active operations. It uses a
  * per-device recursive mutex to ensure that device cleanup waits for all
  * operations to complete.
+ *
+ * Operations that do not need the primary AFC client can lease a client from
+ * the device's AfcClientPool instead. Leased operations do not take the device
+ * mutex, so independent work (thumbnails, exports, streaming) runs in parallel.
  */
 class ServiceManager
 {
@@ -170,7 +179,41 @@ public:
         }
     }
 
-    // Specific AFC operation wrappers
+    /**
+     * @brief Lease a dedicated AFC client from the device's pool
+     * @param wait Block until a client is available instead of failing fast
+     * @return An invalid lease if the device is gone or no client is available
+     */
+    static AfcClientLease leaseAfcClient(iDescriptorDevice *device,
+                                         bool wait = true);
+
+    static afc_error_t
+    executeAfcOperation(const AfcClientLease &lease,
+                        std::function<afc_error_t(afc_client_t)> operation)
+    {
+        if (!lease) {
+            return AFC_E_INVALID_ARG;
+        }
+        return lease.execute(operation);
+    }
+
+    template <typename T>
+    static T executeOperation(const AfcClientLease &lease,
+                              std::function<T(afc_client_t)> operation)
+    {
+        T value{};
+        if (!lease) {
+            return value;
+        }
+        lease.execute([&value, &operation](afc_client_t client) {
+            value = operation(client);
+            return AFC_E_SUCCESS;
+        });
+        return value;
+    }
+
+    // Specific AFC operation wrappers. Directory listings, stat calls and
+    // whole-file reads without altAfc run on a free pooled client if any.
     static afc_error_t
     safeAfcReadDirectory(iDescriptorDevice *device, const char *path,
                          char ***dirs,
@@ -217,6 +260,68 @@ public:
     safeGetFileTree(iDescriptorDevice *device, const std::string &path = "/",
                     bool checkDir = true,
                     std::optional<afc_client_t> altAfc = std::nullopt);
+
+    /**
+     * @brief List a directory with type, size and timestamps for every entry
+     *
+     * The directory is read once, then its entries are stat'ed in batches of
+     * AFC_LIST_BATCH_SIZE. Batches are spread across every pooled AFC client
+     * that is free, so several stat requests are in flight at once. Without
+     * free pooled clients (or with altAfc) a single worker does the work.
+     * Listings of the media domain are served from and stored in the
+     * DirectoryCache.
+     *
+     * @param onBatch Called for each batch in directory order, never
+     *                concurrently, from whichever thread finished it
+     * @param cancelled Optional flag, checked between batches
+     * @return false if the directory could not be read or the listing was
+     *         cancelled
+     */
+    static bool safeListDirectory(
+        iDescriptorDevice *device, const std::string &path,
+        const std::function<void(const std::vector<MediaEntry> &)> &onBatch,
+        std::optional<afc_client_t> altAfc = std::nullopt,
+        const std::atomic<bool> *cancelled = nullptr);
+
+    /**
+     * @brief Whether an operation runs in the device's media AFC domain
+     *
+     * Clears altAfc when it is the device's primary client, so such calls
+     * can still use pooled clients and the DirectoryCache.
+     */
+    static bool usesMediaDomain(iDescriptorDevice *device,
+                                std::optional<afc_client_t> &altAfc);
+
+    // Lease-bound AFC operation wrappers, file handles stay bound to the lease
+    static afc_error_t safeAfcReadDirectory(const AfcClientLease &lease,
+                                            const char *path, char ***dirs);
+    static afc_error_t safeAfcGetFileInfo(const AfcClientLease &lease,
+                                          const char *path, char ***info);
+    static afc_error_t safeAfcGetFileInfoPlist(const AfcClientLease &lease,
+                                               const char *path,
+                                               plist_t *info);
+    static afc_error_t safeAfcFileOpen(const AfcClientLease &lease,
+                                       const char *path, afc_file_mode_t mode,
+                                       uint64_t *handle);
+    static afc_error_t safeAfcFileRead(const AfcClientLease &lease,
+                                       uint64_t handle, char *data,
+                                       uint32_t length, uint32_t *bytes_read);
+    static afc_error_t safeAfcFileWrite(const AfcClientLease &lease,
+                                        uint64_t handle, const char *data,
+                                        uint32_t length,
+                                        uint32_t *bytes_written);
+    static afc_error_t safeAfcFileClose(const AfcClientLease &lease,
+                                        uint64_t handle);
+    static afc_error_t safeAfcFileSeek(const AfcClientLease &lease,
+                                       uint64_t handle, int64_t offset,
+                                       int whence);
+    static afc_error_t safeAfcFileTell(const AfcClientLease &lease,
+                                       uint64_t handle, uint64_t *position);
+    static QByteArray safeReadAfcFileToByteArray(const AfcClientLease &lease,
+                                                 const char *path);
+    static AFCFileTree safeGetFileTree(const AfcClientLease &lease,
+                                       const std::string &path = "/",
+                                       bool checkDir = true);
 };
 
 #endif // SERVICEMANAGER_H
@@ -0,0 +1,299 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "servicesessioncache.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QThread>
+#include <QTimer>
+#include <libimobiledevice/lockdown.h>
+
+static void *startSimulateLocation(idevice_t device)
+{
+    lockdownd_client_t lockdown = nullptr;
+    lockdownd_error_t lerr =
+        lockdownd_client_new_with_handshake(device, &lockdown, TOOL_NAME);
+    if (lerr != LOCKDOWN_E_SUCCESS) {
+        qDebug() << "Could not connect to lockdownd:"
+                 << lockdownd_strerror(lerr);
+        return nullptr;
+    }
+
+    lockdownd_service_descriptor_t svc = nullptr;
+    lerr = lockdownd_start_service(lockdown, DT_SIMULATELOCATION_SERVICE, &svc);
+    lockdownd_client_free(lockdown);
+    if (lerr != LOCKDOWN_E_SUCCESS) {
+        qDebug() << "Could not start" << DT_SIMULATELOCATION_SERVICE << ":"
+                 << lockdownd_strerror(lerr);
+        return nullptr;
+    }
+
+    service_client_t service = nullptr;
+    service_error_t serr = service_client_new(device, svc, &service);
+    lockdownd_service_descriptor_free(svc);
+    if (serr != SERVICE_E_SUCCESS) {
+        qDebug() << "Could not connect to" << DT_SIMULATELOCATION_SERVICE
+                 << ":" << serr;
+        return nullptr;
+    }
+    return service;
+}
+
+static void freeSimulateLocation(void *client)
+{
+    service_client_free(static_cast<service_client_t>(client));
+}
+
+static void *startDiagnosticsRelay(idevice_t device)
+{
+    lockdownd_client_t lockdown = nullptr;
+    lockdownd_error_t lerr =
+        lockdownd_client_new_with_handshake(device, &lockdown, TOOL_NAME);
+    if (lerr != LOCKDOWN_E_SUCCESS) {
+        qDebug() << "Could not connect to lockdownd:"
+                 << lockdownd_strerror(lerr);
+        return nullptr;
+    }
+
+    // The newer service is available on iOS 5 and later
+    lockdownd_service_descriptor_t svc = nullptr;
+    lerr = lockdownd_start_service(lockdown,
+                                   "com.apple.mobile.diagnostics_relay", &svc);
+    if (lerr == LOCKDOWN_E_INVALID_SERVICE) {
+        lerr = lockdownd_start_service(lockdown,
+                                       "com.apple.iosdiagnostics.relay", &svc);
+    }
+    lockdownd_client_free(lockdown);
+    if (lerr != LOCKDOWN_E_SUCCESS) {
+        qDebug() << "Could not start diagnostics relay:"
+                 << lockdownd_strerror(lerr);
+        return nullptr;
+    }
+
+    diagnostics_relay_client_t client = nullptr;
+    diagnostics_relay_error_t err =
+        diagnostics_relay_client_new(device, svc, &client);
+    lockdownd_service_descriptor_free(svc);
+    if (err != DIAGNOSTICS_RELAY_E_SUCCESS) {
+        qDebug() << "Could not connect to diagnostics relay:" << err;
+        return nullptr;
+    }
+    return client;
+}
+
+static void freeDiagnosticsRelay(void *client)
+{
+    auto *relay = static_cast<diagnostics_relay_client_t>(client);
+    diagnostics_relay_goodbye(relay);
+    diagnostics_relay_client_free(relay);
+}
+
+static void *startScreenshotr(idevice_t device)
+{
+    screenshotr_client_t client = nullptr;
+    screenshotr_error_t err =
+        screenshotr_client_start_service(device, &client, TOOL_NAME);
+    if (err != SCREENSHOTR_E_SUCCESS) {
+        qDebug() << "Could not start screenshot service:" << err;
+        return nullptr;
+    }
+    return client;
+}
+
+static void freeScreenshotr(void *client)
+{
+    screenshotr_client_free(static_cast<screenshotr_client_t>(client));
+}
+
+ServiceSessionCache *ServiceSessionCache::sharedInstance()
+{
+    static ServiceSessionCache self;
+    return &self;
+}
+
+ServiceSessionCache::ServiceSessionCache(QObject *parent)
+    : QObject(parent), m_idleTimer(new QTimer(this))
+{
+    m_idleTimer->setInterval(SERVICE_SESSION_SWEEP_INTERVAL_MS);
+    connect(m_idleTimer, &QTimer::timeout, this,
+            &ServiceSessionCache::closeIdleSessions);
+
+    // The first user may be a worker thread, the timer belongs on the GUI
+    // thread
+    if (QCoreApplication *app = QCoreApplication::instance()) {
+        moveToThread(app->thread());
+    }
+    QMetaObject::invokeMethod(m_idleTimer, qOverload<>(&QTimer::start),
+                              Qt::QueuedConnection);
+}
+
+ServiceSessionCache::~ServiceSessionCache()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &[udid, device] : m_devices) {
+        device->removed = true;
+        for (Session &session : device->sessions) {
+            std::lock_guard<std::mutex> sessionLock(session.mutex);
+            closeSession(session);
+        }
+    }
+    m_devices.clear();
+}
+
+bool ServiceSessionCache::withSimulateLocation(
+    iDescriptorDevice *device,
+    const std::function<bool(service_client_t)> &operation)
+{
+    return run(device, SimulateLocation, startSimulateLocation,
+               freeSimulateLocation, [&operation](void *client) {
+                   return operation(static_cast<service_client_t>(client));
+               });
+}
+
+bool ServiceSessionCache::withDiagnosticsRelay(
+    iDescriptorDevice *device,
+    const std::function<bool(diagnostics_relay_client_t)> &operation)
+{
+    return run(device, DiagnosticsRelay, startDiagnosticsRelay,
+               freeDiagnosticsRelay, [&operation](void *client) {
+                   return operation(
+                       static_cast<diagnostics_relay_client_t>(client));
+               });
+}
+
+bool ServiceSessionCache::withScreenshotr(
+    iDescriptorDevice *device,
+    const std::function<bool(screenshotr_client_t)> &operation)
+{
+    return run(device, Screenshotr, startScreenshotr, freeScreenshotr,
+               [&operation](void *client) {
+                   return operation(static_cast<screenshotr_client_t>(client));
+               });
+}
+
+std::shared_ptr<ServiceSessionCache::DeviceSessions>
+ServiceSessionCache::sessionsFor(iDescriptorDevice *device)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return sessionsForLocked(device);
+}
+
+std::shared_ptr<ServiceSessionCache::DeviceSessions>
+ServiceSessionCache::sessionsForLocked(iDescriptorDevice *device)
+{
+    std::shared_ptr<DeviceSessions> &sessions = m_devices[device->udid];
+    // A removed entry is kept until the device is plugged in again, so late
+    // callers on the removed device fail instead of opening new sessions
+    if (!sessions || sessions->device != device->device) {
+        sessions = std::make_shared<DeviceSessions>();
+        sessions->device = device->device;
+    }
+    return sessions;
+}
+
+bool ServiceSessionCache::run(iDescriptorDevice *device, Kind kind,
+                              void *(*startClient)(idevice_t),
+                              void (*freeClient)(void *),
+                              const std::function<bool(void *)> &operation)
+{
+    if (!device || !device->device) {
+        return false;
+    }
+
+    std::shared_ptr<DeviceSessions> sessions = sessionsFor(device);
+    Session &session = sessions->sessions[kind];
+    std::lock_guard<std::mutex> lock(session.mutex);
+    if (sessions->removed) {
+        return false;
+    }
+
+    if (!session.client) {
+        session.client = startClient(sessions->device);
+        if (!session.client) {
+            return false;
+        }
+        session.freeClient = freeClient;
+    }
+
+    bool ok = false;
+    try {
+        ok = operation(session.client);
+    } catch (const std::exception &e) {
+        qDebug() << "Exception in service session operation:" << e.what();
+    }
+    session.lastUsed = Clock::now();
+
+    // The connection may be broken, start over on the next call
+    if (!ok) {
+        closeSession(session);
+    }
+    return ok;
+}
+
+void ServiceSessionCache::closeSession(Session &session)
+{
+    if (session.client && session.freeClient) {
+        session.freeClient(session.client);
+    }
+    session.client = nullptr;
+}
+
+void ServiceSessionCache::closeIdleSessions()
+{
+    std::vector<std::shared_ptr<DeviceSessions>> devices;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto &[udid, sessions] : m_devices) {
+            devices.push_back(sessions);
+        }
+    }
+
+    const Clock::time_point cutoff =
+        Clock::now() -
+        std::chrono::milliseconds(SERVICE_SESSION_IDLE_TIMEOUT_MS);
+    for (const std::shared_ptr<DeviceSessions> &device : devices) {
+        for (Session &session : device->sessions) {
+            // A session that is in use is not idle
+            std::unique_lock<std::mutex> lock(session.mutex, std::try_to_lock);
+            if (lock.owns_lock() && session.client &&
+                session.lastUsed < cutoff) {
+                closeSession(session);
+            }
+        }
+    }
+}
+
+void ServiceSessionCache::removeDevice(iDescriptorDevice *device)
+{
+    std::shared_ptr<DeviceSessions> sessions;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Leave a removed entry even when no session was opened yet, so a
+        // bring-up stage that finishes late can not open one
+        sessions = sessionsForLocked(device);
+        sessions->removed = true;
+    }
+
+    for (Session &session : sessions->sessions) {
+        // Waits for an operation in flight, it fails fast on an unplugged
+        // device
+        std::lock_guard<std::mutex> lock(session.mutex);
+        closeSession(session);
+    }
+}
@@ -0,0 +1,117 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SERVICESESSIONCACHE_H
+#define SERVICESESSIONCACHE_H
+
+#include "iDescriptor.h"
+#include <QObject>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <libimobiledevice/diagnostics_relay.h>
+#include <libimobiledevice/screenshotr.h>
+#include <libimobiledevice/service.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class QTimer;
+
+#define DT_SIMULATELOCATION_SERVICE "com.apple.dt.simulatelocation"
+// Sessions not used for this long are closed
+#define SERVICE_SESSION_IDLE_TIMEOUT_MS 60000
+#define SERVICE_SESSION_SWEEP_INTERVAL_MS 15000
+
+/**
+ * @brief Per-device cache of lockdown service connections
+ *
+ * Starting a service costs a lockdown handshake and a new TLS connection,
+ * which dominates short requests like a single location update or an
+ * IORegistry query. Sessions are started on first use and reused by later
+ * calls. A session is closed when an operation on it fails, when it was idle
+ * for SERVICE_SESSION_IDLE_TIMEOUT_MS, or when its device is removed.
+ *
+ * Operations on the same session are serialized, so a client is never used
+ * by two threads at once. Safe to use from any thread.
+ */
+class ServiceSessionCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ServiceSessionCache *sharedInstance();
+
+    /*
+     * Run operation on the device's cached client, starting the service when
+     * needed. Returns false when the service could not be started or the
+     * operation returned false, in which case the session is closed so the
+     * next call reconnects.
+     */
+    bool withSimulateLocation(
+        iDescriptorDevice *device,
+        const std::function<bool(service_client_t)> &operation);
+    bool withDiagnosticsRelay(
+        iDescriptorDevice *device,
+        const std::function<bool(diagnostics_relay_client_t)> &operation);
+    bool withScreenshotr(
+        iDescriptorDevice *device,
+        const std::function<bool(screenshotr_client_t)> &operation);
+
+    // Waits for running operations, must be called before the device is freed
+    void removeDevice(iDescriptorDevice *device);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    enum Kind { SimulateLocation, DiagnosticsRelay, Screenshotr, KindCount };
+
+    struct Session {
+        std::mutex mutex;
+        void *client = nullptr;
+        void (*freeClient)(void *) = nullptr;
+        Clock::time_point lastUsed;
+    };
+
+    struct DeviceSessions {
+        idevice_t device = nullptr;
+        std::atomic<bool> removed{false};
+        Session sessions[KindCount];
+    };
+
+    explicit ServiceSessionCache(QObject *parent = nullptr);
+    ~ServiceSessionCache();
+
+    std::shared_ptr<DeviceSessions> sessionsFor(iDescriptorDevice *device);
+    // Same, m_mutex must be held
+    std::shared_ptr<DeviceSessions>
+    sessionsForLocked(iDescriptorDevice *device);
+    bool run(iDescriptorDevice *device, Kind kind,
+             void *(*startClient)(idevice_t), void (*freeClient)(void *),
+             const std::function<bool(void *)> &operation);
+    static void closeSession(Session &session);
+    void closeIdleSessions();
+
+    std::mutex m_mutex; // guards m_devices
+    std::unordered_map<std::string, std::shared_ptr<DeviceSessions>> m_devices;
+    QTimer *m_idleTimer;
+};
+
+#endif // SERVICESESSIONCACHE_H
@@ -168,6 +168,39 @@ void SettingsManager::setConnectionTimeout(int seconds)
     m_settings->sync();
 }
 
+int SettingsManager::exportConcurrency() const
+{
+    return m_settings->value("exportConcurrency", 3).toInt();
+}
+
+void SettingsManager::setExportConcurrency(int transfers)
+{
+    m_settings->setValue("exportConcurrency", transfers);
+    m_settings->sync();
+}
+
+bool SettingsManager::incrementalExport() const
+{
+    return m_settings->value("incrementalExport", false).toBool();
+}
+
+void SettingsManager::setIncrementalExport(bool enabled)
+{
+    m_settings->setValue("incrementalExport", enabled);
+    m_settings->sync();
+}
+
+bool SettingsManager::verifyExportChecksum() const
+{
+    return m_settings->value("verifyExportChecksum", false).toBool();
+}
+
+void SettingsManager::setVerifyExportChecksum(bool enabled)
+{
+    m_settings->setValue("verifyExportChecksum", enabled);
+    m_settings->sync();
+}
+
 int SettingsManager::wirelessFileServerPort() const
 {
     return m_settings->value("wirelessFileServerPort", 8080).toInt();
@@ -250,6 +283,9 @@ void SettingsManager::resetToDefaults()
     setAirplayFps(60);
     setAirplayNoHold(true);
     setWirelessFileServerPort(8080);
+    setExportConcurrency(3);
+    setIncrementalExport(false);
+    setVerifyExportChecksum(false);
 #ifdef __linux__
     setShowV4L2(false);
 #endif
@@ -89,6 +89,15 @@ public:
     int wirelessFileServerPort() const;
     void setWirelessFileServerPort(int port);
 
+    int exportConcurrency() const;
+    void setExportConcurrency(int transfers);
+
+    bool incrementalExport() const;
+    void setIncrementalExport(bool enabled);
+
+    bool verifyExportChecksum() const;
+    void setVerifyExportChecksum(bool enabled);
+
     bool showKeychainDialog() const;
     void setShowKeychainDialog(bool show);
 
@@ -18,6 +18,7 @@
  */
 
 #include "settingswidget.h"
+#include "afcclientpool.h"
 #include "mainwindow.h"
 #include "settingsmanager.h"
 #include <QCheckBox>
@@ -87,6 +88,30 @@ void SettingsWidget::setupUI()
     portLayout->addStretch();
     generalLayout->addLayout(portLayout);
 
+    // Parallel export transfers
+    auto *exportLayout = new QHBoxLayout();
+    exportLayout->addWidget(new QLabel("Parallel Export Transfers:"));
+    m_exportConcurrency = new QSpinBox();
+    m_exportConcurrency->setRange(1, AFC_POOL_DEFAULT_MAX_CLIENTS);
+    m_exportConcurrency->setToolTip(
+        "How many files are copied at the same time per export.");
+    exportLayout->addWidget(m_exportConcurrency);
+    exportLayout->addStretch();
+    generalLayout->addLayout(exportLayout);
+
+    m_incrementalExport =
+        new QCheckBox("Skip files that were already exported");
+    m_incrementalExport->setToolTip(
+        "Keeps a manifest in the export folder so unchanged files are "
+        "skipped and interrupted large files are resumed.");
+    generalLayout->addWidget(m_incrementalExport);
+
+    m_verifyExportChecksum = new QCheckBox("Verify exported files");
+    m_verifyExportChecksum->setToolTip(
+        "Compares a SHA-256 checksum of the copied data with the file "
+        "written to disk. Slower, but detects corrupted copies.");
+    generalLayout->addWidget(m_verifyExportChecksum);
+
     // Unmount iFuse drives on exit (not implemented on macOS)
     // TODO: Implement
 #ifndef __APPLE__
@@ -288,6 +313,9 @@ void SettingsWidget::loadSettings()
     }
 
     m_connectionTimeout->setValue(sm->connectionTimeout());
+    m_exportConcurrency->setValue(sm->exportConcurrency());
+    m_incrementalExport->setChecked(sm->incrementalExport());
+    m_verifyExportChecksum->setChecked(sm->verifyExportChecksum());
     m_useUnsecureBackend->setChecked(sm->useUnsecureBackend());
     m_defaultJailbrokenRootPassword->setText(
         sm->defaultJailbrokenRootPassword());
@@ -323,6 +351,12 @@ void SettingsWidget::connectSignals()
     connect(m_wirelessFileServerPort,
             QOverload<int>::of(&QSpinBox::valueChanged), this,
             &SettingsWidget::onSettingChanged);
+    connect(m_exportConcurrency, QOverload<int>::of(&QSpinBox::valueChanged),
+            this, &SettingsWidget::onSettingChanged);
+    connect(m_incrementalExport, &QCheckBox::toggled, this,
+            &SettingsWidget::onSettingChanged);
+    connect(m_verifyExportChecksum, &QCheckBox::toggled, this,
+            &SettingsWidget::onSettingChanged);
 
     connect(m_iconSizeBaseMultiplier,
             QOverload<double>::of(&QDoubleSpinBox::valueChanged), this,
@@ -437,6 +471,9 @@ void SettingsWidget::saveSettings()
     sm->setAutoRaiseWindow(m_autoRaiseWindow->isChecked());
     sm->setSwitchToNewDevice(m_switchToNewDevice->isChecked());
     sm->setWirelessFileServerPort(m_wirelessFileServerPort->value());
+    sm->setExportConcurrency(m_exportConcurrency->value());
+    sm->setIncrementalExport(m_incrementalExport->isChecked());
+    sm->setVerifyExportChecksum(m_verifyExportChecksum->isChecked());
 
 #ifndef __APPLE__
     sm->setUnmountiFuseOnExit(m_unmount_iFuseDrives->isChecked());
@@ -53,6 +53,9 @@ private:
     // General
     QLineEdit *m_downloadPathEdit;
     QSpinBox *m_wirelessFileServerPort;
+    QSpinBox *m_exportConcurrency;
+    QCheckBox *m_incrementalExport;
+    QCheckBox *m_verifyExportChecksum;
     QCheckBox *m_autoUpdateCheck;
     QComboBox *m_themeCombo;
     QCheckBox *m_autoRaiseWindow;
@@ -0,0 +1,337 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "thumbnailstore.h"
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QReadLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QWriteLocker>
+#include <algorithm>
+
+#define THUMBNAIL_INDEX_MAGIC 0x69445448 // "iDTH"
+#define THUMBNAIL_INDEX_VERSION 1
+
+ThumbnailStore *ThumbnailStore::sharedInstance()
+{
+    static ThumbnailStore self(
+        QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation))
+            .filePath("thumbnails"));
+    return &self;
+}
+
+QByteArray ThumbnailStore::makeKey(const std::string &udid,
+                                   const QString &filePath, qint64 fileSize,
+                                   quint64 modificationTime,
+                                   const QSize &thumbnailSize)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArrayView(udid.data(), udid.size()));
+    hash.addData(QByteArrayView("\0", 1));
+    hash.addData(filePath.toUtf8());
+    hash.addData(QByteArrayView("\0", 1));
+    hash.addData(QString("%1:%2:%3x%4")
+                     .arg(fileSize)
+                     .arg(modificationTime)
+                     .arg(thumbnailSize.width())
+                     .arg(thumbnailSize.height())
+                     .toLatin1());
+    return hash.result();
+}
+
+ThumbnailStore::ThumbnailStore(const QString &directory)
+    : m_packPath(QDir(directory).filePath("thumbnails.pack")),
+      m_indexPath(QDir(directory).filePath("thumbnails.idx"))
+{
+    QDir().mkpath(directory);
+    if (openPack()) {
+        loadIndex();
+    }
+}
+
+ThumbnailStore::~ThumbnailStore()
+{
+    QWriteLocker locker(&m_lock);
+    saveIndex();
+    if (m_map) {
+        m_pack.unmap(m_map);
+    }
+}
+
+bool ThumbnailStore::openPack()
+{
+    m_pack.setFileName(m_packPath);
+    if (!m_pack.open(QIODevice::ReadWrite)) {
+        qWarning() << "Could not open thumbnail store" << m_packPath << ":"
+                   << m_pack.errorString();
+        return false;
+    }
+    m_packSize = m_pack.size();
+    m_pack.seek(m_packSize);
+    remapPack();
+    return true;
+}
+
+// Callers hold the write lock
+void ThumbnailStore::remapPack()
+{
+    if (m_map) {
+        m_pack.unmap(m_map);
+        m_map = nullptr;
+    }
+    // The mapping only sees what left QFile's write buffer
+    m_pack.flush();
+    m_mappedSize = m_packSize;
+    if (m_mappedSize > 0) {
+        m_map = m_pack.map(0, m_mappedSize);
+        if (!m_map) {
+            m_mappedSize = 0;
+        }
+    }
+}
+
+bool ThumbnailStore::isMapped(const Record &record) const
+{
+    return m_map && record.offset + record.length <= m_mappedSize;
+}
+
+void ThumbnailStore::loadIndex()
+{
+    QFile file(m_indexPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint64 clock = 0;
+    quint32 count = 0;
+    stream >> magic >> version >> clock >> count;
+    if (magic != THUMBNAIL_INDEX_MAGIC || version != THUMBNAIL_INDEX_VERSION) {
+        qWarning() << "Ignoring incompatible thumbnail index" << m_indexPath;
+        return;
+    }
+
+    m_clock = clock;
+    const qint64 packSize = m_pack.size();
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QByteArray key;
+        auto record = std::make_shared<Record>();
+        qint64 lastUsed = 0;
+        stream >> key >> record->offset >> record->length >> lastUsed;
+        record->lastUsed = lastUsed;
+        // The pack may have been truncated after the index was written
+        if (record->offset >= 0 && record->length > 0 &&
+            record->offset + record->length <= packSize) {
+            m_records.insert(key, record);
+        }
+    }
+}
+
+// Callers hold the write lock
+void ThumbnailStore::saveIndex()
+{
+    QSaveFile file(m_indexPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    // Never let the index point past what reached the pack file
+    if (m_pack.isOpen()) {
+        m_pack.flush();
+    }
+
+    QDataStream stream(&file);
+    stream << quint32(THUMBNAIL_INDEX_MAGIC) << quint32(THUMBNAIL_INDEX_VERSION)
+           << qint64(m_clock.load()) << quint32(m_records.size());
+    for (auto it = m_records.constBegin(); it != m_records.constEnd(); ++it) {
+        stream << it.key() << it.value()->offset << it.value()->length
+               << qint64(it.value()->lastUsed.load());
+    }
+    if (!file.commit()) {
+        qWarning() << "Could not write thumbnail index" << m_indexPath;
+    }
+    m_insertsSinceSave = 0;
+}
+
+QImage ThumbnailStore::find(const QByteArray &key)
+{
+    QByteArray encoded;
+    {
+        QReadLocker locker(&m_lock);
+        auto it = m_records.constFind(key);
+        if (it == m_records.constEnd()) {
+            return QImage();
+        }
+        if (!isMapped(*it.value())) {
+            // Inserted since the pack was last mapped, one remap covers
+            // everything appended in the meantime
+            locker.unlock();
+            {
+                QWriteLocker writeLocker(&m_lock);
+                auto record = m_records.value(key);
+                if (record && !isMapped(*record)) {
+                    remapPack();
+                }
+            }
+            locker.relock();
+            it = m_records.constFind(key);
+            if (it == m_records.constEnd() || !isMapped(*it.value())) {
+                return QImage();
+            }
+        }
+        const Record &record = *it.value();
+        encoded = QByteArray(reinterpret_cast<const char *>(m_map) +
+                                 record.offset,
+                             record.length);
+        it.value()->lastUsed = ++m_clock;
+    }
+
+    // Decode outside the lock so lookups on other threads are not held up
+    return QImage::fromData(encoded);
+}
+
+void ThumbnailStore::insert(const QByteArray &key, const QImage &thumbnail)
+{
+    if (thumbnail.isNull()) {
+        return;
+    }
+
+    QByteArray encoded;
+    QBuffer buffer(&encoded);
+    buffer.open(QIODevice::WriteOnly);
+    if (thumbnail.hasAlphaChannel()) {
+        thumbnail.save(&buffer, "PNG");
+    } else {
+        thumbnail.save(&buffer, "JPG", THUMBNAIL_STORE_JPEG_QUALITY);
+    }
+    if (encoded.isEmpty()) {
+        return;
+    }
+
+    QWriteLocker locker(&m_lock);
+    if (!m_pack.isOpen() || m_records.contains(key)) {
+        return;
+    }
+
+    if (m_packSize + encoded.size() > THUMBNAIL_STORE_MAX_SIZE) {
+        compact(qint64(THUMBNAIL_STORE_MAX_SIZE) *
+                    THUMBNAIL_STORE_COMPACT_PERCENT / 100 -
+                encoded.size());
+    }
+
+    // The file position stays at the end of the pack, find() maps the new
+    // record when it is first looked up
+    const qint64 offset = m_packSize;
+    if (m_pack.write(encoded) != encoded.size()) {
+        qWarning() << "Could not write to thumbnail store:"
+                   << m_pack.errorString();
+        m_pack.resize(offset);
+        m_pack.seek(offset);
+        return;
+    }
+    m_packSize += encoded.size();
+
+    auto record = std::make_shared<Record>();
+    record->offset = offset;
+    record->length = encoded.size();
+    record->lastUsed = ++m_clock;
+    m_records.insert(key, record);
+
+    if (++m_insertsSinceSave >= THUMBNAIL_STORE_INDEX_SAVE_INTERVAL) {
+        saveIndex();
+    }
+}
+
+// Callers hold the write lock
+void ThumbnailStore::compact(qint64 targetSize)
+{
+    // Keep the most recently used thumbnails that fit in the target size
+    QList<QPair<QByteArray, std::shared_ptr<Record>>> records;
+    for (auto it = m_records.constBegin(); it != m_records.constEnd(); ++it) {
+        records.append({it.key(), it.value()});
+    }
+    std::sort(records.begin(), records.end(), [](const auto &a, const auto &b) {
+        return a.second->lastUsed.load() > b.second->lastUsed.load();
+    });
+
+    // Records appended since the last remap are copied from the map too
+    remapPack();
+
+    const QString tempPath = m_packPath + ".tmp";
+    QFile compacted(tempPath);
+    if (!m_map || !compacted.open(QIODevice::WriteOnly)) {
+        // Nothing to copy from, start over
+        m_records.clear();
+        if (m_map) {
+            m_pack.unmap(m_map);
+            m_map = nullptr;
+        }
+        m_mappedSize = 0;
+        m_pack.resize(0);
+        m_pack.seek(0);
+        m_packSize = 0;
+        return;
+    }
+
+    QHash<QByteArray, std::shared_ptr<Record>> kept;
+    qint64 size = 0;
+    for (const auto &entry : records) {
+        const std::shared_ptr<Record> &record = entry.second;
+        if (size + record->length > targetSize) {
+            break;
+        }
+        if (compacted.write(reinterpret_cast<const char *>(m_map) +
+                                record->offset,
+                            record->length) != record->length) {
+            break;
+        }
+        record->offset = size;
+        size += record->length;
+        kept.insert(entry.first, record);
+    }
+    compacted.close();
+
+    qDebug() << "Compacted thumbnail store from" << m_records.size() << "to"
+             << kept.size() << "thumbnails";
+
+    m_pack.unmap(m_map);
+    m_map = nullptr;
+    m_pack.close();
+    QFile::remove(m_packPath);
+    if (!QFile::rename(tempPath, m_packPath)) {
+        qWarning() << "Could not replace thumbnail store" << m_packPath;
+        kept.clear();
+    }
+    m_records = kept;
+    if (openPack()) {
+        if (m_records.isEmpty()) {
+            m_pack.resize(0);
+            m_pack.seek(0);
+            m_packSize = 0;
+            remapPack();
+        }
+        saveIndex();
+    }
+}
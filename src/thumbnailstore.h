@@ -0,0 +1,97 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef THUMBNAILSTORE_H
+#define THUMBNAILSTORE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QReadWriteLock>
+#include <QSize>
+#include <QString>
+#include <atomic>
+#include <memory>
+
+// Size cap of the pack file, least recently used thumbnails are dropped
+// down to THUMBNAIL_STORE_COMPACT_PERCENT of it when it is reached
+#define THUMBNAIL_STORE_MAX_SIZE (256 * 1024 * 1024)
+#define THUMBNAIL_STORE_COMPACT_PERCENT 75
+// The index is written after this many inserts and on exit
+#define THUMBNAIL_STORE_INDEX_SAVE_INTERVAL 64
+#define THUMBNAIL_STORE_JPEG_QUALITY 85
+
+/**
+ * @brief Persistent thumbnail cache shared by all devices
+ *
+ * Encoded thumbnails are appended to a single pack file that is memory-mapped
+ * for reading, an index maps each key to its record. Keys include the device,
+ * path, size and modification time of the source file, so a changed file
+ * never hits a stale thumbnail. Any number of threads can look up thumbnails
+ * at the same time, inserts and compaction take the lock exclusively.
+ */
+class ThumbnailStore
+{
+public:
+    static ThumbnailStore *sharedInstance();
+
+    static QByteArray makeKey(const std::string &udid, const QString &filePath,
+                              qint64 fileSize, quint64 modificationTime,
+                              const QSize &thumbnailSize);
+
+    // Returns a null image on a miss
+    QImage find(const QByteArray &key);
+    void insert(const QByteArray &key, const QImage &thumbnail);
+
+private:
+    struct Record {
+        qint64 offset = 0;
+        qint32 length = 0;
+        std::atomic<qint64> lastUsed{0};
+    };
+
+    explicit ThumbnailStore(const QString &directory);
+    ~ThumbnailStore();
+
+    ThumbnailStore(const ThumbnailStore &) = delete;
+    ThumbnailStore &operator=(const ThumbnailStore &) = delete;
+
+    bool openPack();
+    void remapPack();
+    bool isMapped(const Record &record) const;
+    void loadIndex();
+    void saveIndex();
+    void compact(qint64 targetSize);
+
+    const QString m_packPath;
+    const QString m_indexPath;
+
+    QReadWriteLock m_lock;
+    QFile m_pack;
+    uchar *m_map = nullptr;
+    qint64 m_mappedSize = 0;
+    // Appends stay buffered, m_pack.size() and seek() would flush them
+    qint64 m_packSize = 0;
+    QHash<QByteArray, std::shared_ptr<Record>> m_records;
+    std::atomic<qint64> m_clock{0};
+    int m_insertsSinceSave = 0;
+};
+
+#endif // THUMBNAILSTORE_H
@@ -25,6 +25,7 @@
 #include "settingsmanager.h"
 #include <QDebug>
 #include <QDoubleValidator>
+#include <QFileDialog>
 #include <QGeoCoordinate>
 #include <QGridLayout>
 #include <QGroupBox>
@@ -111,6 +112,9 @@ VirtualLocation::VirtualLocation(iDescriptorDevice *device, QWidget *parent)
     m_applyButton->setDefault(true);
     m_rightLayout->addWidget(m_applyButton);
 
+    // Route playback section
+    setupRoutePlayback(m_rightLayout);
+
     // Recent locations section
     loadRecentLocations(m_rightLayout);
 
@@ -159,6 +163,9 @@ VirtualLocation::VirtualLocation(iDescriptorDevice *device, QWidget *parent)
     connect(AppContext::sharedInstance(), &AppContext::deviceRemoved, this,
             [this](const std::string &udid) {
                 if (m_device->udid == udid) {
+                    // The player sends from its own thread, stop it before
+                    // the device is freed
+                    m_routePlayer->stop();
                     this->close();
                     this->deleteLater();
                 }
@@ -330,12 +337,10 @@ void VirtualLocation::onApplyClicked()
                 // Visual feedback
                 m_applyButton->setText("Applied!");
 
+                const QByteArray lat = m_latitudeEdit->text().toUtf8();
+                const QByteArray lon = m_longitudeEdit->text().toUtf8();
                 bool locationSuccess = set_location(
-                    m_device->device,
-                    const_cast<char *>(
-                        m_latitudeEdit->text().toStdString().c_str()),
-                    const_cast<char *>(
-                        m_longitudeEdit->text().toStdString().c_str()));
+                    m_device, lat.constData(), lon.constData());
 
                 if (!locationSuccess) {
                     QMessageBox::warning(this, "Error",
@@ -486,3 +491,258 @@ void VirtualLocation::addLocationButtons(QLayout *layout,
         layout->addWidget(locationBtn);
     }
 }
+
+void VirtualLocation::setupRoutePlayback(QVBoxLayout *layout)
+{
+    m_routePlayer = new RoutePlayer(this);
+
+    QGroupBox *routeGroup = new QGroupBox("Route Playback");
+    layout->addWidget(routeGroup);
+    QVBoxLayout *routeLayout = new QVBoxLayout(routeGroup);
+
+    QHBoxLayout *sourceLayout = new QHBoxLayout();
+    m_loadRouteButton = new QPushButton("Load...");
+    m_loadRouteButton->setToolTip("Load a GPX or KML route");
+    m_drawRouteButton = new QPushButton("Draw");
+    m_drawRouteButton->setCheckable(true);
+    m_drawRouteButton->setToolTip("Click on the map to add route points");
+    m_clearRouteButton = new QPushButton("Clear");
+    sourceLayout->addWidget(m_loadRouteButton);
+    sourceLayout->addWidget(m_drawRouteButton);
+    sourceLayout->addWidget(m_clearRouteButton);
+    routeLayout->addLayout(sourceLayout);
+
+    m_routeInfoLabel = new QLabel("No route loaded");
+    m_routeInfoLabel->setWordWrap(true);
+    routeLayout->addWidget(m_routeInfoLabel);
+
+    QGridLayout *settingsLayout = new QGridLayout();
+    settingsLayout->addWidget(new QLabel("Speed (km/h):"), 0, 0);
+    m_speedSpinBox = new QDoubleSpinBox();
+    m_speedSpinBox->setRange(0.5, 500.0);
+    m_speedSpinBox->setDecimals(1);
+    m_speedSpinBox->setValue(ROUTE_PLAYER_DEFAULT_SPEED_MPS * 3.6);
+    settingsLayout->addWidget(m_speedSpinBox, 0, 1);
+    settingsLayout->addWidget(new QLabel("Updates/s:"), 1, 0);
+    m_rateSpinBox = new QSpinBox();
+    m_rateSpinBox->setRange(ROUTE_PLAYER_MIN_RATE_HZ,
+                            ROUTE_PLAYER_MAX_RATE_HZ);
+    m_rateSpinBox->setValue(ROUTE_PLAYER_DEFAULT_RATE_HZ);
+    settingsLayout->addWidget(m_rateSpinBox, 1, 1);
+    routeLayout->addLayout(settingsLayout);
+
+    m_routeSlider = new QSlider(Qt::Horizontal);
+    m_routeSlider->setRange(0, ROUTE_SLIDER_STEPS);
+    routeLayout->addWidget(m_routeSlider);
+
+    QHBoxLayout *playbackLayout = new QHBoxLayout();
+    m_playRouteButton = new QPushButton("Play");
+    m_stopRouteButton = new QPushButton("Stop");
+    playbackLayout->addWidget(m_playRouteButton);
+    playbackLayout->addWidget(m_stopRouteButton);
+    routeLayout->addLayout(playbackLayout);
+
+    m_routePlayer->setSpeed(m_speedSpinBox->value() / 3.6);
+    m_routePlayer->setUpdateRate(m_rateSpinBox->value());
+
+    connect(m_loadRouteButton, &QPushButton::clicked, this,
+            &VirtualLocation::onLoadRouteClicked);
+    connect(m_drawRouteButton, &QPushButton::toggled, this,
+            &VirtualLocation::onDrawRouteToggled);
+    connect(m_clearRouteButton, &QPushButton::clicked, this,
+            &VirtualLocation::onClearRouteClicked);
+    connect(m_playRouteButton, &QPushButton::clicked, this,
+            &VirtualLocation::onPlayRouteClicked);
+    connect(m_stopRouteButton, &QPushButton::clicked, m_routePlayer,
+            &RoutePlayer::stop);
+    connect(m_speedSpinBox, &QDoubleSpinBox::valueChanged, this,
+            [this](double kmh) { m_routePlayer->setSpeed(kmh / 3.6); });
+    connect(m_rateSpinBox, &QSpinBox::valueChanged, m_routePlayer,
+            &RoutePlayer::setUpdateRate);
+    connect(m_routeSlider, &QSlider::valueChanged, this,
+            &VirtualLocation::onRouteSliderValueChanged);
+    connect(m_routeSlider, &QSlider::sliderReleased, this, [this]() {
+        onRouteSliderValueChanged(m_routeSlider->value());
+    });
+
+    // Emitted from the player thread, queued to the GUI thread
+    connect(m_routePlayer, &RoutePlayer::positionChanged, this,
+            &VirtualLocation::onRoutePositionChanged);
+    connect(m_routePlayer, &RoutePlayer::stateChanged, this,
+            &VirtualLocation::updateRouteControls);
+    connect(m_routePlayer, &RoutePlayer::sendFailed, this, [this]() {
+        QMessageBox::warning(this, "Error",
+                             "Failed to set location on device, route "
+                             "playback was paused.");
+    });
+
+    updateRouteControls();
+}
+
+QQuickItem *VirtualLocation::mapItem() const
+{
+    QQuickItem *rootObject = m_quickWidget->rootObject();
+    return rootObject ? rootObject->findChild<QQuickItem *>("map") : nullptr;
+}
+
+void VirtualLocation::setRoute(const QList<QGeoCoordinate> &route)
+{
+    m_route = route;
+    m_routePlayer->setRoute(route);
+    {
+        const QSignalBlocker blocker(m_routeSlider);
+        m_routeSlider->setValue(0);
+    }
+
+    if (QQuickItem *map = mapItem()) {
+        QVariantList path;
+        for (const QGeoCoordinate &coordinate : route) {
+            path.append(QVariant::fromValue(coordinate));
+        }
+        QMetaObject::invokeMethod(map, "setRoutePath",
+                                  Q_ARG(QVariant, QVariant(path)));
+    }
+    updateRouteControls();
+}
+
+void VirtualLocation::onLoadRouteClicked()
+{
+    const QString path = QFileDialog::getOpenFileName(
+        this, "Load Route", QString(), "Routes (*.gpx *.kml);;All Files (*)");
+    if (path.isEmpty()) {
+        return;
+    }
+
+    QString error;
+    const QList<QGeoCoordinate> route =
+        RoutePlayer::loadRouteFile(path, &error);
+    if (route.isEmpty()) {
+        QMessageBox::warning(this, "Invalid Route",
+                             "Could not load the route: " + error);
+        return;
+    }
+
+    m_drawRouteButton->setChecked(false);
+    setRoute(route);
+    if (QQuickItem *map = mapItem()) {
+        QMetaObject::invokeMethod(map, "updateCenter",
+                                  Q_ARG(QVariant, route.first().latitude()),
+                                  Q_ARG(QVariant, route.first().longitude()));
+    }
+}
+
+void VirtualLocation::onDrawRouteToggled(bool drawing)
+{
+    if (drawing) {
+        m_routePlayer->stop();
+    }
+    if (QQuickItem *map = mapItem()) {
+        map->setProperty("drawingRoute", drawing);
+    }
+    updateRouteControls();
+}
+
+void VirtualLocation::addRoutePointFromMap(double latitude, double longitude)
+{
+    if (!m_drawRouteButton->isChecked()) {
+        return;
+    }
+    QList<QGeoCoordinate> route = m_route;
+    route.append(QGeoCoordinate(latitude, longitude));
+    setRoute(route);
+}
+
+void VirtualLocation::onClearRouteClicked()
+{
+    setRoute({});
+    if (QQuickItem *map = mapItem()) {
+        QMetaObject::invokeMethod(map, "clearPlaybackPosition");
+    }
+}
+
+void VirtualLocation::onPlayRouteClicked()
+{
+    switch (m_routePlayer->state()) {
+    case RoutePlayer::Playing:
+        m_routePlayer->pause();
+        return;
+    case RoutePlayer::Paused:
+        m_routePlayer->play(m_device);
+        return;
+    case RoutePlayer::Stopped:
+        break;
+    }
+
+    // Location simulation needs the developer disk image, like Apply
+    m_playRouteButton->setEnabled(false);
+    DevDiskImageHelper *devDiskImageHelper =
+        new DevDiskImageHelper(m_device, this);
+    connect(devDiskImageHelper, &DevDiskImageHelper::mountingCompleted, this,
+            [this, devDiskImageHelper](bool success) {
+                devDiskImageHelper->deleteLater();
+                if (success) {
+                    m_drawRouteButton->setChecked(false);
+                    m_routePlayer->play(m_device);
+                }
+                updateRouteControls();
+            });
+    devDiskImageHelper->start();
+}
+
+void VirtualLocation::onRoutePositionChanged(double latitude, double longitude,
+                                             double distance)
+{
+    if (QQuickItem *map = mapItem()) {
+        QMetaObject::invokeMethod(map, "updatePlaybackPosition",
+                                  Q_ARG(QVariant, latitude),
+                                  Q_ARG(QVariant, longitude));
+    }
+
+    const double length = m_routePlayer->routeLength();
+    m_routeInfoLabel->setText(QString("%1 points, %2 of %3 km")
+                                  .arg(m_route.size())
+                                  .arg(distance / 1000.0, 0, 'f', 2)
+                                  .arg(length / 1000.0, 0, 'f', 2));
+
+    // Leave the slider alone while the user drags it
+    if (!m_routeSlider->isSliderDown() && length > 0) {
+        const QSignalBlocker blocker(m_routeSlider);
+        m_routeSlider->setValue(qRound(distance / length * ROUTE_SLIDER_STEPS));
+    }
+}
+
+void VirtualLocation::onRouteSliderValueChanged(int value)
+{
+    // Seeking sends a location, only do that once the drag ends
+    if (m_routeSlider->isSliderDown()) {
+        return;
+    }
+    m_routePlayer->seek(m_routePlayer->routeLength() * value /
+                        ROUTE_SLIDER_STEPS);
+}
+
+void VirtualLocation::updateRouteControls()
+{
+    const RoutePlayer::State state = m_routePlayer->state();
+    const bool hasRoute = m_route.size() > 1;
+    const bool drawing = m_drawRouteButton->isChecked();
+
+    m_playRouteButton->setText(state == RoutePlayer::Playing ? "Pause"
+                                                             : "Play");
+    m_playRouteButton->setEnabled(hasRoute && !drawing);
+    m_stopRouteButton->setEnabled(state != RoutePlayer::Stopped);
+    m_routeSlider->setEnabled(hasRoute && !drawing);
+    m_loadRouteButton->setEnabled(state == RoutePlayer::Stopped);
+    m_drawRouteButton->setEnabled(state == RoutePlayer::Stopped);
+    m_clearRouteButton->setEnabled(state == RoutePlayer::Stopped &&
+                                   !m_route.isEmpty());
+
+    if (state == RoutePlayer::Stopped) {
+        m_routeInfoLabel->setText(
+            m_route.isEmpty()
+                ? QString("No route loaded")
+                : QString("%1 points, %2 km")
+                      .arg(m_route.size())
+                      .arg(m_routePlayer->routeLength() / 1000.0, 0, 'f', 2));
+    }
+}
@@ -22,14 +22,25 @@
 
 #include "devdiskimagehelper.h"
 #include "iDescriptor.h"
+#include "routeplayer.h"
+#include <QDoubleSpinBox>
+#include <QGeoCoordinate>
 #include <QGroupBox>
+#include <QLabel>
 #include <QLineEdit>
 #include <QPushButton>
 #include <QQuickWidget>
+#include <QSlider>
+#include <QSpinBox>
 #include <QTimer>
 #include <QVBoxLayout>
 #include <QWidget>
 
+class QQuickItem;
+
+// Resolution of the route position slider
+#define ROUTE_SLIDER_STEPS 1000
+
 class VirtualLocation : public QWidget
 {
     Q_OBJECT
@@ -43,6 +54,8 @@ signals:
 
 public slots:
     void updateInputsFromMap(double latitude, double longitude);
+    // Called from QML for every click while drawing a route
+    void addRoutePointFromMap(double latitude, double longitude);
 
 private slots:
     void onQuickWidgetStatusChanged(QQuickWidget::Status status);
@@ -51,8 +64,19 @@ private slots:
     void onApplyClicked();
     void updateMapFromInputs();
     void onRecentLocationClicked(double latitude, double longitude);
+    void onLoadRouteClicked();
+    void onDrawRouteToggled(bool drawing);
+    void onClearRouteClicked();
+    void onPlayRouteClicked();
+    void onRoutePositionChanged(double latitude, double longitude,
+                                double distance);
+    void onRouteSliderValueChanged(int value);
+    void updateRouteControls();
 
 private:
+    void setupRoutePlayback(QVBoxLayout *layout);
+    void setRoute(const QList<QGeoCoordinate> &route);
+    QQuickItem *mapItem() const;
     void loadRecentLocations(QVBoxLayout *layout);
     void refreshRecentLocations();
     void addLocationButtons(QLayout *layout,
@@ -67,6 +91,18 @@ private:
     iDescriptorDevice *m_device;
     QVBoxLayout *m_rightLayout = nullptr;
     QGroupBox *m_recentGroup = nullptr;
+
+    RoutePlayer *m_routePlayer = nullptr;
+    QList<QGeoCoordinate> m_route;
+    QPushButton *m_loadRouteButton;
+    QPushButton *m_drawRouteButton;
+    QPushButton *m_clearRouteButton;
+    QPushButton *m_playRouteButton;
+    QPushButton *m_stopRouteButton;
+    QDoubleSpinBox *m_speedSpinBox;
+    QSpinBox *m_rateSpinBox;
+    QSlider *m_routeSlider;
+    QLabel *m_routeInfoLabel;
 };
 
 #endif // VIRTUAL_LOCATION_H
\ No newline at end of file